@@ -0,0 +1,22 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include "config.h"
+#include "globals.h"
+
+// On-target microbenchmarks for the pure logic paths
+// Build with -DRUN_BENCHMARKS=1: after setup each function runs
+// BENCHMARK_ROUNDS x BENCHMARK_ITERATIONS times and the median round is
+// reported as ns/op on Serial ("BENCH <name> <ns/op>") and as a "benchmark"
+// telemetry event tagged with the build stamp, so the numbers can be
+// compared from build to build in the hub's message history.
+
+#ifndef RUN_BENCHMARKS
+#define RUN_BENCHMARKS 0
+#endif
+#define BENCHMARK_ITERATIONS 1000
+#define BENCHMARK_ROUNDS 5 // Median of these; odd
+
+void runBenchmarks();
+
+#endif
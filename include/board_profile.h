@@ -0,0 +1,113 @@
+#ifndef BOARD_PROFILE_H
+#define BOARD_PROFILE_H
+
+#include <stdint.h>
+
+// Board profiles
+// Everything that changes when the feeder is built on different hardware
+// (wiring, LCD backpack, hopper and bowl geometry, load cell) lives in one
+// constexpr BoardProfile. The active profile is chosen at build time with
+// -DBOARD_PROFILE=<name> in platformio.ini; config.h exposes its fields as
+// typed constants, so they fold into immediates exactly like the old macros.
+// A new board is a new profile below, not a source fork.
+
+struct BoardProfile
+{
+  // GPIO wiring
+  uint8_t powerPin;
+  uint8_t button1Pin;
+  uint8_t button2Pin;
+  uint8_t ultrasonicEchoPin;
+  uint8_t ultrasonicTrigPin;
+  uint8_t pirPin;
+  uint8_t hx711DoutPin;
+  uint8_t hx711SckPin;
+  uint8_t redPin;
+  uint8_t greenPin;
+  uint8_t bluePin;
+  uint8_t buzzerPin;
+  uint8_t servoPin;
+  uint8_t rtcIoPin;
+  uint8_t rtcSclkPin;
+  uint8_t rtcCePin;
+
+  // I2C LCD backpack
+  uint8_t lcdAddress;
+  uint8_t lcdColumns;
+  uint8_t lcdRows;
+
+  // Hopper geometry: ultrasonic distance to the food surface (cm)
+  float foodFullDistance;
+  float foodHalfDistance;
+  float foodEmptyDistance;
+  float hopperGramsPerCm; // Starting point; refined from measured dispenses
+
+  // Bowl weight thresholds (grams)
+  float emptyBowlThreshold;
+  float fullBowlThreshold;
+
+  // HX711 counts per gram for this load cell
+  long calibrationFactor;
+};
+
+// Original breadboard build on an ESP32 DevKit V1
+constexpr BoardProfile ESP32_DEVKIT_V1 = {
+    27, 15, 0, 33, 32, 25, 5, 23, 13, 12, 14, 26, 4, 16, 17, 2, // Pins
+    0x27, 16, 2,                                                // LCD
+    9.0f, 13.5f, 18.0f, 48.0f,                                  // Hopper (cm, g/cm)
+    10.0f, 200.0f,                                              // Bowl (g)
+    49400,                                                      // Load cell
+};
+
+#ifndef BOARD_PROFILE
+#define BOARD_PROFILE ESP32_DEVKIT_V1
+#endif
+
+constexpr BoardProfile activeBoard = BOARD_PROFILE;
+
+// Compile-time checks (C++11 constexpr, hence the recursion)
+constexpr uint8_t boardPins[] = {
+    activeBoard.powerPin, activeBoard.button1Pin, activeBoard.button2Pin,
+    activeBoard.ultrasonicEchoPin, activeBoard.ultrasonicTrigPin, activeBoard.pirPin,
+    activeBoard.hx711DoutPin, activeBoard.hx711SckPin, activeBoard.redPin,
+    activeBoard.greenPin, activeBoard.bluePin, activeBoard.buzzerPin,
+    activeBoard.servoPin, activeBoard.rtcIoPin, activeBoard.rtcSclkPin,
+    activeBoard.rtcCePin};
+
+constexpr bool pinUsedFrom(const uint8_t *pins, int count, uint8_t pin, int from)
+{
+  return from < count && (pins[from] == pin || pinUsedFrom(pins, count, pin, from + 1));
+}
+
+constexpr bool pinsUnique(const uint8_t *pins, int count, int index = 0)
+{
+  return index >= count ||
+         (!pinUsedFrom(pins, count, pins[index], index + 1) && pinsUnique(pins, count, index + 1));
+}
+
+// GPIO 34-39 have no output driver on the ESP32
+constexpr bool canDrive(uint8_t pin)
+{
+  return pin < 34;
+}
+
+static_assert(pinsUnique(boardPins, sizeof(boardPins) / sizeof(boardPins[0])),
+              "Board profile assigns the same GPIO twice");
+static_assert(canDrive(activeBoard.ultrasonicTrigPin) && canDrive(activeBoard.hx711SckPin) &&
+                  canDrive(activeBoard.redPin) && canDrive(activeBoard.greenPin) &&
+                  canDrive(activeBoard.bluePin) && canDrive(activeBoard.buzzerPin) &&
+                  canDrive(activeBoard.servoPin) && canDrive(activeBoard.rtcIoPin) &&
+                  canDrive(activeBoard.rtcSclkPin) && canDrive(activeBoard.rtcCePin),
+              "Board profile puts an output on an input-only GPIO");
+static_assert(activeBoard.foodFullDistance < activeBoard.foodHalfDistance &&
+                  activeBoard.foodHalfDistance < activeBoard.foodEmptyDistance,
+              "Hopper distances must be ordered full < half < empty");
+static_assert(activeBoard.hopperGramsPerCm > 0, "Hopper grams per cm must be positive");
+static_assert(activeBoard.emptyBowlThreshold >= 0 &&
+                  activeBoard.emptyBowlThreshold < activeBoard.fullBowlThreshold,
+              "Bowl thresholds must be ordered empty < full");
+static_assert(activeBoard.calibrationFactor != 0, "Load cell calibration factor cannot be zero");
+static_assert(activeBoard.lcdColumns >= 16 && activeBoard.lcdRows >= 2,
+              "Display layout needs at least a 16x2 LCD");
+
+#endif
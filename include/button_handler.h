@@ -4,12 +4,67 @@
 #include "config.h"
 #include "globals.h"
 #include "display_manager.h" // Add this line for buzzerBeepWithLED and setRGBColor
-#include "feeding_control.h" // Add this line for canDispenseFood and recordFoodDispensing
+#include "feeding_control.h" // Add this line for beginDispense and requestFeed
+#include "button_handler_core.h"
 
+// Interrupt-driven buttons with gestures
+// Both buttons interrupt on every edge; the ISR timestamps the edge (micros)
+// into a ring and wakes the button task, which runs above the loop task on
+// the same core. The task debounces (the first edge is taken at once, then
+// the pin is ignored for DEBOUNCE_DELAY and re-read when that ends), turns
+// the clean edges into gestures and commits the mapped action right away:
+//   Button 1: press = feed; held, another feed after BUTTON_LONG_MS and then
+//             every BUTTON_REPEAT_MS
+//   Button 2: click = auto feeding on/off, double click = refill mode,
+//             long press = tare the empty bowl
+// A feed the policy admits right away starts its servo motion on the task;
+// the loop then does the rest of the dispense bookkeeping. Any other feed
+// goes through the feed queue. Toggles only flip a flag. The LCD, the beep
+// and the tare itself happen in handleButtons() on the loop. Latency is
+// measured from the deciding edge (or gesture deadline) to when the action
+// takes effect: toggles and direct feeds at once on the task, the tare when
+// the loop has run it. Presses that wait on a running dispense or the
+// cooldown are counted as deferred and record no latency, and neither do
+// refused or rejected feeds.
+
+#define BUTTON_COUNT 2
+#define BUTTON_EDGE_RING 16              // Power of 2
+#define BUTTON_NOTICE_RING 8             // Task -> loop; power of 2
+#define BUTTON_LONG_MS 1500              // Hold before LONG (and before repeats start)
+#define BUTTON_TARE_HOLD_MS 3000         // Button 2 must be held this long to tare
+#define BUTTON_DOUBLE_MS 300             // Second click must start within this
+#define BUTTON_REPEAT_MS 2000            // Hold-to-repeat period
+#define BUTTON_LATENCY_BUDGET_US 20000
+#define BUTTON_MESSAGE_MS 1500           // LCD feedback stays up this long
+#define BUTTON_TASK_PRIORITY 2           // Above the loop task (1)
+#define BUTTON_TASK_STACK 4096            // Builds the dispense segments on its stack
+
+enum ButtonAction : uint8_t
+{
+  BUTTON_ACTION_NONE,
+  BUTTON_ACTION_FEED,
+  BUTTON_ACTION_AUTO_FEED,
+  BUTTON_ACTION_REFILL,
+  BUTTON_ACTION_TARE
+};
+
+struct ButtonStats
+{
+  unsigned long edges = 0;
+  unsigned long bounces = 0;      // Edges inside the debounce window
+  unsigned long overflows = 0;    // ISR found the ring full
+  unsigned long actions = 0;      // Took effect; the latency fields cover these
+  unsigned long deferred = 0;     // Feeds left to the queue behind a dispense or the cooldown
+  unsigned long overBudget = 0;   // Actions later than BUTTON_LATENCY_BUDGET_US
+  uint32_t lastLatencyUs = 0;
+  uint32_t maxLatencyUs = 0;
+  uint32_t totalLatencyUs = 0;
+};
+
+// Firmware glue
 void initButtons();
-void handleButtons();
-// void handleButton(bool &currentButton, bool &lastButton, bool &buttonState,
-//                   unsigned long &lastPress, unsigned long currentMillis, void (*onPress)());
-void button1Action();
-void button2Action();
-#endif
\ No newline at end of file
+void handleButtons(); // Loop side: feedback and the tare
+const ButtonStats &getButtonStats();
+const char *getButtonActionName(uint8_t action);
+bool performManualFeed(); // Queued manual feed; false if a dispense is running
+#endif
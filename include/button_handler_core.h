@@ -0,0 +1,40 @@
+#ifndef BUTTON_HANDLER_CORE_H
+#define BUTTON_HANDLER_CORE_H
+
+#include <stdint.h>
+
+// Gesture recognizer behind button_handler.h, with no Arduino dependencies
+// so it builds in the native test environment. Times are micros() and only
+// compared by difference, so they may wrap.
+
+enum ButtonGesture : uint8_t
+{
+  GESTURE_NONE,
+  GESTURE_PRESS,  // Every debounced press, before anything else is known
+  GESTURE_CLICK,  // Released before longMs (after doubleMs if double clicks are on)
+  GESTURE_DOUBLE, // Two clicks within doubleMs
+  GESTURE_LONG,   // Held for longMs
+  GESTURE_REPEAT, // Still held, every repeatMs after LONG
+  GESTURE_COUNT
+};
+
+struct GestureTracker
+{
+  // Configuration
+  uint32_t longUs;
+  uint32_t doubleUs;  // 0 = report CLICK on release
+  uint32_t repeatUs;  // 0 = no REPEAT
+
+  bool pressed;
+  bool held;          // LONG already reported for this press
+  uint8_t clicks;     // Waiting for a possible second click
+  uint32_t pressedAt;
+  uint32_t releasedAt;
+  uint32_t nextRepeatAt;
+};
+
+ButtonGesture gestureOnEdge(GestureTracker &tracker, bool pressed, uint32_t nowUs);
+ButtonGesture gestureOnTime(GestureTracker &tracker, uint32_t nowUs, uint32_t &decidedUs);
+bool gestureNextDeadline(const GestureTracker &tracker, uint32_t &deadlineUs); // False = none pending
+
+#endif
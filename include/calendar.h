@@ -0,0 +1,35 @@
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include "config.h"
+#include "globals.h"
+#include "calendar_core.h"
+
+// Calendar and timezone engine
+// The DS1302 holds UTC, disciplined from NTP. Local time is derived with a
+// POSIX TZ rule ("PHT-8", "CET-1CEST,M3.5.0,M10.5.0/3") and all arithmetic is
+// done on Unix seconds with closed-form day/civil conversions: O(1), no heap,
+// valid for 1970-2105.
+
+#define CALENDAR_NVS_NAMESPACE "calendar"
+#define TZ_STRING_MAX 48
+#define RTC_DISCIPLINE_INTERVAL 3600000 // Compare RTC against NTP hourly
+#define RTC_MAX_DRIFT_S 2               // Rewrite the RTC beyond this
+
+// Conversions on RtcDateTime (pure ones on Unix seconds are in calendar_core.h)
+uint32_t unixFromRtc(const RtcDateTime &dt);
+RtcDateTime rtcFromUnix(uint32_t unixSeconds);
+uint32_t unixFromLocal(uint32_t localSeconds); // Local wall clock seconds to UTC
+
+void setupCalendar();
+bool setTimeZone(const char *tz);
+const char *getTimeZone();
+int32_t getUtcOffset(uint32_t unixUtc); // Configured zone, seconds east of UTC
+uint32_t currentEpoch();                // Unix UTC from NTP or the RTC; 0 = clock unknown
+RtcDateTime toLocalTime(const RtcDateTime &utc);
+RtcDateTime getLocalDateTime(); // RTC (UTC) converted to the configured zone
+void syncRtcFromSystemClock(bool force);
+void handleRtcDiscipline();
+int handleTimeZoneMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef CALENDAR_CORE_H
+#define CALENDAR_CORE_H
+
+#include <stdint.h>
+
+// Pure half of the calendar engine (calendar.h): civil/Unix conversions and
+// POSIX TZ rules, with no Arduino dependencies so they build in the native
+// test environment.
+
+#define TZ_NAME_MAX 8
+#define SECONDS_PER_DAY 86400UL
+#define MINUTES_PER_DAY 1440
+#define UNIX_EPOCH_2000 946684800UL // RtcDateTime counts from 2000-01-01
+
+struct CivilTime
+{
+  uint16_t year;
+  uint8_t month;   // 1-12
+  uint8_t day;     // 1-31
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t weekday; // 0 = Sunday
+};
+
+// "Mm.w.d/time": day d (0 = Sunday) of week w (5 = last) of month m
+struct TzTransition
+{
+  uint8_t month;
+  uint8_t week;
+  uint8_t weekday;
+  int32_t timeOfDay; // Seconds after local midnight
+};
+
+struct TimeZoneRule
+{
+  char stdName[TZ_NAME_MAX];
+  char dstName[TZ_NAME_MAX];
+  int32_t stdOffset; // Seconds east of UTC
+  int32_t dstOffset;
+  bool hasDst;
+  TzTransition dstStart; // In standard time
+  TzTransition dstEnd;   // In daylight time
+};
+
+constexpr bool isLeapYear(int year)
+{
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+constexpr uint8_t DAYS_IN_MONTH[2][12] = {
+    {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
+    {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}};
+
+constexpr uint8_t daysInMonth(int year, int month)
+{
+  return DAYS_IN_MONTH[isLeapYear(year) ? 1 : 0][month - 1];
+}
+
+// Pure conversions
+int32_t daysFromCivil(int year, unsigned month, unsigned day); // Days since 1970-01-01
+CivilTime civilFromUnix(uint32_t unixSeconds);
+uint32_t unixFromCivil(const CivilTime &civil);
+bool parsePosixTz(const char *tz, TimeZoneRule &rule); // False leaves 'rule' unspecified
+int32_t utcOffsetAt(const TimeZoneRule &rule, uint32_t unixUtc);
+// Local wall clock seconds to UTC. A time repeated when DST ends resolves to
+// its first (daylight) occurrence; one skipped when it starts is moved
+// forward by the gap, as the clock would read had it not jumped
+uint32_t utcFromLocal(const TimeZoneRule &rule, uint32_t localSeconds);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "config.h"
+#include "globals.h"
+
+// Load-cell calibration persisted in NVS
+// Model: raw = offset + scale * grams. Points collected with known weights are
+// fitted by ordinary least squares (closed-form normal equations). Zero drift
+// is tracked while the bowl is empty and undisturbed, so no re-tare is needed
+// at boot; the stored calibration is applied and only sanity-checked.
+// Undisturbed means DRIFT_TRACK_SETTLE_MS after the last dispense and the last
+// motion, and at most DRIFT_TRACK_DAILY_MAX_GRAMS is absorbed per day, so a few
+// grams of leftovers are not slowly tared away.
+
+#define CALIBRATION_NVS_NAMESPACE "calib"
+#define CALIBRATION_VERSION 1
+#define CALIBRATION_MAX_POINTS 8
+#define CALIBRATION_POINT_READINGS 10     // Averaged raw readings per point
+#define CALIBRATION_CHECK_READINGS 3      // Boot stability check (~300 ms at 10 SPS)
+#define CALIBRATION_STABLE_GRAMS 2.0      // Max spread of the boot check readings
+#define CALIBRATION_ZERO_TOLERANCE 5.0    // Boot reading below -this means the zero moved
+#define DRIFT_TRACK_WINDOW_GRAMS 3.0      // Only readings this close to zero are drift
+#define DRIFT_TRACK_STABLE_SAMPLES 10     // Consecutive quiet readings before tracking
+#define DRIFT_TRACK_STABLE_GRAMS 0.3      // Max step between quiet readings
+#define DRIFT_TRACK_ALPHA 0.02            // EWMA weight of each drift correction
+#define DRIFT_TRACK_SETTLE_MS 1800000     // No dispense or pet motion for this long first
+#define DRIFT_TRACK_DAILY_MAX_GRAMS 1.0   // Correction cap per day; leftover kibble is not drift
+#define DRIFT_SAVE_GRAMS 0.5              // Persist once the zero has moved this much
+#define DRIFT_SAVE_INTERVAL 3600000       // ...and at most once an hour (flash wear)
+
+struct CalibrationData
+{
+  uint16_t version;
+  uint8_t pointCount;  // Points used by the last fit (0 = single-factor default)
+  uint8_t reserved;
+  int32_t offset;      // Raw counts at zero grams (includes tracked drift)
+  float scale;         // Raw counts per gram
+  float residualRms;   // Fit quality in grams
+  float driftTotal;    // Cumulative zero drift absorbed since the last fit, grams
+};
+
+struct CalibrationStatus
+{
+  bool loaded = false;    // Came from NVS rather than a first-boot tare
+  bool validated = false; // Passed the boot stability check
+  float bootSpread = 0.0; // Spread of the boot check readings, grams
+  int pendingPoints = 0;
+};
+
+// Pure least-squares fit of raw = offset + scale * grams
+bool fitCalibration(const float *grams, const double *raw, int count,
+                    int32_t &offset, float &scale, float &residualRms);
+
+void setupCalibration();
+void trackCalibrationDrift(float weight);
+bool tareScale(); // Empty bowl reads zero from now on; false if the HX711 is not ready
+int handleCalibrationMethod(byte *payload, unsigned int length, String &responsePayload);
+const CalibrationData &getCalibration();
+const CalibrationStatus &getCalibrationStatus();
+
+#endif
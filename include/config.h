@@ -6,6 +6,11 @@
 #include <ThreeWire.h>
 #include <RtcDS1302.h>
 #include "secrets.h"
+#include "board_profile.h"
+#include "sensor_manager_core.h" // Sensor enums and thresholds
+#include "network_manager_core.h" // MQTT reconnect backoff limits and interval
+#include "sampling_policy_core.h" // Sensor read rates
+
 // WiFi Configuration
 #define WIFI_SSID ENV_WIFI_SSID
 #define WIFI_PASSWORD ENV_WIFI_PASSWORD
@@ -13,79 +18,92 @@
 
 // Device Configuration
 #define DEVICE_NAME "PetFeeder_001"
-
-// Pin Definitions
-#define POWER_PIN 27
-#define BUTTON1_PIN 15
-#define BUTTON2_PIN 0
-#define ULTRASONIC_ECHO_PIN 33
-#define ULTRASONIC_TRIG_PIN 32
-#define PIR_PIN 25
-#define HX711_DOUT_PIN 5
-#define HX711_SCK_PIN 23
-#define RED_PIN 13
-#define GREEN_PIN 12
-#define BLUE_PIN 14
-#define BUZZER_PIN 26
-#define SERVO_PIN 4
+#ifndef TIMEZONE
+#define TIMEZONE "PHT-8" // POSIX TZ; can be changed at runtime with the "timezone" method
+#endif
+
+// Pin Definitions (from the active board profile)
+constexpr uint8_t POWER_PIN = activeBoard.powerPin;
+constexpr uint8_t BUTTON1_PIN = activeBoard.button1Pin;
+constexpr uint8_t BUTTON2_PIN = activeBoard.button2Pin;
+constexpr uint8_t ULTRASONIC_ECHO_PIN = activeBoard.ultrasonicEchoPin;
+constexpr uint8_t ULTRASONIC_TRIG_PIN = activeBoard.ultrasonicTrigPin;
+constexpr uint8_t PIR_PIN = activeBoard.pirPin;
+constexpr uint8_t HX711_DOUT_PIN = activeBoard.hx711DoutPin;
+constexpr uint8_t HX711_SCK_PIN = activeBoard.hx711SckPin;
+constexpr uint8_t RED_PIN = activeBoard.redPin;
+constexpr uint8_t GREEN_PIN = activeBoard.greenPin;
+constexpr uint8_t BLUE_PIN = activeBoard.bluePin;
+constexpr uint8_t BUZZER_PIN = activeBoard.buzzerPin;
+constexpr uint8_t SERVO_PIN = activeBoard.servoPin;
 
 // DS1302 RTC Module Pins
-#define RTC_IO 16
-#define RTC_SCLK 17
-#define RTC_CE 2
+constexpr uint8_t RTC_IO = activeBoard.rtcIoPin;
+constexpr uint8_t RTC_SCLK = activeBoard.rtcSclkPin;
+constexpr uint8_t RTC_CE = activeBoard.rtcCePin;
 
 // LCD Configuration
-#define LCD_ADDRESS 0x27
-#define LCD_COLUMNS 16
-#define LCD_ROWS 2
+constexpr uint8_t LCD_ADDRESS = activeBoard.lcdAddress;
+constexpr uint8_t LCD_COLUMNS = activeBoard.lcdColumns;
+constexpr uint8_t LCD_ROWS = activeBoard.lcdRows;
 
 // Timing Intervals (in milliseconds)
-#define ULTRASONIC_READ_INTERVAL 200
-#define WEIGHT_READ_INTERVAL 500
-#define RTC_READ_INTERVAL 5000
-#define LCD_UPDATE_INTERVAL 400
-#define DATA_SYNC_INTERVAL 30000
-#define DISPENSE_TIME 1000
-#define MIN_FEEDING_INTERVAL 300000 // 5 minutes
-#define PIR_TIMEOUT 30000           // 30 seconds
-#define DEBOUNCE_DELAY 50
-
-// Sensor Thresholds
-#define FOOD_FULL_DISTANCE 9.0    // cm
-#define FOOD_HALF_DISTANCE 13.5   // cm
-#define FOOD_EMPTY_DISTANCE 18.0  // cm
-#define EMPTY_BOWL_THRESHOLD 10.0 // grams
-#define FULL_BOWL_THRESHOLD 200.0 // grams
-#define SCALE_READINGS 3          // Increased for better stability
+// Sensor reads follow the sampling policy; the old fixed rates it is
+// compared against are in sampling_policy_core.h
+constexpr unsigned long RTC_READ_INTERVAL = 5000;
+constexpr unsigned long LCD_UPDATE_INTERVAL = 400;
+constexpr unsigned long DATA_SYNC_INTERVAL = 30000;
+constexpr unsigned long DISPENSE_TIMEOUT_MARGIN = 2000; // Beyond the pattern duration before the servo is forced to rest
+constexpr unsigned long FEED_COMPLETE_DISPLAY_MS = 1500;
+constexpr unsigned long MIN_FEEDING_INTERVAL = 300000; // 5 minutes
+constexpr unsigned long DEBOUNCE_DELAY = 50; // Button lockout after an accepted edge
+
+// Report-on-change Telemetry
+constexpr float REPORT_WEIGHT_DEADBAND = 2.0;                // grams
+constexpr unsigned long REPORT_MIN_INTERVAL = 2000;          // Rate limit for change-triggered reports
+constexpr unsigned long REPORT_HEARTBEAT_INTERVAL = 600000;  // 10 minutes when nothing changes
 
 // Food Management
-#define FOOD_PORTION_GRAMS 25.0
-#define MAX_DAILY_FOOD 200.0 // grams per day
+constexpr float FOOD_PORTION_GRAMS = 25.0;
+constexpr float MAX_DAILY_FOOD = 200.0; // grams per day
 
 // Feeding Times (in minutes from midnight)
-#define FEEDING_TIME_1 480  // 8:00 AM
-#define FEEDING_TIME_2 720  // 12:00 PM
-#define FEEDING_TIME_3 1080 // 6:00 PM
-#define FEEDING_TIME_4 1320 // 10:00 PM
-
-// RGB Color Definitions
-#define RGB_OFF "OFF"
-#define RGB_RED "RED"
-#define RGB_GREEN "GREEN"
-#define RGB_BLUE "BLUE"
-#define RGB_YELLOW "YELLOW"
-#define RGB_PURPLE "PURPLE"
-#define RGB_WHITE "WHITE"
-
-// Food Level Definitions
-#define FOOD_LEVEL_FULL "FULL"
-#define FOOD_LEVEL_HALF "HALF"
-#define FOOD_LEVEL_EMPTY "EMPTY"
-
-// Bowl Status Definitions
-#define BOWL_STATUS_EMPTY "EMPTY"
-#define BOWL_STATUS_PARTIAL "PARTIAL"
-#define BOWL_STATUS_FULL "FULL"
+constexpr int FEEDING_TIME_1 = 480;  // 8:00 AM
+constexpr int FEEDING_TIME_2 = 720;  // 12:00 PM
+constexpr int FEEDING_TIME_3 = 1080; // 6:00 PM
+constexpr int FEEDING_TIME_4 = 1320; // 10:00 PM
+
+// Load Cell Configuration (SCALE_READINGS is with the sampling rates)
+constexpr long CALIBRATION_FACTOR = activeBoard.calibrationFactor;
+
+static_assert(REPORT_MIN_INTERVAL < REPORT_HEARTBEAT_INTERVAL,
+              "Change reports must be rate limited below the heartbeat");
+static_assert(FEEDING_TIME_1 < FEEDING_TIME_2 && FEEDING_TIME_2 < FEEDING_TIME_3 &&
+                  FEEDING_TIME_3 < FEEDING_TIME_4 && FEEDING_TIME_4 < 24 * 60,
+              "Feeding times must be ascending minutes within one day");
+static_assert(FOOD_PORTION_GRAMS > 0 && FOOD_PORTION_GRAMS <= MAX_DAILY_FOOD,
+              "Portion must fit within the daily limit");
+static_assert(SCALE_READINGS > 0, "Scale needs at least one reading per sample");
+
+// RGB Color IDs (PWM values live in indicator.cpp)
+enum RgbColor : uint8_t
+{
+  RGB_OFF,
+  RGB_RED,
+  RGB_GREEN,
+  RGB_BLUE,
+  RGB_YELLOW,
+  RGB_PURPLE,
+  RGB_WHITE,
+  RGB_COLOR_COUNT,
+  RGB_UNCHANGED = 0xFF // Pattern step leaves the LED as it is
+};
+#define RGB_DEFAULT_BRIGHTNESS 255
+#define RGB_PWM_FREQUENCY 5000
+#define RGB_PWM_RESOLUTION 8
+#define BUZZER_PWM_FREQUENCY 2000
+#define BUZZER_ON_DUTY 255 // Active buzzer: fully on
+#define INDICATOR_TICK_US 5000
 
 // Buzzer Patterns
 #define BUZZER_PATTERN_SINGLE 1
@@ -102,15 +120,51 @@
 #define MQTT_PORT ENV_MQTT_PORT
 #define DEVICE_ID ENV_DEVICE_ID
 #define SAS_TOKEN ENV_SAS_TOKEN
+#ifdef ENV_SAS_KEY
+#define SAS_KEY ENV_SAS_KEY // Device key; tokens are then generated on the device
+#else
+#define SAS_KEY ""
+#endif
 #define MQTT_USERNAME ENV_MQTT_USERNAME
-#define DATABASE_ENDPOINT ENV_DATABASE_ENDPOINT
+constexpr char DATABASE_STATUS_URL[] = "https://petfeeder-embedded.azurewebsites.net/api/devices/status";
 
 // MQTT Buffer Size
 #define MQTT_BUFFER_SIZE 1024
 
-// Load Cell Configuration
-#define CALIBRATION_FACTOR 49400 // Match the calibration factor from working code
-#define SCALE_READINGS 3         // Increased for better stability
+// Upstream transport (set ENV_MQTT_USE_TLS to 0 to point at a plain local
+// mosquitto standing in for the hub)
+#ifdef ENV_MQTT_USE_TLS
+#define MQTT_USE_TLS ENV_MQTT_USE_TLS
+#else
+#define MQTT_USE_TLS 1
+#endif
+
+// Network Role (select per build environment in platformio.ini)
+#define FEEDER_ROLE_DIRECT 0  // Own TLS session to Azure IoT Hub
+#define FEEDER_ROLE_LEAF 1    // Compact telemetry to the local broker only
+#define FEEDER_ROLE_GATEWAY 2 // Bridges the local broker to Azure IoT Hub
+#ifndef FEEDER_ROLE
+#define FEEDER_ROLE FEEDER_ROLE_DIRECT
+#endif
+
+// Local Gateway Configuration
+#ifdef ENV_LOCAL_BROKER_HOST
+#define LOCAL_BROKER_HOST ENV_LOCAL_BROKER_HOST
+#define LOCAL_BROKER_PORT ENV_LOCAL_BROKER_PORT
+#else
+#define LOCAL_BROKER_HOST "mosquitto.local"
+#define LOCAL_BROKER_PORT 1883
+#endif
+#define LOCAL_TOPIC_ROOT "petfeeder"
+#define FEEDER_ID_MAX 32 // Leaf ids: [A-Za-z0-9_-], at most this long
+#define LOCAL_RECONNECT_INTERVAL 5000
+#define GATEWAY_BATCH_INTERVAL 10000 // Upstream flush period
+#define GATEWAY_MAX_FEEDERS 64       // Distinct leaves tracked for stats/routing
+#define GATEWAY_STATS_INTERVAL 60000
+#define GATEWAY_LEAF_MAX_BYTES 384   // Larger leaf messages are dropped, not batched
+#ifndef LEAF_VIRTUAL_FEEDERS
+#define LEAF_VIRTUAL_FEEDERS 1 // >1 makes one leaf simulate N feeders (load test)
+#endif
 
 // Utility Macros
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
@@ -135,37 +189,17 @@ struct SystemState
   bool mqttConnected = false;
 };
 
-struct ButtonState
-{
-  bool button1 = false;
-  bool button2 = false;
-  bool lastButton1 = false;
-  bool lastButton2 = false;
-  bool manualFeedInProgress = false; // Add this field for manual feeding tracking
-};
-
 struct SensorData
 {
-  float distance;
-  float weight;
-  bool motionDetected;
-  char foodLevel[10];     // Use char array instead of String
-  char bowlStatus[10];    // Use char array instead of String
-  char feedingStatus[25]; // Use char array instead of String
-  float dailyFoodDispensed;
-  float totalFoodDispensed;
-
-  // Constructor to initialize the values
-  SensorData() : distance(0.0),
-                 weight(0.0),
-                 motionDetected(false),
-                 dailyFoodDispensed(0.0),
-                 totalFoodDispensed(0.0)
-  {
-    strcpy(foodLevel, FOOD_LEVEL_EMPTY);
-    strcpy(bowlStatus, BOWL_STATUS_EMPTY);
-    strcpy(feedingStatus, "Ready");
-  }
+  float distance = 0.0;
+  float weight = 0.0;
+  float dailyFoodDispensed = 0.0;
+  float totalFoodDispensed = 0.0;
+  FoodLevel foodLevel = FOOD_LEVEL_EMPTY;
+  BowlStatus bowlStatus = BOWL_STATUS_EMPTY;
+  FeedingStatus feedingStatus = FEEDING_STATUS_READY;
+  bool motionDetected = false;
+  uint8_t changes = 0; // SensorChange bits; markReportSent() clears them
 };
 
 struct Timing
@@ -175,10 +209,9 @@ struct Timing
   unsigned long lastRTCRead = 0;
   unsigned long lastLCDUpdate = 0;
   unsigned long lastDataSync = 0;
+  unsigned long lastCommandCheck = 0;
   unsigned long lastFeedingTime = 0;
   unsigned long lastMotionTime = 0;
-  unsigned long lastButton1Press = 0;
-  unsigned long lastButton2Press = 0;
   unsigned long dispenseStartTime = 0;
   unsigned long lastMQTTReconnect = 0;
 };
@@ -198,28 +231,25 @@ struct TimeData
   }
 };
 
+// Hub connection settings; constant, so they stay in flash (the SAS token
+// is generated and held by sas_token.cpp)
 struct IoTHubConfig
 {
-  char mqttServer[100];
-  int mqttPort;
-  char deviceId[20];
-  char sasToken[300];
-  char mqttUsername[100];
-  char databaseEndpoint[100];
-  char telemetryTopic[100];
-  char methodTopic[50];
+  const char *mqttServer;
+  uint16_t mqttPort;
+  const char *deviceId;
+  const char *mqttUsername;
+  const char *telemetryTopic;
+  const char *methodTopic;
+};
 
-  // Constructor
-  IoTHubConfig() : mqttPort(MQTT_PORT)
-  {
-    strcpy(mqttServer, MQTT_SERVER);
-    strcpy(deviceId, DEVICE_ID);
-    strcpy(sasToken, SAS_TOKEN);
-    strcpy(mqttUsername, MQTT_USERNAME);
-    strcpy(databaseEndpoint, DATABASE_ENDPOINT);
-    snprintf(telemetryTopic, sizeof(telemetryTopic), "devices/%s/messages/events/", DEVICE_ID);
-    strcpy(methodTopic, "$iothub/methods/POST/#");
-  }
+constexpr IoTHubConfig iotHub = {
+    MQTT_SERVER,
+    MQTT_PORT,
+    DEVICE_ID,
+    MQTT_USERNAME,
+    "devices/" DEVICE_ID "/messages/events/",
+    "$iothub/methods/POST/#",
 };
 
 #endif
\ No newline at end of file
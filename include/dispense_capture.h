@@ -0,0 +1,95 @@
+#ifndef DISPENSE_CAPTURE_H
+#define DISPENSE_CAPTURE_H
+
+#include "config.h"
+#include "globals.h"
+
+// Dispense capture, oscilloscope style
+// A sampler task reads every HX711 conversion as it arrives (10 or 80 SPS,
+// set by the board's RATE pin) together with the commanded servo angle into
+// a ring that is overwritten all the time. Each dispense marks a window from
+// preMs before it starts to postMs after it finishes; once the window has
+// passed the loop writes it from the ring to one of CAPTURE_FILE_COUNT files
+// on LittleFS, replacing the oldest. The sampler keeps running meanwhile -
+// CAPTURE_SAVE_MARGIN samples of the ring are never part of a window, so it
+// cannot lap one before the loop has saved it.
+// The sampler is also the only regular reader of the chip: getWeight()
+// averages its latest conversions, and anything else that talks to the HX711
+// directly holds a ScaleLock (load_cell.h).
+//
+// File layout (little endian):
+//   header: CaptureFileHeader below
+//   sample: varint deltaMillis | zigzag varint (raw counts - previous raw counts) | u8 servo angle
+// The first sample's delta is from firstMs, its raw delta is from 0.
+// Varints are unsigned LEB128, as in the trace recorder.
+
+#define CAPTURE_RING_SAMPLES 1024        // 12 bytes each; bounds all capture RAM
+#define CAPTURE_SAVE_MARGIN 128          // Ring samples never inside a window
+#define CAPTURE_MAX_WINDOW (CAPTURE_RING_SAMPLES - CAPTURE_SAVE_MARGIN)
+#define CAPTURE_FILE_COUNT 4
+#define CAPTURE_FILE_MAGIC 0x43444650    // "PFDC"
+#define CAPTURE_FILE_VERSION 1
+#define CAPTURE_NVS_NAMESPACE "capture"
+#define CAPTURE_CONFIG_VERSION 1
+#define CAPTURE_PRE_MS 1000              // Defaults; the "capture" method changes them
+#define CAPTURE_POST_MS 3000
+#define CAPTURE_WINDOW_MAX_MS 10000      // Per side
+#define CAPTURE_STALE_MS 500             // No conversion for this long = scale not ready
+#define CAPTURE_TASK_PRIORITY 2          // Above the loop task (1)
+#define CAPTURE_TASK_STACK 2048
+
+#define CAPTURE_FLAG_TRUNCATED 0x01      // Window cut at CAPTURE_MAX_WINDOW samples
+
+struct CaptureSample
+{
+  uint32_t ms;
+  int32_t raw;
+  uint8_t angle; // Commanded servo angle, degrees
+};
+
+struct CaptureFileHeader
+{
+  uint32_t magic;
+  uint8_t version;
+  uint8_t flags;
+  uint16_t samples;
+  uint16_t startIndex;  // First sample at or after the dispense start
+  uint16_t endIndex;    // First sample after the dispense finished
+  uint32_t number;      // Increases with every capture
+  uint32_t epoch;       // Wall clock at the dispense start (0 = unknown)
+  int32_t firstMs;      // First sample relative to the dispense start
+  uint32_t dispenseMs;
+  int32_t offset;       // Calibration at the time, grams = (raw - offset) / scale
+  float scale;
+};
+
+struct CaptureConfig
+{
+  uint16_t version;
+  uint16_t reserved;
+  uint16_t preMs;
+  uint16_t postMs;
+};
+
+struct CaptureStats
+{
+  unsigned long conversions = 0;
+  unsigned long lockMisses = 0;  // Conversions left to a ScaleLock holder
+  unsigned long captures = 0;
+  unsigned long truncated = 0;
+  unsigned long lost = 0;        // Ring lapped or the file write failed
+  uint16_t periodMs = 0;         // Measured conversion period, 0 = not yet known
+  uint32_t lastBytes = 0;
+};
+
+// Firmware glue
+void setupDispenseCapture(); // Starts the sampler; after setupLoadCell()
+void handleDispenseCapture(); // Loop side: closes and saves windows
+void captureDispenseStarted();
+void captureDispenseFinished();
+bool isScaleSamplerRunning();
+bool getLatestScaleRaw(uint8_t count, long &raw); // Mean of the last conversions; false if stale
+const CaptureStats &getCaptureStats();
+int handleCaptureMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
@@ -4,9 +4,11 @@
 #include "config.h"
 #include "globals.h"
 #include "time_manager.h" // Add this line
+#include "indicator.h"
 
 void updateLCD();
-void setRGBColor(String level);
-void buzzerBeepWithLED(int beeps, int duration, int pause = BUZZER_SHORT_PAUSE, String ledColor = RGB_OFF);
+void showLCDMessage(const char *line1, const char *line2, unsigned long holdMs); // updateLCD() waits it out
+void setRGBColor(RgbColor color, uint8_t brightness = RGB_DEFAULT_BRIGHTNESS);
+void buzzerBeepWithLED(int beeps, int duration, int pause = BUZZER_SHORT_PAUSE, RgbColor ledColor = RGB_OFF);
 void updateFoodLevelLED();
 #endif
\ No newline at end of file
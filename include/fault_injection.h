@@ -0,0 +1,41 @@
+#ifndef FAULT_INJECTION_H
+#define FAULT_INJECTION_H
+
+#include "config.h"
+#include "globals.h"
+#include "fault_injection_core.h"
+
+// Network fault injection and resilience scenarios
+// Build with -DFAULT_INJECTION=1. The MQTT and HTTP call sites consult the
+// active fault before touching the network and, when one is set, block and
+// fail the way the real stack does in that situation (a half-open socket
+// holds a publish for the PubSubClient socket timeout, a rejected key returns
+// CONNACK 4 after the TLS handshake, ...). The scenario runner steps through
+// each fault for FAULT_SCENARIO_MS while generating traffic, and measures what
+// the control loop sees: pass latency, scheduled feeds that would have been
+// missed, and how long a button press waits to be serviced. Each scenario is
+// reported as "FAULT <name> ..." on Serial and fails over budget. The fault
+// models, the runner and the meter are in fault_injection_core.
+
+#ifndef FAULT_INJECTION
+#define FAULT_INJECTION 0
+#endif
+
+#if FAULT_INJECTION
+// Call-site hooks; they take the normal path when no fault is active
+int injectConnectFault();      // MQTT_CONNECTED to proceed, else the state to report
+bool injectPublishFault();     // False if the publish must fail
+void injectReadFault();        // Before mqttClient.loop()
+int injectHttpFault();         // 0 to proceed, else an HTTPC_ERROR_* code
+
+void startFaultScenarios();
+void handleFaultScenarios();   // Every loop pass
+
+#define FAULT_PUBLISH_OK() injectPublishFault()
+#define FAULT_READ() injectReadFault()
+#else
+#define FAULT_PUBLISH_OK() true
+#define FAULT_READ()
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef FAULT_INJECTION_CORE_H
+#define FAULT_INJECTION_CORE_H
+
+#include <stdint.h>
+
+// Fault models, the scenario runner and meter (fault_injection.h), with no
+// Arduino dependencies so they build in the native test environment. A model
+// says how long a call site blocks under a fault and how the call ends; the
+// firmware turns that into a delay() and the PubSubClient/HTTPClient code,
+// and test/test_fault_injection replays scenarios on a simulated clock
+// through the same runner and the same connect logic
+// (network_manager_core.h).
+
+#define FAULT_SCENARIO_MS 60000        // Time spent in each scenario
+#define FAULT_TRAFFIC_INTERVAL 5000    // Publish/connect/POST cadence during a scenario
+#define FAULT_FEED_PERIOD_MS 60000     // Synthetic scheduled feed every minute...
+#define FAULT_FEED_WINDOW_MS 60000     // ...missed unless the loop runs within its minute
+#define FAULT_LOOP_BUDGET_MS 250       // Control-path latency budget (worst pass)
+#define FAULT_BUTTON_BUDGET_MS 200     // Worst press-to-service time
+#define FAULT_SOCKET_TIMEOUT_MS 15000  // PubSubClient MQTT_SOCKET_TIMEOUT
+#define FAULT_TLS_HANDSHAKE_MS 1500    // Typical handshake before CONNACK on the ESP32
+#define FAULT_LATENCY_BUCKETS 12       // Log2 histogram, 1 ms .. 2 s and over
+
+enum NetFault : uint8_t
+{
+  FAULT_NONE,
+  FAULT_LATENCY,      // Every publish is held for 'param' ms
+  FAULT_DROP,         // 'param' percent of publishes fail
+  FAULT_HALF_OPEN,    // Peer gone without FIN: publishes hang, then fail
+  FAULT_SLOW_READ,    // Each MQTT read pass takes 'param' ms
+  FAULT_AUTH_REJECT,  // Hub refuses the SAS token
+  FAULT_DNS_FAIL,     // Host lookup fails after 'param' ms
+  FAULT_HTTP_TIMEOUT  // HTTP POST times out after 'param' ms
+};
+
+struct FaultScenario
+{
+  const char *name;
+  NetFault fault;
+  uint32_t param;
+};
+
+enum FaultResult : uint8_t
+{
+  FAULT_RESULT_OK,       // Proceed with the real call
+  FAULT_RESULT_FAILED,   // Publish lost
+  FAULT_RESULT_REJECTED, // CONNACK refused the credentials
+  FAULT_RESULT_REFUSED,  // Host unreachable or lookup failed
+  FAULT_RESULT_TIMEOUT   // No answer within the socket timeout
+};
+
+struct FaultEffect
+{
+  uint32_t blockMs; // How long the call holds the loop
+  FaultResult result;
+};
+
+FaultEffect connectFaultEffect(NetFault fault, uint32_t param);
+FaultEffect publishFaultEffect(NetFault fault, uint32_t param, uint32_t random);
+uint32_t readFaultDelay(NetFault fault, uint32_t param);
+FaultEffect httpFaultEffect(NetFault fault, uint32_t param);
+
+struct FaultReport
+{
+  uint32_t passes;
+  uint32_t maxLoopMs;
+  uint32_t p99LoopMs;      // Upper edge of the 99th percentile bucket
+  uint16_t feedsDue;
+  uint16_t feedsMissed;
+  uint16_t presses;
+  uint32_t maxButtonMs;
+  uint32_t avgButtonMs;
+  bool passed;
+};
+
+// What the control loop sees during one scenario: pass latency, scheduled
+// feeds that would have been missed, and how long a button press waits
+struct FaultMeter
+{
+  uint32_t lastPass;
+  uint32_t nextFeedDue;
+  uint32_t pressAt;
+  uint32_t buttonTotalMs;
+  uint32_t histogram[FAULT_LATENCY_BUCKETS];
+  FaultReport report;
+};
+
+uint8_t latencyBucket(uint32_t ms); // Bucket b holds passes of up to 2^b ms
+void faultMeterStart(FaultMeter &meter, uint32_t nowMs);
+void faultMeterPass(FaultMeter &meter, uint32_t nowMs, uint32_t random); // Every loop pass
+const FaultReport &faultMeterFinish(FaultMeter &meter);                  // Fills p99 and the verdict
+
+// The traffic a scenario generates every FAULT_TRAFFIC_INTERVAL
+enum FaultTraffic : uint8_t
+{
+  FAULT_TRAFFIC_TELEMETRY, // A heartbeat report, reconnecting as telemetry does
+  FAULT_TRAFFIC_RECONNECT, // Drop the session and connectMQTT()
+  FAULT_TRAFFIC_HTTP_POST  // sendToDatabase()
+};
+
+FaultTraffic faultTrafficFor(NetFault fault);
+
+// One running scenario
+struct FaultRunner
+{
+  FaultMeter meter;
+  uint32_t startMs;
+  uint32_t lastTrafficMs;
+};
+
+enum FaultStep : uint8_t
+{
+  FAULT_STEP_IDLE,
+  FAULT_STEP_TRAFFIC, // Generate faultTrafficFor() the active fault
+  FAULT_STEP_DONE     // 'durationMs' is up: finish with faultMeterFinish()
+};
+
+void faultRunnerStart(FaultRunner &runner, uint32_t nowMs); // Traffic on the first pass
+FaultStep faultRunnerPass(FaultRunner &runner, uint32_t nowMs, uint32_t random,
+                          uint32_t durationMs); // Every loop pass
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef FEED_QUEUE_H
+#define FEED_QUEUE_H
+
+#include "config.h"
+#include "globals.h"
+
+// Feed command queue
+// Every feed request (button, direct method, schedule) is pushed through a
+// lock-free single-producer/single-consumer ring and nothing else starts a
+// dispense. handleFeedQueue() drains the ring once per loop pass, coalesces
+// duplicates into one pending command per source, and starts the highest
+// priority one the feed policy allows: manual > remote > scheduled.
+// Commands wait out an active dispense or the cooldown for up to ttlMs; an
+// empty hopper or the daily limit rejects them straight away.
+// The one shortcut is a button press the policy admits right now: the button
+// task starts that dispense itself (getFeedAdmission()) instead of waiting
+// for the next loop pass.
+
+#define FEED_RING_SIZE 8                    // Power of two
+#define FEED_POLICY_NVS_NAMESPACE "feedpol"
+#define FEED_POLICY_VERSION 1
+#define FEED_COOLDOWN_MS 5000               // After a dispense ends, for every source
+#define FEED_DAILY_LIMIT_GRAMS 0.0          // 0 = no limit (MAX_DAILY_FOOD is the suggested value)
+#define FEED_COMMAND_TTL_MS 30000           // Waiting commands older than this are dropped
+
+enum FeedAdmission : uint8_t
+{
+  FEED_ADMIT_NOW,    // Nothing running, waiting or cooling down
+  FEED_ADMIT_WAIT,   // Would wait in the queue
+  FEED_ADMIT_REJECT  // Hopper empty or daily limit
+};
+
+enum FeedSource : uint8_t
+{
+  FEED_SOURCE_SCHEDULED = 0, // Lowest priority
+  FEED_SOURCE_REMOTE = 1,
+  FEED_SOURCE_MANUAL = 2,
+  FEED_SOURCE_COUNT
+};
+
+struct FeedPolicy
+{
+  uint16_t version;
+  uint8_t manualIgnoresDailyLimit; // Someone at the feeder can always top up
+  uint8_t reserved;
+  uint32_t cooldownMs;
+  uint32_t ttlMs;
+  float dailyLimitGrams;
+};
+
+struct FeedQueueStats
+{
+  unsigned long requested = 0;
+  unsigned long coalesced = 0;  // Duplicate of a command already waiting
+  unsigned long overflowed = 0; // Ring full
+  unsigned long rejected = 0;   // Hopper empty or daily limit
+  unsigned long expired = 0;    // Waited longer than ttlMs
+  unsigned long started = 0;
+  unsigned long startFailed = 0; // Dispense would not start; the command keeps waiting
+  uint8_t depth = 0;            // Commands waiting right now
+  uint8_t maxDepth = 0;
+  unsigned long lastWaitMs = 0; // Request to dispense start
+  unsigned long maxWaitMs = 0;
+  unsigned long totalWaitMs = 0;
+};
+
+bool requestFeed(FeedSource source); // Safe from the MQTT callback and the button task; false if the ring is full
+FeedAdmission getFeedAdmission(FeedSource source); // Reads only; safe from the button task
+void handleFeedQueue();
+bool isFeedCooldownActive();
+const char *getFeedSourceName(uint8_t source);
+const FeedPolicy &getFeedPolicy();
+const FeedQueueStats &getFeedQueueStats();
+void setupFeedQueue();
+int handleFeedPolicyMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
@@ -6,17 +6,21 @@
 #include "display_manager.h"
 #include "network_manager.h"
 #include "time_manager.h"
+#include "indicator.h"
+#include "feed_queue.h"
 
 void handleFeeding();
 void checkFeedingComplete();
-void performAutoFeed();
-bool canDispenseFood();
+bool performAutoFeed();
 void recordFoodDispensing(String feedingType);
-String getFeedingStatus(); // Keep this declaration here
+bool beginDispense(const char *feedingType, const char *title,
+                   const IndicatorPattern *moveCue, const IndicatorPattern *completeCue);
+// Loop-side bookkeeping for a dispense whose motion is already running
+// (beginDispense() does both; the button task starts the motion itself)
+void dispenseStarted(const char *feedingType, const char *title,
+                     const IndicatorPattern *completeCue, unsigned long startMillis);
+FeedingStatus getFeedingStatus();
 void resetDailyCounters();
-// Add these function declarations to your feeding_control.h
-void handleRemoteFeeding();
-bool canDispenseFoodRemote();
-String getRemoteFeedingStatus();
+bool handleRemoteFeeding();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include "config.h"
+#include "globals.h"
+
+// Local gateway mode
+// Leaf feeders publish compact telemetry to an on-LAN broker instead of
+// holding their own TLS session to Azure IoT Hub. One gateway node batches
+// that telemetry upstream and fans direct methods back out to the leaves.
+//
+// Local topic layout (LOCAL_TOPIC_ROOT = "petfeeder"):
+//   petfeeder/<feederId>/t                 leaf -> gateway telemetry
+//   petfeeder/<feederId>/m/<method>/<rid>  gateway -> leaf direct method
+//   petfeeder/<feederId>/r/<status>/<rid>  leaf -> gateway method response
+//   petfeeder/gateway/stats                gateway throughput counters
+//
+// Direct methods reach a leaf when the hub payload carries
+// {"target":"<feederId>", ...}; anything else is handled by the gateway itself.
+
+struct GatewayStats
+{
+  unsigned long messagesIn = 0;
+  unsigned long batchesOut = 0;
+  unsigned long bytesOut = 0;
+  unsigned long methodsForwarded = 0;
+  unsigned long responsesForwarded = 0;
+  unsigned long dropped = 0;
+  int feedersSeen = 0;
+  float messagesPerSecond = 0.0;
+};
+
+// Shared by every role
+const char *getFeederId();
+
+// Leaf role
+bool publishLeafTelemetry();
+void subscribeLeafTopics();
+bool isLeafMethodTopic(const char *topic);
+void handleLeafMethod(char *topic, byte *payload, unsigned int length);
+
+// Gateway role
+void setupGateway();
+void handleGateway();
+bool forwardMethodToFeeder(const char *target, const String &methodName,
+                           const String &requestId, byte *payload, unsigned int length);
+const GatewayStats &getGatewayStats();
+
+#endif
@@ -23,27 +23,9 @@ extern HX711 scale;
 extern int feedingTimes[];
 extern int numFeedingTimes;
 extern SystemState feederSystem;
-extern ButtonState buttons;
 extern SensorData sensors;
 extern Timing timing;
 extern TimeData timeData;
-extern IoTHubConfig iotHub;
 extern PubSubClient mqttClient;
 
-// Add this structure definition before the existing structures
-struct BowlData
-{
-  float weight;
-  int status;
-};
-
-// Add bowl status constants
-#define BOWL_EMPTY 0
-#define BOWL_LOW 1
-#define BOWL_FULL 2
-#define BOWL_ERROR 3
-
-// Add bowlData to the extern declarations
-extern BowlData bowlData;
-
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include "config.h"
+#include "globals.h"
+#include "history_store_core.h"
+
+// On-device history, round-robin database style
+// Three fixed-size tiers of the same point layout:
+//   minute - 1440 points (24 h)
+//   hour   -  720 points (30 days)
+//   day    -  366 points (a year)
+// Every sample or event is folded into the open bucket of each tier (means
+// for bowl weight and hopper grams, sums for intake, dispensed grams and
+// visits); when the clock moves into the next bucket the open one is written
+// into the ring and skipped buckets are cleared. Buckets follow the local
+// clock so days start at local midnight. Each tier is checkpointed to its own
+// LittleFS file, one file per loop pass: all tiers every
+// HISTORY_CHECKPOINT_MS, and the hour and day tiers whenever a bucket closes.
+// Nothing is recorded until the clock is known.
+
+#define HISTORY_MINUTE_POINTS 1440
+#define HISTORY_HOUR_POINTS 720
+#define HISTORY_DAY_POINTS 366
+#define HISTORY_CHECKPOINT_MS 900000  // At most this much is lost on a reset
+#define HISTORY_PAGE_POINTS 360       // Default buckets scanned per "history" call
+#define HISTORY_PAGE_MAX 1440
+#define HISTORY_INLINE_POINTS 12      // Up to this many buckets go in the method response itself
+#define HISTORY_FILE_MAGIC 0x54534948 // "HIST"
+#define HISTORY_FILE_VERSION 1
+
+struct HistoryStats
+{
+  unsigned long samples = 0;
+  unsigned long checkpoints = 0;
+  unsigned long checkpointFailures = 0;
+  uint32_t lastCheckpointMs = 0; // Time the last file write took
+  bool restored = false;         // Tiers came back from flash at boot
+};
+
+// Firmware glue
+void setupHistory();
+void recordHistory(HistoryField field, float value);
+void handleHistory(); // Closes buckets on time and checkpoints, one file per call
+const HistoryStats &getHistoryStats();
+int handleHistoryMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
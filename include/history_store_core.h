@@ -0,0 +1,90 @@
+#ifndef HISTORY_STORE_CORE_H
+#define HISTORY_STORE_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// History rings and the "history" page format (history_store.h), with no
+// Arduino or LittleFS dependencies so they build in the native test
+// environment.
+
+#define HISTORY_NO_WEIGHT INT16_MIN
+#define HISTORY_NO_HOPPER 0xFFFF
+
+enum HistoryField : uint8_t
+{
+  HISTORY_WEIGHT,    // Bowl weight sample, g
+  HISTORY_HOPPER,    // Hopper contents sample, g
+  HISTORY_INTAKE,    // Grams eaten in a finished meal
+  HISTORY_DISPENSED, // Grams dispensed
+  HISTORY_VISIT      // One pet visit
+};
+
+enum HistoryTierId : uint8_t
+{
+  HISTORY_TIER_MINUTE,
+  HISTORY_TIER_HOUR,
+  HISTORY_TIER_DAY,
+  HISTORY_TIER_COUNT
+};
+
+struct HistoryPoint
+{
+  int16_t weightDg;   // Mean bowl weight, 0.1 g; HISTORY_NO_WEIGHT = no sample
+  uint16_t hopperG;   // Mean hopper contents; HISTORY_NO_HOPPER = no sample
+  uint16_t intakeDg;  // Eaten, 0.1 g
+  uint16_t dispensedG;
+  uint16_t visits;
+  uint16_t updates;   // Samples and events folded in; 0 = empty bucket
+};
+
+struct HistoryAccumulator
+{
+  uint32_t bucket; // Local seconds / period; 0 = nothing open
+  float weightSum;
+  float hopperSum;
+  float intakeGrams;
+  float dispensedGrams;
+  uint32_t weightCount;
+  uint32_t hopperCount;
+  uint32_t visits;
+  uint32_t updates;
+};
+
+struct HistoryTier
+{
+  uint32_t periodS;
+  uint16_t size;
+  HistoryPoint *points;
+  uint32_t headBucket; // Bucket in points[headIndex]; 0 = ring empty
+  uint16_t headIndex;
+  HistoryAccumulator open;
+};
+
+void historyClear(HistoryTier &tier);
+bool historyRoll(HistoryTier &tier, uint32_t localSeconds); // True when a bucket closed
+void historyAdd(HistoryTier &tier, uint32_t localSeconds, HistoryField field, float value);
+HistoryPoint historyPointFrom(const HistoryAccumulator &open);
+bool historyLookup(const HistoryTier &tier, uint32_t bucket, HistoryPoint &point); // False = no data
+
+// Page of a "history" query: buckets [first, end], clamped to what the ring
+// can still hold and to maxPoints; 'more' when buckets up to 'last' remain
+struct HistoryPage
+{
+  uint32_t first;
+  uint32_t end;
+  bool more;
+};
+
+HistoryPage historyPageRange(const HistoryTier &tier, uint32_t first, uint32_t last,
+                             uint32_t maxPoints);
+
+#define HISTORY_TEXT_MAX 160 // Fits any one of the pieces below
+
+// Pieces of the page JSON; each returns the length written (cut to 'size')
+size_t historyFormatHeader(char *out, size_t size, const char *tierName, uint32_t periodS);
+size_t historyFormatPoint(char *out, size_t size, uint32_t unixUtc, const HistoryPoint &point,
+                          bool first);
+size_t historyFormatTrailer(char *out, size_t size, long next); // next = -1 at the end
+
+#endif
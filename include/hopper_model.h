@@ -0,0 +1,96 @@
+#ifndef HOPPER_MODEL_H
+#define HOPPER_MODEL_H
+
+#include "config.h"
+#include "globals.h"
+
+// Hopper contents in grams and days until empty
+// The ultrasonic distance to the food surface is mapped to grams with a
+// linear model (grams per cm of height). Each dispense measures the grams that
+// reached the bowl; once the surface has dropped far enough, the measured
+// grams over the measured drop re-estimate grams per cm. Hopper grams sampled
+// every HOPPER_SAMPLE_INTERVAL feed an exponentially weighted least-squares
+// line whose slope is the consumption rate. Every step is O(1) with no heap.
+
+#define HOPPER_NVS_NAMESPACE "hopper"
+#define HOPPER_DISTANCE_TAU_MS 4000    // Level filter time constant; reads come 0.2-60 s apart
+#define HOPPER_SAMPLE_INTERVAL 600000  // Forecast sample every 10 minutes
+#define HOPPER_HALF_LIFE_DAYS 3.0      // Older samples fade from the fit
+#define HOPPER_MIN_SPAN_DAYS 0.25      // History needed before forecasting
+#define HOPPER_MIN_RATE 1.0            // g/day; slower reads as "not being eaten"
+#define HOPPER_REFILL_GRAMS 50.0       // Level jump that counts as a refill
+#define HOPPER_SETTLE_MS 3000          // Bowl settle time after a dispense
+#define HOPPER_CHECK_MIN_CM 1.0        // Surface drop before cross-checking the model
+#define HOPPER_CHECK_ALPHA 0.3         // Weight of each cross-check on grams per cm
+#define HOPPER_LOW_DAYS 3.0            // Low-stock alert
+#define HOPPER_CRITICAL_DAYS 1.0       // Critical alert (also below one portion)
+
+enum StockAlert : uint8_t
+{
+  STOCK_OK,
+  STOCK_LOW,
+  STOCK_CRITICAL
+};
+
+struct HopperModel
+{
+  float gramsPerCm;
+  float emptyDistance; // Surface distance with no food left
+  float fullDistance;  // Highest surface the sensor can see
+};
+
+// Weighted sums over (t days, grams), with t = 0 at the latest sample so the
+// sums stay small and float keeps its precision
+struct ConsumptionFit
+{
+  float sumW;
+  float sumT;
+  float sumY;
+  float sumTT;
+  float sumTY;
+  float spanDays; // Since the first sample after the last reset
+  uint16_t samples;
+};
+
+// Dispensed grams accumulated since the surface was last at anchorDistance
+struct HopperCheck
+{
+  float anchorDistance;
+  float measuredGrams;
+};
+
+struct HopperStats
+{
+  float grams = 0.0;
+  float capacity = 0.0;
+  float gramsPerCm = 0.0;
+  float gramsPerDay = 0.0;     // Consumption from the fit, 0 until known
+  float daysUntilEmpty = -1.0; // -1 = no forecast yet
+  float lastCheckError = 0.0;  // Model vs measured at the last cross-check, percent
+  float lastDispenseGrams = 0.0;
+  unsigned long checks = 0;
+  unsigned long refills = 0;
+  StockAlert alert = STOCK_OK;
+};
+
+// Pure core
+float hopperGrams(const HopperModel &model, float distanceCm);
+float hopperCapacity(const HopperModel &model);
+void consumptionFitReset(ConsumptionFit &fit);
+void consumptionFitAdd(ConsumptionFit &fit, float dtDays, float grams, float halfLifeDays);
+bool consumptionFitLine(const ConsumptionFit &fit, float &gramsPerDay, float &gramsNow);
+float forecastDaysUntilEmpty(const ConsumptionFit &fit, float minSpanDays, float minRate);
+bool hopperCrossCheck(HopperModel &model, HopperCheck &check, float distanceCm,
+                      float dispensedGrams, float &errorPercent); // True when grams/cm was updated
+StockAlert stockAlertFor(float grams, float daysUntilEmpty);
+
+// Firmware glue
+void setupHopper();
+void updateHopperLevel(float distanceCm); // Every valid ultrasonic reading
+void hopperDispenseStarted();
+void hopperDispenseFinished();
+const HopperStats &getHopperStats();
+const char *getStockAlertName(StockAlert alert);
+int handleHopperMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
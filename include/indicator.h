@@ -0,0 +1,41 @@
+#ifndef INDICATOR_H
+#define INDICATOR_H
+
+#include "config.h"
+
+// RGB LED and buzzer pattern engine
+// Both outputs are LEDC PWM channels (allocated through ESP32PWM so they never
+// collide with the servo). Patterns are static step tables advanced by an
+// esp_timer tick; starting one only swaps a pointer, so callers never block.
+// When a pattern finishes the LED returns to its resting color.
+
+struct IndicatorStep
+{
+  RgbColor color;     // RGB_UNCHANGED keeps the current LED color
+  uint8_t brightness; // 0-255, scales the color
+  bool buzzer;
+  uint16_t durationMs;
+};
+
+struct IndicatorPattern
+{
+  const IndicatorStep *steps;
+  uint8_t stepCount;
+  uint8_t repeat; // Times the step table is played
+};
+
+// Built-in patterns
+extern const IndicatorPattern PATTERN_BUTTON_BEEP;    // Short click
+extern const IndicatorPattern PATTERN_DISPENSE_MOVE;  // Servo move cue
+extern const IndicatorPattern PATTERN_REMOTE_MOVE;    // Servo move cue, blue flash
+extern const IndicatorPattern PATTERN_FEED_COMPLETE;  // Three beeps
+extern const IndicatorPattern PATTERN_REMOTE_COMPLETE; // Three beeps, green flashes
+extern const IndicatorPattern PATTERN_AUTO_COMPLETE;   // Warning beeps, purple flashes
+
+void setupIndicators();
+void startIndicatorPattern(const IndicatorPattern &pattern);
+void startBeepPattern(int beeps, int durationMs, int pauseMs, RgbColor color = RGB_UNCHANGED);
+void setRestingColor(RgbColor color, uint8_t brightness = RGB_DEFAULT_BRIGHTNESS);
+bool isIndicatorPatternActive();
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef JSON_POOL_H
+#define JSON_POOL_H
+
+#include "config.h"
+#include "globals.h"
+
+// Shared JSON scratch for the loop task
+// Telemetry, events and direct-method responses are all built and serialized
+// on the loop task, one at a time, so they share one statically allocated
+// document and text buffer instead of each putting up to 2 KB on the 8 KB
+// loop stack. The borrower must finish with both before calling anything
+// that builds JSON itself. Small request documents stay on the stack so a
+// handler can parse its request while it fills the pool with the response.
+
+#define JSON_POOL_SIZE 1024
+#define JSON_TEXT_SIZE MQTT_BUFFER_SIZE
+
+JsonDocument &borrowJsonDocument(); // Cleared
+char *borrowJsonText();             // JSON_TEXT_SIZE bytes
+
+#endif
@@ -8,14 +8,25 @@
 
 // Function declarations
 void setupLoadCell();
-float getWeight();
-void updateBowlWeight();
-void handleButtonPress();
-void dispenseFood();
+float getWeight(uint8_t readings = SCALE_READINGS);
+void updateBowlWeight(uint8_t readings = SCALE_READINGS);
+bool isScaleReady(); // A recent conversion is available
 void playBuzzer(int beepCount = 1, int beepDuration = BUZZER_SHORT_BEEP, int pauseDuration = BUZZER_SHORT_PAUSE);
 void displayMessage(String line1, String line2 = "");
 void displayWeight(float weight);
 
 extern HX711 scale;
 
+// The capture sampler (dispense_capture.h) reads every conversion on its own
+// task; anything else that talks to the HX711 directly holds a ScaleLock
+class ScaleLock
+{
+public:
+  ScaleLock();
+  ~ScaleLock();
+};
+
+bool tryLockScale();
+void unlockScale();
+
 #endif // LOAD_CELL_H
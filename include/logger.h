@@ -0,0 +1,61 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "config.h"
+#include "logger_core.h"
+
+// Leveled, asynchronous logging
+// LOGE/LOGW/LOGI/LOGD format into a fixed-slot lock-free ring and return; a
+// low-priority task drains the ring to Serial, so call sites never wait on the
+// UART. Levels above LOG_LEVEL compile to nothing, arguments included.
+// When the ring is full the message is dropped and counted. The caller-side
+// cost of every call is also counted per tag (logCosts direct method).
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO // Build with -DLOG_LEVEL=4 for debug output
+#endif
+
+#define LOG_DRAIN_INTERVAL_MS 10
+#define LOG_TASK_PRIORITY 1      // Lowest above idle, on core 0 away from the loop task
+#define LOG_COSTS_REPORTED 8     // Tags in the logCosts response, costliest first
+#define LOG_TASK_STACK 3072
+
+struct LoggerStats
+{
+  unsigned long written = 0;
+  unsigned long dropped = 0;       // Ring full
+  unsigned long avgEnqueueUs = 0;  // Mean cost of a log call on the caller's side
+  unsigned long maxEnqueueUs = 0;
+};
+
+void setupLogger();
+void logWrite(uint8_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+LoggerStats getLoggerStats();
+int handleLogCostsMethod(String &responsePayload);
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(tag, ...) logWrite(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define LOGE(tag, ...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(tag, ...) logWrite(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define LOGW(tag, ...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(tag, ...) logWrite(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define LOGI(tag, ...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(tag, ...) logWrite(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define LOGD(tag, ...) do { } while (0)
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef LOGGER_CORE_H
+#define LOGGER_CORE_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <atomic>
+
+// The message ring and the per-tag cost counters behind logger.h, with no
+// Arduino dependencies so test/test_logger can time real call sites on the
+// host.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#define LOG_SLOT_COUNT 32   // Power of two
+#define LOG_MESSAGE_MAX 120 // Longer messages are truncated
+#define LOG_TAG_MAX 32      // Tags with their own cost counters; more are lumped
+
+struct LogSlot
+{
+  std::atomic<uint32_t> sequence;
+  uint32_t millis;
+  const char *tag;
+  uint8_t level;
+  char message[LOG_MESSAGE_MAX];
+};
+
+// Bounded MPMC queue (Vyukov) used with a single consumer. Each slot carries a
+// sequence number: a producer may claim slot i when sequence == position, and
+// publishes it by storing position + 1. No locks, so any task or timer
+// callback can log concurrently.
+struct LogRing
+{
+  LogSlot slots[LOG_SLOT_COUNT];
+  std::atomic<uint32_t> enqueuePosition;
+  uint32_t dequeuePosition; // Consumer only
+  std::atomic<uint32_t> written;
+  std::atomic<uint32_t> dropped; // Ring full
+};
+
+void logRingInit(LogRing &ring);
+// Formats into the next free slot; false, and counted as dropped, when full
+bool logRingPush(LogRing &ring, uint32_t millis, uint8_t level, const char *tag,
+                 const char *format, va_list args);
+const LogSlot *logRingPeek(LogRing &ring); // Oldest published message, or nullptr
+void logRingPop(LogRing &ring);            // Frees the slot logRingPeek() returned
+
+// Caller-side cost of log calls per tag. Tags are the modules' static TAG
+// strings and are told apart by address.
+struct LogTagCost
+{
+  std::atomic<const char *> tag;
+  std::atomic<uint32_t> calls;
+  std::atomic<uint32_t> totalUs;
+  std::atomic<uint32_t> maxUs;
+};
+
+struct LogCostTable
+{
+  LogTagCost tags[LOG_TAG_MAX];
+  std::atomic<uint32_t> untracked; // Calls from tags past LOG_TAG_MAX
+};
+
+void logCostRecord(LogCostTable &table, const char *tag, uint32_t us);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef MEAL_TRACKER_H
+#define MEAL_TRACKER_H
+
+#include <stdint.h>
+
+// Meal Detection Configuration
+#define MEAL_NOISE_GRAMS 0.8       // Drops smaller than this are load-cell jitter
+#define MEAL_START_DROP_GRAMS 2.0  // Drop (with a pet present) that opens a meal
+#define MEAL_END_QUIET_MS 60000    // No eating for this long closes a meal
+#define MEAL_MIN_GRAMS 3.0         // Shorter "meals" are discarded as noise
+#define MEAL_RATE_WINDOW 64        // Samples in the rolling intake-rate window (power of 2)
+
+// Stream processor over the bowl-weight series.
+// Every update is O(1) and allocation-free; the core has no Arduino
+// dependencies (meal_tracker_core.cpp) so recorded weight traces can be
+// replayed through it on a host.
+enum MealState
+{
+  MEAL_IDLE,
+  MEAL_EATING
+};
+
+struct MealEvent
+{
+  unsigned long startMillis;
+  unsigned long endMillis;
+  float startWeight;
+  float endWeight;
+  float gramsEaten;
+  float peakRate; // grams per minute
+};
+
+struct MealTracker
+{
+  MealState state = MEAL_IDLE;
+  bool hasSample = false;
+  float lastWeight = 0.0;
+  float referenceWeight = 0.0; // Bowl weight before the current drop started
+  unsigned long lastSampleMillis = 0;
+  unsigned long lastDropMillis = 0;
+
+  // Rolling intake rate: ring of (grams consumed, elapsed ms) with running sums
+  float consumed[MEAL_RATE_WINDOW] = {};
+  uint16_t elapsed[MEAL_RATE_WINDOW] = {};
+  uint8_t head = 0;
+  float consumedSum = 0.0;
+  unsigned long elapsedSum = 0;
+
+  MealEvent current = {};
+};
+
+struct MealStats
+{
+  int mealsToday = 0;
+  float gramsToday = 0.0;
+  float intakeRate = 0.0; // grams per minute over the rolling window
+  bool eating = false;
+  MealEvent lastMeal = {};
+};
+
+// Pure core: feed one sample, returns true and fills 'event' when a meal ends
+bool mealTrackerUpdate(MealTracker &tracker, unsigned long nowMillis, float weight,
+                       bool animalPresent, bool dispensing, MealEvent &event);
+float mealTrackerIntakeRate(const MealTracker &tracker);
+
+// Firmware glue: called after every sensorWeightStep() (sensor_manager_core.h),
+// which runs the tracker; 'ended' is the meal that just closed, if any
+void updateMealTracking(const MealEvent *ended);
+const MealStats &getMealStats();
+void resetMealDailyStats();
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef METHOD_STREAM_H
+#define METHOD_STREAM_H
+
+#include "config.h"
+#include "globals.h"
+#include "method_stream_core.h"
+
+// Streamed direct-method results
+// The hub takes exactly one response per request ID, and a PubSubClient
+// publish has to fit in MQTT_BUFFER_SIZE. Larger results are written through
+// a MethodStream (an Arduino Print, so serializeJson() and file copies can
+// target it directly): every METHOD_CHUNK_BYTES it publishes a telemetry
+// message whose properties carry the request ID, a sequence number and a
+// last flag, e.g.
+//   devices/<id>/messages/events/$.ct=application%2Fjson&rid=42&seq=3&last=0
+// The method response itself is a short summary. History handlers page with
+// a cursor so each call streams a bounded amount and the full result is
+// never in RAM at once. The chunking itself is in method_stream_core.
+
+#define METHOD_CT_JSON "application%2Fjson"        // URL-encoded for the property bag
+#define METHOD_CT_BINARY "application%2Foctet-stream"
+
+class MethodStream : public Print
+{
+public:
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *data, size_t size) override;
+  using Print::write;
+
+  bool end(); // Publishes the final chunk (last=1); false if any chunk failed
+  uint16_t chunks() const { return writer.sequence; }
+  uint32_t bytes() const { return writer.total; }
+
+private:
+  friend MethodStream &openMethodStream(const char *contentType);
+  static bool publishChunk(void *context, const uint8_t *data, size_t length, uint16_t sequence,
+                           bool last);
+
+  const char *contentType;
+  uint8_t buffer[METHOD_CHUNK_BYTES];
+  ChunkWriter writer;
+  unsigned long startMillis;
+};
+
+struct MethodStreamStats
+{
+  unsigned long streams = 0;
+  unsigned long chunks = 0;
+  unsigned long bytes = 0;
+  unsigned long failures = 0;
+  uint32_t lastBytesPerSec = 0;
+};
+
+// Set by handleDirectMethod() before dispatching; chunks are tagged with it
+void setMethodRequestId(const char *requestId);
+// One stream at a time; reopening discards an unfinished one
+MethodStream &openMethodStream(const char *contentType);
+// Streams an oversized response and replaces it with a summary
+bool streamOversizedResponse(String &responsePayload);
+const MethodStreamStats &getMethodStreamStats();
+
+#endif
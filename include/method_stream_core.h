@@ -0,0 +1,37 @@
+#ifndef METHOD_STREAM_CORE_H
+#define METHOD_STREAM_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Chunking behind MethodStream (method_stream.h), with no Arduino or MQTT
+// dependencies so it builds in the native test environment. Bytes collect in
+// a caller-supplied buffer; each time it fills, the sink gets one chunk with
+// its sequence number, and end() sends the rest (possibly empty) as the last
+// one. The firmware sink publishes to the hub; test/test_method_stream uses a
+// counting one.
+
+#define METHOD_CHUNK_BYTES 768 // Chunk payload; well under MQTT_BUFFER_SIZE
+
+// False stops the stream: later writes are dropped and end() fails
+typedef bool (*ChunkSink)(void *context, const uint8_t *data, size_t length, uint16_t sequence,
+                          bool last);
+
+struct ChunkWriter
+{
+  uint8_t *buffer;
+  size_t capacity;
+  size_t used;
+  uint16_t sequence; // Chunks sent so far
+  uint32_t total;    // Bytes accepted
+  bool failed;
+  ChunkSink sink;
+  void *context;
+};
+
+void chunkWriterOpen(ChunkWriter &writer, uint8_t *buffer, size_t capacity, ChunkSink sink,
+                     void *context);
+size_t chunkWriterWrite(ChunkWriter &writer, const uint8_t *data, size_t size);
+bool chunkWriterEnd(ChunkWriter &writer); // Sends the last chunk; false if any chunk failed
+
+#endif
@@ -4,16 +4,29 @@
 #include "config.h"
 #include "globals.h"
 #include "time_manager.h"
+#include "report_policy.h"
+#include "network_manager_core.h"
+
+#define METHOD_NAME_MAX 32
+#define REQUEST_ID_MAX 40
+#define METHOD_RESPONSE_OVERHEAD 80 // MQTT header plus "$iothub/methods/res/<status>/?$rid=<id>"
+#define TELEMETRY_BACKLOG_SLOTS 6   // Events held while the broker is unreachable
+#define TELEMETRY_EVENT_MAX 256     // Larger events are not held
 
 // MQTT function declarations
 void setupMQTT();
 bool connectMQTT();
+void resetMQTTBackoff(); // Next connectMQTT() tries immediately
 void handleMQTTCallback(char *topic, byte *payload, unsigned int length);
-void sendSensorDataToAzure();
+bool sendSensorDataToAzure(uint8_t triggers = REPORT_HEARTBEAT);
+bool publishTelemetryEvent(const char *payload, size_t length); // False = held for retry or dropped
+uint8_t getTelemetryBacklogDepth();
 void handleBackendCommunication();
 bool checkForRemoteCommands();
 void setupTime();
 void handleDirectMethod(char *topic, byte *payload, unsigned int length);
+int dispatchDirectMethod(const String &methodName, byte *payload, unsigned int length,
+                         String &responsePayload);
 void processMQTTLoop();
 bool sendToDatabase();
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef NETWORK_MANAGER_CORE_H
+#define NETWORK_MANAGER_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pure parts of the MQTT client (network_manager.h), with no Arduino
+// dependencies so they build in the native test environment.
+
+// Parser for "$iothub/methods/POST/{method}/?$rid={id}"; false if the
+// method name or request ID is missing. Outputs are always terminated.
+bool parseMethodTopic(const char *topic, char *methodName, size_t methodSize,
+                      char *requestId, size_t requestIdSize);
+
+// MQTT reconnect backoff; replaces the blocking retry loop
+constexpr unsigned long MQTT_BACKOFF_MIN_MS = 5000;     // First retry after a failed connect
+constexpr unsigned long MQTT_BACKOFF_MAX_MS = 300000;   // Doubling stops here
+constexpr unsigned long MQTT_AUTH_BACKOFF_MS = 1800000; // After repeated hub auth rejections
+constexpr uint8_t MQTT_AUTH_FAILURE_LIMIT = 3;
+
+struct ReconnectBackoff
+{
+  uint32_t lastAttemptMs;
+  uint32_t waitMs; // 0 = connect on the next call
+  uint8_t authFailures;
+};
+
+bool reconnectDue(ReconnectBackoff &backoff, uint32_t nowMs); // True also records the attempt
+// 'random' is any 32-bit random value, for the jitter
+void reconnectFailed(ReconnectBackoff &backoff, bool authRejected, uint32_t random);
+void reconnectSucceeded(ReconnectBackoff &backoff);
+
+// Connect and reconnect decisions of connectMQTT() and the telemetry
+// publish, with the transport behind function pointers: the firmware wraps
+// PubSubClient, test/test_fault_injection a simulated broker behind the
+// fault models
+constexpr unsigned long MQTT_RECONNECT_INTERVAL = 30000; // Publish-driven reconnects at most this often
+
+enum ConnectOutcome : uint8_t
+{
+  CONNECT_ALREADY,  // Was connected; nothing attempted
+  CONNECT_NOT_DUE,  // Backoff (or the publish reconnect interval) still running
+  CONNECT_OK,
+  CONNECT_FAILED,   // Transport or broker failure
+  CONNECT_REJECTED  // Hub refused the credentials
+};
+
+struct MqttTransport
+{
+  void *context;
+  bool (*connected)(void *context);
+  ConnectOutcome (*connect)(void *context); // One attempt: CONNECT_OK, _FAILED or _REJECTED
+};
+
+// connectMQTT(): one attempt when the backoff allows it, and the backoff
+// bookkeeping for its outcome
+ConnectOutcome mqttConnect(ReconnectBackoff &backoff, const MqttTransport &transport,
+                           uint32_t nowMs, uint32_t random);
+// Before a telemetry publish: while disconnected, a reconnect at most once
+// per MQTT_RECONNECT_INTERVAL, through mqttConnect(). Publish on
+// CONNECT_ALREADY or CONNECT_OK.
+ConnectOutcome mqttConnectForPublish(ReconnectBackoff &backoff, unsigned long &lastReconnectMs,
+                                     const MqttTransport &transport, uint32_t nowMs,
+                                     uint32_t random);
+
+#endif
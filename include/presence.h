@@ -0,0 +1,34 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include "config.h"
+#include "globals.h"
+#include "presence_core.h"
+
+// Pet presence from PIR edges
+// The PIR pin interrupts on every edge; the ISR timestamps it into a ring the
+// loop drains, so pulses during a blocking feed or network call are kept.
+// Edges are folded into visits (first motion until PIR_TIMEOUT without
+// motion), each tagged with the bowl-weight change across it, and into a
+// 24-bucket histogram of the last day keyed by local hour. The tracker and
+// the histogram are in presence_core.h.
+
+#define PIR_EDGE_RING 32   // Power of 2
+#define VISIT_LOG_SIZE 8   // Recent visits kept for the "visits" method
+
+struct PresenceStats
+{
+  unsigned long edges = 0;
+  unsigned long edgeOverflows = 0; // ISR found the ring full
+  unsigned long visits = 0;
+  Visit lastVisit = {};
+};
+
+// Firmware glue
+void setupPresence();
+void handlePresence();
+uint16_t getVisitsLast24h();
+const PresenceStats &getPresenceStats();
+int handleVisitsMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PRESENCE_CORE_H
+#define PRESENCE_CORE_H
+
+#include <stdint.h>
+
+// Visit tracking and the hourly histogram behind presence.h, with no Arduino
+// dependencies so they build in the native test environment and in the
+// trace replay.
+
+#define VISIT_HOURS 24
+constexpr unsigned long PIR_TIMEOUT = 30000; // No motion for this long ends a visit
+
+struct PirEdge
+{
+  uint32_t millis;
+  uint8_t level;
+};
+
+struct Visit
+{
+  uint32_t startEpoch;   // Unix UTC, 0 = clock unknown
+  uint32_t durationMs;   // First to last motion
+  uint16_t motionEdges;  // Rising edges during the visit
+  float bowlDeltaGrams;  // Positive = food left the bowl
+};
+
+struct PresenceTracker
+{
+  bool active = false;
+  bool motion = false;
+  uint32_t startMillis = 0;
+  uint32_t lastMotionMillis = 0;
+  uint16_t motionEdges = 0;
+  float startWeight = 0.0;
+};
+
+struct VisitHistogram
+{
+  uint32_t hourStamp[VISIT_HOURS] = {}; // Absolute local hour the bucket holds
+  uint16_t visits[VISIT_HOURS] = {};
+  uint32_t seconds[VISIT_HOURS] = {};
+};
+
+void presenceOnEdge(PresenceTracker &tracker, const PirEdge &edge, float weight);
+bool presenceCheckEnd(PresenceTracker &tracker, uint32_t nowMillis, float weight,
+                      uint32_t endGapMs, Visit &visit); // True once per finished visit
+void histogramAddVisit(VisitHistogram &histogram, uint32_t absoluteHour, uint32_t seconds);
+uint16_t histogramVisitsSince(const VisitHistogram &histogram, uint32_t absoluteHour);
+
+#endif
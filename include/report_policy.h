@@ -0,0 +1,36 @@
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include "config.h"
+#include "globals.h"
+
+// Report-on-change telemetry
+// Each channel has a deadband; crossing it schedules an immediate publish
+// (rate limited by REPORT_MIN_INTERVAL). With no changes, a heartbeat is
+// sent every REPORT_HEARTBEAT_INTERVAL so the backend can tell idle from dead.
+
+enum ReportTrigger
+{
+  REPORT_NONE = 0,
+  REPORT_WEIGHT = 1 << 0,   // Bowl weight moved by more than the deadband
+  REPORT_LEVEL = 1 << 1,    // Container level changed
+  REPORT_MOTION = 1 << 2,   // Pet presence edge
+  REPORT_FEEDING = 1 << 3,  // Dispense started or finished
+  REPORT_HEARTBEAT = 1 << 4 // Nothing changed for a full heartbeat interval
+};
+
+struct ReportStats
+{
+  unsigned long published = 0;
+  unsigned long heartbeats = 0;
+  unsigned long changeReports = 0;
+  unsigned long rateLimited = 0; // Loop passes where a change waited for the rate limit
+};
+
+uint8_t getPendingReportTriggers(unsigned long currentMillis);
+bool isReportRateLimited(unsigned long currentMillis);
+void markReportSent(uint8_t triggers, unsigned long currentMillis);
+void describeReportTriggers(uint8_t triggers, char *buffer, size_t size);
+const ReportStats &getReportStats();
+
+#endif
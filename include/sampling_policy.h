@@ -0,0 +1,38 @@
+#ifndef SAMPLING_POLICY_H
+#define SAMPLING_POLICY_H
+
+#include "config.h"
+#include "globals.h"
+#include "sampling_policy_core.h"
+
+// Activity-adaptive sensor sampling
+// handleSensors() reads the load cell and the ultrasonic sensor at the rates
+// of the current mode instead of fixed intervals:
+//   IDLE      - nobody at the bowl: slow weight, ultrasonic once a minute
+//   PRESENCE  - pet at the bowl or a dashboard open: fast single-reading weight
+//   DISPENSE  - dispensing or refilling, and SAMPLING_DISPENSE_LINGER_MS after:
+//               fast weight and fast ultrasonic for the hopper cross-check
+// The PIR is interrupt-driven (presence.h) and already sees every edge.
+// While the dispense capture sampler runs (dispense_capture.h) it reads every
+// HX711 conversion whatever the mode; weightMs and weightReadings then set
+// how often the loop takes a weight and how many of the sampler's latest
+// conversions it averages, not how often the chip is read. The sampler
+// counts its own reads through recordWeightConversion(). Without it the loop
+// reads the chip and both knobs set the chip reads as well.
+// Time spent in sensor reads is measured and compared with what the old
+// fixed ULTRASONIC_READ_INTERVAL / WEIGHT_READ_INTERVAL rates would cost.
+// The modes, rates and load arithmetic are in sampling_policy_core.h.
+
+#define SAMPLING_NVS_NAMESPACE "sampling"
+void setupSamplingPolicy();
+const SamplingRates &updateSamplingMode(); // Once per handleSensors() pass
+const SamplingRates &getSamplingRates();   // Of the current mode
+void recordWeightSample(uint32_t busyUs, uint8_t readings); // Loop, per weight taken
+void recordWeightConversion(uint32_t busyUs);                // Sampler task, per chip read
+void recordUltrasonicSample(uint32_t busyUs);
+// Percent of wall time spent in sensor reads, and the fixed-rate estimate
+void getSamplingLoad(float &busyPercent, float &fixedRatePercent);
+const SamplingStats &getSamplingStats();
+int handleSamplingMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
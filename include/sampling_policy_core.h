@@ -0,0 +1,67 @@
+#ifndef SAMPLING_POLICY_CORE_H
+#define SAMPLING_POLICY_CORE_H
+
+#include <stdint.h>
+
+// Sampling modes, rates and the load estimate (sampling_policy.h), with no
+// Arduino dependencies so a day of activity can be simulated in the native
+// test environment. config.h includes this for the firmware.
+
+// Old fixed rates, which the load estimate compares against
+constexpr unsigned long ULTRASONIC_READ_INTERVAL = 200;
+constexpr unsigned long WEIGHT_READ_INTERVAL = 500;
+constexpr uint8_t SCALE_READINGS = 3; // Increased for better stability
+
+#define SAMPLING_POLICY_VERSION 1
+#define SAMPLING_DISPENSE_LINGER_MS 10000 // Covers HOPPER_SETTLE_MS and the level filter
+
+enum SamplingMode : uint8_t
+{
+  SAMPLING_IDLE,
+  SAMPLING_PRESENCE,
+  SAMPLING_DISPENSE,
+  SAMPLING_MODE_COUNT
+};
+
+struct SamplingRates
+{
+  uint32_t weightMs;
+  uint32_t ultrasonicMs;
+  uint8_t weightReadings; // HX711 conversions averaged per sample
+  uint8_t reserved[3];
+};
+
+struct SamplingPolicy
+{
+  uint16_t version;
+  uint16_t reserved;
+  SamplingRates rates[SAMPLING_MODE_COUNT];
+};
+
+struct SamplingStats
+{
+  SamplingMode mode = SAMPLING_IDLE;
+  unsigned long modeChanges = 0;
+  unsigned long weightReads = 0;
+  unsigned long weightConversions = 0;
+  unsigned long ultrasonicReads = 0;
+  uint64_t weightBusyUs = 0;
+  uint64_t ultrasonicBusyUs = 0;
+};
+
+extern const SamplingPolicy defaultSamplingPolicy;
+
+SamplingMode selectSamplingMode(bool hopperActive, bool petPresent);
+// Mode for this pass; the hopper counts as active for
+// SAMPLING_DISPENSE_LINGER_MS after 'hopperBusy' was last seen
+SamplingMode samplingModeAt(uint32_t &hopperActiveMillis, uint32_t nowMs, bool hopperBusy,
+                            bool petPresent);
+bool samplingRatesValid(const SamplingRates &rates);
+const char *getSamplingModeName(SamplingMode mode);
+
+// Percent of 'elapsedMs' spent in sensor reads, and what the fixed rates
+// above would have cost at the same measured cost per conversion and echo
+void samplingLoad(const SamplingStats &stats, uint32_t elapsedMs, float &busyPercent,
+                  float &fixedRatePercent);
+
+#endif
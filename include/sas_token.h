@@ -0,0 +1,30 @@
+#ifndef SAS_TOKEN_H
+#define SAS_TOKEN_H
+
+#include "config.h"
+#include "globals.h"
+#include "sas_token_core.h"
+
+// IoT Hub SAS tokens generated on the device
+// The device's shared access key (base64, as shown in the hub) is kept in
+// NVS. Tokens are signed with HMAC-SHA256 through mbedTLS, which uses the
+// ESP32 SHA accelerator, and renewed SAS_RENEW_BEFORE_S ahead of expiry.
+// Without a key or a synced clock the static SAS_TOKEN from secrets.h is used.
+
+#define SAS_NVS_NAMESPACE "iothub"
+#define SAS_TOKEN_TTL_S 86400     // 24 h tokens
+#define SAS_RENEW_BEFORE_S 3600   // Renew this long before expiry
+#define SAS_KEY_MAX 64            // Decoded key bytes (hub keys are 32)
+#define SAS_TOKEN_MAX 300
+
+// buildSasToken() from sas_token_core.h, signed with mbedTLS
+size_t buildSasToken(const uint8_t *key, size_t keyLength, const char *resourceUri,
+                     uint32_t expiry, char *out, size_t outSize);
+
+void setupSasToken();
+bool refreshSasToken();   // False without a key or a synced clock
+bool isSasRenewalDue();
+const char *getSasToken();
+int handleSasKeyMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SAS_TOKEN_CORE_H
+#define SAS_TOKEN_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// SAS token formatting (sas_token.h) with the HMAC passed in, so everything
+// but the signature itself builds in the native test environment. The
+// firmware passes mbedTLS HMAC-SHA256.
+
+#define SAS_DIGEST_BYTES 32
+
+// Writes the SAS_DIGEST_BYTES HMAC-SHA256 of 'message' under 'key' to 'digest'
+typedef bool (*SasHmac)(const uint8_t *key, size_t keyLength, const uint8_t *message,
+                        size_t messageLength, uint8_t *digest);
+
+// Percent-encodes everything outside the RFC 3986 unreserved set; returns
+// the encoded length, or 0 if 'out' is too small
+size_t urlEncode(const char *in, size_t inLength, char *out, size_t outSize);
+
+// Standard base64 with padding; returns the encoded length, or 0 if 'out'
+// is too small
+size_t base64Encode(const uint8_t *in, size_t inLength, char *out, size_t outSize);
+
+// Builds "SharedAccessSignature sr=..&sig=..&se=.." for resourceUri
+// ("<host>/devices/<id>"). Returns the token length, or 0 if 'out' is too small
+// or the HMAC fails.
+size_t buildSasToken(SasHmac hmac, const uint8_t *key, size_t keyLength, const char *resourceUri,
+                     uint32_t expiry, char *out, size_t outSize);
+
+#endif
@@ -3,11 +3,20 @@
 
 #include "config.h"
 #include "globals.h"
+#include "sensor_manager_core.h"
 
 void handleSensors();
-float readUltrasonicDistance();
-String getFoodLevel(float distanceInches);
-String getBowlStatus(float currentWeight);
-void updateLoadCellReading();
+unsigned long readUltrasonicEcho(); // Microseconds, 0 on timeout
+
+// The readings' pure state (sensor_manager_core.h); loop task only
+extern SensorCore sensorCore;
+
+// Change-tracked writes into 'sensors' and 'feederSystem'; loop task only
+void setFoodLevel(FoodLevel level);
+void setBowlStatus(BowlStatus status);
+void setFeedingStatus(FeedingStatus status);
+void setMotionDetected(bool motion);
+void setPetPresent(bool present);
+void setDispensing(bool dispensing);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef SENSOR_MANAGER_CORE_H
+#define SENSOR_MANAGER_CORE_H
+
+#include <stdint.h>
+#include "board_profile.h"
+#include "presence_core.h"
+#include "meal_tracker.h"
+
+// Sensor states and thresholds, with no Arduino dependencies, so the
+// classification logic builds in the native test environment as well.
+// config.h includes this for the firmware.
+
+// Sensor Thresholds (from the active board profile)
+constexpr float FOOD_FULL_DISTANCE = activeBoard.foodFullDistance;     // cm
+constexpr float FOOD_HALF_DISTANCE = activeBoard.foodHalfDistance;     // cm
+constexpr float FOOD_EMPTY_DISTANCE = activeBoard.foodEmptyDistance;   // cm
+constexpr float HOPPER_GRAMS_PER_CM = activeBoard.hopperGramsPerCm;    // Default hopper model
+constexpr float EMPTY_BOWL_THRESHOLD = activeBoard.emptyBowlThreshold; // grams
+constexpr float FULL_BOWL_THRESHOLD = activeBoard.fullBowlThreshold;   // grams
+
+// Sensor State Enums
+enum FoodLevel : uint8_t
+{
+  FOOD_LEVEL_EMPTY,
+  FOOD_LEVEL_HALF,
+  FOOD_LEVEL_FULL
+};
+
+enum BowlStatus : uint8_t
+{
+  BOWL_STATUS_EMPTY,
+  BOWL_STATUS_PARTIAL,
+  BOWL_STATUS_FULL,
+  BOWL_STATUS_ERROR // HX711 not responding
+};
+
+enum FeedingStatus : uint8_t
+{
+  FEEDING_STATUS_READY,
+  FEEDING_STATUS_DAILY_LIMIT,
+  FEEDING_STATUS_TOO_SOON,
+  FEEDING_STATUS_NO_FOOD,
+  FEEDING_STATUS_REFILL
+};
+
+// SensorData::changes bits, set when a field takes a new value and cleared
+// by markReportSent(); the report policy tests the mask instead of keeping
+// saved copies
+enum SensorChange : uint8_t
+{
+  CHANGE_FOOD_LEVEL = 1 << 0,
+  CHANGE_BOWL_STATUS = 1 << 1,
+  CHANGE_FEEDING_STATUS = 1 << 2,
+  CHANGE_MOTION = 1 << 3,     // Raw PIR level
+  CHANGE_PET_PRESENT = 1 << 4, // feederSystem.animalDetected
+  CHANGE_DISPENSING = 1 << 5   // feederSystem.dispensing
+};
+
+// Pure conversions and classifiers
+float echoToDistanceCm(unsigned long echoMicros); // Ultrasonic echo time to cm
+FoodLevel getFoodLevel(float distanceCm);
+BowlStatus getBowlStatus(float currentWeight);
+
+// String forms, for display and upstream payloads only
+const char *getFoodLevelName(FoodLevel level);
+const char *getBowlStatusName(BowlStatus status);
+const char *getFeedingStatusName(FeedingStatus status);
+
+// What handleSensors() does with each reading, on the pure state it keeps.
+// The firmware steps it with live readings and copies the results into
+// 'sensors' through the change-tracked setters; tools/trace_replay and
+// test_trace_recorder step it with recorded ones, so a replay decides what
+// the device decided. Meals, for one, are gated on the presence the tracker
+// latches until PIR_TIMEOUT after the last motion, not on the raw PIR level.
+struct SensorCore
+{
+  float distance = 0.0f;
+  FoodLevel foodLevel = FOOD_LEVEL_EMPTY;
+  float weight = 0.0f;
+  BowlStatus bowlStatus = BOWL_STATUS_EMPTY;
+  PresenceTracker presence; // presence.active is feederSystem.animalDetected
+  MealTracker meals;
+};
+
+// Hopper echo; false, and the last level kept, on a pulseIn() timeout (0)
+bool sensorEchoStep(SensorCore &core, unsigned long echoMicros);
+// Bowl weight: status and meal tracking; true and 'meal' when a meal ended
+bool sensorWeightStep(SensorCore &core, uint32_t nowMs, float weight, bool dispensing,
+                      MealEvent &meal);
+void sensorWeightLost(SensorCore &core); // HX711 not responding
+void sensorPirStep(SensorCore &core, const PirEdge &edge);
+// After the edges of a pass: true and 'visit' once per finished visit
+bool sensorPresenceStep(SensorCore &core, uint32_t nowMs, Visit &visit);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SERVO_MOTION_H
+#define SERVO_MOTION_H
+
+#include "config.h"
+#include "globals.h"
+#include "indicator.h"
+#include "servo_motion_core.h"
+
+// Servo motion controller
+// Angle moves follow a trapezoidal-velocity or S-curve (minimum jerk) profile
+// advanced by an esp_timer tick, so the loop never sleeps through a dispense
+// and the servo never slams between end stops (which is what pulled the supply
+// down during WiFi TX). A dispense is described as data: open/rest angles,
+// move and dwell times, cycle count and an optional agitation wiggle for clumps.
+// The active pattern can be changed with the "dispensePattern" direct method
+// and is kept in NVS.
+
+#define MOTION_NVS_NAMESPACE "motion"
+#define MOTION_TICK_US 10000        // Profile update period (servo frame is 20 ms)
+#define MOTION_MAX_SEGMENTS 96
+#define SERVO_MIN_US 544            // ESP32Servo defaults for 0 and 180 degrees
+#define SERVO_MAX_US 2400
+#define SERVO_REST_ANGLE 90
+
+void setupServoMotion();
+bool startDispenseMotion(const DispensePattern &pattern, const IndicatorPattern *moveCue);
+bool moveServoTo(uint8_t angle, uint16_t durationMs);
+void stopServoMotion(); // Returns to rest
+bool isServoMotionActive();
+uint8_t getDispenseCycle(); // 1-based cycle in progress, 0 when idle
+uint8_t getServoAngle();    // Last commanded angle, degrees
+const DispensePattern &getDispensePattern();
+int handleDispensePatternMethod(byte *payload, unsigned int length, String &responsePayload);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SERVO_MOTION_CORE_H
+#define SERVO_MOTION_CORE_H
+
+#include <stdint.h>
+
+// Dispense patterns and motion profile shapes (servo_motion.h), with no
+// Arduino dependencies so they build in the native test environment.
+
+#define MOTION_PATTERN_VERSION 1
+
+enum MotionProfile : uint8_t
+{
+  PROFILE_TRAPEZOID = 0,
+  PROFILE_SCURVE = 1
+};
+
+struct DispensePattern
+{
+  uint16_t version;
+  uint8_t profile;       // MotionProfile
+  uint8_t restAngle;
+  uint8_t openAngle;
+  uint8_t cycles;
+  uint8_t wiggleCount;   // Agitation moves at the open angle (0 = none)
+  uint8_t wiggleDegrees; // Wiggle amplitude around the open angle
+  uint16_t moveMs;       // Rest <-> open move time
+  uint16_t dwellMs;      // Hold at the open angle
+  uint16_t wiggleMs;     // Time per wiggle move
+  uint16_t pauseMs;      // Hold at rest between cycles
+};
+
+// Default: same 90/45 degree, three-cycle pattern as before, shaped moves and
+// shorter pauses
+#define DEFAULT_DISPENSE_PATTERN {MOTION_PATTERN_VERSION, PROFILE_SCURVE, 90, 45, 3, 0, 8, 250, 500, 120, 400}
+
+// Profile shape: fraction of the move completed at fraction t of its time
+float motionProfilePosition(MotionProfile profile, float t);
+bool isValidDispensePattern(const DispensePattern &pattern);
+uint32_t dispensePatternDurationMs(const DispensePattern &pattern);
+
+#endif
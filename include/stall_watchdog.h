@@ -0,0 +1,70 @@
+#ifndef STALL_WATCHDOG_H
+#define STALL_WATCHDOG_H
+
+#include "config.h"
+#include "globals.h"
+
+// Loop-stall watchdog
+// loop() checks in once per pass. A low-stack FreeRTOS task notices when it
+// hasn't within STALL_BUDGET_MS and attributes the stall to the instrumented
+// region that was active. The worst stalls are kept in RTC memory so they
+// survive the reset the hardware task watchdog performs as a last resort.
+
+#define STALL_BUDGET_MS 2000         // loop() pass longer than this is a stall
+#define STALL_POLL_MS 100            // Watchdog task period
+#define STALL_LOG_SIZE 8             // Worst stalls kept across resets
+#define HW_WATCHDOG_TIMEOUT_S 120    // Hardware task watchdog (last resort; > worst MQTT retry)
+
+enum StallRegion : uint8_t
+{
+  REGION_NONE,
+  REGION_SETUP,
+  REGION_BUTTONS,
+  REGION_DISPENSE,
+  REGION_SENSORS,
+  REGION_ULTRASONIC, // pulseIn()
+  REGION_SCALE,      // HX711 get_units()
+  REGION_MQTT_CONNECT,
+  REGION_MQTT_LOOP,  // Includes direct-method callbacks
+  REGION_TELEMETRY,
+  REGION_HTTP_POST,
+  REGION_NTP_SYNC,
+  REGION_LCD,
+  REGION_FLASH,      // LittleFS file writes
+  REGION_COUNT
+};
+
+struct StallRecord
+{
+  uint32_t durationMs;
+  uint32_t uptimeMs;   // Uptime when the stall began
+  uint32_t epoch;      // Wall clock when the stall began (0 = unknown)
+  uint32_t regionMs;   // How long 'region' had been active, up to when it ended
+  uint16_t bootCount;
+  uint8_t region;      // Active when the stall was detected
+  uint8_t fatal;       // 1 = ended in a hardware watchdog reset
+};
+
+// Marks the enclosed scope as a named blocking region for attribution
+class StallRegionScope
+{
+public:
+  explicit StallRegionScope(StallRegion region);
+  ~StallRegionScope();
+
+private:
+  StallRegion previousRegion;
+  unsigned long previousStart;
+};
+
+#define STALL_REGION(region) StallRegionScope stallRegionScope(region)
+
+void setupStallWatchdog();
+void armHardwareWatchdog();
+void stallWatchdogCheckIn();
+const char *getStallRegionName(uint8_t region);
+int getStallRecords(StallRecord *records, int maxRecords); // Worst first
+uint32_t getWorstStallMs();
+int handleGetStallsMethod(String &responsePayload);
+
+#endif
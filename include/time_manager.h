@@ -3,10 +3,11 @@
 
 #include "config.h"
 #include "globals.h"
+#include "calendar.h"
+#include "time_manager_core.h"
 
 String formatTime(const RtcDateTime &dt);
 String formatDateTime(const RtcDateTime &dt);
-RtcDateTime getPhilippineTime();
 RtcDateTime getNextScheduledFeedTime(const RtcDateTime &currentTime);
 bool shouldAutoFeed(const RtcDateTime &currentTime);
 
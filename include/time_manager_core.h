@@ -0,0 +1,20 @@
+#ifndef TIME_MANAGER_CORE_H
+#define TIME_MANAGER_CORE_H
+
+#include <stdint.h>
+#include "calendar_core.h"
+
+// Pure schedule logic behind time_manager.h. Times are seconds on any
+// midnight-aligned local clock (RtcDateTime seconds since 2000 on the device);
+// feeding times are minutes from midnight.
+
+// Within a minute of a feeding time (across midnight) and no feed in the
+// last hour. lastFeedSeconds 0 = never fed.
+bool isScheduledFeedDue(int minuteOfDay, const int *times, int count,
+                        uint32_t nowSeconds, uint32_t lastFeedSeconds);
+
+// Next feeding time strictly after nowSeconds: the earliest one still ahead
+// today, else the earliest one tomorrow. count must be at least 1.
+uint32_t nextScheduledFeedSeconds(uint32_t nowSeconds, const int *times, int count);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "config.h"
+#include "globals.h"
+#include "trace_recorder_core.h"
+
+// Sensor trace recorder
+// Streams timestamped raw inputs into a compact binary file on LittleFS so a
+// field misbehaviour can be replayed through the same logic later.
+//
+// File layout (little endian):
+//   header: "PFTR" | u8 version | u32 epoch at start (0 = unknown) | u32 millis at start
+//   record: varint deltaMillis | u8 type | payload
+//     TRACE_HX711    zigzag varint (raw counts - previous raw counts)
+//     TRACE_ECHO     varint echo time in microseconds
+//     TRACE_PIR      u8 level
+//     TRACE_BUTTON   u8 (button index << 1 | level)
+//     TRACE_MQTT     varint topicLength | topic | varint payloadLength | payload
+// Varints are unsigned LEB128. Topics are cut at TRACE_TOPIC_MAX and MQTT
+// payloads at TRACE_MQTT_MAX bytes. Encoding and the player that reads a trace
+// back are in trace_recorder_core.h.
+
+#define TRACE_FILE_PATH "/trace.bin"
+#define TRACE_BUFFER_SIZE 4096          // RAM staging buffer
+#define TRACE_FLUSH_INTERVAL 5000       // Flush at least this often while recording
+#define TRACE_MAX_FILE_BYTES 262144     // Recording stops at this size
+#define TRACE_UPLOAD_PAGE 32768         // Default bytes streamed per "upload" call
+#define TRACE_UPLOAD_PAGE_MAX 131072
+#ifndef TRACE_RECORD_AT_BOOT
+#define TRACE_RECORD_AT_BOOT 0          // Build with -DTRACE_RECORD_AT_BOOT=1 to start at power-up
+#endif
+
+struct TraceStats
+{
+  bool recording = false;
+  unsigned long records = 0;
+  unsigned long bytesWritten = 0;
+  unsigned long overruns = 0; // Records lost because the staging buffer was full
+};
+
+void setupTraceRecorder();
+void handleTraceRecorder();
+bool startTraceRecording();
+void stopTraceRecording();
+
+// Input taps; cheap no-ops while not recording
+void traceScaleRaw(long raw);
+void traceEchoMicros(unsigned long echoMicros);
+void tracePirLevel(bool level);
+void traceButtonLevel(uint8_t button, bool level);
+void traceMqttMessage(const char *topic, const byte *payload, unsigned int length);
+
+int handleTraceMethod(byte *payload, unsigned int length, String &responsePayload);
+const TraceStats &getTraceStats();
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef TRACE_RECORDER_CORE_H
+#define TRACE_RECORDER_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_manager_core.h"
+
+// Trace file encoding and the player that reads it back (layout in
+// trace_recorder.h). No Arduino dependencies: the recorder writes with these
+// encoders on the device, and the same player decodes an uploaded trace on a
+// host so it can be replayed through the pure cores (see
+// tools/trace_replay.cpp and test/test_trace_recorder).
+
+#define TRACE_VERSION 1
+#define TRACE_HEADER_BYTES 13
+#define TRACE_TOPIC_MAX 128
+#define TRACE_MQTT_MAX 256
+#define TRACE_RECORD_MAX (16 + TRACE_TOPIC_MAX + TRACE_MQTT_MAX) // Largest encoded record
+
+enum TraceRecordType : uint8_t
+{
+  TRACE_HX711 = 1,
+  TRACE_ECHO = 2,
+  TRACE_PIR = 3,
+  TRACE_BUTTON = 4,
+  TRACE_MQTT = 5
+};
+
+// Varints are unsigned LEB128, shared with the dispense capture files
+size_t putVarint(uint8_t *out, uint32_t value);
+uint32_t zigzag(int32_t value);
+int32_t unzigzag(uint32_t value);
+
+// Recorder side: each returns the bytes written to 'out' (at most
+// TRACE_RECORD_MAX; TRACE_HEADER_BYTES for the header)
+struct TraceEncoder
+{
+  uint32_t lastMillis;
+  int32_t lastScaleRaw;
+};
+
+size_t traceEncodeHeader(TraceEncoder &encoder, uint8_t *out, uint32_t epoch, uint32_t startMillis);
+size_t traceEncodeScaleRaw(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, int32_t raw);
+size_t traceEncodeEcho(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, uint32_t echoMicros);
+size_t traceEncodePir(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, bool level);
+size_t traceEncodeButton(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, uint8_t button,
+                         bool level);
+size_t traceEncodeMqtt(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, const char *topic,
+                       const uint8_t *payload, size_t length); // Cut at the limits above
+
+// Player side, over a whole trace in memory
+struct TraceRecord
+{
+  TraceRecordType type;
+  uint32_t millis;        // Device millis() when recorded
+  int32_t scaleRaw;       // TRACE_HX711: absolute raw counts
+  uint32_t echoMicros;    // TRACE_ECHO
+  uint8_t button;         // TRACE_BUTTON
+  bool level;             // TRACE_PIR, TRACE_BUTTON: pin level
+  const char *topic;      // TRACE_MQTT: points into the trace, not terminated
+  size_t topicLength;
+  const uint8_t *payload; // TRACE_MQTT: points into the trace
+  size_t payloadLength;
+};
+
+struct TracePlayer
+{
+  const uint8_t *data;
+  size_t length;
+  size_t offset;
+  uint32_t epoch;       // Wall clock at the start, 0 = unknown
+  uint32_t startMillis;
+  uint32_t millis;
+  int32_t scaleRaw;
+  bool corrupt;         // Stopped on a truncated or unknown record
+};
+
+bool traceOpen(TracePlayer &player, const uint8_t *data, size_t length); // False: not a trace
+bool traceNext(TracePlayer &player, TraceRecord &record);                // False at the end or on corruption
+
+// What a replayed record led to
+struct TraceReplayEvents
+{
+  bool levelRead;  // Valid echo: core.distance and core.foodLevel updated
+  bool mealEnded;  // 'meal' filled
+  bool visitEnded; // 'visit' filled
+  MealEvent meal;
+  Visit visit;
+};
+
+// Steps 'core' with one record the way handleSensors() stepped it when the
+// record was taken: first the visit check the loop makes every pass, then
+// sensorWeightStep() for an HX711 sample (raw counts to grams with 'offset'
+// and 'scale'), sensorEchoStep() for an echo and sensorPirStep() for a PIR
+// edge. The trace does not hold the dispensing flag; it is taken as false.
+void traceReplayRecord(SensorCore &core, const TraceRecord &record, long offset, float scale,
+                       TraceReplayEvents &events);
+
+#endif
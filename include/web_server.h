@@ -0,0 +1,23 @@
+#ifndef WEB_SERVER_H
+#define WEB_SERVER_H
+
+#include "config.h"
+#include "globals.h"
+#include "web_server_core.h"
+
+// Local dashboard server
+// GET /status returns a JSON snapshot and /ws streams live samples to LAN
+// browsers. Requests are served from the AsyncTCP task; the loop only
+// refreshes a snapshot and queues frames, so a slow client never blocks it.
+// Each client has a bounded send queue (WS_MAX_QUEUED_MESSAGES); frames for
+// a client whose queue is full are dropped rather than buffered. The client
+// table and the fan-out are in web_server_core.
+
+#define WEB_SERVER_PORT 80
+#define WEB_STREAM_INTERVAL_MS 100  // 10 Hz sample stream
+
+void setupWebServer();
+void handleWebServer();
+const WebServerStats &getWebServerStats();
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef WEB_SERVER_CORE_H
+#define WEB_SERVER_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor_manager_core.h"
+
+// Client table, connect and disconnect handling, the /status body, the
+// stream frame and the fan-out of the local dashboard, with no Arduino or
+// AsyncTCP dependencies so the connection limit and the backpressure rules
+// build in the native test environment. The firmware supplies the send
+// function; test/test_web_server supplies simulated clients with bounded
+// queues. What stays on the device is the AsyncWebServer/AsyncWebSocket
+// glue: accepting sockets, writing the close frame and the library's own
+// send queue.
+
+#define WEB_MAX_CLIENTS 4           // WebSocket connections beyond this are refused
+#define WEB_FRAME_MAX 160
+#define WEB_STATUS_MAX 320
+#define WEB_CLOSE_TRY_AGAIN 1013    // Close code for refused connections
+
+struct WebServerStats
+{
+  uint8_t clients = 0;
+  unsigned long framesSent = 0;
+  unsigned long framesDropped = 0; // Client send queue was full
+  unsigned long rejected = 0;      // Connections refused by WEB_MAX_CLIENTS
+  unsigned long statusRequests = 0;
+};
+
+// Copied out of the loop task; read by the server task
+struct WebSnapshot
+{
+  unsigned long uptimeMs;
+  float weight;
+  float distance;
+  float dailyFoodDispensed;
+  FoodLevel foodLevel;
+  BowlStatus bowlStatus;
+  FeedingStatus feedingStatus;
+  bool motion;
+  bool dispensing;
+};
+
+struct WebClientTable
+{
+  uint32_t ids[WEB_MAX_CLIENTS];
+  uint8_t count;
+};
+
+bool webClientAdmit(WebClientTable &table, uint32_t id);  // False: table full, refuse it
+bool webClientRemove(WebClientTable &table, uint32_t id); // False: was never admitted
+
+// WebSocket connect and disconnect events: update the table and the client
+// and refusal counts. False from webClientConnect() means close the socket
+// with WEB_CLOSE_TRY_AGAIN.
+bool webClientConnect(WebClientTable &table, uint32_t id, WebServerStats &stats);
+void webClientDisconnect(WebClientTable &table, uint32_t id, WebServerStats &stats);
+
+// One stream sample; returns the frame length (always < WEB_FRAME_MAX)
+int formatStreamFrame(char *out, size_t size, const WebSnapshot &s);
+// GET /status body; returns its length (always < WEB_STATUS_MAX)
+int formatStatusJson(char *out, size_t size, const WebSnapshot &s, const WebServerStats &stats);
+
+enum WebSendResult : uint8_t
+{
+  WEB_SEND_OK,
+  WEB_SEND_FULL, // Client queue full: this frame is dropped for it
+  WEB_SEND_GONE  // Disconnected between the table copy and the send
+};
+
+// What a send to a client in this state does
+WebSendResult webSendResultFor(bool connected, bool queueFull);
+
+// Must not block: a client that cannot take the frame now reports FULL
+typedef WebSendResult (*WebSendFrame)(void *context, uint32_t clientId, const char *frame,
+                                      size_t length);
+
+// Offers one frame to every client in the table, counting sent and dropped
+// frames in 'stats'
+void webFanOut(const WebClientTable &clients, const char *frame, size_t length, WebSendFrame send,
+               void *context, WebServerStats &stats);
+
+#endif
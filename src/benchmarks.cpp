@@ -0,0 +1,170 @@
+#include "benchmarks.h"
+#include "json_pool.h"
+#include "sensor_manager.h"
+#include "time_manager.h"
+#include "network_manager.h"
+#include "servo_motion.h"
+#include "sas_token.h"
+#include "calendar.h"
+#include "hopper_model.h"
+#include <ArduinoJson.h>
+
+#if RUN_BENCHMARKS
+
+static volatile uint32_t benchmarkSink; // Keeps results observable
+
+typedef void (*BenchmarkBody)(uint32_t i);
+
+struct Benchmark
+{
+  const char *name;
+  BenchmarkBody body;
+};
+
+static void benchFoodLevel(uint32_t i)
+{
+  benchmarkSink += getFoodLevel((i % 250) * 0.1f);
+}
+
+static void benchBowlStatus(uint32_t i)
+{
+  benchmarkSink += getBowlStatus((float)(i % 300));
+}
+
+static void benchFormatTime(uint32_t i)
+{
+  benchmarkSink += formatTime(RtcDateTime(i * 61)).length();
+}
+
+static void benchFormatDateTime(uint32_t i)
+{
+  benchmarkSink += formatDateTime(RtcDateTime(i * 86461)).length();
+}
+
+static void benchLocalTime(uint32_t i)
+{
+  benchmarkSink += toLocalTime(RtcDateTime(i * 3607)).Hour();
+}
+
+static void benchCivilFromUnix(uint32_t i)
+{
+  benchmarkSink += civilFromUnix(UNIX_EPOCH_2000 + i * 86461).day;
+}
+
+static void benchNextFeed(uint32_t i)
+{
+  benchmarkSink += getNextScheduledFeedTime(RtcDateTime(i * 607)).Minute();
+}
+
+static void benchFeedDue(uint32_t i)
+{
+  benchmarkSink += isScheduledFeedDue(i % MINUTES_PER_DAY, feedingTimes, numFeedingTimes,
+                                      i * 60, 0);
+}
+
+static void benchMethodTopic(uint32_t i)
+{
+  char method[METHOD_NAME_MAX];
+  char requestId[REQUEST_ID_MAX];
+  benchmarkSink += parseMethodTopic("$iothub/methods/POST/runMotors/?$rid=42", method, sizeof(method),
+                                    requestId, sizeof(requestId));
+}
+
+static void benchMotionProfile(uint32_t i)
+{
+  benchmarkSink += (uint32_t)(motionProfilePosition(PROFILE_SCURVE, (i % 100) * 0.01f) * 1000);
+}
+
+static void benchSasToken(uint32_t i)
+{
+  static const uint8_t key[32] = {0x5a, 0x17, 0xc3, 0x08}; // Hub-sized key
+  char token[SAS_TOKEN_MAX];
+  benchmarkSink += buildSasToken(key, sizeof(key), "example.azure-devices.net/devices/PetFeeder_001",
+                                 1700000000 + i, token, sizeof(token));
+}
+
+static void benchConsumptionFit(uint32_t i)
+{
+  static ConsumptionFit fit = {};
+  consumptionFitAdd(fit, 1.0f / 144, 1500.0f - (i % 1000) * 0.5f, HOPPER_HALF_LIFE_DAYS);
+  benchmarkSink += (uint32_t)forecastDaysUntilEmpty(fit, HOPPER_MIN_SPAN_DAYS, HOPPER_MIN_RATE);
+}
+
+static const Benchmark benchmarks[] = {
+    {"getFoodLevel", benchFoodLevel},
+    {"getBowlStatus", benchBowlStatus},
+    {"formatTime", benchFormatTime},
+    {"formatDateTime", benchFormatDateTime},
+    {"toLocalTime", benchLocalTime},
+    {"civilFromUnix", benchCivilFromUnix},
+    {"getNextScheduledFeedTime", benchNextFeed},
+    {"isScheduledFeedDue", benchFeedDue},
+    {"parseMethodTopic", benchMethodTopic},
+    {"motionProfilePosition", benchMotionProfile},
+    {"buildSasToken", benchSasToken},
+    {"consumptionFit", benchConsumptionFit},
+};
+
+static uint32_t runRound(BenchmarkBody body)
+{
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++)
+  {
+    body(i);
+  }
+  return ESP.getCycleCount() - start;
+}
+
+static uint32_t medianNanosPerOp(BenchmarkBody body)
+{
+  uint32_t rounds[BENCHMARK_ROUNDS];
+  for (int r = 0; r < BENCHMARK_ROUNDS; r++)
+  {
+    rounds[r] = runRound(body);
+  }
+
+  // Insertion sort; five entries
+  for (int i = 1; i < BENCHMARK_ROUNDS; i++)
+  {
+    uint32_t value = rounds[i];
+    int j = i - 1;
+    while (j >= 0 && rounds[j] > value)
+    {
+      rounds[j + 1] = rounds[j];
+      j--;
+    }
+    rounds[j + 1] = value;
+  }
+
+  uint32_t cycles = rounds[BENCHMARK_ROUNDS / 2];
+  return (uint32_t)((uint64_t)cycles * 1000 / ESP.getCpuFreqMHz() / BENCHMARK_ITERATIONS);
+}
+
+void runBenchmarks()
+{
+  Serial.println("\n=== Running benchmarks ===");
+
+  JsonDocument &doc = borrowJsonDocument();
+  doc["deviceId"] = DEVICE_ID;
+  doc["messageType"] = "benchmark";
+  doc["build"] = __DATE__ " " __TIME__;
+  doc["cpuMHz"] = ESP.getCpuFreqMHz();
+  JsonObject results = doc.createNestedObject("nsPerOp");
+
+  for (size_t i = 0; i < ARRAY_SIZE(benchmarks); i++)
+  {
+    runRound(benchmarks[i].body); // Warm caches and the heap
+    uint32_t nanos = medianNanosPerOp(benchmarks[i].body);
+    results[benchmarks[i].name] = nanos;
+    Serial.printf("BENCH %s %lu\n", benchmarks[i].name, (unsigned long)nanos);
+    yield();
+  }
+
+  char *payload = borrowJsonText();
+  size_t length = serializeJson(doc, payload, JSON_TEXT_SIZE);
+  if (publishTelemetryEvent(payload, length))
+    Serial.println("✓ Benchmark results published");
+  Serial.println("==========================\n");
+}
+
+#endif
@@ -1,200 +1,393 @@
 #include "button_handler.h"
 #include "feeding_control.h"
 #include "globals.h"
+#include "calibration.h"
+#include "servo_motion.h"
+#include "stall_watchdog.h"
+#include "trace_recorder.h"
+#include "logger.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const char *TAG = "buttons";
+
+struct ButtonEdge
+{
+  uint32_t micros;
+  uint8_t button;
+  uint8_t level; // Raw pin level; LOW = pressed
+};
+
+// Button task -> loop: debounced levels (gesture NONE) for the trace, and
+// committed actions for feedback
+struct ButtonNotice
+{
+  uint8_t button;
+  uint8_t gesture;
+  uint8_t action;
+  uint8_t value; // Level: pressed; action: committed
+};
 
-// Button state variables
-bool lastButton1State = HIGH;
-bool lastButton2State = HIGH;
-unsigned long lastButton1Press = 0;
-unsigned long lastButton2Press = 0;
-const unsigned long debounceDelay = 200; // Reduced from 300
-void performManualFeed();                // Forward declaration
-void initButtons()
+struct ButtonInput
 {
-  pinMode(BUTTON1_PIN, INPUT_PULLUP);
-  pinMode(BUTTON2_PIN, INPUT_PULLUP);
+  uint8_t pin;
+  bool pressed;        // Debounced
+  bool settling;       // Inside the debounce window
+  uint32_t acceptedAt; // micros() of the last debounced edge
+  GestureTracker gesture;
+};
+
+// Both ISRs run from the one GPIO interrupt handler, so they never overlap:
+// still a single producer
+static ButtonEdge edgeRing[BUTTON_EDGE_RING];
+static volatile uint8_t edgeHead = 0;
+static volatile uint8_t edgeTail = 0;
+static volatile uint32_t edgeOverflows = 0;
+
+static ButtonNotice noticeRing[BUTTON_NOTICE_RING];
+static volatile uint8_t noticeHead = 0;
+static volatile uint8_t noticeTail = 0;
+
+static ButtonInput inputs[BUTTON_COUNT];
+static ButtonStats buttonStats;
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED; // Latency comes from the task and the loop
+static std::atomic<bool> tareRequested(false);
+static uint32_t tareDecidedUs = 0; // Written before tareRequested is set
+static std::atomic<bool> manualFeedStarted(false);
+static unsigned long manualFeedStartMs = 0; // Written before manualFeedStarted is set
+static TaskHandle_t buttonTask = nullptr;
+
+static const ButtonAction actionMap[BUTTON_COUNT][GESTURE_COUNT] = {
+    // NONE, PRESS, CLICK, DOUBLE, LONG, REPEAT
+    {BUTTON_ACTION_NONE, BUTTON_ACTION_FEED, BUTTON_ACTION_NONE, BUTTON_ACTION_NONE,
+     BUTTON_ACTION_FEED, BUTTON_ACTION_FEED},
+    {BUTTON_ACTION_NONE, BUTTON_ACTION_NONE, BUTTON_ACTION_AUTO_FEED, BUTTON_ACTION_REFILL,
+     BUTTON_ACTION_TARE, BUTTON_ACTION_NONE},
+};
+
+static inline void IRAM_ATTR pushEdge(uint8_t button, uint8_t pin)
+{
+  uint8_t head = edgeHead;
+  uint8_t next = (head + 1) & (BUTTON_EDGE_RING - 1);
+  if (next == edgeTail)
+  {
+    edgeOverflows++;
+  }
+  else
+  {
+    edgeRing[head].micros = micros();
+    edgeRing[head].button = button;
+    edgeRing[head].level = digitalRead(pin);
+    edgeHead = next;
+  }
 
-  // Read initial states
-  lastButton1State = digitalRead(BUTTON1_PIN);
-  lastButton2State = digitalRead(BUTTON2_PIN);
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(buttonTask, &woken);
+  portYIELD_FROM_ISR(woken);
+}
 
-  Serial.println("Buttons initialized with INPUT_PULLUP");
-  Serial.printf("Button 1 Pin: %d, Initial State: %s\n", BUTTON1_PIN, lastButton1State ? "HIGH (not pressed)" : "LOW (pressed)");
-  Serial.printf("Button 2 Pin: %d, Initial State: %s\n", BUTTON2_PIN, lastButton2State ? "HIGH (not pressed)" : "LOW (pressed)");
+static void IRAM_ATTR button1EdgeIsr()
+{
+  pushEdge(0, BUTTON1_PIN);
 }
 
-void handleButtons()
+static void IRAM_ATTR button2EdgeIsr()
+{
+  pushEdge(1, BUTTON2_PIN);
+}
+
+static void postNotice(uint8_t button, uint8_t gesture, uint8_t action, bool value)
 {
-  // Read current button states
-  bool button1State = digitalRead(BUTTON1_PIN);
-  bool button2State = digitalRead(BUTTON2_PIN);
-  unsigned long currentTime = millis();
+  uint8_t head = noticeHead;
+  uint8_t next = (head + 1) & (BUTTON_NOTICE_RING - 1);
+  if (next == noticeTail)
+    return; // Feedback only; the action itself has already happened
+  noticeRing[head] = {button, gesture, action, (uint8_t)(value ? 1 : 0)};
+  noticeHead = next;
+}
 
-  // Debug button states periodically - reduced frequency
-  static unsigned long lastDebugPrint = 0;
-  if (currentTime - lastDebugPrint > 10000) // Every 10 seconds instead of 5
+// Called where an action takes effect, with the time of the input that
+// decided it
+static void recordActionLatency(uint32_t decidedUs)
+{
+  uint32_t latencyUs = micros() - decidedUs;
+  portENTER_CRITICAL(&statsLock);
+  buttonStats.actions++;
+  buttonStats.lastLatencyUs = latencyUs;
+  buttonStats.totalLatencyUs += latencyUs;
+  if (latencyUs > buttonStats.maxLatencyUs)
+    buttonStats.maxLatencyUs = latencyUs;
+  if (latencyUs > BUTTON_LATENCY_BUDGET_US)
+    buttonStats.overBudget++;
+  portEXIT_CRITICAL(&statsLock);
+}
+
+// Button task. An admissible feed starts its motion here and the loop
+// finishes the bookkeeping; anything else is left to the feed queue, which
+// also reports a rejection
+static bool startManualFeed(uint32_t decidedUs)
+{
+  if (feederSystem.refillMode)
+    return false;
+
+  FeedAdmission admission = getFeedAdmission(FEED_SOURCE_MANUAL);
+  if (admission == FEED_ADMIT_NOW && startDispenseMotion(getDispensePattern(), &PATTERN_DISPENSE_MOVE))
   {
-    Serial.printf("Button States - B1: %s (%s), B2: %s (%s), Dispensing: %s\n",
-                  button1State ? "HIGH" : "LOW",
-                  button1State ? "NOT PRESSED" : "PRESSED",
-                  button2State ? "HIGH" : "LOW",
-                  button2State ? "NOT PRESSED" : "PRESSED",
-                  feederSystem.dispensing ? "YES" : "NO");
-    lastDebugPrint = currentTime;
+    manualFeedStartMs = millis();
+    manualFeedStarted.store(true);
+    recordActionLatency(decidedUs); // The motion tick picks it up within MOTION_TICK_US
+    return true;
   }
 
-  // Handle Button 1 (Manual Feed/Dispense) - ACTIVE LOW (pressed = LOW)
-  // Only trigger on falling edge (HIGH to LOW transition)
-  if (button1State == LOW && lastButton1State == HIGH &&
-      (currentTime - lastButton1Press) > debounceDelay)
+  if (!requestFeed(FEED_SOURCE_MANUAL))
+    return false;
+  if (admission != FEED_ADMIT_REJECT)
+    buttonStats.deferred++; // Task only
+  return true;
+}
+
+// Runs on the button task: commits the action. Toggles and direct feeds take
+// effect here; the tare records its latency where it actually runs
+static void dispatchGesture(uint8_t button, ButtonGesture gesture, uint32_t decidedUs)
+{
+  ButtonAction action = actionMap[button][gesture];
+  if (action == BUTTON_ACTION_NONE)
+    return;
+
+  bool committed = true;
+  switch (action)
   {
-    Serial.println("=== BUTTON 1 PRESSED - Manual feed triggered ===");
-    lastButton1Press = currentTime;
+  case BUTTON_ACTION_FEED:
+    committed = startManualFeed(decidedUs);
+    break;
+  case BUTTON_ACTION_AUTO_FEED:
+    feederSystem.autoFeedingEnabled = !feederSystem.autoFeedingEnabled;
+    recordActionLatency(decidedUs);
+    break;
+  case BUTTON_ACTION_REFILL:
+    // Refill pauses automatic feeding until it ends
+    feederSystem.refillMode = !feederSystem.refillMode;
+    feederSystem.autoFeedingEnabled = !feederSystem.refillMode;
+    recordActionLatency(decidedUs);
+    break;
+  case BUTTON_ACTION_TARE:
+    tareDecidedUs = decidedUs;
+    tareRequested.store(true); // Scale reads belong to the loop
+    break;
+  default:
+    break;
+  }
 
-    // Check if enough time has passed since last dispensing - reduced cooldown
-    bool canDispense = !feederSystem.dispensing &&
-                       (currentTime - timing.lastFeedingTime >= 500); // Reduced from 1000ms to 500ms
+  postNotice(button, gesture, action, committed);
+}
+
+static void acceptLevel(uint8_t button, bool pressed, uint32_t atUs)
+{
+  ButtonInput &input = inputs[button];
+  input.pressed = pressed;
+  input.settling = true;
+  input.acceptedAt = atUs;
+  postNotice(button, GESTURE_NONE, BUTTON_ACTION_NONE, pressed);
+  dispatchGesture(button, gestureOnEdge(input.gesture, pressed, atUs), atUs);
+}
 
-    if (canDispense)
+static void drainEdges()
+{
+  while (edgeTail != edgeHead)
+  {
+    ButtonEdge edge = edgeRing[edgeTail];
+    edgeTail = (edgeTail + 1) & (BUTTON_EDGE_RING - 1);
+
+    ButtonInput &input = inputs[edge.button];
+    bool pressed = edge.level == LOW;
+    buttonStats.edges++;
+    if ((input.settling && edge.micros - input.acceptedAt < DEBOUNCE_DELAY * 1000UL) ||
+        pressed == input.pressed)
     {
-      // Call performManualFeed directly to override all restrictions
-      Serial.println("Starting MANUAL OVERRIDE feeding sequence...");
-      performManualFeed();
+      buttonStats.bounces++;
+      continue;
     }
-    else
+    acceptLevel(edge.button, pressed, edge.micros);
+  }
+  buttonStats.overflows = edgeOverflows;
+}
+
+// Ticks until the next debounce window or gesture deadline
+static TickType_t nextWakeTicks(uint32_t nowUs)
+{
+  TickType_t wait = portMAX_DELAY;
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+  {
+    uint32_t deadlines[2];
+    uint8_t count = 0;
+    if (inputs[b].settling)
+      deadlines[count++] = inputs[b].acceptedAt + DEBOUNCE_DELAY * 1000UL;
+    if (gestureNextDeadline(inputs[b].gesture, deadlines[count]))
+      count++;
+
+    for (uint8_t i = 0; i < count; i++)
     {
-      // Show a message explaining why we can't dispense
-      if (feederSystem.dispensing)
-      {
-        Serial.println("Cannot dispense - already dispensing (button press ignored)");
-      }
-      else
-      {
-        Serial.println("Cannot dispense - cooldown period (button press ignored)");
-
-        // Show cooldown message on LCD - reduced delay
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print("Please wait");
-        lcd.setCursor(0, 1);
-        lcd.print("Cooldown active");
-        delay(500); // Reduced from 1000ms
-      }
+      int32_t remainingUs = (int32_t)(deadlines[i] - nowUs);
+      TickType_t ticks = remainingUs <= 0 ? 0 : pdMS_TO_TICKS((remainingUs + 999) / 1000);
+      if (ticks < wait)
+        wait = ticks;
     }
   }
+  return wait;
+}
 
-  // Handle Button 2 (Settings/Mode toggle) - ACTIVE LOW
-  if (button2State == LOW && lastButton2State == HIGH &&
-      (currentTime - lastButton2Press) > debounceDelay)
+static void buttonTaskLoop(void *)
+{
+  for (;;)
   {
-    Serial.println("=== BUTTON 2 PRESSED - Toggle auto feeding ===");
-    lastButton2Press = currentTime;
+    ulTaskNotifyTake(pdTRUE, nextWakeTicks(micros()));
 
-    // Toggle auto feeding mode
-    feederSystem.autoFeedingEnabled = !feederSystem.autoFeedingEnabled;
+    drainEdges();
 
-    Serial.printf("Auto feeding is now: %s\n",
-                  feederSystem.autoFeedingEnabled ? "ENABLED" : "DISABLED");
+    uint32_t now = micros();
+    for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+    {
+      ButtonInput &input = inputs[b];
 
-    // Show status on LCD - reduced delay
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("Auto Feeding:");
-    lcd.setCursor(0, 1);
-    lcd.print(feederSystem.autoFeedingEnabled ? "ENABLED " : "DISABLED");
-    delay(1000); // Reduced from 2000
-  }
+      // Window over: catch a change the lockout swallowed
+      if (input.settling && now - input.acceptedAt >= DEBOUNCE_DELAY * 1000UL)
+      {
+        input.settling = false;
+        bool pressed = digitalRead(input.pin) == LOW;
+        if (pressed != input.pressed)
+          acceptLevel(b, pressed, now);
+      }
 
-  // Update last states
-  lastButton1State = button1State;
-  lastButton2State = button2State;
+      uint32_t decidedUs;
+      ButtonGesture gesture;
+      while ((gesture = gestureOnTime(input.gesture, now, decidedUs)) != GESTURE_NONE)
+        dispatchGesture(b, gesture, decidedUs);
+    }
+  }
 }
 
-void performManualFeed()
+void initButtons()
 {
-  // Set dispensing flag immediately to prevent multiple triggers
-  feederSystem.dispensing = true;
-  timing.dispenseStartTime = millis();
+  if (buttonTask != nullptr)
+    return;
+
+  pinMode(BUTTON1_PIN, INPUT_PULLUP);
+  pinMode(BUTTON2_PIN, INPUT_PULLUP);
 
-  Serial.println("=== STARTING MANUAL FEED SEQUENCE ===");
+  inputs[0].pin = BUTTON1_PIN;
+  inputs[0].gesture.longUs = BUTTON_LONG_MS * 1000UL;
+  inputs[0].gesture.repeatUs = BUTTON_REPEAT_MS * 1000UL;
+  inputs[1].pin = BUTTON2_PIN;
+  inputs[1].gesture.longUs = BUTTON_TARE_HOLD_MS * 1000UL;
+  inputs[1].gesture.doubleUs = BUTTON_DOUBLE_MS * 1000UL;
 
-  // Display dispensing status on LCD
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print("Manual Dispensing");
+  // A button held through boot is not a press
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+  {
+    inputs[b].pressed = digitalRead(inputs[b].pin) == LOW;
+    inputs[b].gesture.pressed = inputs[b].pressed;
+    inputs[b].gesture.held = inputs[b].pressed;
+  }
 
-  // Servo dispensing: Move servo from 90 to 45 degrees and back, 3 times with 1s delay
-  // (Matching your working servo code exactly)
-  for (int i = 0; i < 3; i++)
+  // Same core as the loop, so an action never waits for a blocking loop pass
+  if (xTaskCreatePinnedToCore(buttonTaskLoop, "buttons", BUTTON_TASK_STACK, nullptr,
+                              BUTTON_TASK_PRIORITY, &buttonTask, 1) != pdPASS)
   {
-    Serial.printf("Dispensing cycle %d/3\n", i + 1);
+    buttonTask = nullptr;
+    Serial.println("✗ Button task could not be started");
+    return;
+  }
+  attachInterrupt(digitalPinToInterrupt(BUTTON1_PIN), button1EdgeIsr, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(BUTTON2_PIN), button2EdgeIsr, CHANGE);
 
-    // Update LCD with cycle number
-    lcd.setCursor(0, 1);
-    lcd.print("Cycle ");
-    lcd.print(i + 1);
-    lcd.print(" of 3     ");
+  Serial.println("✓ Buttons on interrupts (B1 feed/hold, B2 auto/double refill/hold tare)");
+  Serial.printf("Button 1 Pin: %d, Initial State: %s\n", BUTTON1_PIN, inputs[0].pressed ? "LOW (pressed)" : "HIGH (not pressed)");
+  Serial.printf("Button 2 Pin: %d, Initial State: %s\n", BUTTON2_PIN, inputs[1].pressed ? "LOW (pressed)" : "HIGH (not pressed)");
+}
 
-    // Move servo to 45 degrees (left) - matching your working code
-    myServo.write(45);
+static void showActionFeedback(const ButtonNotice &notice)
+{
+  LOGI(TAG, "Button %u: %s (%s)", notice.button + 1, getButtonActionName(notice.action),
+       notice.value ? "done" : "refused");
 
-    // Buzzer sound when moving
-    digitalWrite(BUZZER_PIN, HIGH);
-    delay(200);
-    digitalWrite(BUZZER_PIN, LOW);
+  switch (notice.action)
+  {
+  case BUTTON_ACTION_FEED:
+    startIndicatorPattern(PATTERN_BUTTON_BEEP);
+    if (!notice.value && feederSystem.refillMode)
+      showLCDMessage("REFILL MODE", "Feed blocked", BUTTON_MESSAGE_MS);
+    else if (!notice.value)
+      showLCDMessage("Feed queue full", "Try again", BUTTON_MESSAGE_MS);
+    else if (!feederSystem.dispensing && isFeedCooldownActive())
+      showLCDMessage("Please wait", "Feed queued", BUTTON_MESSAGE_MS);
+    break;
+  case BUTTON_ACTION_AUTO_FEED:
+    startIndicatorPattern(PATTERN_BUTTON_BEEP);
+    showLCDMessage("Auto Feeding:", feederSystem.autoFeedingEnabled ? "ENABLED" : "DISABLED",
+                   BUTTON_MESSAGE_MS);
+    break;
+  case BUTTON_ACTION_REFILL:
+    startBeepPattern(2, BUZZER_SHORT_BEEP, BUZZER_SHORT_PAUSE);
+    if (feederSystem.refillMode)
+      showLCDMessage("REFILL MODE", "System Paused", BUTTON_MESSAGE_MS);
+    else
+      showLCDMessage("System Resumed", "Ready", BUTTON_MESSAGE_MS);
+    break;
+  default:
+    break;
+  }
+}
 
-    delay(500); // Wait in position
+void handleButtons()
+{
+  STALL_REGION(REGION_BUTTONS);
 
-    // Return servo to 90 degrees (center)
-    myServo.write(90);
+  // Before the notices, so their feedback sees the dispense running
+  if (manualFeedStarted.exchange(false))
+    dispenseStarted("Manual Override", "Manual Dispensing", &PATTERN_FEED_COMPLETE, manualFeedStartMs);
 
-    // Buzzer sound when returning
-    digitalWrite(BUZZER_PIN, HIGH);
-    delay(200);
-    digitalWrite(BUZZER_PIN, LOW);
+  while (noticeTail != noticeHead)
+  {
+    ButtonNotice notice = noticeRing[noticeTail];
+    noticeTail = (noticeTail + 1) & (BUTTON_NOTICE_RING - 1);
 
-    // 1 second delay between cycles (except after last cycle)
-    if (i < 2)
-    {
-      delay(1000);
-    }
+    if (notice.gesture == GESTURE_NONE)
+      traceButtonLevel(notice.button + 1, !notice.value); // Pin level: HIGH = released
+    else
+      showActionFeedback(notice);
   }
 
-  // Final confirmation - reduced delay
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print("Complete!");
-  lcd.setCursor(0, 1);
-  lcd.print("Food Dispensed");
-
-  // Final buzzer sequence
-  for (int i = 0; i < 3; i++)
+  if (tareRequested.exchange(false))
   {
-    digitalWrite(BUZZER_PIN, HIGH);
-    delay(150);
-    digitalWrite(BUZZER_PIN, LOW);
-    delay(150);
+    bool tared = tareScale();
+    recordActionLatency(tareDecidedUs);
+    startIndicatorPattern(PATTERN_BUTTON_BEEP);
+    showLCDMessage(tared ? "Bowl tared" : "Tare failed", tared ? "0.0 g" : "Scale not ready",
+                   BUTTON_MESSAGE_MS);
   }
+}
 
-  delay(500); // Reduced from 1000
-
-  // Clear dispensing flag and update timing
-  feederSystem.dispensing = false;
-  timing.lastFeedingTime = millis();
-
-  // Record the manual feeding
-  recordFoodDispensing("Manual Override");
-
-  Serial.println("=== MANUAL FEEDING SEQUENCE COMPLETED ===");
-  Serial.println("Ready for next dispensing");
+const ButtonStats &getButtonStats()
+{
+  return buttonStats;
 }
 
-bool isButton1Pressed()
+const char *getButtonActionName(uint8_t action)
 {
-  return digitalRead(BUTTON1_PIN) == LOW;
+  static const char *names[] = {"none", "feed", "auto feeding", "refill mode", "tare"};
+  return action < ARRAY_SIZE(names) ? names[action] : "unknown";
 }
 
-bool isButton2Pressed()
+bool performManualFeed()
 {
-  return digitalRead(BUTTON2_PIN) == LOW;
-}
\ No newline at end of file
+  // Started by the feed queue for a press that had to wait. Runs the dispense
+  // pattern in the background; checkFeedingComplete() records it once the
+  // servo is back at rest
+  if (!beginDispense("Manual Override", "Manual Dispensing", &PATTERN_DISPENSE_MOVE, &PATTERN_FEED_COMPLETE))
+  {
+    LOGW(TAG, "Cannot start manual feed - already dispensing");
+    return false;
+  }
+  return true;
+}
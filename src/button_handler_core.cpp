@@ -0,0 +1,72 @@
+#include "button_handler_core.h"
+
+ButtonGesture gestureOnEdge(GestureTracker &tracker, bool pressed, uint32_t nowUs)
+{
+  if (pressed)
+  {
+    if (tracker.pressed)
+      return GESTURE_NONE;
+    tracker.pressed = true;
+    tracker.held = false;
+    tracker.pressedAt = nowUs;
+    return GESTURE_PRESS;
+  }
+
+  if (!tracker.pressed)
+    return GESTURE_NONE;
+  tracker.pressed = false;
+  if (tracker.held)
+    return GESTURE_NONE;
+  if (tracker.doubleUs == 0)
+    return GESTURE_CLICK;
+
+  if (++tracker.clicks >= 2)
+  {
+    tracker.clicks = 0;
+    return GESTURE_DOUBLE;
+  }
+  tracker.releasedAt = nowUs;
+  return GESTURE_NONE;
+}
+
+ButtonGesture gestureOnTime(GestureTracker &tracker, uint32_t nowUs, uint32_t &decidedUs)
+{
+  if (tracker.pressed && !tracker.held && nowUs - tracker.pressedAt >= tracker.longUs)
+  {
+    tracker.held = true;
+    tracker.clicks = 0; // A click followed by a hold is just a hold
+    decidedUs = tracker.pressedAt + tracker.longUs;
+    tracker.nextRepeatAt = decidedUs + tracker.repeatUs;
+    return GESTURE_LONG;
+  }
+
+  if (tracker.pressed && tracker.held && tracker.repeatUs > 0 &&
+      (int32_t)(nowUs - tracker.nextRepeatAt) >= 0)
+  {
+    decidedUs = tracker.nextRepeatAt;
+    tracker.nextRepeatAt += tracker.repeatUs;
+    return GESTURE_REPEAT;
+  }
+
+  if (!tracker.pressed && tracker.clicks == 1 && nowUs - tracker.releasedAt >= tracker.doubleUs)
+  {
+    tracker.clicks = 0;
+    decidedUs = tracker.releasedAt + tracker.doubleUs;
+    return GESTURE_CLICK;
+  }
+
+  return GESTURE_NONE;
+}
+
+bool gestureNextDeadline(const GestureTracker &tracker, uint32_t &deadlineUs)
+{
+  if (tracker.pressed && !tracker.held)
+    deadlineUs = tracker.pressedAt + tracker.longUs;
+  else if (tracker.pressed && tracker.repeatUs > 0)
+    deadlineUs = tracker.nextRepeatAt;
+  else if (!tracker.pressed && tracker.clicks == 1)
+    deadlineUs = tracker.releasedAt + tracker.doubleUs;
+  else
+    return false;
+  return true;
+}
@@ -0,0 +1,159 @@
+#include "calendar.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include <time.h>
+
+static const char *TAG = "calendar";
+
+static Preferences calendarPrefs;
+static TimeZoneRule activeZone;
+static char activeTz[TZ_STRING_MAX] = "";
+static unsigned long lastDisciplineMillis = 0;
+
+uint32_t unixFromRtc(const RtcDateTime &dt)
+{
+  CivilTime civil = {dt.Year(), dt.Month(), dt.Day(), dt.Hour(), dt.Minute(), dt.Second(), 0};
+  return unixFromCivil(civil);
+}
+
+RtcDateTime rtcFromUnix(uint32_t unixSeconds)
+{
+  CivilTime civil = civilFromUnix(unixSeconds);
+  return RtcDateTime(civil.year, civil.month, civil.day, civil.hour, civil.minute, civil.second);
+}
+
+// ---------------------------------------------------------------------------
+// Device clock
+// ---------------------------------------------------------------------------
+
+void setupCalendar()
+{
+  char stored[TZ_STRING_MAX] = "";
+  calendarPrefs.begin(CALENDAR_NVS_NAMESPACE, true);
+  calendarPrefs.getString("tz", stored, sizeof(stored));
+  calendarPrefs.end();
+
+  if (stored[0] != '\0' && parsePosixTz(stored, activeZone))
+  {
+    strcpy(activeTz, stored);
+  }
+  else if (parsePosixTz(TIMEZONE, activeZone))
+  {
+    strcpy(activeTz, TIMEZONE);
+  }
+  else
+  {
+    Serial.println("✗ TIMEZONE is not a valid POSIX TZ string - using UTC");
+    parsePosixTz("UTC0", activeZone);
+    strcpy(activeTz, "UTC0");
+  }
+  Serial.printf("✓ Time zone %s\n", activeTz);
+}
+
+bool setTimeZone(const char *tz)
+{
+  TimeZoneRule rule;
+  if (strlen(tz) >= TZ_STRING_MAX || !parsePosixTz(tz, rule))
+    return false;
+
+  activeZone = rule;
+  strcpy(activeTz, tz);
+  calendarPrefs.begin(CALENDAR_NVS_NAMESPACE, false);
+  calendarPrefs.putString("tz", activeTz);
+  calendarPrefs.end();
+  LOGI(TAG, "Time zone set to %s", activeTz);
+  return true;
+}
+
+const char *getTimeZone()
+{
+  return activeTz;
+}
+
+int32_t getUtcOffset(uint32_t unixUtc)
+{
+  return utcOffsetAt(activeZone, unixUtc);
+}
+
+uint32_t currentEpoch()
+{
+  time_t now = time(nullptr);
+  if (now > 1600000000)
+    return (uint32_t)now;
+  return feederSystem.rtcReady ? unixFromRtc(rtc.GetDateTime()) : 0;
+}
+
+RtcDateTime toLocalTime(const RtcDateTime &utc)
+{
+  uint32_t unixUtc = unixFromRtc(utc);
+  return rtcFromUnix(unixUtc + utcOffsetAt(activeZone, unixUtc));
+}
+
+RtcDateTime getLocalDateTime()
+{
+  return toLocalTime(rtc.GetDateTime());
+}
+
+uint32_t unixFromLocal(uint32_t localSeconds)
+{
+  return utcFromLocal(activeZone, localSeconds);
+}
+
+void syncRtcFromSystemClock(bool force)
+{
+  time_t now = time(nullptr);
+  if (now < 1600000000)
+    return; // NTP has not answered yet
+
+  long drift = (long)unixFromRtc(rtc.GetDateTime()) - (long)now;
+  if (force || labs(drift) >= RTC_MAX_DRIFT_S)
+  {
+    rtc.SetDateTime(rtcFromUnix((uint32_t)now));
+    LOGI(TAG, "RTC set from NTP (was %+ld s off)", drift);
+  }
+}
+
+void handleRtcDiscipline()
+{
+  unsigned long currentMillis = millis();
+  if (currentMillis - lastDisciplineMillis < RTC_DISCIPLINE_INTERVAL)
+    return;
+  lastDisciplineMillis = currentMillis;
+  syncRtcFromSystemClock(false);
+}
+
+// {"action":"get"} or {"action":"set","tz":"<POSIX TZ>"}
+int handleTimeZoneMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<128> request;
+  if (deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  String action = request["action"] | "get";
+
+  if (action == "set")
+  {
+    if (!setTimeZone(request["tz"] | ""))
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Invalid POSIX TZ string\"}";
+      return 400;
+    }
+    // Schedule and display pick up the new zone on their next RTC pass
+  }
+  else if (action != "get")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown time zone action\"}";
+    return 400;
+  }
+
+  uint32_t now = unixFromRtc(rtc.GetDateTime());
+  char json[160];
+  snprintf(json, sizeof(json), "{\"status\":\"success\",\"tz\":\"%s\",\"utcOffset\":%ld}",
+           activeTz, (long)utcOffsetAt(activeZone, now));
+  responsePayload = json;
+  return 200;
+}
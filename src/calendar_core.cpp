@@ -0,0 +1,208 @@
+#include "calendar_core.h"
+#include <ctype.h>
+#include <stddef.h>
+
+// Closed-form conversions after Howard Hinnant's "chrono-compatible
+// low-level date algorithms"; years start in March so leap days fall last
+int32_t daysFromCivil(int year, unsigned month, unsigned day)
+{
+  year -= month <= 2;
+  int era = (year >= 0 ? year : year - 399) / 400;
+  unsigned yearOfEra = (unsigned)(year - era * 400);
+  unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + (int32_t)dayOfEra - 719468;
+}
+
+CivilTime civilFromUnix(uint32_t unixSeconds)
+{
+  uint32_t days = unixSeconds / SECONDS_PER_DAY;
+  uint32_t secondOfDay = unixSeconds % SECONDS_PER_DAY;
+
+  uint32_t shifted = days + 719468; // Days since 0000-03-01
+  uint32_t era = shifted / 146097;
+  uint32_t dayOfEra = shifted - era * 146097;
+  uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  uint32_t monthIndex = (5 * dayOfYear + 2) / 153; // 0 = March
+  uint32_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+
+  CivilTime civil;
+  civil.year = (uint16_t)(yearOfEra + era * 400 + (month <= 2 ? 1 : 0));
+  civil.month = (uint8_t)month;
+  civil.day = (uint8_t)(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+  civil.hour = (uint8_t)(secondOfDay / 3600);
+  civil.minute = (uint8_t)(secondOfDay / 60 % 60);
+  civil.second = (uint8_t)(secondOfDay % 60);
+  civil.weekday = (uint8_t)((days + 4) % 7); // 1970-01-01 was a Thursday
+  return civil;
+}
+
+uint32_t unixFromCivil(const CivilTime &civil)
+{
+  return (uint32_t)daysFromCivil(civil.year, civil.month, civil.day) * SECONDS_PER_DAY +
+         civil.hour * 3600UL + civil.minute * 60UL + civil.second;
+}
+
+// ---------------------------------------------------------------------------
+// POSIX TZ rules
+// ---------------------------------------------------------------------------
+
+// "PHT" or quoted "<+08>"; POSIX wants at least three characters
+static const char *parseTzName(const char *p, char *name)
+{
+  size_t n = 0;
+  if (*p == '<')
+  {
+    for (p++; *p != '\0' && *p != '>'; p++)
+    {
+      if (n < TZ_NAME_MAX - 1)
+        name[n++] = *p;
+    }
+    if (*p != '>')
+      return nullptr;
+    p++;
+  }
+  else
+  {
+    for (; isalpha((unsigned char)*p); p++)
+    {
+      if (n < TZ_NAME_MAX - 1)
+        name[n++] = *p;
+    }
+  }
+  name[n] = '\0';
+  return n >= 3 ? p : nullptr;
+}
+
+static const char *parseNumber(const char *p, int32_t &value)
+{
+  if (!isdigit((unsigned char)*p))
+    return nullptr;
+  value = 0;
+  while (isdigit((unsigned char)*p))
+    value = value * 10 + (*p++ - '0');
+  return p;
+}
+
+// [+|-]hh[:mm[:ss]] in seconds
+static const char *parseTzTime(const char *p, int32_t &seconds)
+{
+  int32_t sign = 1;
+  if (*p == '+' || *p == '-')
+    sign = *p++ == '-' ? -1 : 1;
+
+  int32_t hours = 0, minutes = 0, secs = 0;
+  if ((p = parseNumber(p, hours)) == nullptr)
+    return nullptr;
+  if (*p == ':' && (p = parseNumber(p + 1, minutes)) != nullptr && *p == ':')
+    p = parseNumber(p + 1, secs);
+  if (p == nullptr || hours > 167 || minutes > 59 || secs > 59)
+    return nullptr;
+
+  seconds = sign * (hours * 3600 + minutes * 60 + secs);
+  return p;
+}
+
+// Only the "Mm.w.d[/time]" form; Julian-day rules are not supported
+static const char *parseTzTransition(const char *p, TzTransition &transition)
+{
+  int32_t month, week, weekday;
+  if (*p != 'M' || (p = parseNumber(p + 1, month)) == nullptr || *p != '.' ||
+      (p = parseNumber(p + 1, week)) == nullptr || *p != '.' ||
+      (p = parseNumber(p + 1, weekday)) == nullptr)
+    return nullptr;
+  if (month < 1 || month > 12 || week < 1 || week > 5 || weekday > 6)
+    return nullptr;
+
+  transition.month = month;
+  transition.week = week;
+  transition.weekday = weekday;
+  transition.timeOfDay = 2 * 3600;
+  if (*p == '/')
+    p = parseTzTime(p + 1, transition.timeOfDay);
+  return p;
+}
+
+bool parsePosixTz(const char *tz, TimeZoneRule &rule)
+{
+  int32_t offset;
+  const char *p = parseTzName(tz, rule.stdName);
+  if (p == nullptr || (p = parseTzTime(p, offset)) == nullptr)
+    return false;
+
+  // POSIX offsets count west of UTC
+  rule.stdOffset = -offset;
+  rule.dstOffset = rule.stdOffset;
+  rule.dstName[0] = '\0';
+  rule.hasDst = false;
+  if (*p == '\0')
+    return true;
+
+  if ((p = parseTzName(p, rule.dstName)) == nullptr)
+    return false;
+  rule.hasDst = true;
+  rule.dstOffset = rule.stdOffset + 3600;
+  if (*p != '\0' && *p != ',')
+  {
+    if ((p = parseTzTime(p, offset)) == nullptr)
+      return false;
+    rule.dstOffset = -offset;
+  }
+
+  if (*p == '\0')
+  {
+    // No rule given: current US rule, as glibc does
+    rule.dstStart = {3, 2, 0, 2 * 3600};
+    rule.dstEnd = {11, 1, 0, 2 * 3600};
+    return true;
+  }
+
+  if (*p != ',' || (p = parseTzTransition(p + 1, rule.dstStart)) == nullptr || *p != ',' ||
+      (p = parseTzTransition(p + 1, rule.dstEnd)) == nullptr)
+    return false;
+  return *p == '\0';
+}
+
+// UTC instant of a transition in 'year'; 'offset' is the zone offset in force before it
+static int64_t transitionUtc(const TzTransition &transition, int year, int32_t offset)
+{
+  int32_t firstDay = daysFromCivil(year, transition.month, 1);
+  int firstWeekday = (firstDay + 4) % 7;
+  int day = 1 + (transition.weekday - firstWeekday + 7) % 7 + (transition.week - 1) * 7;
+  if (day > daysInMonth(year, transition.month))
+    day -= 7; // Week 5 means the last one
+
+  return (int64_t)(firstDay + day - 1) * SECONDS_PER_DAY + transition.timeOfDay - offset;
+}
+
+int32_t utcOffsetAt(const TimeZoneRule &rule, uint32_t unixUtc)
+{
+  if (!rule.hasDst)
+    return rule.stdOffset;
+
+  int year = civilFromUnix((uint32_t)((int64_t)unixUtc + rule.stdOffset)).year;
+  int64_t start = transitionUtc(rule.dstStart, year, rule.stdOffset);
+  int64_t end = transitionUtc(rule.dstEnd, year, rule.dstOffset);
+  int64_t now = unixUtc;
+
+  // Southern hemisphere zones start DST late in the year and end it early
+  bool dst = start < end ? (now >= start && now < end) : (now >= start || now < end);
+  return dst ? rule.dstOffset : rule.stdOffset;
+}
+
+uint32_t utcFromLocal(const TimeZoneRule &rule, uint32_t localSeconds)
+{
+  int32_t ahead = rule.dstOffset > rule.stdOffset ? rule.dstOffset : rule.stdOffset;
+  int32_t behind = rule.dstOffset > rule.stdOffset ? rule.stdOffset : rule.dstOffset;
+
+  uint32_t earlier = localSeconds - ahead;
+  if (utcOffsetAt(rule, earlier) == ahead)
+    return earlier;
+  uint32_t later = localSeconds - behind;
+  if (utcOffsetAt(rule, later) == behind)
+    return later;
+
+  // Neither reading exists: use the offset in force before the jump
+  return localSeconds - utcOffsetAt(rule, earlier);
+}
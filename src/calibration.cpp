@@ -0,0 +1,309 @@
+#include "calibration.h"
+#include "load_cell.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <ArduinoJson.h>
+
+static const char *TAG = "calib";
+
+static Preferences calibrationPrefs;
+static CalibrationData calibration;
+static CalibrationStatus calibrationStatus;
+
+// Points collected through the "calibrate" direct method, fitted on demand
+static float pointGrams[CALIBRATION_MAX_POINTS];
+static double pointRaw[CALIBRATION_MAX_POINTS];
+
+// Drift tracking state
+static float lastQuietWeight = 0.0;
+static int quietSamples = 0;
+static int32_t savedOffset = 0;
+static unsigned long lastDriftSave = 0;
+static unsigned long driftDayStart = 0;
+static float driftToday = 0.0; // Grams absorbed since driftDayStart
+
+bool fitCalibration(const float *grams, const double *raw, int count,
+                    int32_t &offset, float &scale, float &residualRms)
+{
+  if (count < 2)
+    return false;
+
+  double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+  for (int i = 0; i < count; i++)
+  {
+    sumX += grams[i];
+    sumY += raw[i];
+    sumXX += (double)grams[i] * grams[i];
+    sumXY += grams[i] * raw[i];
+  }
+
+  double denominator = count * sumXX - sumX * sumX;
+  if (fabs(denominator) < 1e-9)
+    return false; // All points at the same weight
+
+  double slope = (count * sumXY - sumX * sumY) / denominator;
+  if (fabs(slope) < 1e-6)
+    return false;
+  double intercept = (sumY - slope * sumX) / count;
+
+  double squaredError = 0;
+  for (int i = 0; i < count; i++)
+  {
+    double predictedGrams = (raw[i] - intercept) / slope;
+    double error = predictedGrams - grams[i];
+    squaredError += error * error;
+  }
+
+  offset = (int32_t)lround(intercept);
+  scale = (float)slope;
+  residualRms = (float)sqrt(squaredError / count);
+  return true;
+}
+
+static void applyCalibration()
+{
+  scale.set_offset(calibration.offset);
+  scale.set_scale(calibration.scale);
+}
+
+static bool loadCalibration()
+{
+  calibrationPrefs.begin(CALIBRATION_NVS_NAMESPACE, true);
+  size_t length = calibrationPrefs.getBytes("data", &calibration, sizeof(calibration));
+  calibrationPrefs.end();
+
+  return length == sizeof(calibration) &&
+         calibration.version == CALIBRATION_VERSION &&
+         calibration.scale != 0.0;
+}
+
+static bool saveCalibration()
+{
+  calibrationPrefs.begin(CALIBRATION_NVS_NAMESPACE, false);
+  size_t written = calibrationPrefs.putBytes("data", &calibration, sizeof(calibration));
+  calibrationPrefs.end();
+
+  savedOffset = calibration.offset;
+  lastDriftSave = millis();
+  return written == sizeof(calibration);
+}
+
+// A few readings with the stored calibration: they must agree with each
+// other and must not sit far below zero (which would mean the zero moved)
+static void validateCalibration()
+{
+  float minWeight = 0, maxWeight = 0;
+  for (int i = 0; i < CALIBRATION_CHECK_READINGS; i++)
+  {
+    if (!scale.wait_ready_timeout(200))
+    {
+      LOGE(TAG, "✗ Calibration check: HX711 not responding");
+      calibrationStatus.validated = false;
+      return;
+    }
+    float weight = scale.get_units(1);
+    if (i == 0 || weight < minWeight)
+      minWeight = weight;
+    if (i == 0 || weight > maxWeight)
+      maxWeight = weight;
+  }
+
+  calibrationStatus.bootSpread = maxWeight - minWeight;
+  calibrationStatus.validated = calibrationStatus.bootSpread <= CALIBRATION_STABLE_GRAMS &&
+                                minWeight >= -CALIBRATION_ZERO_TOLERANCE;
+
+  LOGI(TAG, "%s Calibration check: %.1f..%.1f g (spread %.2f g)",
+            calibrationStatus.validated ? "✓" : "✗",
+            minWeight, maxWeight, calibrationStatus.bootSpread);
+}
+
+void setupCalibration()
+{
+  if (loadCalibration())
+  {
+    calibrationStatus.loaded = true;
+    savedOffset = calibration.offset;
+    applyCalibration();
+    LOGI(TAG, "✓ Calibration loaded: offset %ld, scale %.2f (%d points, rms %.2f g)",
+              (long)calibration.offset, calibration.scale,
+              calibration.pointCount, calibration.residualRms);
+    validateCalibration();
+    return;
+  }
+
+  // First boot: fall back to the compile-time factor and a one-off tare,
+  // then persist so later boots skip the tare entirely
+  LOGI(TAG, "No stored calibration - taring with default factor");
+  calibration = {};
+  calibration.version = CALIBRATION_VERSION;
+  calibration.scale = CALIBRATION_FACTOR;
+  scale.set_scale(calibration.scale);
+  scale.tare(CALIBRATION_POINT_READINGS);
+  calibration.offset = scale.get_offset();
+  saveCalibration();
+  calibrationStatus.validated = true;
+}
+
+void trackCalibrationDrift(float weight)
+{
+  unsigned long now = millis();
+  if (now - driftDayStart >= 86400000UL)
+  {
+    driftDayStart = now;
+    driftToday = 0.0;
+  }
+
+  // Only an empty bowl, long after the last dispense or meal, tells us where
+  // zero really is; food left over reads the same for hours
+  if (feederSystem.dispensing || feederSystem.animalDetected ||
+      fabs(weight) > DRIFT_TRACK_WINDOW_GRAMS ||
+      now - timing.lastFeedingTime < DRIFT_TRACK_SETTLE_MS || // 0 = boot, which counts too
+      now - timing.lastMotionTime < DRIFT_TRACK_SETTLE_MS ||
+      driftToday >= DRIFT_TRACK_DAILY_MAX_GRAMS)
+  {
+    quietSamples = 0;
+    return;
+  }
+
+  if (fabs(weight - lastQuietWeight) > DRIFT_TRACK_STABLE_GRAMS)
+  {
+    quietSamples = 0;
+  }
+  lastQuietWeight = weight;
+
+  if (++quietSamples < DRIFT_TRACK_STABLE_SAMPLES)
+    return;
+
+  // Nudge the zero toward the current reading (weight * scale raw counts)
+  float correction = DRIFT_TRACK_ALPHA * weight;
+  driftToday += fabs(correction);
+  calibration.offset += (int32_t)lround(correction * calibration.scale);
+  calibration.driftTotal += correction;
+  scale.set_offset(calibration.offset);
+
+  float movedGrams = fabs((float)(calibration.offset - savedOffset) / calibration.scale);
+  if (movedGrams >= DRIFT_SAVE_GRAMS && now - lastDriftSave >= DRIFT_SAVE_INTERVAL)
+  {
+    saveCalibration();
+    LOGI(TAG, "Zero drift persisted: %.2f g since last fit", calibration.driftTotal);
+  }
+}
+
+static String calibrationStatusJson()
+{
+  StaticJsonDocument<256> doc;
+  doc["status"] = "success";
+  doc["offset"] = calibration.offset;
+  doc["scale"] = calibration.scale;
+  doc["points"] = calibration.pointCount;
+  doc["residualRms"] = calibration.residualRms;
+  doc["driftTotal"] = calibration.driftTotal;
+  doc["validated"] = calibrationStatus.validated;
+  doc["pendingPoints"] = calibrationStatus.pendingPoints;
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+bool tareScale()
+{
+  ScaleLock lock;
+  if (!scale.wait_ready_timeout(500))
+    return false;
+  calibration.offset = (int32_t)lround(scale.read_average(CALIBRATION_POINT_READINGS));
+  calibration.driftTotal = 0.0;
+  applyCalibration();
+  saveCalibration();
+  LOGI(TAG, "Scale tared");
+  return true;
+}
+
+// {"action":"tare"|"addPoint"|"fit"|"clear"|"status", "grams":<known weight>}
+int handleCalibrationMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<128> request;
+  if (deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  String action = request["action"] | "status";
+
+  if (action == "tare")
+  {
+    if (!tareScale())
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Scale not ready\"}";
+      return 503;
+    }
+  }
+  else if (action == "addPoint")
+  {
+    // A missing weight would go into the fit as 0 g
+    if (!request["grams"].is<float>())
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"grams is required\"}";
+      return 400;
+    }
+    if (calibrationStatus.pendingPoints >= CALIBRATION_MAX_POINTS)
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Too many points\"}";
+      return 400;
+    }
+    ScaleLock lock;
+    if (!scale.wait_ready_timeout(500))
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Scale not ready\"}";
+      return 503;
+    }
+    int i = calibrationStatus.pendingPoints++;
+    pointGrams[i] = request["grams"].as<float>();
+    pointRaw[i] = scale.read_average(CALIBRATION_POINT_READINGS);
+    LOGD(TAG, "Calibration point %d: %.1f g -> %.0f raw", i + 1, pointGrams[i], pointRaw[i]);
+  }
+  else if (action == "fit")
+  {
+    int32_t offset;
+    float slope, rms;
+    if (!fitCalibration(pointGrams, pointRaw, calibrationStatus.pendingPoints, offset, slope, rms))
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Need 2+ points at different weights\"}";
+      return 400;
+    }
+    calibration.offset = offset;
+    calibration.scale = slope;
+    calibration.residualRms = rms;
+    calibration.pointCount = calibrationStatus.pendingPoints;
+    calibration.driftTotal = 0.0;
+    calibrationStatus.pendingPoints = 0;
+    calibrationStatus.validated = true;
+    applyCalibration();
+    saveCalibration();
+    LOGI(TAG, "✓ Calibration fitted: offset %ld, scale %.2f, rms %.2f g",
+              (long)offset, slope, rms);
+  }
+  else if (action == "clear")
+  {
+    calibrationStatus.pendingPoints = 0;
+  }
+  else if (action != "status")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown calibration action\"}";
+    return 400;
+  }
+
+  responsePayload = calibrationStatusJson();
+  return 200;
+}
+
+const CalibrationData &getCalibration()
+{
+  return calibration;
+}
+
+const CalibrationStatus &getCalibrationStatus()
+{
+  return calibrationStatus;
+}
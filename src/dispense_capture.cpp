@@ -0,0 +1,452 @@
+#include "dispense_capture.h"
+#include "load_cell.h"
+#include "servo_motion.h"
+#include "sampling_policy.h"
+#include "trace_recorder.h"
+#include "method_stream.h"
+#include "json_pool.h"
+#include "calendar.h"
+#include "stall_watchdog.h"
+#include "logger.h"
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+
+static const char *TAG = "capture";
+
+enum CaptureState : uint8_t
+{
+  CAPTURE_IDLE,
+  CAPTURE_DISPENSING,
+  CAPTURE_POST
+};
+
+static Preferences capturePrefs;
+static const CaptureConfig defaultCaptureConfig = {CAPTURE_CONFIG_VERSION, 0, CAPTURE_PRE_MS, CAPTURE_POST_MS};
+static CaptureConfig captureConfig = defaultCaptureConfig;
+static CaptureStats captureStats;
+static TaskHandle_t samplerTask = nullptr;
+static bool filesystemReady = false;
+
+// Written only by the sampler: the slot first, then the count. The loop runs
+// on the same core and only reads slots behind the count.
+static CaptureSample ring[CAPTURE_RING_SAMPLES];
+static volatile uint32_t sampleCount = 0;
+
+// Window being captured (loop side)
+static CaptureState state = CAPTURE_IDLE;
+static uint32_t firstCount = 0;
+static uint32_t triggerCount = 0;
+static uint32_t endCount = 0;
+static uint32_t triggerMs = 0;
+static uint32_t endMs = 0;
+static uint32_t triggerEpoch = 0;
+
+// Saved captures, by file slot
+static CaptureFileHeader stored[CAPTURE_FILE_COUNT];
+static uint32_t storedBytes[CAPTURE_FILE_COUNT];
+static uint32_t nextNumber = 1;
+
+static void captureFilePath(uint8_t slot, char *path, size_t size)
+{
+  snprintf(path, size, "/cap%u.bin", slot);
+}
+
+static void samplerTaskLoop(void *)
+{
+  uint32_t lastMs = 0;
+  for (;;)
+  {
+    if (!tryLockScale())
+    {
+      captureStats.lockMisses++;
+      vTaskDelay(1);
+      continue;
+    }
+    if (!scale.is_ready())
+    {
+      unlockScale();
+      vTaskDelay(1);
+      continue;
+    }
+    uint32_t startMicros = micros();
+    long raw = scale.read();
+    recordWeightConversion(micros() - startMicros);
+    unlockScale();
+
+    uint32_t now = millis();
+    CaptureSample &sample = ring[sampleCount % CAPTURE_RING_SAMPLES];
+    sample.ms = now;
+    sample.raw = (int32_t)raw;
+    sample.angle = getServoAngle();
+    sampleCount = sampleCount + 1;
+    captureStats.conversions++;
+
+    // Conversion period, ignoring gaps left by lock holders
+    uint32_t gap = now - lastMs;
+    if (lastMs != 0 && gap < 200)
+      captureStats.periodMs = captureStats.periodMs == 0 ? gap : (captureStats.periodMs * 7 + gap) / 8;
+    lastMs = now;
+
+    // Next conversion is about a period away; poll from three quarters of it
+    uint32_t sleepMs = captureStats.periodMs * 3 / 4;
+    vTaskDelay(sleepMs > 1 ? pdMS_TO_TICKS(sleepMs) : 1);
+  }
+}
+
+bool isScaleSamplerRunning()
+{
+  return samplerTask != nullptr;
+}
+
+bool getLatestScaleRaw(uint8_t count, long &raw)
+{
+  uint32_t available = sampleCount;
+  if (samplerTask == nullptr || available == 0 || count == 0)
+    return false;
+  if (millis() - ring[(available - 1) % CAPTURE_RING_SAMPLES].ms > CAPTURE_STALE_MS)
+    return false;
+
+  if (count > available)
+    count = available;
+  int64_t sum = 0;
+  for (uint8_t i = 1; i <= count; i++)
+    sum += ring[(available - i) % CAPTURE_RING_SAMPLES].raw;
+  raw = (long)(sum / count);
+  return true;
+}
+
+static void loadStoredHeaders()
+{
+  for (uint8_t slot = 0; slot < CAPTURE_FILE_COUNT; slot++)
+  {
+    stored[slot] = {};
+    storedBytes[slot] = 0;
+
+    char path[16];
+    captureFilePath(slot, path, sizeof(path));
+    if (!LittleFS.exists(path))
+      continue;
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file)
+      continue;
+    CaptureFileHeader header;
+    if (file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+        header.magic == CAPTURE_FILE_MAGIC && header.version == CAPTURE_FILE_VERSION)
+    {
+      stored[slot] = header;
+      storedBytes[slot] = file.size();
+      if (header.number >= nextNumber)
+        nextNumber = header.number + 1;
+    }
+    file.close();
+  }
+}
+
+// Writes ring samples [first, last) to the oldest slot; false if the ring
+// lapped the window meanwhile or the file could not be written
+static bool saveCapture(uint32_t first, uint32_t last, uint8_t flags)
+{
+  STALL_REGION(REGION_FLASH);
+
+  uint8_t slot = 0;
+  for (uint8_t s = 1; s < CAPTURE_FILE_COUNT; s++)
+  {
+    if (stored[s].number < stored[slot].number)
+      slot = s;
+  }
+
+  CaptureFileHeader header = {};
+  header.magic = CAPTURE_FILE_MAGIC;
+  header.version = CAPTURE_FILE_VERSION;
+  header.flags = flags;
+  header.samples = (uint16_t)(last - first);
+  header.startIndex = (uint16_t)(triggerCount - first);
+  header.endIndex = (uint16_t)((endCount < last ? endCount : last) - first);
+  header.number = nextNumber;
+  header.epoch = triggerEpoch;
+  header.firstMs = (int32_t)(ring[first % CAPTURE_RING_SAMPLES].ms - triggerMs);
+  header.dispenseMs = endMs - triggerMs;
+  header.offset = (int32_t)scale.get_offset();
+  header.scale = scale.get_scale();
+
+  File file = LittleFS.open("/cap.tmp", FILE_WRITE);
+  if (!file)
+    return false;
+  bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+  uint32_t bytes = sizeof(header);
+
+  uint8_t buffer[256];
+  size_t used = 0;
+  uint32_t previousMs = triggerMs + header.firstMs;
+  int32_t previousRaw = 0;
+  for (uint32_t i = first; ok && i < last; i++)
+  {
+    const CaptureSample &sample = ring[i % CAPTURE_RING_SAMPLES];
+    used += putVarint(buffer + used, sample.ms - previousMs);
+    used += putVarint(buffer + used, zigzag(sample.raw - previousRaw));
+    buffer[used++] = sample.angle;
+    previousMs = sample.ms;
+    previousRaw = sample.raw;
+
+    // Room for the largest sample (5 + 5 + 1 bytes)
+    if (used > sizeof(buffer) - 11 || i + 1 == last)
+    {
+      ok = file.write(buffer, used) == used;
+      bytes += used;
+      used = 0;
+    }
+  }
+  file.close();
+
+  // The sampler may have overwritten the oldest samples while they were written
+  ok = ok && sampleCount - first <= CAPTURE_RING_SAMPLES;
+  char path[16];
+  captureFilePath(slot, path, sizeof(path));
+  ok = ok && LittleFS.rename("/cap.tmp", path);
+  if (!ok)
+  {
+    LittleFS.remove("/cap.tmp");
+    return false;
+  }
+
+  stored[slot] = header;
+  storedBytes[slot] = bytes;
+  nextNumber++;
+  captureStats.lastBytes = bytes;
+  LOGI(TAG, "Dispense capture #%lu: %u samples, %lu bytes%s", (unsigned long)header.number,
+       header.samples, (unsigned long)bytes, flags & CAPTURE_FLAG_TRUNCATED ? " (truncated)" : "");
+  return true;
+}
+
+// Saves the window from the ring; 'flags' says why it was closed
+static void closeCapture(uint8_t flags)
+{
+  if (state == CAPTURE_DISPENSING)
+  {
+    endCount = sampleCount;
+    endMs = millis();
+  }
+  state = CAPTURE_IDLE;
+
+  // Post-trigger: up to postMs after the dispense finished
+  uint32_t last = sampleCount;
+  while (last > endCount &&
+         (int32_t)(ring[(last - 1) % CAPTURE_RING_SAMPLES].ms - (endMs + captureConfig.postMs)) > 0)
+    last--;
+
+  if (flags & CAPTURE_FLAG_TRUNCATED)
+    captureStats.truncated++;
+  if (last <= firstCount)
+    return;
+  if (!filesystemReady || !saveCapture(firstCount, last, flags))
+  {
+    captureStats.lost++;
+    LOGW(TAG, "⚠️ Dispense capture lost");
+    return;
+  }
+  captureStats.captures++;
+}
+
+void captureDispenseStarted()
+{
+  if (samplerTask == nullptr)
+    return;
+
+  // Back-to-back dispenses: the previous window ends here
+  if (state != CAPTURE_IDLE)
+    closeCapture(0);
+
+  state = CAPTURE_DISPENSING;
+  triggerCount = sampleCount;
+  triggerMs = millis();
+  triggerEpoch = currentEpoch();
+  endCount = triggerCount;
+  endMs = triggerMs;
+
+  // Pre-trigger: the samples of the last preMs, at most half the window so
+  // the dispense itself always fits
+  firstCount = triggerCount;
+  while (firstCount > 0 && triggerCount - (firstCount - 1) <= CAPTURE_MAX_WINDOW / 2 &&
+         (int32_t)(ring[(firstCount - 1) % CAPTURE_RING_SAMPLES].ms - (triggerMs - captureConfig.preMs)) >= 0)
+    firstCount--;
+}
+
+void captureDispenseFinished()
+{
+  if (state != CAPTURE_DISPENSING)
+    return;
+  state = CAPTURE_POST;
+  endCount = sampleCount;
+  endMs = millis();
+}
+
+void handleDispenseCapture()
+{
+  if (state == CAPTURE_IDLE)
+    return;
+
+  // A window that outgrows the ring is cut rather than lapped
+  if (sampleCount - firstCount >= CAPTURE_MAX_WINDOW)
+    closeCapture(CAPTURE_FLAG_TRUNCATED);
+  else if (state == CAPTURE_POST && millis() - endMs >= captureConfig.postMs)
+    closeCapture(0);
+}
+
+void setupDispenseCapture()
+{
+  if (samplerTask != nullptr)
+    return;
+
+  CaptureConfig config;
+  capturePrefs.begin(CAPTURE_NVS_NAMESPACE, true);
+  size_t length = capturePrefs.getBytes("config", &config, sizeof(config));
+  capturePrefs.end();
+  if (length == sizeof(config) && config.version == CAPTURE_CONFIG_VERSION)
+    captureConfig = config;
+
+  filesystemReady = LittleFS.begin(true); // Already mounted by the trace recorder
+  if (filesystemReady)
+    loadStoredHeaders();
+  else
+    Serial.println("✗ LittleFS unavailable - dispense captures not saved");
+
+  // Same core as the loop, so the loop's view of the ring is never torn
+  if (xTaskCreatePinnedToCore(samplerTaskLoop, "capture", CAPTURE_TASK_STACK, nullptr,
+                              CAPTURE_TASK_PRIORITY, &samplerTask, 1) != pdPASS)
+  {
+    samplerTask = nullptr;
+    Serial.println("✗ Scale sampler could not be started - reading on the loop");
+    return;
+  }
+  Serial.printf("✓ Dispense capture: %u ms before, %u ms after, %u-sample ring\n",
+                captureConfig.preMs, captureConfig.postMs, CAPTURE_RING_SAMPLES);
+}
+
+const CaptureStats &getCaptureStats()
+{
+  return captureStats;
+}
+
+static int uploadCapture(int index, String &responsePayload)
+{
+  if (index < 0 || index >= CAPTURE_FILE_COUNT || stored[index].magic != CAPTURE_FILE_MAGIC)
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"No such capture\"}";
+    return 404;
+  }
+
+  char path[16];
+  captureFilePath(index, path, sizeof(path));
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file)
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Capture file unreadable\"}";
+    return 500;
+  }
+
+  MethodStream &stream = openMethodStream(METHOD_CT_BINARY);
+  uint8_t chunk[128];
+  size_t n;
+  while ((n = file.read(chunk, sizeof(chunk))) > 0)
+  {
+    if (stream.write(chunk, n) != n)
+      break;
+  }
+  file.close();
+
+  if (!stream.end())
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Upload interrupted\"}";
+    return 503;
+  }
+
+  char json[128];
+  snprintf(json, sizeof(json), "{\"status\":\"success\",\"index\":%d,\"bytes\":%lu,\"chunks\":%u}",
+           index, (unsigned long)stream.bytes(), stream.chunks());
+  responsePayload = json;
+  return 200;
+}
+
+static void captureListJson(String &responsePayload)
+{
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  doc["preMs"] = captureConfig.preMs;
+  doc["postMs"] = captureConfig.postMs;
+  doc["ringSamples"] = CAPTURE_RING_SAMPLES;
+  doc["maxWindow"] = CAPTURE_MAX_WINDOW;
+  doc["periodMs"] = captureStats.periodMs;
+  JsonArray captures = doc.createNestedArray("captures");
+  for (uint8_t slot = 0; slot < CAPTURE_FILE_COUNT; slot++)
+  {
+    const CaptureFileHeader &header = stored[slot];
+    if (header.magic != CAPTURE_FILE_MAGIC)
+      continue;
+    JsonObject entry = captures.createNestedObject();
+    entry["index"] = slot;
+    entry["number"] = header.number;
+    entry["epoch"] = header.epoch;
+    entry["samples"] = header.samples;
+    entry["dispenseMs"] = header.dispenseMs;
+    entry["bytes"] = storedBytes[slot];
+    entry["truncated"] = (header.flags & CAPTURE_FLAG_TRUNCATED) != 0;
+  }
+  serializeJson(doc, responsePayload);
+}
+
+// {"action":"list"}, {"action":"upload","index":n}, {"action":"set","preMs":n,"postMs":n}
+// or {"action":"clear"}
+int handleCaptureMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<96> request;
+  if (deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  String action = request["action"] | "list";
+
+  if (action == "upload")
+  {
+    return uploadCapture(request["index"] | -1, responsePayload);
+  }
+  else if (action == "set")
+  {
+    uint32_t preMs = request["preMs"] | (uint32_t)captureConfig.preMs;
+    uint32_t postMs = request["postMs"] | (uint32_t)captureConfig.postMs;
+    if (preMs > CAPTURE_WINDOW_MAX_MS || postMs > CAPTURE_WINDOW_MAX_MS)
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Window out of range\"}";
+      return 400;
+    }
+
+    captureConfig.preMs = (uint16_t)preMs;
+    captureConfig.postMs = (uint16_t)postMs;
+    capturePrefs.begin(CAPTURE_NVS_NAMESPACE, false);
+    capturePrefs.putBytes("config", &captureConfig, sizeof(captureConfig));
+    capturePrefs.end();
+    LOGI(TAG, "Capture window set: %lu ms before, %lu ms after", (unsigned long)preMs, (unsigned long)postMs);
+  }
+  else if (action == "clear")
+  {
+    for (uint8_t slot = 0; slot < CAPTURE_FILE_COUNT; slot++)
+    {
+      char path[16];
+      captureFilePath(slot, path, sizeof(path));
+      if (stored[slot].magic == CAPTURE_FILE_MAGIC)
+        LittleFS.remove(path);
+      stored[slot] = {};
+      storedBytes[slot] = 0;
+    }
+  }
+  else if (action != "list")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown capture action\"}";
+    return 400;
+  }
+
+  captureListJson(responsePayload);
+  return 200;
+}
@@ -1,33 +1,46 @@
 #include "display_manager.h"
+#include "servo_motion.h"
+#include "sensor_manager.h"
+#include "calendar.h"
+
+static unsigned long messageShownAt = 0;
+static unsigned long messageHoldMs = 0;
+
+void showLCDMessage(const char *line1, const char *line2, unsigned long holdMs)
+{
+  lcd.clear();
+  lcd.setCursor(0, 0);
+  lcd.print(line1);
+  lcd.setCursor(0, 1);
+  lcd.print(line2);
+  messageShownAt = millis();
+  messageHoldMs = holdMs;
+}
 
 void updateLCD()
 {
+  if (millis() - messageShownAt < messageHoldMs)
+    return;
+
   // First line: Time and connection status
   lcd.setCursor(0, 0);
   if (feederSystem.rtcReady && !feederSystem.dispensing)
   {
-    lcd.print(formatTime(rtc.GetDateTime()));
+    lcd.print(formatTime(getLocalDateTime()));
     lcd.print(feederSystem.backendConnected ? " *" : " X");
     lcd.print(" ");
 
     // Display food level on first line
-    if (strcmp(sensors.foodLevel, FOOD_LEVEL_FULL) == 0)
-    {
-      lcd.print("FULL ");
-    }
-    else if (strcmp(sensors.foodLevel, FOOD_LEVEL_HALF) == 0)
-    {
-      lcd.print("HALF ");
-    }
-    else
-    {
-      lcd.print("EMPTY");
-    }
+    lcd.printf("%-5s", getFoodLevelName(sensors.foodLevel));
   }
   else if (feederSystem.dispensing)
   {
     lcd.print("Dispensing...   ");
   }
+  else if (timing.lastFeedingTime != 0 && millis() - timing.lastFeedingTime < FEED_COMPLETE_DISPLAY_MS)
+  {
+    lcd.print("Complete!       ");
+  }
   else
   {
     lcd.print("Pet Feeder Ready");
@@ -41,7 +54,15 @@ void updateLCD()
   }
   else if (feederSystem.dispensing)
   {
-    lcd.print("Please wait...  ");
+    // Cycle progress from the motion controller
+    char cycleLine[17];
+    snprintf(cycleLine, sizeof(cycleLine), "Cycle %u of %u     ",
+             getDispenseCycle(), getDispensePattern().cycles);
+    lcd.print(getDispenseCycle() > 0 ? cycleLine : "Please wait...  ");
+  }
+  else if (timing.lastFeedingTime != 0 && millis() - timing.lastFeedingTime < FEED_COMPLETE_DISPLAY_MS)
+  {
+    lcd.print("Food Dispensed  ");
   }
   else
   {
@@ -64,50 +85,10 @@ void updateLCD()
   }
 }
 
-void setRGBColor(String level)
+void setRGBColor(RgbColor color, uint8_t brightness)
 {
-  // Ensure RGB pins are properly configured
-  pinMode(RED_PIN, OUTPUT);
-  pinMode(GREEN_PIN, OUTPUT);
-  pinMode(BLUE_PIN, OUTPUT);
-
-  bool red = false, green = false, blue = false;
-
-  if (level == RGB_GREEN || level == FOOD_LEVEL_FULL || strcmp(sensors.foodLevel, FOOD_LEVEL_FULL) == 0)
-  {
-    green = true; // Green for full food container
-  }
-  else if (level == RGB_RED || level == FOOD_LEVEL_EMPTY || strcmp(sensors.foodLevel, FOOD_LEVEL_EMPTY) == 0)
-  {
-    red = true; // Red for empty food container
-  }
-  else if (level == RGB_BLUE || level == FOOD_LEVEL_HALF || strcmp(sensors.foodLevel, FOOD_LEVEL_HALF) == 0)
-  {
-    blue = true; // Blue for half empty food container
-  }
-  else if (level == RGB_PURPLE || level == "VIOLET") // Violet/Purple for initialization
-  {
-    red = true;
-    blue = true; // Red + Blue = Violet/Purple
-  }
-  else if (level == RGB_YELLOW)
-  {
-    red = true;
-    green = true; // Red + Green = Yellow
-  }
-  else if (level == RGB_WHITE)
-  {
-    red = true;
-    green = true;
-    blue = true; // All colors = White
-  }
-
-  // Write to RGB pins with explicit HIGH/LOW
-  digitalWrite(RED_PIN, red ? HIGH : LOW);
-  digitalWrite(GREEN_PIN, green ? HIGH : LOW);
-  digitalWrite(BLUE_PIN, blue ? HIGH : LOW);
-
-  Serial.printf("RGB LED set: R=%d G=%d B=%d for level: %s\n", red, green, blue, level.c_str());
+  // Sets the resting color; any running pattern returns to it when done
+  setRestingColor(color, brightness);
 }
 
 // Add initialization LED function
@@ -120,37 +101,26 @@ void setInitializationLED()
 void updateFoodLevelLED()
 {
   // Update LED based on current food level
-  if (strcmp(sensors.foodLevel, FOOD_LEVEL_FULL) == 0)
+  switch (sensors.foodLevel)
   {
+  case FOOD_LEVEL_FULL:
     setRGBColor(RGB_GREEN); // Green for full
-  }
-  else if (strcmp(sensors.foodLevel, FOOD_LEVEL_HALF) == 0)
-  {
+    break;
+  case FOOD_LEVEL_HALF:
     setRGBColor(RGB_BLUE); // Blue for half
-  }
-  else if (strcmp(sensors.foodLevel, FOOD_LEVEL_EMPTY) == 0)
-  {
+    break;
+  case FOOD_LEVEL_EMPTY:
     setRGBColor(RGB_RED); // Red for empty
-  }
-  else
-  {
+    break;
+  default:
     setRGBColor(RGB_OFF); // Turn off if unknown
+    break;
   }
 }
 
-void buzzerBeepWithLED(int beeps, int duration, int pause, String ledColor)
+void buzzerBeepWithLED(int beeps, int duration, int pause, RgbColor ledColor)
 {
-  for (int i = 0; i < beeps; i++)
-  {
-    digitalWrite(BUZZER_PIN, HIGH);
-    setRGBColor(ledColor);
-    delay(duration);
-    digitalWrite(BUZZER_PIN, LOW);
-    setRGBColor(RGB_OFF);
-    if (i < beeps - 1)
-      delay(pause);
-  }
-
-  // Restore food level LED after buzzer sequence
+  // Food level LED is restored by the pattern engine after the sequence
   updateFoodLevelLED();
-}
\ No newline at end of file
+  startBeepPattern(beeps, duration, pause, ledColor);
+}
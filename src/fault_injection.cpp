@@ -0,0 +1,195 @@
+#include "fault_injection.h"
+#include "json_pool.h"
+#include "network_manager.h"
+#include "logger.h"
+#include <ArduinoJson.h>
+
+#if FAULT_INJECTION
+
+static const char *TAG = "fault";
+
+// Connect faults last: repeated auth rejections push the backoff to 30 min
+static const FaultScenario scenarios[] = {
+    {"baseline", FAULT_NONE, 0},
+    {"latency", FAULT_LATENCY, 800},
+    {"drop", FAULT_DROP, 50},
+    {"slowRead", FAULT_SLOW_READ, 300},
+    {"halfOpen", FAULT_HALF_OPEN, FAULT_SOCKET_TIMEOUT_MS},
+    {"httpTimeout", FAULT_HTTP_TIMEOUT, 3000},
+    {"dnsFail", FAULT_DNS_FAIL, 2000},
+    {"authReject", FAULT_AUTH_REJECT, FAULT_TLS_HANDSHAKE_MS},
+};
+
+static NetFault activeFault = FAULT_NONE;
+static uint32_t activeParam = 0;
+
+// scenarioIndex < 0 = idle
+static int scenarioIndex = -1;
+static FaultRunner runner;
+static FaultReport reports[ARRAY_SIZE(scenarios)];
+
+// Holds the loop the way the real stack would
+static FaultResult apply(const FaultEffect &effect)
+{
+  if (effect.blockMs > 0)
+    delay(effect.blockMs);
+  return effect.result;
+}
+
+int injectConnectFault()
+{
+  switch (apply(connectFaultEffect(activeFault, activeParam)))
+  {
+  case FAULT_RESULT_REJECTED:
+    return MQTT_CONNECT_BAD_CREDENTIALS;
+  case FAULT_RESULT_REFUSED:
+    return MQTT_CONNECT_FAILED;
+  case FAULT_RESULT_TIMEOUT:
+    return MQTT_CONNECTION_TIMEOUT;
+  default:
+    return MQTT_CONNECTED;
+  }
+}
+
+bool injectPublishFault()
+{
+  return apply(publishFaultEffect(activeFault, activeParam, esp_random())) == FAULT_RESULT_OK;
+}
+
+void injectReadFault()
+{
+  uint32_t ms = readFaultDelay(activeFault, activeParam);
+  if (ms > 0)
+    delay(ms);
+}
+
+int injectHttpFault()
+{
+  switch (apply(httpFaultEffect(activeFault, activeParam)))
+  {
+  case FAULT_RESULT_TIMEOUT:
+    return HTTPC_ERROR_READ_TIMEOUT;
+  case FAULT_RESULT_REFUSED:
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  default:
+    return 0;
+  }
+}
+
+static void startScenario(int index)
+{
+  unsigned long now = millis();
+  scenarioIndex = index;
+  activeFault = scenarios[index].fault;
+  activeParam = scenarios[index].param;
+
+  faultRunnerStart(runner, now);
+
+  LOGI(TAG, "Scenario %s started (%lu ms)", scenarios[index].name, (unsigned long)activeParam);
+}
+
+static void generateTraffic()
+{
+  switch (faultTrafficFor(activeFault))
+  {
+  case FAULT_TRAFFIC_RECONNECT:
+    if (mqttClient.connected())
+      mqttClient.disconnect();
+    connectMQTT(); // Gated by the reconnect backoff like any other attempt
+    break;
+  case FAULT_TRAFFIC_HTTP_POST:
+    sendToDatabase();
+    break;
+  default:
+    sendSensorDataToAzure(REPORT_HEARTBEAT);
+    break;
+  }
+}
+
+static void publishFaultReport(int failed)
+{
+  JsonDocument &doc = borrowJsonDocument();
+  doc["deviceId"] = DEVICE_ID;
+  doc["messageType"] = "faultReport";
+  doc["build"] = __DATE__ " " __TIME__;
+  doc["loopBudgetMs"] = FAULT_LOOP_BUDGET_MS;
+  doc["failed"] = failed;
+  JsonArray results = doc.createNestedArray("scenarios");
+  for (size_t i = 0; i < ARRAY_SIZE(scenarios); i++)
+  {
+    JsonObject entry = results.createNestedObject();
+    entry["name"] = scenarios[i].name;
+    entry["maxLoopMs"] = reports[i].maxLoopMs;
+    entry["p99LoopMs"] = reports[i].p99LoopMs;
+    entry["missedFeeds"] = reports[i].feedsMissed;
+    entry["maxButtonMs"] = reports[i].maxButtonMs;
+    entry["pass"] = reports[i].passed;
+  }
+
+  char *payload = borrowJsonText();
+  size_t length = serializeJson(doc, payload, JSON_TEXT_SIZE);
+  if (!publishTelemetryEvent(payload, length))
+    LOGW(TAG, "Fault report not published (still offline)");
+}
+
+static void finishScenario()
+{
+  FaultReport &report = reports[scenarioIndex];
+  report = faultMeterFinish(runner.meter);
+
+  Serial.printf("FAULT %s passes=%lu maxLoop=%lu p99=%lu feedsMissed=%u/%u button max=%lu avg=%lu %s\n",
+                scenarios[scenarioIndex].name, (unsigned long)report.passes,
+                (unsigned long)report.maxLoopMs, (unsigned long)report.p99LoopMs,
+                report.feedsMissed, report.feedsDue, (unsigned long)report.maxButtonMs,
+                (unsigned long)report.avgButtonMs, report.passed ? "PASS" : "FAIL");
+
+  activeFault = FAULT_NONE;
+  activeParam = 0;
+
+  if (scenarioIndex + 1 < (int)ARRAY_SIZE(scenarios))
+  {
+    startScenario(scenarioIndex + 1);
+    return;
+  }
+
+  scenarioIndex = -1;
+  int failed = 0;
+  for (size_t i = 0; i < ARRAY_SIZE(scenarios); i++)
+  {
+    if (!reports[i].passed)
+      failed++;
+  }
+  Serial.printf("FAULT REPORT %s: %d of %u scenarios over budget (loop %d ms, button %d ms)\n",
+                failed == 0 ? "PASS" : "FAIL", failed, (unsigned)ARRAY_SIZE(scenarios),
+                FAULT_LOOP_BUDGET_MS, FAULT_BUTTON_BUDGET_MS);
+
+  resetMQTTBackoff(); // Reconnect now rather than after the auth backoff
+  publishFaultReport(failed);
+}
+
+void startFaultScenarios()
+{
+  Serial.printf("\n=== Fault injection: %u scenarios x %d s ===\n",
+                (unsigned)ARRAY_SIZE(scenarios), FAULT_SCENARIO_MS / 1000);
+  startScenario(0);
+}
+
+void handleFaultScenarios()
+{
+  if (scenarioIndex < 0)
+    return;
+
+  switch (faultRunnerPass(runner, millis(), esp_random(), FAULT_SCENARIO_MS))
+  {
+  case FAULT_STEP_DONE:
+    finishScenario();
+    break;
+  case FAULT_STEP_TRAFFIC:
+    generateTraffic();
+    break;
+  default:
+    break;
+  }
+}
+
+#endif
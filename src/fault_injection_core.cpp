@@ -0,0 +1,153 @@
+#include "fault_injection_core.h"
+#include <string.h>
+
+FaultEffect connectFaultEffect(NetFault fault, uint32_t param)
+{
+  switch (fault)
+  {
+  case FAULT_AUTH_REJECT:
+    return {param, FAULT_RESULT_REJECTED};
+  case FAULT_DNS_FAIL:
+    return {param, FAULT_RESULT_REFUSED};
+  case FAULT_HALF_OPEN:
+    return {param, FAULT_RESULT_TIMEOUT};
+  default:
+    return {0, FAULT_RESULT_OK};
+  }
+}
+
+FaultEffect publishFaultEffect(NetFault fault, uint32_t param, uint32_t random)
+{
+  switch (fault)
+  {
+  case FAULT_LATENCY:
+    return {param, FAULT_RESULT_OK};
+  case FAULT_DROP:
+    return {0, random % 100 >= param ? FAULT_RESULT_OK : FAULT_RESULT_FAILED};
+  case FAULT_HALF_OPEN:
+    return {param, FAULT_RESULT_FAILED}; // Send buffer full, nothing acknowledged
+  default:
+    return {0, FAULT_RESULT_OK};
+  }
+}
+
+uint32_t readFaultDelay(NetFault fault, uint32_t param)
+{
+  return fault == FAULT_SLOW_READ ? param : 0;
+}
+
+FaultEffect httpFaultEffect(NetFault fault, uint32_t param)
+{
+  switch (fault)
+  {
+  case FAULT_HTTP_TIMEOUT:
+    return {param, FAULT_RESULT_TIMEOUT};
+  case FAULT_DNS_FAIL:
+    return {param, FAULT_RESULT_REFUSED};
+  default:
+    return {0, FAULT_RESULT_OK};
+  }
+}
+
+uint8_t latencyBucket(uint32_t ms)
+{
+  uint8_t bucket = 0;
+  while (bucket < FAULT_LATENCY_BUCKETS - 1 && (1UL << bucket) < ms)
+    bucket++;
+  return bucket;
+}
+
+void faultMeterStart(FaultMeter &meter, uint32_t nowMs)
+{
+  memset(&meter, 0, sizeof(meter));
+  meter.lastPass = nowMs;
+  meter.nextFeedDue = nowMs + FAULT_FEED_PERIOD_MS;
+  meter.pressAt = nowMs + 500;
+}
+
+void faultMeterPass(FaultMeter &meter, uint32_t nowMs, uint32_t random)
+{
+  FaultReport &report = meter.report;
+  uint32_t passMs = nowMs - meter.lastPass;
+  meter.lastPass = nowMs;
+
+  report.passes++;
+  if (passMs > report.maxLoopMs)
+    report.maxLoopMs = passMs;
+  meter.histogram[latencyBucket(passMs)]++;
+
+  // A scheduled feed is only checked while the loop runs within its minute
+  while ((int32_t)(nowMs - meter.nextFeedDue) >= 0)
+  {
+    report.feedsDue++;
+    if (nowMs - meter.nextFeedDue >= FAULT_FEED_WINDOW_MS)
+      report.feedsMissed++;
+    meter.nextFeedDue += FAULT_FEED_PERIOD_MS;
+  }
+
+  // Synthetic button press, serviced on the first pass after it
+  if ((int32_t)(nowMs - meter.pressAt) >= 0)
+  {
+    uint32_t responseMs = nowMs - meter.pressAt;
+    report.presses++;
+    meter.buttonTotalMs += responseMs;
+    if (responseMs > report.maxButtonMs)
+      report.maxButtonMs = responseMs;
+    meter.pressAt = nowMs + 200 + random % 800;
+  }
+}
+
+const FaultReport &faultMeterFinish(FaultMeter &meter)
+{
+  FaultReport &report = meter.report;
+
+  // 99th percentile: upper edge of the bucket holding it
+  uint32_t target = report.passes - report.passes / 100;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < FAULT_LATENCY_BUCKETS; b++)
+  {
+    seen += meter.histogram[b];
+    if (seen >= target)
+    {
+      report.p99LoopMs = b < FAULT_LATENCY_BUCKETS - 1 ? (1UL << b) : report.maxLoopMs;
+      break;
+    }
+  }
+  report.avgButtonMs = report.presses > 0 ? meter.buttonTotalMs / report.presses : 0;
+  report.passed = report.maxLoopMs <= FAULT_LOOP_BUDGET_MS &&
+                  report.maxButtonMs <= FAULT_BUTTON_BUDGET_MS && report.feedsMissed == 0;
+  return report;
+}
+
+FaultTraffic faultTrafficFor(NetFault fault)
+{
+  switch (fault)
+  {
+  case FAULT_AUTH_REJECT:
+  case FAULT_DNS_FAIL:
+    return FAULT_TRAFFIC_RECONNECT;
+  case FAULT_HTTP_TIMEOUT:
+    return FAULT_TRAFFIC_HTTP_POST;
+  default:
+    return FAULT_TRAFFIC_TELEMETRY;
+  }
+}
+
+void faultRunnerStart(FaultRunner &runner, uint32_t nowMs)
+{
+  faultMeterStart(runner.meter, nowMs);
+  runner.startMs = nowMs;
+  runner.lastTrafficMs = nowMs - FAULT_TRAFFIC_INTERVAL;
+}
+
+FaultStep faultRunnerPass(FaultRunner &runner, uint32_t nowMs, uint32_t random,
+                          uint32_t durationMs)
+{
+  faultMeterPass(runner.meter, nowMs, random);
+  if (nowMs - runner.startMs >= durationMs)
+    return FAULT_STEP_DONE;
+  if (nowMs - runner.lastTrafficMs < FAULT_TRAFFIC_INTERVAL)
+    return FAULT_STEP_IDLE;
+  runner.lastTrafficMs = nowMs;
+  return FAULT_STEP_TRAFFIC;
+}
@@ -0,0 +1,306 @@
+#include "feed_queue.h"
+#include "json_pool.h"
+#include "feeding_control.h"
+#include "button_handler.h"
+#include "servo_motion.h"
+#include "logger.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+
+static const char *TAG = "feedq";
+
+struct FeedCommand
+{
+  uint8_t source;
+  unsigned long requestedMillis;
+};
+
+// Producers: requestFeed() from the loop and the button task, serialized by
+// a spinlock. Consumer: handleFeedQueue(). Both indices only ever advance,
+// the ring holds FEED_RING_SIZE entries.
+static FeedCommand ring[FEED_RING_SIZE];
+static std::atomic<uint32_t> ringHead(0); // Next write
+static std::atomic<uint32_t> ringTail(0); // Next read
+static portMUX_TYPE producerLock = portMUX_INITIALIZER_UNLOCKED;
+
+// One waiting command per source, coalesced
+static bool waiting[FEED_SOURCE_COUNT];
+static unsigned long waitingSince[FEED_SOURCE_COUNT];
+static bool startRetrying[FEED_SOURCE_COUNT]; // Logged its first failed start
+
+static Preferences policyPrefs;
+static FeedPolicy feedPolicy = {FEED_POLICY_VERSION, 1, 0, FEED_COOLDOWN_MS,
+                                FEED_COMMAND_TTL_MS, FEED_DAILY_LIMIT_GRAMS};
+static FeedQueueStats feedQueueStats;
+
+static const char *sourceNames[FEED_SOURCE_COUNT] = {"scheduled", "remote", "manual"};
+
+const char *getFeedSourceName(uint8_t source)
+{
+  return source < FEED_SOURCE_COUNT ? sourceNames[source] : "unknown";
+}
+
+bool requestFeed(FeedSource source)
+{
+  bool queued = false;
+  portENTER_CRITICAL(&producerLock);
+  uint32_t head = ringHead.load(std::memory_order_relaxed);
+  if (head - ringTail.load(std::memory_order_acquire) >= FEED_RING_SIZE)
+  {
+    feedQueueStats.overflowed++;
+  }
+  else
+  {
+    ring[head & (FEED_RING_SIZE - 1)] = {source, millis()};
+    ringHead.store(head + 1, std::memory_order_release);
+    queued = true;
+  }
+  portEXIT_CRITICAL(&producerLock);
+  return queued;
+}
+
+bool isFeedCooldownActive()
+{
+  return timing.lastFeedingTime != 0 &&
+         millis() - timing.lastFeedingTime < feedPolicy.cooldownMs;
+}
+
+// Reason a command can never run right now, or nullptr
+static const char *rejectionReason(uint8_t source)
+{
+  if (sensors.foodLevel == FOOD_LEVEL_EMPTY)
+    return "hopper empty";
+
+  bool limitApplies = feedPolicy.dailyLimitGrams > 0.0 &&
+                      !(source == FEED_SOURCE_MANUAL && feedPolicy.manualIgnoresDailyLimit);
+  if (limitApplies && sensors.dailyFoodDispensed + FOOD_PORTION_GRAMS > feedPolicy.dailyLimitGrams)
+    return "daily limit reached";
+
+  return nullptr;
+}
+
+FeedAdmission getFeedAdmission(FeedSource source)
+{
+  if (rejectionReason(source) != nullptr)
+    return FEED_ADMIT_REJECT;
+
+  // Anything already queued goes first, in the queue's own order
+  bool queued = ringHead.load(std::memory_order_acquire) != ringTail.load(std::memory_order_acquire) ||
+                feedQueueStats.depth != 0;
+  if (queued || feederSystem.dispensing || isServoMotionActive() || isFeedCooldownActive())
+    return FEED_ADMIT_WAIT;
+  return FEED_ADMIT_NOW;
+}
+
+static bool startFeed(uint8_t source)
+{
+  switch (source)
+  {
+  case FEED_SOURCE_MANUAL:
+    return performManualFeed();
+  case FEED_SOURCE_REMOTE:
+    return handleRemoteFeeding();
+  default:
+    return performAutoFeed();
+  }
+}
+
+static void updateDepth()
+{
+  uint8_t depth = 0;
+  for (int i = 0; i < FEED_SOURCE_COUNT; i++)
+  {
+    if (waiting[i])
+      depth++;
+  }
+  feedQueueStats.depth = depth;
+  if (depth > feedQueueStats.maxDepth)
+    feedQueueStats.maxDepth = depth;
+}
+
+void handleFeedQueue()
+{
+  // Drain the ring into the per-source waiting slots
+  uint32_t tail = ringTail.load(std::memory_order_relaxed);
+  uint32_t head = ringHead.load(std::memory_order_acquire);
+  while (tail != head)
+  {
+    FeedCommand command = ring[tail & (FEED_RING_SIZE - 1)];
+    tail++;
+    feedQueueStats.requested++;
+
+    const char *reason = rejectionReason(command.source);
+    if (reason != nullptr)
+    {
+      feedQueueStats.rejected++;
+      LOGW(TAG, "Feed request (%s) rejected: %s", getFeedSourceName(command.source), reason);
+      if (command.source == FEED_SOURCE_MANUAL)
+        startBeepPattern(BUZZER_PATTERN_WARNING, BUZZER_SHORT_BEEP, BUZZER_SHORT_PAUSE, RGB_RED);
+      continue;
+    }
+
+    if (waiting[command.source])
+    {
+      feedQueueStats.coalesced++; // Keep the earlier request time
+      continue;
+    }
+    waiting[command.source] = true;
+    startRetrying[command.source] = false;
+    waitingSince[command.source] = command.requestedMillis;
+  }
+  ringTail.store(tail, std::memory_order_release);
+
+  unsigned long now = millis();
+  for (int i = 0; i < FEED_SOURCE_COUNT; i++)
+  {
+    if (waiting[i] && now - waitingSince[i] > feedPolicy.ttlMs)
+    {
+      waiting[i] = false;
+      feedQueueStats.expired++;
+      LOGW(TAG, "Feed request (%s) expired after %lu ms", getFeedSourceName(i), now - waitingSince[i]);
+      if (i == FEED_SOURCE_MANUAL)
+        startBeepPattern(BUZZER_PATTERN_WARNING, BUZZER_SHORT_BEEP, BUZZER_SHORT_PAUSE, RGB_RED);
+    }
+  }
+  updateDepth();
+
+  // The motion check covers a press the button task started since the last pass
+  if (feedQueueStats.depth == 0 || feederSystem.dispensing || isServoMotionActive() ||
+      isFeedCooldownActive())
+    return;
+
+  // Highest priority first
+  for (int source = FEED_SOURCE_COUNT - 1; source >= 0; source--)
+  {
+    if (!waiting[source])
+      continue;
+
+    // Conditions may have changed while it waited
+    const char *reason = rejectionReason(source);
+    if (reason != nullptr)
+    {
+      waiting[source] = false;
+      feedQueueStats.rejected++;
+      LOGW(TAG, "Feed request (%s) rejected: %s", getFeedSourceName(source), reason);
+    }
+    else if (!startFeed(source))
+    {
+      // Motion still busy: leave it queued for the next pass until ttlMs
+      feedQueueStats.startFailed++;
+      if (!startRetrying[source])
+        LOGW(TAG, "Feed request (%s) could not start, retrying", getFeedSourceName(source));
+      startRetrying[source] = true;
+    }
+    else
+    {
+      waiting[source] = false;
+      unsigned long waitMs = now - waitingSince[source];
+      feedQueueStats.started++;
+      feedQueueStats.lastWaitMs = waitMs;
+      feedQueueStats.totalWaitMs += waitMs;
+      if (waitMs > feedQueueStats.maxWaitMs)
+        feedQueueStats.maxWaitMs = waitMs;
+    }
+    break;
+  }
+  updateDepth();
+}
+
+const FeedPolicy &getFeedPolicy()
+{
+  return feedPolicy;
+}
+
+const FeedQueueStats &getFeedQueueStats()
+{
+  return feedQueueStats;
+}
+
+void setupFeedQueue()
+{
+  FeedPolicy stored;
+  policyPrefs.begin(FEED_POLICY_NVS_NAMESPACE, true);
+  size_t length = policyPrefs.getBytes("policy", &stored, sizeof(stored));
+  policyPrefs.end();
+
+  if (length == sizeof(stored) && stored.version == FEED_POLICY_VERSION)
+  {
+    feedPolicy = stored;
+    LOGI(TAG, "✓ Feed policy loaded: cooldown %lu ms, daily limit %.0f g",
+         (unsigned long)feedPolicy.cooldownMs, feedPolicy.dailyLimitGrams);
+  }
+}
+
+static String feedPolicyJson()
+{
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  doc["cooldownMs"] = feedPolicy.cooldownMs;
+  doc["ttlMs"] = feedPolicy.ttlMs;
+  doc["dailyLimitGrams"] = feedPolicy.dailyLimitGrams;
+  doc["manualIgnoresDailyLimit"] = feedPolicy.manualIgnoresDailyLimit != 0;
+  doc["dailyDispensedGrams"] = sensors.dailyFoodDispensed;
+
+  JsonObject queue = doc.createNestedObject("queue");
+  queue["depth"] = feedQueueStats.depth;
+  queue["maxDepth"] = feedQueueStats.maxDepth;
+  queue["requested"] = feedQueueStats.requested;
+  queue["started"] = feedQueueStats.started;
+  queue["startFailed"] = feedQueueStats.startFailed;
+  queue["coalesced"] = feedQueueStats.coalesced;
+  queue["rejected"] = feedQueueStats.rejected;
+  queue["expired"] = feedQueueStats.expired;
+  queue["overflowed"] = feedQueueStats.overflowed;
+  queue["lastWaitMs"] = feedQueueStats.lastWaitMs;
+  queue["maxWaitMs"] = feedQueueStats.maxWaitMs;
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+// {"action":"get"|"set", "cooldownMs":n, "ttlMs":n, "dailyLimitGrams":g, "manualIgnoresDailyLimit":b}
+int handleFeedPolicyMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<192> request;
+  if (deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  String action = request["action"] | "get";
+
+  if (action == "set")
+  {
+    FeedPolicy updated = feedPolicy;
+    updated.cooldownMs = request["cooldownMs"] | updated.cooldownMs;
+    updated.ttlMs = request["ttlMs"] | updated.ttlMs;
+    updated.dailyLimitGrams = request["dailyLimitGrams"] | updated.dailyLimitGrams;
+    updated.manualIgnoresDailyLimit = (request["manualIgnoresDailyLimit"] | (updated.manualIgnoresDailyLimit != 0)) ? 1 : 0;
+
+    if (updated.cooldownMs > 3600000 || updated.ttlMs < 1000 || updated.ttlMs > 3600000 ||
+        updated.dailyLimitGrams < 0.0)
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Policy out of range\"}";
+      return 400;
+    }
+
+    feedPolicy = updated;
+    policyPrefs.begin(FEED_POLICY_NVS_NAMESPACE, false);
+    policyPrefs.putBytes("policy", &feedPolicy, sizeof(feedPolicy));
+    policyPrefs.end();
+    LOGI(TAG, "Feed policy updated: cooldown %lu ms, daily limit %.0f g",
+         (unsigned long)feedPolicy.cooldownMs, feedPolicy.dailyLimitGrams);
+  }
+  else if (action != "get")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown policy action\"}";
+    return 400;
+  }
+
+  responsePayload = feedPolicyJson();
+  return 200;
+}
@@ -1,6 +1,19 @@
 #include "feeding_control.h"
 #include "globals.h"
 #include "display_manager.h"
+#include "meal_tracker.h"
+#include "stall_watchdog.h"
+#include "history_store.h"
+#include "dispense_capture.h"
+#include "servo_motion.h"
+#include "feed_queue.h"
+#include "sensor_manager.h"
+#include "calendar.h"
+#include "hopper_model.h"
+#include "logger.h"
+
+static const char *TAG = "feed";
+
 void handleFeeding()
 {
   // IMPORTANT: Only handle auto-feeding here
@@ -16,276 +29,150 @@ void handleFeeding()
   // Don't start dispensing automatically from this function
 }
 
-// New function for remote feeding that can override timing restrictions
-void handleRemoteFeeding()
+// Dispense in progress; finished by checkFeedingComplete()
+static const char *activeFeedingType = nullptr;
+static const IndicatorPattern *activeCompleteCue = nullptr;
+
+bool beginDispense(const char *feedingType, const char *title,
+                   const IndicatorPattern *moveCue, const IndicatorPattern *completeCue)
 {
-  // Only check critical restrictions for remote feeding
-  if (feederSystem.dispensing)
-  {
-    Serial.println("Cannot dispense food - already dispensing");
-    return;
-  }
+  STALL_REGION(REGION_DISPENSE);
 
-  // Check if food level is empty
-  if (strcmp(sensors.foodLevel, FOOD_LEVEL_EMPTY) == 0)
-  {
-    Serial.println("Cannot dispense food - no food available");
-    return;
-  }
+  if (feederSystem.dispensing || !startDispenseMotion(getDispensePattern(), moveCue))
+    return false;
 
-  // Use the EXACT same dispensing pattern as manual feeding
-  Serial.println("=== STARTING REMOTE FEED SEQUENCE ===");
+  dispenseStarted(feedingType, title, completeCue, millis());
+  return true;
+}
 
+void dispenseStarted(const char *feedingType, const char *title,
+                     const IndicatorPattern *completeCue, unsigned long startMillis)
+{
   // Set dispensing flag immediately to prevent multiple triggers
-  feederSystem.dispensing = true;
-  timing.dispenseStartTime = millis();
-
-  // Display dispensing status on LCD
+  setDispensing(true);
+  timing.dispenseStartTime = startMillis;
+  activeFeedingType = feedingType;
+  activeCompleteCue = completeCue;
+  hopperDispenseStarted();
+  captureDispenseStarted();
+
+  // Display dispensing status on LCD; updateLCD() adds the cycle number
   lcd.clear();
   lcd.setCursor(0, 0);
-  lcd.print("Remote Dispensing");
-
-  // Servo dispensing: 90° to 45° and back, 3 times with 1s delay (SAME AS MANUAL)
-  for (int i = 0; i < 3; i++)
-  {
-    Serial.printf("Remote dispensing cycle %d/3\n", i + 1);
-
-    // Update LCD with cycle number
-    lcd.setCursor(0, 1);
-    lcd.print("Cycle ");
-    lcd.print(i + 1);
-    lcd.print(" of 3     ");
-
-    // Move servo to 45 degrees (left)
-    myServo.write(45);
-
-    // Buzzer sound when moving with LED feedback
-    digitalWrite(BUZZER_PIN, HIGH);
-    setRGBColor(RGB_BLUE); // Blue during remote dispensing
-    delay(200);
-    digitalWrite(BUZZER_PIN, LOW);
-    setRGBColor(RGB_OFF);
-
-    delay(500); // Wait in position
-
-    // Return servo to 90 degrees (center)
-    myServo.write(90);
-
-    // Buzzer sound when returning with LED feedback
-    digitalWrite(BUZZER_PIN, HIGH);
-    setRGBColor(RGB_BLUE);
-    delay(200);
-    digitalWrite(BUZZER_PIN, LOW);
-    setRGBColor(RGB_OFF);
-
-    // 1 second delay between cycles (except after last cycle)
-    if (i < 2)
-    {
-      delay(1000);
-    }
-  }
+  lcd.print(title);
 
-  // Final confirmation (SAME AS MANUAL)
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print("Complete!");
-  lcd.setCursor(0, 1);
-  lcd.print("Food Dispensed");
-
-  // Final buzzer sequence with LED
-  for (int i = 0; i < 3; i++)
-  {
-    digitalWrite(BUZZER_PIN, HIGH);
-    setRGBColor(RGB_GREEN); // Green for completion
-    delay(150);
-    digitalWrite(BUZZER_PIN, LOW);
-    setRGBColor(RGB_OFF);
-    delay(150);
-  }
-
-  delay(500); // Reduced from 1000
-
-  // Clear dispensing flag and update timing
-  feederSystem.dispensing = false;
-  timing.lastFeedingTime = millis();
-
-  // Record the remote feeding
-  recordFoodDispensing("Remote");
-
-  // Restore food level LED
-  updateFoodLevelLED();
+  LOGI(TAG, "=== STARTING %s FEED SEQUENCE ===", feedingType);
+}
 
-  Serial.println("=== REMOTE FEEDING SEQUENCE COMPLETED ===");
-  Serial.println("Ready for next dispensing");
+// Started by the feed queue for remote commands; the policy was checked there
+bool handleRemoteFeeding()
+{
+  // Same dispense pattern as manual feeding, blue LED cues
+  return beginDispense("Remote", "Remote Dispensing", &PATTERN_REMOTE_MOVE, &PATTERN_REMOTE_COMPLETE);
 }
 
-// This function should be called in your main loop to check if dispensing is complete
+// Called every loop pass; finishes the dispense once the servo is back at rest
 void checkFeedingComplete()
 {
-  unsigned long currentMillis = millis();
+  if (!feederSystem.dispensing || activeFeedingType == nullptr)
+    return;
 
-  // This function is only for automatic timeout of dispensing
-  // Manual feeding handles its own completion
-  if (feederSystem.dispensing &&
-      !buttons.manualFeedInProgress && // Don't interfere with manual feeding
-      currentMillis - timing.dispenseStartTime >= DISPENSE_TIME)
+  unsigned long elapsed = millis() - timing.dispenseStartTime;
+  if (isServoMotionActive())
   {
-    // Stop dispensing
-    myServo.write(90); // Return to rest position
-    feederSystem.dispensing = false;
+    if (elapsed < dispensePatternDurationMs(getDispensePattern()) + DISPENSE_TIMEOUT_MARGIN)
+      return;
 
-    // Provide completion feedback
-    buzzerBeepWithLED(BUZZER_PATTERN_WARNING, BUZZER_MEDIUM_BEEP, BUZZER_MEDIUM_PAUSE, RGB_PURPLE);
-    setRGBColor(sensors.foodLevel);
-
-    Serial.println("Automatic feeding cycle completed (timed)");
+    LOGW(TAG, "⚠️ Dispense motion overran - returning servo to rest");
+    stopServoMotion();
   }
-}
 
-void performAutoFeed()
-{
-  // Only proceed if not already dispensing
-  if (feederSystem.dispensing)
-  {
-    Serial.println("Cannot auto-feed - already dispensing");
-    return;
-  }
+  setDispensing(false);
 
-  Serial.println("=== AUTO FEED SEQUENCE STARTING ===");
+  // Completion cue, then back to the food level color
+  updateFoodLevelLED();
+  if (activeCompleteCue != nullptr)
+    startIndicatorPattern(*activeCompleteCue);
 
-  // Set dispensing flag immediately
-  feederSystem.dispensing = true;
-  timing.dispenseStartTime = millis();
+  recordFoodDispensing(activeFeedingType);
+  hopperDispenseFinished();
+  captureDispenseFinished();
 
-  // Display on LCD
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print("Auto Feeding");
+  LOGI(TAG, "=== %s FEEDING SEQUENCE COMPLETED in %lu ms ===", activeFeedingType, elapsed);
+  activeFeedingType = nullptr;
+}
 
-  // Use the same dispensing pattern
-  myServo.write(45); // Move to dispense position
+bool performAutoFeed()
+{
+  if (!beginDispense("Scheduled", "Auto Feeding", nullptr, &PATTERN_AUTO_COMPLETE))
+  {
+    LOGW(TAG, "Cannot auto-feed - already dispensing");
+    return false;
+  }
 
-  // Record and provide feedback
-  recordFoodDispensing("Scheduled");
+  // Provide feedback; LED stays blue until the dispense completes
   buzzerBeepWithLED(BUZZER_PATTERN_SINGLE, BUZZER_MEDIUM_BEEP, 0, RGB_BLUE);
   setRGBColor(RGB_BLUE);
 
   // Update last auto feed time
   if (feederSystem.rtcReady)
   {
-    timeData.lastAutoFeedTime = rtc.GetDateTime();
+    timeData.lastAutoFeedTime = getLocalDateTime();
   }
-
-  Serial.println("Auto feeding started");
-}
-
-bool canDispenseFood()
-{
-  unsigned long currentMillis = millis();
-
-  // Check minimum interval between feedings - reduced to 5 seconds for auto-feeding
-  if (currentMillis - timing.lastFeedingTime < 5000) // 5 seconds
-    return false;
-
-  // Check if food level is empty - use strcmp for char array comparison
-  if (strcmp(sensors.foodLevel, FOOD_LEVEL_EMPTY) == 0)
-    return false;
-
-  // REMOVED: Bowl full check and daily limit for manual feeding
-  return true;
-}
-
-// New function specifically for manual feeding - always allow if not empty
-bool canManualDispense()
-{
-  // Only check if food is available and not currently dispensing
-  if (feederSystem.dispensing)
-    return false;
-
-  // Check if food level is empty
-  if (strcmp(sensors.foodLevel, FOOD_LEVEL_EMPTY) == 0)
-    return false;
-
-  // Allow manual dispensing regardless of bowl status, timing, or daily limits
-  return true;
-}
-
-// New function that can override timing for remote commands
-bool canDispenseFoodRemote()
-{
-  // DISABLED: Daily limit check
-  // if (sensors.dailyFoodDispensed >= MAX_DAILY_FOOD)
-  //   return false;
-
-  // Check if food level is empty - use strcmp for char array comparison
-  if (strcmp(sensors.foodLevel, FOOD_LEVEL_EMPTY) == 0)
-    return false;
-
-  // Skip timing and bowl full checks for remote commands
   return true;
 }
 
 void recordFoodDispensing(String feedingType)
 {
-  // DISABLED: Daily food tracking
-  // sensors.dailyFoodDispensed += FOOD_PORTION_GRAMS;
+  // Daily total feeds the feed policy's daily limit
+  sensors.dailyFoodDispensed += FOOD_PORTION_GRAMS;
   sensors.totalFoodDispensed += FOOD_PORTION_GRAMS;
+  recordHistory(HISTORY_DISPENSED, FOOD_PORTION_GRAMS);
   timing.lastFeedingTime = millis();
 
   // Update feeding status
-  String status = getFeedingStatus();
-  strcpy(sensors.feedingStatus, status.c_str());
+  setFeedingStatus(getFeedingStatus());
 
-  Serial.println("Food dispensed: " + feedingType + " - " + String(FOOD_PORTION_GRAMS) + "g");
+  LOGI(TAG, "Food dispensed: %s - %dg", feedingType.c_str(), (int)FOOD_PORTION_GRAMS);
 }
 
-String getFeedingStatus()
+FeedingStatus getFeedingStatus()
 {
-  unsigned long currentMillis = millis();
+  if (feederSystem.refillMode)
+    return FEEDING_STATUS_REFILL;
 
-  // DISABLED: Daily limit check
-  // if (sensors.dailyFoodDispensed >= MAX_DAILY_FOOD)
-  //   return String("Daily limit reached");
+  // Same rules the feed queue applies
+  const FeedPolicy &policy = getFeedPolicy();
+  if (policy.dailyLimitGrams > 0.0 &&
+      sensors.dailyFoodDispensed + FOOD_PORTION_GRAMS > policy.dailyLimitGrams)
+    return FEEDING_STATUS_DAILY_LIMIT;
 
   // DISABLED: Bowl full check
-  // if (feederSystem.bowlFull || strcmp(sensors.bowlStatus, BOWL_STATUS_FULL) == 0)
-  //   return String("Bowl full");
-
-  if (currentMillis - timing.lastFeedingTime < 5000) // 5 seconds
-    return String("Too soon");
+  // if (feederSystem.bowlFull || sensors.bowlStatus == BOWL_STATUS_FULL)
+  //   return FEEDING_STATUS_BOWL_FULL;
 
-  // Use strcmp for char array comparison
-  if (strcmp(sensors.foodLevel, FOOD_LEVEL_EMPTY) == 0)
-    return String("No food");
-
-  return String("Ready to feed");
-}
-
-// New function for remote feeding status
-String getRemoteFeedingStatus()
-{
-  // DISABLED: Daily limit check
-  // if (sensors.dailyFoodDispensed >= MAX_DAILY_FOOD)
-  //   return String("Daily limit reached");
+  if (isFeedCooldownActive())
+    return FEEDING_STATUS_TOO_SOON;
 
-  if (strcmp(sensors.foodLevel, FOOD_LEVEL_EMPTY) == 0)
-    return String("No food");
+  if (sensors.foodLevel == FOOD_LEVEL_EMPTY)
+    return FEEDING_STATUS_NO_FOOD;
 
-  return String("Ready to feed");
+  return FEEDING_STATUS_READY;
 }
 
 void resetDailyCounters()
 {
   if (feederSystem.rtcReady)
   {
-    RtcDateTime now = rtc.GetDateTime();
+    RtcDateTime now = getLocalDateTime();
     static int lastDay = -1;
 
-    if (lastDay != now.Day())
+    // The first call only notes the day; a total restored at boot is kept
+    if (lastDay != -1 && lastDay != now.Day())
     {
-      // DISABLED: Daily counter reset
-      // sensors.dailyFoodDispensed = 0.0;
-      lastDay = now.Day();
+      sensors.dailyFoodDispensed = 0.0;
+      resetMealDailyStats();
     }
+    lastDay = now.Day();
   }
 }
\ No newline at end of file
@@ -0,0 +1,527 @@
+#include "gateway.h"
+#include "network_manager.h"
+#include "sensor_manager.h"
+#include "logger.h"
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <ArduinoJson.h>
+
+static const char *TAG = "gateway";
+
+const char *getFeederId()
+{
+#if FEEDER_ROLE == FEEDER_ROLE_LEAF
+  // Leaves share one firmware image, so derive a stable ID from the MAC
+  // instead of the per-device DEVICE_ID secret
+  static char feederId[20] = "";
+  if (feederId[0] == '\0')
+  {
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(feederId, sizeof(feederId), "feeder-%02x%02x%02x", mac[3], mac[4], mac[5]);
+  }
+  return feederId;
+#else
+  return DEVICE_ID;
+#endif
+}
+
+// Leaf ids are spliced into the upstream batch JSON and into topics, so only
+// characters that need no escaping in either are accepted
+static bool isValidFeederId(const char *id, size_t length)
+{
+  if (length == 0 || length > FEEDER_ID_MAX)
+    return false;
+  for (size_t i = 0; i < length; i++)
+  {
+    char c = id[i];
+    if (!isalnum((unsigned char)c) && c != '_' && c != '-')
+      return false;
+  }
+  return true;
+}
+
+// Splits "<root>/<id>/<kind>/<a>/<b>" into its id, a and b segments.
+// Returns false if the topic does not match the expected kind or the id is
+// not a valid feeder id.
+static bool parseLocalTopic(const char *topic, char kind,
+                            String &id, String &first, String &second)
+{
+  String topicStr = String(topic);
+  String prefix = String(LOCAL_TOPIC_ROOT) + "/";
+  if (!topicStr.startsWith(prefix))
+    return false;
+
+  int idStart = prefix.length();
+  int idEnd = topicStr.indexOf('/', idStart);
+  int length = topicStr.length();
+  if (idEnd <= idStart || idEnd + 1 >= length || topicStr[idEnd + 1] != kind)
+    return false;
+  if (idEnd + 2 < length && topicStr[idEnd + 2] != '/')
+    return false;
+
+  id = topicStr.substring(idStart, idEnd);
+  if (!isValidFeederId(id.c_str(), id.length()))
+    return false;
+
+  int firstStart = idEnd + 3; // skip "/<kind>/"
+  if (firstStart >= length)
+  {
+    first = "";
+    second = "";
+    return true;
+  }
+
+  int firstEnd = topicStr.indexOf('/', firstStart);
+  if (firstEnd < 0)
+  {
+    first = topicStr.substring(firstStart);
+    second = "";
+  }
+  else
+  {
+    first = topicStr.substring(firstStart, firstEnd);
+    second = topicStr.substring(firstEnd + 1);
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Leaf role
+// ---------------------------------------------------------------------------
+
+static bool publishLeafSample(const char *feederId)
+{
+  // Compact, hand-formatted payload: no JSON document and no TLS framing
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%s/t", LOCAL_TOPIC_ROOT, feederId);
+
+  char payload[96];
+  int len = snprintf(payload, sizeof(payload),
+                     "{\"w\":%.1f,\"l\":\"%s\",\"p\":%d,\"up\":%lu}",
+                     sensors.weight, getFoodLevelName(sensors.foodLevel),
+                     feederSystem.animalDetected ? 1 : 0, millis() / 1000);
+
+  return mqttClient.publish(topic, (const uint8_t *)payload, len);
+}
+
+bool publishLeafTelemetry()
+{
+  if (!mqttClient.connected() && !connectMQTT())
+  {
+    LOGE(TAG, "✗ Local broker unavailable, telemetry skipped");
+    return false;
+  }
+
+  bool ok = publishLeafSample(getFeederId());
+
+  // Load generation: one physical leaf impersonating several feeders so the
+  // gateway can be measured as the feeder count grows
+  for (int i = 1; i < LEAF_VIRTUAL_FEEDERS; i++)
+  {
+    char virtualId[32];
+    snprintf(virtualId, sizeof(virtualId), "%s-v%d", getFeederId(), i);
+    ok = publishLeafSample(virtualId) && ok;
+  }
+
+  feederSystem.mqttConnected = ok;
+  feederSystem.backendConnected = ok;
+  return ok;
+}
+
+void subscribeLeafTopics()
+{
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%s/m/#", LOCAL_TOPIC_ROOT, getFeederId());
+  mqttClient.subscribe(topic);
+  LOGI(TAG, "Subscribed to local methods: %s", topic);
+}
+
+bool isLeafMethodTopic(const char *topic)
+{
+  String id, methodName, requestId;
+  return parseLocalTopic(topic, 'm', id, methodName, requestId);
+}
+
+void handleLeafMethod(char *topic, byte *payload, unsigned int length)
+{
+  String id, methodName, requestId;
+  if (!parseLocalTopic(topic, 'm', id, methodName, requestId) || methodName.length() == 0)
+  {
+    LOGW(TAG, "Malformed local method topic");
+    return;
+  }
+
+  LOGD(TAG, "Local method '%s' (rid %s)", methodName.c_str(), requestId.c_str());
+
+  String responsePayload;
+  int status = dispatchDirectMethod(methodName, payload, length, responsePayload);
+
+  char responseTopic[96];
+  snprintf(responseTopic, sizeof(responseTopic), "%s/%s/r/%d/%s",
+           LOCAL_TOPIC_ROOT, getFeederId(), status, requestId.c_str());
+
+  if (!mqttClient.publish(responseTopic, responsePayload.c_str()))
+  {
+    LOGE(TAG, "✗ Failed to publish local method response");
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Gateway role
+// ---------------------------------------------------------------------------
+
+#if FEEDER_ROLE == FEEDER_ROLE_GATEWAY
+
+static WiFiClient localWifiClient;
+static PubSubClient localClient(localWifiClient);
+
+static GatewayStats gatewayStats;
+static unsigned long lastLocalReconnect = 0;
+static unsigned long lastBatchFlush = 0;
+static unsigned long lastStatsReport = 0;
+static unsigned long messagesAtLastReport = 0;
+
+// Distinct leaves, kept as FNV-1a hashes so the table stays a few hundred bytes
+static uint32_t knownFeeders[GATEWAY_MAX_FEEDERS];
+
+// Upstream batch: {"messageType":"batch","gatewayId":"..","feeders":[{..},{..}]}
+static char batchBuffer[MQTT_BUFFER_SIZE];
+static size_t batchLength = 0;
+static size_t batchHeaderLength = 0;
+static int batchCount = 0;
+static bool upstreamReconnectPending = false;
+
+static uint32_t hashFeederId(const char *id, size_t len)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++)
+  {
+    hash ^= (uint8_t)id[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static bool isKnownFeeder(uint32_t hash)
+{
+  for (int i = 0; i < gatewayStats.feedersSeen; i++)
+  {
+    if (knownFeeders[i] == hash)
+      return true;
+  }
+  return false;
+}
+
+static void rememberFeeder(const String &id)
+{
+  uint32_t hash = hashFeederId(id.c_str(), id.length());
+  if (!isKnownFeeder(hash) && gatewayStats.feedersSeen < GATEWAY_MAX_FEEDERS)
+  {
+    knownFeeders[gatewayStats.feedersSeen++] = hash;
+    LOGI(TAG, "Gateway: new feeder %s (%d total)", id.c_str(), gatewayStats.feedersSeen);
+  }
+}
+
+static void resetBatch()
+{
+  batchHeaderLength = snprintf(batchBuffer, sizeof(batchBuffer),
+                               "{\"messageType\":\"batch\",\"gatewayId\":\"%s\",\"feeders\":[",
+                               getFeederId());
+  batchLength = batchHeaderLength;
+  batchCount = 0;
+}
+
+static void flushBatch()
+{
+  if (batchCount == 0)
+    return;
+
+  if (!mqttClient.connected())
+  {
+    // Keep the batch; new samples are dropped until the hub is back. This
+    // can run inside the local broker callback, so the reconnect itself is
+    // left to handleGateway()
+    upstreamReconnectPending = true;
+    return;
+  }
+
+  // Close the array and object in place
+  batchBuffer[batchLength++] = ']';
+  batchBuffer[batchLength++] = '}';
+
+  if (mqttClient.publish(iotHub.telemetryTopic, (const uint8_t *)batchBuffer, batchLength))
+  {
+    gatewayStats.batchesOut++;
+    gatewayStats.bytesOut += batchLength;
+    feederSystem.backendConnected = true;
+  }
+  else
+  {
+    gatewayStats.dropped += batchCount;
+    feederSystem.backendConnected = false;
+    LOGE(TAG, "✗ Gateway batch publish failed");
+  }
+
+  resetBatch();
+}
+
+// Structural check of a leaf payload: one JSON object, brackets balanced
+// outside strings, no raw control characters. Cheaper than a full parse and
+// enough to keep one bad leaf from breaking the whole upstream batch.
+static bool isWellFormedLeafObject(const byte *payload, unsigned int length)
+{
+  if (length < 2 || length > GATEWAY_LEAF_MAX_BYTES || payload[0] != '{')
+    return false;
+
+  char stack[16];
+  uint8_t depth = 0;
+  bool inString = false;
+  for (unsigned int i = 0; i < length; i++)
+  {
+    char c = (char)payload[i];
+    if ((uint8_t)c < 0x20)
+      return false;
+    if (inString)
+    {
+      if (c == '\\')
+        i++; // Skip the escaped character
+      else if (c == '"')
+        inString = false;
+      continue;
+    }
+
+    if (c == '"')
+    {
+      inString = true;
+    }
+    else if (c == '{' || c == '[')
+    {
+      if (depth == sizeof(stack))
+        return false;
+      stack[depth++] = c == '{' ? '}' : ']';
+    }
+    else if (c == '}' || c == ']')
+    {
+      if (depth == 0 || stack[--depth] != c)
+        return false;
+      // Nothing may follow the outer object
+      if (depth == 0 && i != length - 1)
+        return false;
+    }
+  }
+  return depth == 0 && !inString;
+}
+
+// Appends {"id":"<id>",<leaf fields>} after a structural check of the leaf payload
+static void appendToBatch(const String &id, const byte *payload, unsigned int length)
+{
+  if (!isWellFormedLeafObject(payload, length))
+  {
+    gatewayStats.dropped++;
+    LOGW(TAG, "Gateway: malformed or oversized message from %s dropped", id.c_str());
+    return;
+  }
+
+  // ',' + {"id":"..", + payload body (without its '{') + room for "]}"
+  size_t needed = 1 + 8 + id.length() + (length - 1) + 2;
+  if (batchLength + needed > sizeof(batchBuffer))
+  {
+    flushBatch();
+    if (batchLength + needed > sizeof(batchBuffer))
+    {
+      gatewayStats.dropped++;
+      return;
+    }
+  }
+
+  if (batchCount > 0)
+  {
+    batchBuffer[batchLength++] = ',';
+  }
+  batchLength += snprintf(batchBuffer + batchLength, sizeof(batchBuffer) - batchLength,
+                          "{\"id\":\"%s\",", id.c_str());
+  if (length > 2)
+  {
+    memcpy(batchBuffer + batchLength, payload + 1, length - 1);
+    batchLength += length - 1;
+  }
+  else
+  {
+    // Empty leaf object: drop our trailing ',' and close
+    batchBuffer[batchLength - 1] = '}';
+  }
+  batchCount++;
+}
+
+static void handleLocalMessage(char *topic, byte *payload, unsigned int length)
+{
+  String id, first, second;
+
+  if (parseLocalTopic(topic, 't', id, first, second))
+  {
+    gatewayStats.messagesIn++;
+    rememberFeeder(id);
+    appendToBatch(id, payload, length);
+    return;
+  }
+
+  if (parseLocalTopic(topic, 'r', id, first, second))
+  {
+    // first = status, second = rid
+    String responseTopic = "$iothub/methods/res/" + first + "/?$rid=" + second;
+    if (mqttClient.publish(responseTopic.c_str(), payload, length))
+    {
+      gatewayStats.responsesForwarded++;
+    }
+    else
+    {
+      LOGE(TAG, "✗ Failed to forward response from %s", id.c_str());
+    }
+    return;
+  }
+
+  // Subscribed filters only deliver t and r topics: the feeder id was bad
+  gatewayStats.dropped++;
+  LOGW(TAG, "Gateway: message with an invalid feeder id dropped");
+}
+
+static bool connectLocalBroker()
+{
+  String clientId = String(getFeederId()) + "-gw";
+  if (!localClient.connect(clientId.c_str()))
+  {
+    LOGE(TAG, "Local broker connect failed, state %d", localClient.state());
+    return false;
+  }
+
+  String telemetryFilter = String(LOCAL_TOPIC_ROOT) + "/+/t";
+  String responseFilter = String(LOCAL_TOPIC_ROOT) + "/+/r/#";
+  localClient.subscribe(telemetryFilter.c_str());
+  localClient.subscribe(responseFilter.c_str());
+  LOGI(TAG, "✓ Gateway connected to local broker");
+  return true;
+}
+
+void setupGateway()
+{
+  LOGI(TAG, "=== Setting up Local Gateway ===");
+  LOGI(TAG, "Local broker: %s:%d", LOCAL_BROKER_HOST, LOCAL_BROKER_PORT);
+
+  localClient.setServer(LOCAL_BROKER_HOST, LOCAL_BROKER_PORT);
+  localClient.setCallback(handleLocalMessage);
+  localClient.setBufferSize(MQTT_BUFFER_SIZE);
+  localClient.setKeepAlive(60);
+
+  resetBatch();
+  lastBatchFlush = millis();
+  lastStatsReport = millis();
+  lastLocalReconnect = millis();
+  connectLocalBroker();
+}
+
+void handleGateway()
+{
+  unsigned long currentMillis = millis();
+
+  // Upstream reconnect requested by a flush; connectMQTT() is backed off
+  // and returns at once while it waits
+  if (upstreamReconnectPending)
+  {
+    if (mqttClient.connected() || connectMQTT())
+      upstreamReconnectPending = false;
+  }
+
+  if (localClient.connected())
+  {
+    localClient.loop();
+  }
+  else if (WiFi.status() == WL_CONNECTED &&
+           currentMillis - lastLocalReconnect >= LOCAL_RECONNECT_INTERVAL)
+  {
+    // Single non-blocking attempt per interval so leaves can't stall the loop
+    lastLocalReconnect = currentMillis;
+    connectLocalBroker();
+  }
+
+  if (currentMillis - lastBatchFlush >= GATEWAY_BATCH_INTERVAL)
+  {
+    flushBatch();
+    lastBatchFlush = currentMillis;
+  }
+
+  if (currentMillis - lastStatsReport >= GATEWAY_STATS_INTERVAL)
+  {
+    unsigned long elapsed = currentMillis - lastStatsReport;
+    gatewayStats.messagesPerSecond =
+        (gatewayStats.messagesIn - messagesAtLastReport) * 1000.0 / elapsed;
+    messagesAtLastReport = gatewayStats.messagesIn;
+    lastStatsReport = currentMillis;
+
+    char stats[192];
+    int len = snprintf(stats, sizeof(stats),
+                       "{\"feeders\":%d,\"msgIn\":%lu,\"msgPerSec\":%.2f,\"batches\":%lu,"
+                       "\"bytesOut\":%lu,\"methods\":%lu,\"responses\":%lu,\"dropped\":%lu}",
+                       gatewayStats.feedersSeen, gatewayStats.messagesIn,
+                       gatewayStats.messagesPerSecond, gatewayStats.batchesOut,
+                       gatewayStats.bytesOut, gatewayStats.methodsForwarded,
+                       gatewayStats.responsesForwarded, gatewayStats.dropped);
+
+    LOGI(TAG, "Gateway stats: %s", stats);
+    if (localClient.connected())
+    {
+      String statsTopic = String(LOCAL_TOPIC_ROOT) + "/gateway/stats";
+      localClient.publish(statsTopic.c_str(), (const uint8_t *)stats, len);
+    }
+  }
+}
+
+bool forwardMethodToFeeder(const char *target, const String &methodName,
+                           const String &requestId, byte *payload, unsigned int length)
+{
+  size_t targetLength = strlen(target);
+  if (!isValidFeederId(target, targetLength) || !isKnownFeeder(hashFeederId(target, targetLength)) ||
+      !localClient.connected())
+  {
+    return false;
+  }
+
+  char topic[128];
+  snprintf(topic, sizeof(topic), "%s/%s/m/%s/%s",
+           LOCAL_TOPIC_ROOT, target, methodName.c_str(), requestId.c_str());
+
+  if (!localClient.publish(topic, payload, length))
+  {
+    return false;
+  }
+
+  gatewayStats.methodsForwarded++;
+  return true;
+}
+
+const GatewayStats &getGatewayStats()
+{
+  return gatewayStats;
+}
+
+#else
+
+// Non-gateway builds keep the symbols so callers need no role checks
+
+static GatewayStats gatewayStats;
+
+void setupGateway() {}
+
+void handleGateway() {}
+
+bool forwardMethodToFeeder(const char *, const String &, const String &, byte *, unsigned int)
+{
+  return false;
+}
+
+const GatewayStats &getGatewayStats()
+{
+  return gatewayStats;
+}
+
+#endif
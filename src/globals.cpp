@@ -11,8 +11,6 @@ HX711 scale;
 int feedingTimes[] = {FEEDING_TIME_1, FEEDING_TIME_2, FEEDING_TIME_3, FEEDING_TIME_4};
 int numFeedingTimes = ARRAY_SIZE(feedingTimes);
 SystemState feederSystem;
-ButtonState buttons;
 SensorData sensors;
 Timing timing;
-TimeData timeData;
-IoTHubConfig iotHub;
\ No newline at end of file
+TimeData timeData;
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "history_store.h"
+#include "json_pool.h"
+#include "method_stream.h"
+#include "calendar.h"
+#include "stall_watchdog.h"
+#include "logger.h"
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+
+static const char *TAG = "history";
+
+struct HistoryFileHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t periodS;
+  uint32_t headBucket;
+  uint16_t headIndex;
+  uint16_t reserved;
+  HistoryAccumulator open;
+};
+
+static HistoryPoint minutePoints[HISTORY_MINUTE_POINTS];
+static HistoryPoint hourPoints[HISTORY_HOUR_POINTS];
+static HistoryPoint dayPoints[HISTORY_DAY_POINTS];
+
+static HistoryTier tiers[HISTORY_TIER_COUNT] = {
+    {60, HISTORY_MINUTE_POINTS, minutePoints, 0, 0, {}},
+    {3600, HISTORY_HOUR_POINTS, hourPoints, 0, 0, {}},
+    {86400, HISTORY_DAY_POINTS, dayPoints, 0, 0, {}},
+};
+static const char *tierNames[HISTORY_TIER_COUNT] = {"minute", "hour", "day"};
+static const char *tierFiles[HISTORY_TIER_COUNT] = {"/hist_min.bin", "/hist_hour.bin", "/hist_day.bin"};
+
+static bool filesystemReady = false;
+static bool tierDirty[HISTORY_TIER_COUNT];
+static unsigned long lastMinuteCheckpoint = 0;
+static unsigned long lastRoll = 0;
+static HistoryStats historyStats;
+
+// Local wall-clock seconds; 0 while the clock is unknown
+static uint32_t localNow()
+{
+  uint32_t epoch = currentEpoch();
+  return epoch == 0 ? 0 : epoch + getUtcOffset(epoch);
+}
+
+static bool loadTier(uint8_t id)
+{
+  HistoryTier &tier = tiers[id];
+  File file = LittleFS.open(tierFiles[id], FILE_READ);
+  if (!file)
+    return false;
+
+  HistoryFileHeader header;
+  size_t pointBytes = sizeof(HistoryPoint) * tier.size;
+  bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == HISTORY_FILE_MAGIC && header.version == HISTORY_FILE_VERSION &&
+            header.size == tier.size && header.periodS == tier.periodS &&
+            header.headIndex < tier.size &&
+            file.read((uint8_t *)tier.points, pointBytes) == pointBytes;
+  file.close();
+
+  if (!ok)
+  {
+    historyClear(tier);
+    LOGW(TAG, "%s history file unreadable, starting empty", tierNames[id]);
+    return false;
+  }
+  tier.headBucket = header.headBucket;
+  tier.headIndex = header.headIndex;
+  tier.open = header.open;
+  return true;
+}
+
+// Written beside the old file and renamed over it, so a reset mid-write
+// keeps the previous checkpoint
+static void saveTier(uint8_t id)
+{
+  STALL_REGION(REGION_FLASH);
+  unsigned long start = millis();
+  HistoryTier &tier = tiers[id];
+
+  HistoryFileHeader header = {HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION, tier.size, tier.periodS,
+                              tier.headBucket, tier.headIndex, 0, tier.open};
+  size_t pointBytes = sizeof(HistoryPoint) * tier.size;
+
+  File file = LittleFS.open("/hist.tmp", FILE_WRITE);
+  bool ok = file && file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            file.write((const uint8_t *)tier.points, pointBytes) == pointBytes;
+  if (file)
+    file.close();
+  ok = ok && LittleFS.rename("/hist.tmp", tierFiles[id]);
+
+  tierDirty[id] = false;
+  historyStats.lastCheckpointMs = millis() - start;
+  if (ok)
+  {
+    historyStats.checkpoints++;
+    LOGD(TAG, "%s history saved in %lu ms", tierNames[id], (unsigned long)historyStats.lastCheckpointMs);
+  }
+  else
+  {
+    historyStats.checkpointFailures++;
+    LOGE(TAG, "✗ %s history checkpoint failed", tierNames[id]);
+  }
+}
+
+void setupHistory()
+{
+  filesystemReady = LittleFS.begin(true); // Already mounted by the trace recorder
+  if (!filesystemReady)
+  {
+    Serial.println("✗ LittleFS unavailable - history kept in RAM only");
+    return;
+  }
+
+  uint8_t restored = 0;
+  for (uint8_t id = 0; id < HISTORY_TIER_COUNT; id++)
+  {
+    if (loadTier(id))
+      restored++;
+  }
+  historyStats.restored = restored > 0;
+  lastMinuteCheckpoint = millis();
+
+  // Today's dispensed total survives the reboot through the open day bucket
+  uint32_t local = localNow();
+  const HistoryAccumulator &today = tiers[HISTORY_TIER_DAY].open;
+  if (local != 0 && today.bucket == local / tiers[HISTORY_TIER_DAY].periodS)
+    sensors.dailyFoodDispensed = today.dispensedGrams;
+
+  Serial.printf("✓ History: %u of %u tiers restored\n", restored, HISTORY_TIER_COUNT);
+}
+
+void recordHistory(HistoryField field, float value)
+{
+  uint32_t local = localNow();
+  if (local == 0)
+    return;
+
+  for (uint8_t id = 0; id < HISTORY_TIER_COUNT; id++)
+  {
+    if (historyRoll(tiers[id], local))
+      tierDirty[id] = true;
+    historyAdd(tiers[id], local, field, value);
+  }
+  historyStats.samples++;
+}
+
+void handleHistory()
+{
+  unsigned long now = millis();
+  if (now - lastRoll < 1000)
+    return;
+  lastRoll = now;
+
+  // Close buckets on time even when no samples arrive
+  uint32_t local = localNow();
+  if (local != 0)
+  {
+    for (uint8_t id = 0; id < HISTORY_TIER_COUNT; id++)
+    {
+      if (historyRoll(tiers[id], local))
+        tierDirty[id] = true;
+    }
+  }
+
+  if (!filesystemReady)
+    return;
+
+  // At most one file write per pass; coarse tiers first, they change rarely
+  if (tierDirty[HISTORY_TIER_DAY])
+    saveTier(HISTORY_TIER_DAY);
+  else if (tierDirty[HISTORY_TIER_HOUR])
+    saveTier(HISTORY_TIER_HOUR);
+  else if (now - lastMinuteCheckpoint >= HISTORY_CHECKPOINT_MS)
+  {
+    lastMinuteCheckpoint = now;
+    saveTier(HISTORY_TIER_MINUTE);
+    // Their open buckets (today's totals) follow on the next passes
+    tierDirty[HISTORY_TIER_HOUR] = true;
+    tierDirty[HISTORY_TIER_DAY] = true;
+  }
+}
+
+const HistoryStats &getHistoryStats()
+{
+  return historyStats;
+}
+
+// Print into a fixed buffer, for responses small enough to send inline
+class TextBufferPrint : public Print
+{
+public:
+  TextBufferPrint(char *buffer, size_t size) : buffer(buffer), size(size), used(0) {}
+  size_t write(uint8_t c) override
+  {
+    if (used + 1 >= size)
+      return 0;
+    buffer[used++] = (char)c;
+    buffer[used] = '\0';
+    return 1;
+  }
+  using Print::write;
+
+private:
+  char *buffer;
+  size_t size;
+  size_t used;
+};
+
+static uint32_t bucketOf(const HistoryTier &tier, uint32_t unixUtc)
+{
+  return (unixUtc + getUtcOffset(unixUtc)) / tier.periodS;
+}
+
+static uint32_t utcOf(const HistoryTier &tier, uint32_t bucket)
+{
+  return unixFromLocal(bucket * tier.periodS);
+}
+
+// One pass over [first, last]; returns the number of non-empty points written
+static uint16_t writeHistory(Print &out, uint8_t id, uint32_t first, uint32_t last, long next)
+{
+  const HistoryTier &tier = tiers[id];
+  char text[HISTORY_TEXT_MAX];
+  out.write((const uint8_t *)text, historyFormatHeader(text, sizeof(text), tierNames[id], tier.periodS));
+
+  uint16_t written = 0;
+  for (uint32_t bucket = first; bucket <= last; bucket++)
+  {
+    HistoryPoint point;
+    if (!historyLookup(tier, bucket, point))
+      continue;
+    out.write((const uint8_t *)text,
+              historyFormatPoint(text, sizeof(text), utcOf(tier, bucket), point, written == 0));
+    written++;
+  }
+
+  out.write((const uint8_t *)text, historyFormatTrailer(text, sizeof(text), next));
+  return written;
+}
+
+// {"tier":"minute"|"hour"|"day","from":<unix>,"to":<unix>,"maxPoints":n}
+// Without a tier the finest one still holding 'from' is used. Up to
+// HISTORY_INLINE_POINTS buckets come back in the response; longer ranges are
+// streamed (method_stream.h). "next" is the 'from' of the following page, -1
+// at the end.
+int handleHistoryMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<128> request;
+  if (length > 0 && deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  uint32_t now = currentEpoch();
+  if (now == 0)
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Clock not set\"}";
+    return 503;
+  }
+
+  uint32_t to = request["to"] | now;
+  uint32_t from = request["from"] | (to > 86400 ? to - 86400 : 0);
+  if (from > to)
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"from is after to\"}";
+    return 400;
+  }
+
+  String tierName = request["tier"] | "";
+  uint8_t id;
+  if (tierName.length() == 0)
+  {
+    uint32_t age = now > from ? now - from : 0;
+    id = age < 86400UL ? HISTORY_TIER_MINUTE : age < 30UL * 86400UL ? HISTORY_TIER_HOUR : HISTORY_TIER_DAY;
+  }
+  else
+  {
+    for (id = 0; id < HISTORY_TIER_COUNT && tierName != tierNames[id]; id++)
+      ;
+    if (id == HISTORY_TIER_COUNT)
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Unknown tier\"}";
+      return 400;
+    }
+  }
+
+  const HistoryTier &tier = tiers[id];
+  uint32_t maxPoints = request["maxPoints"] | (uint32_t)HISTORY_PAGE_POINTS;
+  if (maxPoints == 0 || maxPoints > HISTORY_PAGE_MAX)
+    maxPoints = HISTORY_PAGE_MAX;
+
+  HistoryPage page = historyPageRange(tier, bucketOf(tier, from), bucketOf(tier, to), maxPoints);
+  uint32_t first = page.first;
+  uint32_t end = page.end;
+  long next = page.more ? (long)utcOf(tier, end + 1) : -1L;
+
+  if (end - first < HISTORY_INLINE_POINTS)
+  {
+    char *text = borrowJsonText();
+    TextBufferPrint out(text, JSON_TEXT_SIZE);
+    writeHistory(out, id, first, end, next);
+    responsePayload = text;
+    return 200;
+  }
+
+  MethodStream &stream = openMethodStream(METHOD_CT_JSON);
+  uint16_t points = writeHistory(stream, id, first, end, next);
+  if (!stream.end())
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Stream interrupted\"}";
+    return 503;
+  }
+
+  char summary[192];
+  snprintf(summary, sizeof(summary),
+           "{\"status\":\"success\",\"tier\":\"%s\",\"streamed\":true,\"points\":%u,"
+           "\"chunks\":%u,\"bytes\":%lu,\"next\":%ld}",
+           tierNames[id], points, stream.chunks(), (unsigned long)stream.bytes(), next);
+  responsePayload = summary;
+  return 200;
+}
@@ -0,0 +1,192 @@
+#include "history_store_core.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void historyClear(HistoryTier &tier)
+{
+  memset(tier.points, 0, sizeof(HistoryPoint) * tier.size);
+  tier.headBucket = 0;
+  tier.headIndex = 0;
+  tier.open = {};
+}
+
+HistoryPoint historyPointFrom(const HistoryAccumulator &open)
+{
+  HistoryPoint point;
+  if (open.weightCount > 0)
+  {
+    float dg = roundf(open.weightSum / open.weightCount * 10.0f);
+    point.weightDg = (int16_t)(dg < -32767.0f ? -32767.0f : dg > 32767.0f ? 32767.0f : dg);
+  }
+  else
+  {
+    point.weightDg = HISTORY_NO_WEIGHT;
+  }
+
+  if (open.hopperCount > 0)
+  {
+    float g = roundf(open.hopperSum / open.hopperCount);
+    point.hopperG = (uint16_t)(g < 0.0f ? 0.0f : g > 65534.0f ? 65534.0f : g);
+  }
+  else
+  {
+    point.hopperG = HISTORY_NO_HOPPER;
+  }
+
+  float intakeDg = roundf(open.intakeGrams * 10.0f);
+  point.intakeDg = (uint16_t)(intakeDg > 65535.0f ? 65535.0f : intakeDg);
+  float dispensed = roundf(open.dispensedGrams);
+  point.dispensedG = (uint16_t)(dispensed > 65535.0f ? 65535.0f : dispensed);
+  point.visits = (uint16_t)(open.visits > 65535 ? 65535 : open.visits);
+  point.updates = (uint16_t)(open.updates > 65535 ? 65535 : open.updates);
+  return point;
+}
+
+// Writes the open bucket into the ring, clearing any buckets skipped since
+// the last one (bounded by the ring size)
+static void commitOpen(HistoryTier &tier)
+{
+  const HistoryAccumulator &open = tier.open;
+  if (open.bucket == 0 || open.updates == 0)
+    return;
+
+  uint32_t gap = tier.headBucket == 0 ? tier.size : open.bucket - tier.headBucket;
+  if (gap >= tier.size)
+  {
+    memset(tier.points, 0, sizeof(HistoryPoint) * tier.size);
+    tier.headIndex = 0;
+  }
+  else
+  {
+    for (uint32_t k = 1; k < gap; k++)
+      tier.points[(tier.headIndex + k) % tier.size] = {};
+    tier.headIndex = (tier.headIndex + gap) % tier.size;
+  }
+  tier.headBucket = open.bucket;
+  tier.points[tier.headIndex] = historyPointFrom(open);
+}
+
+bool historyRoll(HistoryTier &tier, uint32_t localSeconds)
+{
+  uint32_t bucket = localSeconds / tier.periodS;
+  if (bucket == tier.open.bucket)
+    return false;
+
+  if (bucket < tier.open.bucket)
+  {
+    // Clock stepped back: small steps just drop samples, large ones
+    // (a wrong clock corrected) would leave the ring in the future
+    if (tier.open.bucket - bucket > 1)
+      historyClear(tier);
+    else
+      return false;
+  }
+
+  bool closed = tier.open.updates > 0;
+  commitOpen(tier);
+  tier.open = {};
+  tier.open.bucket = bucket;
+  return closed;
+}
+
+void historyAdd(HistoryTier &tier, uint32_t localSeconds, HistoryField field, float value)
+{
+  historyRoll(tier, localSeconds);
+  HistoryAccumulator &open = tier.open;
+  if (localSeconds / tier.periodS != open.bucket)
+    return;
+
+  switch (field)
+  {
+  case HISTORY_WEIGHT:
+    open.weightSum += value;
+    open.weightCount++;
+    break;
+  case HISTORY_HOPPER:
+    open.hopperSum += value;
+    open.hopperCount++;
+    break;
+  case HISTORY_INTAKE:
+    open.intakeGrams += value;
+    break;
+  case HISTORY_DISPENSED:
+    open.dispensedGrams += value;
+    break;
+  case HISTORY_VISIT:
+    open.visits++;
+    break;
+  }
+  open.updates++;
+}
+
+bool historyLookup(const HistoryTier &tier, uint32_t bucket, HistoryPoint &point)
+{
+  if (bucket == tier.open.bucket && tier.open.updates > 0)
+  {
+    point = historyPointFrom(tier.open);
+    return true;
+  }
+  if (tier.headBucket == 0 || bucket > tier.headBucket)
+    return false;
+
+  // Past the window, even if nothing has overwritten it yet
+  uint32_t back = tier.headBucket - bucket;
+  if (back >= tier.size || (tier.open.bucket > bucket && tier.open.bucket - bucket >= tier.size))
+    return false;
+  point = tier.points[(tier.headIndex + tier.size - back) % tier.size];
+  return point.updates > 0;
+}
+
+HistoryPage historyPageRange(const HistoryTier &tier, uint32_t first, uint32_t last,
+                             uint32_t maxPoints)
+{
+  // Older than the ring is empty anyway; start at its oldest bucket
+  if (tier.open.bucket >= tier.size && first <= tier.open.bucket - tier.size)
+    first = tier.open.bucket - tier.size + 1;
+  if (first > last)
+    first = last;
+
+  HistoryPage page;
+  page.first = first;
+  page.end = last - first >= maxPoints ? first + maxPoints - 1 : last;
+  page.more = page.end < last;
+  return page;
+}
+
+static size_t clip(int n, size_t size)
+{
+  if (n < 0 || size == 0)
+    return 0;
+  return (size_t)n < size ? (size_t)n : size - 1;
+}
+
+size_t historyFormatHeader(char *out, size_t size, const char *tierName, uint32_t periodS)
+{
+  return clip(snprintf(out, size,
+                       "{\"status\":\"success\",\"tier\":\"%s\",\"period\":%lu,"
+                       "\"fields\":[\"t\",\"weight\",\"hopper\",\"intake\",\"dispensed\",\"visits\"],\"points\":[",
+                       tierName, (unsigned long)periodS),
+              size);
+}
+
+size_t historyFormatPoint(char *out, size_t size, uint32_t unixUtc, const HistoryPoint &point,
+                          bool first)
+{
+  char weight[12] = "null";
+  char hopper[8] = "null";
+  if (point.weightDg != HISTORY_NO_WEIGHT)
+    snprintf(weight, sizeof(weight), "%.1f", point.weightDg / 10.0f);
+  if (point.hopperG != HISTORY_NO_HOPPER)
+    snprintf(hopper, sizeof(hopper), "%u", point.hopperG);
+
+  return clip(snprintf(out, size, "%s[%lu,%s,%s,%.1f,%u,%u]", first ? "" : ",",
+                       (unsigned long)unixUtc, weight, hopper, point.intakeDg / 10.0f,
+                       point.dispensedG, point.visits),
+              size);
+}
+
+size_t historyFormatTrailer(char *out, size_t size, long next)
+{
+  return clip(snprintf(out, size, "],\"next\":%ld}", next), size);
+}
@@ -0,0 +1,342 @@
+#include "hopper_model.h"
+#include "json_pool.h"
+#include "network_manager.h"
+#include "gateway.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <ArduinoJson.h>
+
+static const char *TAG = "hopper";
+
+static Preferences hopperPrefs;
+static HopperModel hopperModel;
+static ConsumptionFit consumptionFit;
+static HopperCheck hopperCheck;
+static HopperStats hopperStats;
+
+static bool hasLevel = false;
+static float filteredDistance = 0.0;
+static unsigned long lastLevelMillis = 0;
+static unsigned long lastSampleMillis = 0;
+static float lastSampleGrams = 0.0;
+
+// Dispense being measured: bowl weight before, settle deadline after
+static float dispenseStartWeight = 0.0;
+static bool dispensePending = false;
+static unsigned long dispenseEndMillis = 0;
+
+float hopperGrams(const HopperModel &model, float distanceCm)
+{
+  if (distanceCm >= model.emptyDistance)
+    return 0.0;
+  if (distanceCm < model.fullDistance)
+    distanceCm = model.fullDistance; // Closer than the sensor can resolve
+  return model.gramsPerCm * (model.emptyDistance - distanceCm);
+}
+
+float hopperCapacity(const HopperModel &model)
+{
+  return model.gramsPerCm * (model.emptyDistance - model.fullDistance);
+}
+
+void consumptionFitReset(ConsumptionFit &fit)
+{
+  fit = {};
+}
+
+void consumptionFitAdd(ConsumptionFit &fit, float dtDays, float grams, float halfLifeDays)
+{
+  if (fit.samples > 0)
+  {
+    // Move the origin to the new sample: t -> t - dt
+    fit.sumTT += dtDays * dtDays * fit.sumW - 2.0f * dtDays * fit.sumT;
+    fit.sumTY -= dtDays * fit.sumY;
+    fit.sumT -= dtDays * fit.sumW;
+
+    float decay = powf(0.5f, dtDays / halfLifeDays);
+    fit.sumW *= decay;
+    fit.sumT *= decay;
+    fit.sumY *= decay;
+    fit.sumTT *= decay;
+    fit.sumTY *= decay;
+    fit.spanDays += dtDays;
+  }
+
+  // New sample at t = 0 adds nothing to the t sums
+  fit.sumW += 1.0f;
+  fit.sumY += grams;
+  if (fit.samples < 0xFFFF)
+    fit.samples++;
+}
+
+bool consumptionFitLine(const ConsumptionFit &fit, float &gramsPerDay, float &gramsNow)
+{
+  if (fit.samples < 3)
+    return false;
+
+  float denominator = fit.sumW * fit.sumTT - fit.sumT * fit.sumT;
+  if (denominator <= 1e-9f)
+    return false;
+
+  float slope = (fit.sumW * fit.sumTY - fit.sumT * fit.sumY) / denominator;
+  gramsNow = (fit.sumY - slope * fit.sumT) / fit.sumW;
+  gramsPerDay = -slope;
+  return true;
+}
+
+float forecastDaysUntilEmpty(const ConsumptionFit &fit, float minSpanDays, float minRate)
+{
+  float gramsPerDay, gramsNow;
+  if (fit.spanDays < minSpanDays || !consumptionFitLine(fit, gramsPerDay, gramsNow))
+    return -1.0;
+  if (gramsPerDay < minRate)
+    return -1.0; // Flat or rising: nothing to extrapolate
+  return gramsNow > 0.0f ? gramsNow / gramsPerDay : 0.0f;
+}
+
+bool hopperCrossCheck(HopperModel &model, HopperCheck &check, float distanceCm,
+                      float dispensedGrams, float &errorPercent)
+{
+  check.measuredGrams += dispensedGrams;
+
+  float drop = distanceCm - check.anchorDistance;
+  if (drop < HOPPER_CHECK_MIN_CM || check.measuredGrams <= 0.0f)
+    return false; // Too little movement to beat ultrasonic noise
+
+  float predicted = model.gramsPerCm * drop;
+  errorPercent = (predicted - check.measuredGrams) / check.measuredGrams * 100.0f;
+
+  float observed = check.measuredGrams / drop;
+  model.gramsPerCm += HOPPER_CHECK_ALPHA * (observed - model.gramsPerCm);
+
+  check.anchorDistance = distanceCm;
+  check.measuredGrams = 0.0;
+  return true;
+}
+
+StockAlert stockAlertFor(float grams, float daysUntilEmpty)
+{
+  if (grams < FOOD_PORTION_GRAMS)
+    return STOCK_CRITICAL;
+  if (daysUntilEmpty < 0.0f)
+    return STOCK_OK; // No forecast yet
+  if (daysUntilEmpty <= HOPPER_CRITICAL_DAYS)
+    return STOCK_CRITICAL;
+  if (daysUntilEmpty <= HOPPER_LOW_DAYS)
+    return STOCK_LOW;
+  return STOCK_OK;
+}
+
+const char *getStockAlertName(StockAlert alert)
+{
+  static const char *names[] = {"OK", "LOW", "CRITICAL"};
+  return alert < ARRAY_SIZE(names) ? names[alert] : "UNKNOWN";
+}
+
+static void saveGramsPerCm()
+{
+  hopperPrefs.begin(HOPPER_NVS_NAMESPACE, false);
+  hopperPrefs.putFloat("gpc", hopperModel.gramsPerCm);
+  hopperPrefs.end();
+}
+
+static void restartForecast()
+{
+  consumptionFitReset(consumptionFit);
+  hopperCheck.anchorDistance = filteredDistance;
+  hopperCheck.measuredGrams = 0.0;
+  hopperStats.gramsPerDay = 0.0;
+  hopperStats.daysUntilEmpty = -1.0;
+}
+
+static void publishStockAlert()
+{
+  char payload[192];
+  int len = snprintf(payload, sizeof(payload),
+                     "{\"messageType\":\"hopper\",\"deviceId\":\"%s\",\"alert\":\"%s\","
+                     "\"grams\":%.0f,\"daysUntilEmpty\":%.1f,\"gramsPerDay\":%.1f}",
+                     getFeederId(), getStockAlertName(hopperStats.alert), hopperStats.grams,
+                     hopperStats.daysUntilEmpty, hopperStats.gramsPerDay);
+
+  if (!publishTelemetryEvent(payload, len))
+    LOGE(TAG, "✗ Failed to send hopper alert");
+}
+
+void setupHopper()
+{
+  hopperModel.emptyDistance = FOOD_EMPTY_DISTANCE;
+  hopperModel.fullDistance = FOOD_FULL_DISTANCE;
+
+  hopperPrefs.begin(HOPPER_NVS_NAMESPACE, true);
+  hopperModel.gramsPerCm = hopperPrefs.getFloat("gpc", HOPPER_GRAMS_PER_CM);
+  hopperPrefs.end();
+
+  consumptionFitReset(consumptionFit);
+  hopperStats.gramsPerCm = hopperModel.gramsPerCm;
+  hopperStats.capacity = hopperCapacity(hopperModel);
+  Serial.printf("✓ Hopper model: %.1f g/cm, %.0f g capacity\n",
+                hopperModel.gramsPerCm, hopperStats.capacity);
+}
+
+// Grams that reached the bowl, once it has settled after a dispense
+static void measureDispense(unsigned long now)
+{
+  if (!dispensePending || now - dispenseEndMillis < HOPPER_SETTLE_MS)
+    return;
+  dispensePending = false;
+
+  // A pet eating from the bowl (or no load cell) hides the delivery;
+  // count the nominal portion so the hopper still loses it
+  float grams = sensors.weight - dispenseStartWeight;
+  if (grams <= 0.0f || grams > 3.0f * FOOD_PORTION_GRAMS)
+    grams = FOOD_PORTION_GRAMS;
+  hopperStats.lastDispenseGrams = grams;
+
+  float errorPercent;
+  if (hopperCrossCheck(hopperModel, hopperCheck, filteredDistance, grams, errorPercent))
+  {
+    hopperStats.checks++;
+    hopperStats.lastCheckError = errorPercent;
+    hopperStats.gramsPerCm = hopperModel.gramsPerCm;
+    hopperStats.capacity = hopperCapacity(hopperModel);
+    saveGramsPerCm();
+    LOGI(TAG, "Hopper model off by %+.0f%%, now %.1f g/cm", errorPercent, hopperModel.gramsPerCm);
+  }
+}
+
+static void sampleForecast(unsigned long now)
+{
+  if (hopperStats.grams > lastSampleGrams + HOPPER_REFILL_GRAMS && consumptionFit.samples > 0)
+  {
+    hopperStats.refills++;
+    restartForecast();
+    LOGI(TAG, "Hopper refilled to %.0f g", hopperStats.grams);
+  }
+
+  float dtDays = (now - lastSampleMillis) / (float)(SECONDS_PER_DAY * 1000UL);
+  consumptionFitAdd(consumptionFit, dtDays, hopperStats.grams, HOPPER_HALF_LIFE_DAYS);
+  lastSampleMillis = now;
+  lastSampleGrams = hopperStats.grams;
+
+  float gramsPerDay, gramsNow;
+  if (consumptionFitLine(consumptionFit, gramsPerDay, gramsNow))
+    hopperStats.gramsPerDay = gramsPerDay > 0.0f ? gramsPerDay : 0.0f;
+  hopperStats.daysUntilEmpty =
+      forecastDaysUntilEmpty(consumptionFit, HOPPER_MIN_SPAN_DAYS, HOPPER_MIN_RATE);
+
+  StockAlert alert = stockAlertFor(hopperStats.grams, hopperStats.daysUntilEmpty);
+  if (alert != hopperStats.alert)
+  {
+    hopperStats.alert = alert;
+    LOGW(TAG, "Hopper stock %s: %.0f g, %.1f days left", getStockAlertName(alert),
+         hopperStats.grams, hopperStats.daysUntilEmpty);
+    publishStockAlert();
+  }
+}
+
+void updateHopperLevel(float distanceCm)
+{
+  // Lid open during refill mode; readings are meaningless
+  if (feederSystem.refillMode)
+    return;
+
+  unsigned long now = millis();
+  if (!hasLevel)
+  {
+    hasLevel = true;
+    filteredDistance = distanceCm;
+    hopperCheck.anchorDistance = distanceCm;
+    lastSampleMillis = now;
+    lastSampleGrams = hopperGrams(hopperModel, distanceCm);
+  }
+  else
+  {
+    // The sampling policy changes the read interval, so weight by elapsed time
+    float alpha = 1.0f - expf(-(float)(now - lastLevelMillis) / HOPPER_DISTANCE_TAU_MS);
+    filteredDistance += alpha * (distanceCm - filteredDistance);
+  }
+  lastLevelMillis = now;
+  hopperStats.grams = hopperGrams(hopperModel, filteredDistance);
+
+  measureDispense(now);
+
+  if (now - lastSampleMillis >= HOPPER_SAMPLE_INTERVAL)
+    sampleForecast(now);
+}
+
+void hopperDispenseStarted()
+{
+  dispenseStartWeight = sensors.weight;
+  dispensePending = false;
+}
+
+void hopperDispenseFinished()
+{
+  dispenseEndMillis = millis();
+  dispensePending = true;
+}
+
+const HopperStats &getHopperStats()
+{
+  return hopperStats;
+}
+
+// {"action":"status"}, {"action":"set","grams":<weighed contents>} or {"action":"reset"}
+int handleHopperMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<128> request;
+  if (deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  String action = request["action"] | "status";
+
+  if (action == "set")
+  {
+    float grams = request["grams"] | 0.0f;
+    float height = hopperModel.emptyDistance - filteredDistance;
+    if (grams <= 0.0f || !hasLevel || height < HOPPER_CHECK_MIN_CM)
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Need grams > 0 and food in the hopper\"}";
+      return 400;
+    }
+    hopperModel.gramsPerCm = grams / height;
+    saveGramsPerCm();
+    restartForecast(); // Old samples are in the old scale
+    LOGI(TAG, "Hopper calibrated: %.0f g over %.1f cm", grams, height);
+  }
+  else if (action == "reset")
+  {
+    hopperModel.gramsPerCm = HOPPER_GRAMS_PER_CM;
+    hopperPrefs.begin(HOPPER_NVS_NAMESPACE, false);
+    hopperPrefs.remove("gpc");
+    hopperPrefs.end();
+    restartForecast();
+  }
+  else if (action != "status")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown hopper action\"}";
+    return 400;
+  }
+
+  hopperStats.gramsPerCm = hopperModel.gramsPerCm;
+  hopperStats.capacity = hopperCapacity(hopperModel);
+  hopperStats.grams = hopperGrams(hopperModel, filteredDistance);
+
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  doc["grams"] = roundf(hopperStats.grams);
+  doc["capacity"] = roundf(hopperStats.capacity);
+  doc["gramsPerCm"] = hopperStats.gramsPerCm;
+  doc["gramsPerDay"] = hopperStats.gramsPerDay;
+  doc["daysUntilEmpty"] = hopperStats.daysUntilEmpty;
+  doc["alert"] = getStockAlertName(hopperStats.alert);
+  doc["lastDispenseGrams"] = hopperStats.lastDispenseGrams;
+  doc["lastCheckError"] = hopperStats.lastCheckError;
+  doc["checks"] = hopperStats.checks;
+  doc["refills"] = hopperStats.refills;
+  serializeJson(doc, responsePayload);
+  return 200;
+}
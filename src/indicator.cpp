@@ -0,0 +1,222 @@
+#include "indicator.h"
+#include <ESP32Servo.h>
+#include <esp_timer.h>
+
+struct RgbValue
+{
+  uint8_t red;
+  uint8_t green;
+  uint8_t blue;
+};
+
+// Indexed by RgbColor
+static const RgbValue colorTable[RGB_COLOR_COUNT] = {
+    {0, 0, 0},       // RGB_OFF
+    {255, 0, 0},     // RGB_RED
+    {0, 255, 0},     // RGB_GREEN
+    {0, 0, 255},     // RGB_BLUE
+    {255, 160, 0},   // RGB_YELLOW
+    {200, 0, 255},   // RGB_PURPLE
+    {255, 255, 255}, // RGB_WHITE
+};
+
+static const IndicatorStep buttonBeepSteps[] = {
+    {RGB_UNCHANGED, 0, true, BUZZER_SHORT_BEEP},
+};
+static const IndicatorStep dispenseMoveSteps[] = {
+    {RGB_UNCHANGED, 0, true, 200},
+};
+static const IndicatorStep remoteMoveSteps[] = {
+    {RGB_BLUE, RGB_DEFAULT_BRIGHTNESS, true, 200},
+};
+static const IndicatorStep feedCompleteSteps[] = {
+    {RGB_UNCHANGED, 0, true, 150},
+    {RGB_UNCHANGED, 0, false, 150},
+};
+static const IndicatorStep remoteCompleteSteps[] = {
+    {RGB_GREEN, RGB_DEFAULT_BRIGHTNESS, true, 150},
+    {RGB_OFF, 0, false, 150},
+};
+static const IndicatorStep autoCompleteSteps[] = {
+    {RGB_PURPLE, RGB_DEFAULT_BRIGHTNESS, true, BUZZER_MEDIUM_BEEP},
+    {RGB_OFF, 0, false, BUZZER_MEDIUM_PAUSE},
+};
+
+const IndicatorPattern PATTERN_BUTTON_BEEP = {buttonBeepSteps, ARRAY_SIZE(buttonBeepSteps), 1};
+const IndicatorPattern PATTERN_DISPENSE_MOVE = {dispenseMoveSteps, ARRAY_SIZE(dispenseMoveSteps), 1};
+const IndicatorPattern PATTERN_REMOTE_MOVE = {remoteMoveSteps, ARRAY_SIZE(remoteMoveSteps), 1};
+const IndicatorPattern PATTERN_FEED_COMPLETE = {feedCompleteSteps, ARRAY_SIZE(feedCompleteSteps), 3};
+const IndicatorPattern PATTERN_REMOTE_COMPLETE = {remoteCompleteSteps, ARRAY_SIZE(remoteCompleteSteps), 3};
+const IndicatorPattern PATTERN_AUTO_COMPLETE = {autoCompleteSteps, ARRAY_SIZE(autoCompleteSteps), BUZZER_PATTERN_WARNING};
+
+static ESP32PWM redPwm;
+static ESP32PWM greenPwm;
+static ESP32PWM bluePwm;
+static ESP32PWM buzzerPwm;
+static esp_timer_handle_t indicatorTimer = nullptr;
+
+// Requests from the loop task, picked up by the timer tick
+static portMUX_TYPE indicatorMux = portMUX_INITIALIZER_UNLOCKED;
+static IndicatorPattern pendingPattern;
+static IndicatorStep pendingTrainSteps[2];
+static bool patternPending = false;
+static RgbColor pendingRestColor = RGB_OFF;
+static uint8_t pendingRestBrightness = RGB_DEFAULT_BRIGHTNESS;
+static bool restPending = false;
+
+// Owned by the timer tick
+static IndicatorPattern activePattern;
+static IndicatorStep activeTrainSteps[2];
+static uint8_t stepIndex = 0;
+static uint8_t repeatsLeft = 0;
+static unsigned long stepStart = 0;
+static volatile bool patternActive = false;
+static RgbColor restColor = RGB_OFF;
+static uint8_t restBrightness = RGB_DEFAULT_BRIGHTNESS;
+
+static void writeColor(RgbColor color, uint8_t brightness)
+{
+  if (color == RGB_UNCHANGED || color >= RGB_COLOR_COUNT)
+    return;
+
+  const RgbValue &value = colorTable[color];
+  redPwm.write(value.red * brightness / 255);
+  greenPwm.write(value.green * brightness / 255);
+  bluePwm.write(value.blue * brightness / 255);
+}
+
+static void writeBuzzer(bool on)
+{
+  buzzerPwm.write(on ? BUZZER_ON_DUTY : 0);
+}
+
+static void applyStep(const IndicatorStep &step)
+{
+  writeColor(step.color, step.brightness);
+  writeBuzzer(step.buzzer);
+}
+
+static void finishPattern()
+{
+  patternActive = false;
+  writeBuzzer(false);
+  writeColor(restColor, restBrightness);
+}
+
+static void indicatorTick(void *)
+{
+  bool newPattern = false;
+  bool newRest = false;
+
+  portENTER_CRITICAL(&indicatorMux);
+  if (patternPending)
+  {
+    activePattern = pendingPattern;
+    memcpy(activeTrainSteps, pendingTrainSteps, sizeof(activeTrainSteps));
+    if (pendingPattern.steps == pendingTrainSteps)
+      activePattern.steps = activeTrainSteps; // Generated beep train
+    patternPending = false;
+    newPattern = true;
+  }
+  if (restPending)
+  {
+    restColor = pendingRestColor;
+    restBrightness = pendingRestBrightness;
+    restPending = false;
+    newRest = true;
+  }
+  portEXIT_CRITICAL(&indicatorMux);
+
+  unsigned long now = millis();
+
+  if (newPattern)
+  {
+    stepIndex = 0;
+    repeatsLeft = activePattern.repeat;
+    stepStart = now;
+    patternActive = activePattern.stepCount > 0 && repeatsLeft > 0;
+    if (patternActive)
+      applyStep(activePattern.steps[0]);
+    else
+      finishPattern();
+    return;
+  }
+
+  if (!patternActive)
+  {
+    if (newRest)
+      writeColor(restColor, restBrightness);
+    return;
+  }
+
+  if (now - stepStart < activePattern.steps[stepIndex].durationMs)
+    return;
+
+  if (++stepIndex >= activePattern.stepCount)
+  {
+    if (--repeatsLeft == 0)
+    {
+      finishPattern();
+      return;
+    }
+    stepIndex = 0;
+  }
+  stepStart = now;
+  applyStep(activePattern.steps[stepIndex]);
+}
+
+void setupIndicators()
+{
+  redPwm.attachPin(RED_PIN, RGB_PWM_FREQUENCY, RGB_PWM_RESOLUTION);
+  greenPwm.attachPin(GREEN_PIN, RGB_PWM_FREQUENCY, RGB_PWM_RESOLUTION);
+  bluePwm.attachPin(BLUE_PIN, RGB_PWM_FREQUENCY, RGB_PWM_RESOLUTION);
+  buzzerPwm.attachPin(BUZZER_PIN, BUZZER_PWM_FREQUENCY, RGB_PWM_RESOLUTION);
+  writeColor(RGB_OFF, 0);
+  writeBuzzer(false);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = indicatorTick;
+  timerArgs.name = "indicator";
+  if (esp_timer_create(&timerArgs, &indicatorTimer) == ESP_OK)
+  {
+    esp_timer_start_periodic(indicatorTimer, INDICATOR_TICK_US);
+    Serial.println("✓ Indicator pattern engine started");
+  }
+  else
+  {
+    Serial.println("✗ Indicator timer unavailable");
+  }
+}
+
+void startIndicatorPattern(const IndicatorPattern &pattern)
+{
+  portENTER_CRITICAL(&indicatorMux);
+  pendingPattern = pattern;
+  patternPending = true;
+  portEXIT_CRITICAL(&indicatorMux);
+}
+
+void startBeepPattern(int beeps, int durationMs, int pauseMs, RgbColor color)
+{
+  portENTER_CRITICAL(&indicatorMux);
+  pendingTrainSteps[0] = {color, RGB_DEFAULT_BRIGHTNESS, true, (uint16_t)durationMs};
+  pendingTrainSteps[1] = {color == RGB_UNCHANGED ? RGB_UNCHANGED : RGB_OFF, 0, false,
+                          (uint16_t)pauseMs};
+  pendingPattern = {pendingTrainSteps, 2, (uint8_t)beeps};
+  patternPending = true;
+  portEXIT_CRITICAL(&indicatorMux);
+}
+
+void setRestingColor(RgbColor color, uint8_t brightness)
+{
+  portENTER_CRITICAL(&indicatorMux);
+  pendingRestColor = color;
+  pendingRestBrightness = brightness;
+  restPending = true;
+  portEXIT_CRITICAL(&indicatorMux);
+}
+
+bool isIndicatorPatternActive()
+{
+  return patternActive || patternPending;
+}
@@ -0,0 +1,15 @@
+#include "json_pool.h"
+
+static StaticJsonDocument<JSON_POOL_SIZE> jsonDocument;
+static char jsonText[JSON_TEXT_SIZE];
+
+JsonDocument &borrowJsonDocument()
+{
+  jsonDocument.clear();
+  return jsonDocument;
+}
+
+char *borrowJsonText()
+{
+  return jsonText;
+}
@@ -3,6 +3,39 @@
 #include <Wire.h>
 #include "config.h"
 #include "globals.h"
+#include "meal_tracker.h"
+#include "calibration.h"
+#include "sensor_manager.h"
+#include "stall_watchdog.h"
+#include "trace_recorder.h"
+#include "indicator.h"
+#include "feeding_control.h"
+#include "dispense_capture.h"
+
+static SemaphoreHandle_t scaleMutex = nullptr;
+
+ScaleLock::ScaleLock()
+{
+  if (scaleMutex != nullptr)
+    xSemaphoreTake(scaleMutex, portMAX_DELAY);
+}
+
+ScaleLock::~ScaleLock()
+{
+  if (scaleMutex != nullptr)
+    xSemaphoreGive(scaleMutex);
+}
+
+bool tryLockScale()
+{
+  return scaleMutex == nullptr || xSemaphoreTake(scaleMutex, 0) == pdTRUE;
+}
+
+void unlockScale()
+{
+  if (scaleMutex != nullptr)
+    xSemaphoreGive(scaleMutex);
+}
 
 // Load Cell Functions
 void setupLoadCell()
@@ -14,172 +47,76 @@ void setupLoadCell()
   rtc_clk_cpu_freq_to_config(RTC_CPU_FREQ_80M, &config);
   rtc_clk_cpu_freq_set_config_fast(&config);
 
-  // Initialize the scale
-  scale.begin(HX711_DOUT_PIN, HX711_SCK_PIN);
-  scale.set_scale(CALIBRATION_FACTOR);
-  scale.tare(); // Reset scale to zero
+  if (scaleMutex == nullptr)
+    scaleMutex = xSemaphoreCreateMutex();
 
-  // Initialize buzzer pin
-  pinMode(BUZZER_PIN, OUTPUT);
-  digitalWrite(BUZZER_PIN, LOW);
+  // Initialize the scale with the stored calibration (no tare at boot)
+  ScaleLock lock;
+  scale.begin(HX711_DOUT_PIN, HX711_SCK_PIN);
+  setupCalibration();
 
   // Log that load cell is initialized
   Serial.println("Load cell initialized");
+}
 
-  delay(500); // Give time for the scale to stabilize
+bool isScaleReady()
+{
+  long raw;
+  return isScaleSamplerRunning() ? getLatestScaleRaw(1, raw) : scale.is_ready();
 }
 
-float getWeight()
+float getWeight(uint8_t readings)
 {
   // Get weight in grams (more appropriate for 1kg load cell)
-  if (scale.is_ready())
+  long raw;
+  if (isScaleSamplerRunning())
   {
-    return scale.get_units(SCALE_READINGS);
+    // The sampler already holds the latest conversions
+    if (!getLatestScaleRaw(readings, raw))
+      return 0.0;
+  }
+  else if (scale.is_ready())
+  {
+    STALL_REGION(REGION_SCALE);
+    ScaleLock lock;
+    raw = (long)scale.read_average(readings);
   }
   else
   {
     return 0.0;
   }
+
+  // Same as get_units(), but the raw counts are kept for the trace recorder
+  traceScaleRaw(raw);
+  return (raw - scale.get_offset()) / scale.get_scale();
 }
 
-void updateBowlWeight()
+void updateBowlWeight(uint8_t readings)
 {
-  if (scale.is_ready())
+  if (isScaleReady())
   {
-    // Get weight and update global sensor data
-    float weight = getWeight();
-    sensors.weight = weight;
-
-    // Update bowl status based on weight
-    if (weight < EMPTY_BOWL_THRESHOLD)
-    {
-      strcpy(sensors.bowlStatus, BOWL_STATUS_EMPTY);
-    }
-    else if (weight < FULL_BOWL_THRESHOLD)
-    {
-      strcpy(sensors.bowlStatus, BOWL_STATUS_PARTIAL);
-    }
-    else
-    {
-      strcpy(sensors.bowlStatus, BOWL_STATUS_FULL);
-    }
+    // Bowl status and meal detection, then into the global sensor data
+    MealEvent meal;
+    bool mealEnded = sensorWeightStep(sensorCore, millis(), getWeight(readings),
+                                      feederSystem.dispensing, meal);
+    sensors.weight = sensorCore.weight;
+    setBowlStatus(sensorCore.bowlStatus);
+
+    updateMealTracking(mealEnded ? &meal : nullptr);
+    trackCalibrationDrift(sensorCore.weight);
   }
   else
   {
+    sensorWeightLost(sensorCore);
     sensors.weight = 0;
-    strcpy(sensors.bowlStatus, "ERROR");
+    setBowlStatus(BOWL_STATUS_ERROR);
   }
 }
 
 void playBuzzer(int beepCount, int beepDuration, int pauseDuration)
 {
-  for (int i = 0; i < beepCount; i++)
-  {
-    digitalWrite(BUZZER_PIN, HIGH);
-    delay(beepDuration);
-    digitalWrite(BUZZER_PIN, LOW);
-    if (i < beepCount - 1) // Don't pause after the last beep
-    {
-      delay(pauseDuration);
-    }
-  }
-}
-
-void handleButtonPress()
-{
-  unsigned long currentTime = millis();
-
-  // Read button states (INPUT_PULLUP means LOW when pressed)
-  bool button1Pressed = digitalRead(BUTTON1_PIN) == LOW;
-  bool button2Pressed = digitalRead(BUTTON2_PIN) == LOW;
-
-  // Handle Button 1 (Dispense) with debouncing
-  if (button1Pressed && !buttons.lastButton1 &&
-      (currentTime - timing.lastButton1Press) > DEBOUNCE_DELAY)
-  {
-    timing.lastButton1Press = currentTime;
-    playBuzzer(1, BUZZER_SHORT_BEEP, 0); // Single beep for button press
-
-    if (!feederSystem.refillMode && !buttons.manualFeedInProgress)
-    {
-      buttons.manualFeedInProgress = true;
-      dispenseFood();
-      buttons.manualFeedInProgress = false;
-    }
-    else if (feederSystem.refillMode)
-    {
-      displayMessage("System Paused", "Press Button2");
-    }
-  }
-
-  // Handle Button 2 (Refill/Pause) with debouncing
-  if (button2Pressed && !buttons.lastButton2 &&
-      (currentTime - timing.lastButton2Press) > DEBOUNCE_DELAY)
-  {
-    timing.lastButton2Press = currentTime;
-    playBuzzer(2, BUZZER_SHORT_BEEP, BUZZER_SHORT_PAUSE); // Double beep for refill
-
-    // Toggle refill mode
-    feederSystem.refillMode = !feederSystem.refillMode;
-
-    if (feederSystem.refillMode)
-    {
-      strcpy(sensors.feedingStatus, "REFILL MODE");
-      displayMessage("REFILL MODE", "System Paused");
-      feederSystem.autoFeedingEnabled = false; // Disable auto feeding
-    }
-    else
-    {
-      strcpy(sensors.feedingStatus, "Ready");
-      displayMessage("System Resumed", "Ready");
-      feederSystem.autoFeedingEnabled = true; // Re-enable auto feeding
-      delay(2000);                            // Show message for 2 seconds
-    }
-  }
-
-  // Update button states for next iteration
-  buttons.lastButton1 = button1Pressed;
-  buttons.lastButton2 = button2Pressed;
-}
-
-void dispenseFood()
-{
-  if (feederSystem.refillMode)
-  {
-    return; // Don't dispense if in refill mode
-  }
-
-  feederSystem.dispensing = true;
-  strcpy(sensors.feedingStatus, "Dispensing...");
-  displayMessage("Dispensing...", "Please wait");
-
-  // Move servo from 90 to 45 degrees and back, 3 times
-  for (int i = 0; i < 3; i++)
-  {
-    // Move to 45 degrees (left)
-    myServo.write(45);
-    playBuzzer(1, BUZZER_SHORT_BEEP, 0); // Beep during movement
-    delay(500);
-
-    // Return to 90 degrees (center)
-    myServo.write(90);
-    delay(500);
-  }
-
-  // Final beep sequence to indicate completion
-  playBuzzer(3, BUZZER_SHORT_BEEP, BUZZER_SHORT_PAUSE);
-
-  // Update sensor data
-  sensors.dailyFoodDispensed += FOOD_PORTION_GRAMS;
-  sensors.totalFoodDispensed += FOOD_PORTION_GRAMS;
-
-  strcpy(sensors.feedingStatus, "Dispensed");
-  displayMessage("Food Dispensed", "Complete");
-
-  delay(2000); // Show completion message
-
-  feederSystem.dispensing = false;
-  strcpy(sensors.feedingStatus, "Ready");
+  // Plays from the pattern engine; the LED is left as it is
+  startBeepPattern(beepCount, beepDuration, pauseDuration);
 }
 
 void displayMessage(String line1, String line2)
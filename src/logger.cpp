@@ -0,0 +1,136 @@
+#include "logger.h"
+#include "json_pool.h"
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// The loop task, timer callbacks and the watchdog task all log; the ring and
+// the cost table are lock-free (logger_core.h)
+static LogRing ring;
+static LogCostTable costs;
+static std::atomic<uint32_t> enqueueMicrosTotal(0);
+static std::atomic<uint32_t> maxEnqueueMicros(0);
+
+static TaskHandle_t drainTask = nullptr;
+
+static const char levelLetters[] = {'-', 'E', 'W', 'I', 'D'};
+
+static bool initRing()
+{
+  logRingInit(ring);
+  return true;
+}
+static bool ringReady = initRing(); // Before setup() so early messages are kept
+
+static void drainLogs()
+{
+  const LogSlot *slot;
+  while ((slot = logRingPeek(ring)) != nullptr)
+  {
+    Serial.printf("[%7lu][%c][%s] %s\n", (unsigned long)slot->millis,
+                  levelLetters[slot->level], slot->tag, slot->message);
+    logRingPop(ring);
+  }
+}
+
+static void logDrainTask(void *)
+{
+  uint32_t reportedDrops = 0;
+  for (;;)
+  {
+    drainLogs();
+
+    uint32_t dropped = ring.dropped.load(std::memory_order_relaxed);
+    if (dropped != reportedDrops)
+    {
+      Serial.printf("[log] %lu message(s) dropped\n", (unsigned long)(dropped - reportedDrops));
+      reportedDrops = dropped;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
+}
+
+void setupLogger()
+{
+  if (drainTask != nullptr)
+    return;
+
+  // Same core as WiFi; the loop task runs on core 1
+  if (xTaskCreatePinnedToCore(logDrainTask, "logDrain", LOG_TASK_STACK, nullptr,
+                              LOG_TASK_PRIORITY, &drainTask, 0) != pdPASS)
+  {
+    drainTask = nullptr;
+    Serial.println("✗ Log drain task could not be started");
+  }
+}
+
+void logWrite(uint8_t level, const char *tag, const char *format, ...)
+{
+  uint32_t startCycles = ESP.getCycleCount();
+
+  va_list args;
+  va_start(args, format);
+  bool queued = logRingPush(ring, millis(), level, tag, format, args);
+  va_end(args);
+
+  uint32_t micros = (ESP.getCycleCount() - startCycles) / ESP.getCpuFreqMHz();
+  logCostRecord(costs, tag, micros);
+  if (!queued)
+    return;
+
+  enqueueMicrosTotal.fetch_add(micros, std::memory_order_relaxed);
+  uint32_t worst = maxEnqueueMicros.load(std::memory_order_relaxed);
+  while (micros > worst &&
+         !maxEnqueueMicros.compare_exchange_weak(worst, micros, std::memory_order_relaxed))
+  {
+  }
+}
+
+LoggerStats getLoggerStats()
+{
+  LoggerStats stats;
+  stats.written = ring.written.load(std::memory_order_relaxed);
+  stats.dropped = ring.dropped.load(std::memory_order_relaxed);
+  stats.avgEnqueueUs = stats.written ? enqueueMicrosTotal.load(std::memory_order_relaxed) / stats.written : 0;
+  stats.maxEnqueueUs = maxEnqueueMicros.load(std::memory_order_relaxed);
+  return stats;
+}
+
+// {"tags":{"<tag>":[calls,avgUs,maxUs],...},"untracked":n}, the
+// LOG_COSTS_REPORTED tags with the highest total cost
+int handleLogCostsMethod(String &responsePayload)
+{
+  bool reported[LOG_TAG_MAX] = {};
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  JsonObject tags = doc.createNestedObject("tags");
+  for (uint8_t n = 0; n < LOG_COSTS_REPORTED; n++)
+  {
+    int costliest = -1;
+    uint32_t costliestUs = 0;
+    for (int i = 0; i < LOG_TAG_MAX; i++)
+    {
+      uint32_t totalUs = costs.tags[i].totalUs.load(std::memory_order_relaxed);
+      if (!reported[i] && costs.tags[i].tag.load(std::memory_order_acquire) != nullptr &&
+          (costliest < 0 || totalUs > costliestUs))
+      {
+        costliest = i;
+        costliestUs = totalUs;
+      }
+    }
+    if (costliest < 0)
+      break;
+
+    reported[costliest] = true;
+    const LogTagCost &entry = costs.tags[costliest];
+    uint32_t calls = entry.calls.load(std::memory_order_relaxed);
+    JsonArray values = tags.createNestedArray(entry.tag.load(std::memory_order_relaxed));
+    values.add(calls);
+    values.add(calls ? costliestUs / calls : 0);
+    values.add(entry.maxUs.load(std::memory_order_relaxed));
+  }
+  doc["untracked"] = costs.untracked.load(std::memory_order_relaxed);
+  serializeJson(doc, responsePayload);
+  return 200;
+}
@@ -0,0 +1,94 @@
+#include "logger_core.h"
+#include <stdio.h>
+
+void logRingInit(LogRing &ring)
+{
+  for (uint32_t i = 0; i < LOG_SLOT_COUNT; i++)
+    ring.slots[i].sequence.store(i, std::memory_order_relaxed);
+  ring.enqueuePosition.store(0, std::memory_order_relaxed);
+  ring.dequeuePosition = 0;
+  ring.written.store(0, std::memory_order_relaxed);
+  ring.dropped.store(0, std::memory_order_relaxed);
+}
+
+bool logRingPush(LogRing &ring, uint32_t millis, uint8_t level, const char *tag,
+                 const char *format, va_list args)
+{
+  // Claim a slot
+  uint32_t position = ring.enqueuePosition.load(std::memory_order_relaxed);
+  LogSlot *slot;
+  for (;;)
+  {
+    slot = &ring.slots[position & (LOG_SLOT_COUNT - 1)];
+    int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+    if (diff == 0)
+    {
+      if (ring.enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+    {
+      ring.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false; // Full
+    }
+    else
+    {
+      position = ring.enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->millis = millis;
+  slot->tag = tag;
+  slot->level = level <= LOG_LEVEL_DEBUG ? level : LOG_LEVEL_DEBUG;
+  vsnprintf(slot->message, sizeof(slot->message), format, args);
+  slot->sequence.store(position + 1, std::memory_order_release);
+  ring.written.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+const LogSlot *logRingPeek(LogRing &ring)
+{
+  LogSlot &slot = ring.slots[ring.dequeuePosition & (LOG_SLOT_COUNT - 1)];
+  if (slot.sequence.load(std::memory_order_acquire) != ring.dequeuePosition + 1)
+    return nullptr;
+  return &slot;
+}
+
+void logRingPop(LogRing &ring)
+{
+  LogSlot &slot = ring.slots[ring.dequeuePosition & (LOG_SLOT_COUNT - 1)];
+  slot.sequence.store(ring.dequeuePosition + LOG_SLOT_COUNT, std::memory_order_release);
+  ring.dequeuePosition++;
+}
+
+static void raiseMax(std::atomic<uint32_t> &worst, uint32_t value)
+{
+  uint32_t current = worst.load(std::memory_order_relaxed);
+  while (value > current && !worst.compare_exchange_weak(current, value, std::memory_order_relaxed))
+  {
+  }
+}
+
+void logCostRecord(LogCostTable &table, const char *tag, uint32_t us)
+{
+  // Entries are claimed once and never freed, so a scan finds a tag or the
+  // first free entry; a lost race for that entry just moves on
+  for (uint32_t i = 0; i < LOG_TAG_MAX; i++)
+  {
+    LogTagCost &entry = table.tags[i];
+    const char *current = entry.tag.load(std::memory_order_acquire);
+    if (current == nullptr)
+    {
+      if (entry.tag.compare_exchange_strong(current, tag, std::memory_order_acq_rel))
+        current = tag;
+    }
+    if (current != tag)
+      continue;
+
+    entry.calls.fetch_add(1, std::memory_order_relaxed);
+    entry.totalUs.fetch_add(us, std::memory_order_relaxed);
+    raiseMax(entry.maxUs, us);
+    return;
+  }
+  table.untracked.fetch_add(1, std::memory_order_relaxed);
+}
@@ -9,11 +9,30 @@
 #include "time_manager.h"
 #include "network_manager.h"
 #include "load_cell.h"
+#include "stall_watchdog.h"
+#include "trace_recorder.h"
+#include "logger.h"
+#include "feed_queue.h"
+#include "benchmarks.h"
+#include "web_server.h"
+#include "calendar.h"
+#include "presence.h"
+#include "hopper_model.h"
+#include "method_stream.h"
+#include "sampling_policy.h"
+#include "history_store.h"
+#include "dispense_capture.h"
+#include "fault_injection.h"
+
+static const char *TAG = "main";
 
 void testDataSending();
 
 void setup()
 {
+  // Start stall attribution before anything can block (NTP, WiFi, MQTT)
+  setupStallWatchdog();
+
   // Add setup timeout mechanism - reduced to 30 seconds
   unsigned long setupStartTime = millis();
   const unsigned long SETUP_TIMEOUT = 30000; // Reduced from 60 to 30 seconds
@@ -46,7 +65,7 @@ void setup()
 
   // Initialize load cell early
   Serial.println("Initializing load cell (final check)...");
-  if (!scale.is_ready())
+  if (!isScaleReady())
   {
     setupLoadCell(); // Try one more time
   }
@@ -110,10 +129,23 @@ void setup()
 
   unsigned long totalSetupTime = millis() - setupStartTime;
   Serial.printf("Setup completed in %lu ms - entering main loop\n", totalSetupTime);
+
+#if RUN_BENCHMARKS
+  runBenchmarks(); // Before the hardware watchdog is armed
+#endif
+
+#if FAULT_INJECTION
+  startFaultScenarios(); // Runs from loop() over the next few minutes
+#endif
+
+  // loop() now has to check in every STALL_BUDGET_MS
+  armHardwareWatchdog();
 }
 
 void loop()
 {
+  stallWatchdogCheckIn();
+
   if (!feederSystem.initialized)
   {
     delay(100);
@@ -122,6 +154,10 @@ void loop()
 
   unsigned long currentMillis = millis();
 
+#if FAULT_INJECTION
+  handleFaultScenarios();
+#endif
+
   // Handle buttons FIRST to catch manual dispense commands
   // This must be before handleFeeding() to ensure button presses override
   handleButtons();
@@ -136,49 +172,51 @@ void loop()
   if (feederSystem.rtcReady && !feederSystem.dispensing &&
       currentMillis - timing.lastRTCRead >= RTC_READ_INTERVAL)
   {
-    RtcDateTime now = rtc.GetDateTime();
+    RtcDateTime now = getLocalDateTime();
 
     String currentTimeStr = formatTime(now);
     strcpy(timeData.currentTimeString, currentTimeStr.c_str());
 
+    timeData.nextScheduledFeed = getNextScheduledFeedTime(now);
     String nextFeedStr = formatTime(timeData.nextScheduledFeed);
     strcpy(timeData.nextFeedTimeString, nextFeedStr.c_str());
 
-    // Only check auto feeding if not manually dispensing
-    if (shouldAutoFeed(now) && !feederSystem.dispensing)
+    // Duplicate requests inside the schedule window coalesce in the queue
+    if (shouldAutoFeed(now))
     {
-      Serial.println("=== AUTO FEED TRIGGERED ===");
-      performAutoFeed();
+      requestFeed(FEED_SOURCE_SCHEDULED);
     }
     timing.lastRTCRead = currentMillis;
   }
 
-  // Handle sensors (including load cell)
+  // Start the highest priority feed request the policy allows
+  handleFeedQueue();
+
+  // Handle sensors (including load cell and meal tracking)
   handleSensors();
 
-  // Update bowl weight regularly
-  if (currentMillis - timing.lastWeightRead >= WEIGHT_READ_INTERVAL)
-  {
-    updateBowlWeight();
-    timing.lastWeightRead = currentMillis;
-  }
+  // Stream the fresh samples to local dashboard clients
+  handleWebServer();
+
+  // Close history buckets and checkpoint them to flash
+  handleHistory();
+
+  // Save the dispense window once its post-trigger time has passed
+  handleDispenseCapture();
 
   // Check if automatic feeding sequence is complete
   checkFeedingComplete();
 
-  // Print connection status every 30 seconds
+  // One bounded health line every 30 seconds; per-module counters are in
+  // telemetry and the getStats direct method
   static unsigned long lastStatusPrint = 0;
   if (currentMillis - lastStatusPrint >= 30000)
   {
-    Serial.printf("\n=== STATUS UPDATE ===\n");
-    Serial.printf("WiFi: %s (RSSI: %d dBm)\n",
-                  WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected",
-                  WiFi.RSSI());
-    Serial.printf("MQTT: %s\n", feederSystem.mqttConnected ? "Connected" : "Disconnected");
-    Serial.printf("Backend: %s\n", feederSystem.backendConnected ? "Connected" : "Disconnected");
-    Serial.printf("Uptime: %lu seconds\n", millis() / 1000);
-    Serial.printf("Free heap: %d bytes\n", ESP.getFreeHeap());
-    Serial.println("====================\n");
+    LOGI(TAG, "up %lus wifi %d dBm mqtt %s heap %u (min %u) stack %u held %u logdrop %lu",
+         millis() / 1000, WiFi.status() == WL_CONNECTED ? (int)WiFi.RSSI() : 0,
+         feederSystem.mqttConnected ? "up" : "down", (unsigned)ESP.getFreeHeap(),
+         (unsigned)ESP.getMinFreeHeap(), (unsigned)uxTaskGetStackHighWaterMark(nullptr),
+         (unsigned)getTelemetryBacklogDepth(), getLoggerStats().dropped);
     lastStatusPrint = currentMillis;
   }
 
@@ -186,11 +224,17 @@ void loop()
 
   if (currentMillis - timing.lastLCDUpdate >= LCD_UPDATE_INTERVAL)
   {
+    STALL_REGION(REGION_LCD);
     updateLCD();
     timing.lastLCDUpdate = currentMillis;
   }
 
   resetDailyCounters();
+
+  // Correct DS1302 drift against NTP
+  handleRtcDiscipline();
+
+  handleTraceRecorder();
 }
 
 void testDataSending()
@@ -209,9 +253,9 @@ void testDataSending()
   Serial.printf("- Distance: %.2f inches\n", sensors.distance);
   Serial.printf("- Weight: %.2f grams\n", sensors.weight);
   Serial.printf("- Motion detected: %s\n", sensors.motionDetected ? "Yes" : "No");
-  Serial.printf("- Food level: %s\n", sensors.foodLevel);
-  Serial.printf("- Bowl status: %s\n", sensors.bowlStatus);
-  Serial.printf("- Feeding status: %s\n", sensors.feedingStatus);
+  Serial.printf("- Food level: %s\n", getFoodLevelName(sensors.foodLevel));
+  Serial.printf("- Bowl status: %s\n", getBowlStatusName(sensors.bowlStatus));
+  Serial.printf("- Feeding status: %s\n", getFeedingStatusName(sensors.feedingStatus));
   Serial.printf("- Daily food dispensed: %.2f grams\n", sensors.dailyFoodDispensed);
   Serial.printf("- WiFi connected: %s\n", WiFi.status() == WL_CONNECTED ? "Yes" : "No");
   Serial.printf("- WiFi RSSI: %d dBm\n", WiFi.RSSI());
@@ -0,0 +1,58 @@
+#include "meal_tracker.h"
+#include "sensor_manager.h"
+#include "network_manager.h"
+#include "gateway.h"
+#include "globals.h"
+#include "logger.h"
+#include "history_store.h"
+
+static const char *TAG = "meal";
+
+static MealStats mealStats;
+
+static void publishMealEvent(const MealEvent &meal)
+{
+  char payload[160];
+  int len = snprintf(payload, sizeof(payload),
+                     "{\"messageType\":\"meal\",\"deviceId\":\"%s\",\"startUptime\":%lu,"
+                     "\"durationSec\":%lu,\"grams\":%.1f,\"peakRate\":%.2f,\"bowlWeight\":%.1f}",
+                     getFeederId(), meal.startMillis / 1000,
+                     (meal.endMillis - meal.startMillis) / 1000,
+                     meal.gramsEaten, meal.peakRate, meal.endWeight);
+
+  if (publishTelemetryEvent(payload, len))
+  {
+    LOGI(TAG, "✓ Meal event sent: %.1fg in %lus",
+              meal.gramsEaten, (meal.endMillis - meal.startMillis) / 1000);
+  }
+  else
+  {
+    LOGE(TAG, "✗ Failed to send meal event");
+  }
+}
+
+void updateMealTracking(const MealEvent *ended)
+{
+  mealStats.intakeRate = mealTrackerIntakeRate(sensorCore.meals);
+  mealStats.eating = sensorCore.meals.state == MEAL_EATING;
+
+  if (ended != nullptr)
+  {
+    mealStats.mealsToday++;
+    mealStats.gramsToday += ended->gramsEaten;
+    mealStats.lastMeal = *ended;
+    recordHistory(HISTORY_INTAKE, ended->gramsEaten);
+    publishMealEvent(*ended);
+  }
+}
+
+const MealStats &getMealStats()
+{
+  return mealStats;
+}
+
+void resetMealDailyStats()
+{
+  mealStats.mealsToday = 0;
+  mealStats.gramsToday = 0.0;
+}
@@ -0,0 +1,112 @@
+#include "meal_tracker.h"
+
+static void pushIntakeSample(MealTracker &tracker, float grams, unsigned long dtMillis)
+{
+  if (dtMillis > 0xFFFF)
+    dtMillis = 0xFFFF;
+
+  // Replace the oldest slot and keep the running sums in step
+  tracker.consumedSum += grams - tracker.consumed[tracker.head];
+  tracker.elapsedSum += dtMillis;
+  tracker.elapsedSum -= tracker.elapsed[tracker.head];
+  tracker.consumed[tracker.head] = grams;
+  tracker.elapsed[tracker.head] = (uint16_t)dtMillis;
+  tracker.head = (tracker.head + 1) & (MEAL_RATE_WINDOW - 1);
+
+  if (tracker.consumedSum < 0.0)
+    tracker.consumedSum = 0.0; // float round-off from repeated subtraction
+}
+
+float mealTrackerIntakeRate(const MealTracker &tracker)
+{
+  if (tracker.elapsedSum == 0)
+    return 0.0;
+  return tracker.consumedSum * 60000.0 / tracker.elapsedSum;
+}
+
+bool mealTrackerUpdate(MealTracker &tracker, unsigned long nowMillis, float weight,
+                       bool animalPresent, bool dispensing, MealEvent &event)
+{
+  if (!tracker.hasSample)
+  {
+    tracker.hasSample = true;
+    tracker.lastWeight = weight;
+    tracker.referenceWeight = weight;
+    tracker.lastSampleMillis = nowMillis;
+    return false;
+  }
+
+  unsigned long dt = nowMillis - tracker.lastSampleMillis;
+  tracker.lastSampleMillis = nowMillis;
+  tracker.lastWeight = weight;
+
+  // The bowl fills during a dispense; that is never eating
+  if (dispensing)
+  {
+    tracker.referenceWeight = weight;
+    pushIntakeSample(tracker, 0.0, dt);
+    return false;
+  }
+
+  // Positive when food has left the bowl since the reference point
+  float drop = tracker.referenceWeight - weight;
+  float eaten = 0.0;
+
+  if (tracker.state == MEAL_IDLE)
+  {
+    if (!animalPresent || drop <= -MEAL_NOISE_GRAMS)
+    {
+      // Nobody at the bowl (drift/creep) or the bowl was topped up
+      tracker.referenceWeight = weight;
+    }
+    else if (drop >= MEAL_START_DROP_GRAMS)
+    {
+      tracker.state = MEAL_EATING;
+      tracker.current = {};
+      tracker.current.startMillis = nowMillis;
+      tracker.current.startWeight = tracker.referenceWeight;
+      tracker.lastDropMillis = nowMillis;
+      eaten = drop;
+      tracker.referenceWeight = weight;
+    }
+  }
+  else
+  {
+    if (drop >= MEAL_NOISE_GRAMS)
+    {
+      eaten = drop;
+      tracker.referenceWeight = weight;
+      tracker.lastDropMillis = nowMillis;
+    }
+    else if (drop <= -MEAL_NOISE_GRAMS)
+    {
+      tracker.referenceWeight = weight; // Pet pressed on the bowl or it was refilled
+    }
+  }
+
+  pushIntakeSample(tracker, eaten, dt);
+
+  if (tracker.state != MEAL_EATING)
+    return false;
+
+  tracker.current.gramsEaten += eaten;
+  float rate = mealTrackerIntakeRate(tracker);
+  if (rate > tracker.current.peakRate)
+    tracker.current.peakRate = rate;
+
+  unsigned long quiet = nowMillis - tracker.lastDropMillis;
+  bool ended = (quiet >= MEAL_END_QUIET_MS && !animalPresent) ||
+               quiet >= 2UL * MEAL_END_QUIET_MS;
+  if (!ended)
+    return false;
+
+  tracker.state = MEAL_IDLE;
+  tracker.current.endMillis = tracker.lastDropMillis;
+  tracker.current.endWeight = weight;
+
+  if (tracker.current.gramsEaten < MEAL_MIN_GRAMS)
+    return false;
+
+  event = tracker.current;
+  return true;
+}
@@ -0,0 +1,102 @@
+#include "method_stream.h"
+#include "network_manager.h"
+#include "stall_watchdog.h"
+#include "logger.h"
+
+static const char *TAG = "stream";
+
+static MethodStream methodStream;
+static MethodStreamStats streamStats;
+static char methodRequestId[REQUEST_ID_MAX] = "";
+
+void setMethodRequestId(const char *requestId)
+{
+  strncpy(methodRequestId, requestId, sizeof(methodRequestId) - 1);
+  methodRequestId[sizeof(methodRequestId) - 1] = '\0';
+}
+
+MethodStream &openMethodStream(const char *contentType)
+{
+  methodStream.contentType = contentType;
+  chunkWriterOpen(methodStream.writer, methodStream.buffer, sizeof(methodStream.buffer),
+                  MethodStream::publishChunk, &methodStream);
+  methodStream.startMillis = millis();
+  return methodStream;
+}
+
+bool MethodStream::publishChunk(void *context, const uint8_t *data, size_t length,
+                                uint16_t sequence, bool last)
+{
+#if FEEDER_ROLE == FEEDER_ROLE_LEAF
+  // The gateway only forwards single responses from leaves
+  return false;
+#else
+  MethodStream &stream = *(MethodStream *)context;
+  char topic[160];
+  snprintf(topic, sizeof(topic), "%s$.ct=%s&rid=%s&seq=%u&last=%d", iotHub.telemetryTopic,
+           stream.contentType, methodRequestId, sequence, last ? 1 : 0);
+
+  // Streamed publish: the payload goes straight to the socket, not through
+  // PubSubClient's buffer
+  bool sent = mqttClient.beginPublish(topic, length, false) &&
+              mqttClient.write(data, length) == length &&
+              mqttClient.endPublish();
+  if (!sent)
+  {
+    LOGE(TAG, "✗ Chunk %u of request %s not published", sequence, methodRequestId);
+    return false;
+  }
+
+  stallWatchdogCheckIn(); // A long stream is progress, not a stall
+  return true;
+#endif
+}
+
+size_t MethodStream::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t MethodStream::write(const uint8_t *data, size_t size)
+{
+  return chunkWriterWrite(writer, data, size);
+}
+
+bool MethodStream::end()
+{
+  bool ok = chunkWriterEnd(writer);
+
+  unsigned long elapsed = millis() - startMillis;
+  streamStats.streams++;
+  streamStats.chunks += writer.sequence;
+  streamStats.bytes += writer.total;
+  if (!ok)
+  {
+    streamStats.failures++;
+    return false;
+  }
+  streamStats.lastBytesPerSec =
+      elapsed > 0 ? (uint32_t)((uint64_t)writer.total * 1000 / elapsed) : writer.total;
+  LOGI(TAG, "Streamed %lu bytes in %u chunks (%lu B/s)", (unsigned long)writer.total,
+       writer.sequence, (unsigned long)streamStats.lastBytesPerSec);
+  return true;
+}
+
+bool streamOversizedResponse(String &responsePayload)
+{
+  MethodStream &stream = openMethodStream(METHOD_CT_JSON);
+  stream.write((const uint8_t *)responsePayload.c_str(), responsePayload.length());
+  bool ok = stream.end();
+
+  char summary[128];
+  snprintf(summary, sizeof(summary),
+           "{\"status\":\"%s\",\"streamed\":true,\"chunks\":%u,\"bytes\":%lu}",
+           ok ? "success" : "error", stream.chunks(), (unsigned long)stream.bytes());
+  responsePayload = summary;
+  return ok;
+}
+
+const MethodStreamStats &getMethodStreamStats()
+{
+  return streamStats;
+}
@@ -0,0 +1,52 @@
+#include "method_stream_core.h"
+#include <string.h>
+
+void chunkWriterOpen(ChunkWriter &writer, uint8_t *buffer, size_t capacity, ChunkSink sink,
+                     void *context)
+{
+  writer.buffer = buffer;
+  writer.capacity = capacity;
+  writer.used = 0;
+  writer.sequence = 0;
+  writer.total = 0;
+  writer.failed = false;
+  writer.sink = sink;
+  writer.context = context;
+}
+
+static void flushChunk(ChunkWriter &writer, bool last)
+{
+  if (writer.failed)
+    return;
+  if (!writer.sink(writer.context, writer.buffer, writer.used, writer.sequence, last))
+  {
+    writer.failed = true;
+    return;
+  }
+  writer.sequence++;
+  writer.used = 0;
+}
+
+size_t chunkWriterWrite(ChunkWriter &writer, const uint8_t *data, size_t size)
+{
+  size_t written = 0;
+  while (written < size && !writer.failed)
+  {
+    size_t n = size - written;
+    if (n > writer.capacity - writer.used)
+      n = writer.capacity - writer.used;
+    memcpy(writer.buffer + writer.used, data + written, n);
+    writer.used += n;
+    written += n;
+    writer.total += n;
+    if (writer.used == writer.capacity)
+      flushChunk(writer, false);
+  }
+  return written;
+}
+
+bool chunkWriterEnd(ChunkWriter &writer)
+{
+  flushChunk(writer, true);
+  return !writer.failed;
+}
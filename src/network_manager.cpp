@@ -1,29 +1,61 @@
 #include "network_manager.h"
+#include "json_pool.h"
 #include "feeding_control.h"
 #include "time_manager.h"
 #include "sensor_manager.h"
+#include "button_handler.h"
+#include "gateway.h"
+#include "meal_tracker.h"
+#include "report_policy.h"
+#include "calibration.h"
+#include "stall_watchdog.h"
+#include "trace_recorder.h"
+#include "servo_motion.h"
+#include "logger.h"
+#include "sas_token.h"
+#include "calendar.h"
+#include "presence.h"
+#include "hopper_model.h"
+#include "fault_injection.h"
+#include "feed_queue.h"
+#include "method_stream.h"
+#include "sampling_policy.h"
+#include "history_store.h"
+#include "dispense_capture.h"
+#include "web_server.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 
-const char *mqttServer = MQTT_SERVER;
-const int mqttPort = MQTT_PORT;
-const char *deviceId = DEVICE_ID;
-const char *sasToken = SAS_TOKEN;
-const char *mqttUsername = MQTT_USERNAME;
-const char *databaseEndpoint = DATABASE_ENDPOINT;
+static const char *TAG = "mqtt";
 
+static ReconnectBackoff backoff;
+static unsigned long lastRenewAttempt = 0;
+
+#if FEEDER_ROLE == FEEDER_ROLE_LEAF || !MQTT_USE_TLS
+WiFiClient wifiClient; // Plain MQTT to the local broker / mosquitto
+#else
 WiFiClientSecure wifiClient;
+#endif
 PubSubClient mqttClient(wifiClient);
 
 void setupMQTT()
 {
   setupTime();
+#if FEEDER_ROLE != FEEDER_ROLE_LEAF
+  setupSasToken();
+#endif
+#if FEEDER_ROLE == FEEDER_ROLE_LEAF
+  // Leaves only ever talk to the on-LAN broker
+  mqttClient.setServer(LOCAL_BROKER_HOST, LOCAL_BROKER_PORT);
+#else
+#if MQTT_USE_TLS
   wifiClient.setInsecure(); // For testing only
-
-  mqttClient.setServer(mqttServer, mqttPort);
+#endif
+  mqttClient.setServer(iotHub.mqttServer, iotHub.mqttPort);
+#endif
   mqttClient.setCallback(handleMQTTCallback);
   mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
   mqttClient.setKeepAlive(120);
@@ -31,77 +63,169 @@ void setupMQTT()
   mqttClient.disconnect();
   delay(100);
 
-  Serial.println("\n=== Setting up MQTT Connection ===");
+  LOGI(TAG, "=== Setting up MQTT Connection ===");
   if (connectMQTT())
   {
-    Serial.println("✓ MQTT Setup Complete");
+    LOGI(TAG, "✓ MQTT Setup Complete");
   }
   else
   {
-    Serial.println("✗ MQTT Setup Failed");
+    LOGE(TAG, "✗ MQTT Setup Failed");
   }
-  Serial.println("===============================\n");
+
+#if FEEDER_ROLE == FEEDER_ROLE_GATEWAY
+  setupGateway();
+#endif
 }
 
-bool connectMQTT()
+static ConnectOutcome connectOutcomeForState(int state)
 {
-  const int maxRetries = 3;
-  int retryCount = 0;
+  if (state == MQTT_CONNECT_BAD_CREDENTIALS || state == MQTT_CONNECT_UNAUTHORIZED)
+    return CONNECT_REJECTED;
+  return CONNECT_FAILED;
+}
 
-  while (retryCount < maxRetries && !mqttClient.connected())
-  {
-    Serial.println("Connecting to Azure IoT Hub...");
-    Serial.printf("Server: %s\n", mqttServer);
-    Serial.printf("Port: %d\n", mqttPort);
-    Serial.printf("Username: %s\n", mqttUsername);
+static bool transportConnected(void *)
+{
+  return mqttClient.connected();
+}
 
-    String clientId = String(DEVICE_ID);
+// One attempt over PubSubClient; the backoff around it is mqttConnect()'s
+static ConnectOutcome transportConnect(void *)
+{
+  STALL_REGION(REGION_MQTT_CONNECT);
 
-    if (mqttClient.connect(clientId.c_str(), mqttUsername, sasToken))
-    {
-      Serial.println("Connected to Azure IoT Hub");
+#if FAULT_INJECTION
+  int injectedState = injectConnectFault();
+  if (injectedState != MQTT_CONNECTED)
+  {
+    LOGW(TAG, "✗ MQTT connect failed (injected state %d)", injectedState);
+    return connectOutcomeForState(injectedState);
+  }
+#endif
 
-      mqttClient.subscribe("$iothub/methods/POST/#");
-      mqttClient.subscribe("$iothub/twin/PATCH/properties/desired/#");
+#if FEEDER_ROLE == FEEDER_ROLE_LEAF
+  LOGI(TAG, "Connecting to local broker %s:%d as %s...",
+       LOCAL_BROKER_HOST, LOCAL_BROKER_PORT, getFeederId());
 
-      feederSystem.mqttConnected = true;
-      return true;
-    }
+  if (mqttClient.connect(getFeederId()))
+  {
+    LOGI(TAG, "Connected to local broker");
+    subscribeLeafTopics();
+    return CONNECT_OK;
+  }
+#else
+  LOGI(TAG, "Connecting to Azure IoT Hub %s:%d...", iotHub.mqttServer, iotHub.mqttPort);
+  LOGD(TAG, "Username: %s", iotHub.mqttUsername);
+
+  if (mqttClient.connect(iotHub.deviceId, iotHub.mqttUsername, getSasToken()))
+  {
+    LOGI(TAG, "Connected to Azure IoT Hub");
 
-    retryCount++;
-    Serial.printf("Failed to connect, attempt %d of %d\n", retryCount, maxRetries);
-    Serial.printf("MQTT State: %d\n", mqttClient.state());
-    delay(5000 * retryCount);
+    mqttClient.subscribe(iotHub.methodTopic);
+    mqttClient.subscribe("$iothub/twin/PATCH/properties/desired/#");
+    return CONNECT_OK;
   }
+#endif
+
+  int state = mqttClient.state();
+  LOGW(TAG, "✗ MQTT connect failed (state %d)", state);
+  return connectOutcomeForState(state);
+}
 
+static const MqttTransport mqttTransport = {nullptr, transportConnected, transportConnect};
+
+// Firmware side of a connect outcome; true when connected
+static bool connectFinished(ConnectOutcome outcome)
+{
+  switch (outcome)
+  {
+  case CONNECT_ALREADY:
+    return true;
+  case CONNECT_OK:
+    feederSystem.mqttConnected = true;
+    return true;
+  case CONNECT_NOT_DUE:
+    return false;
+  case CONNECT_REJECTED:
+    // A stale token is the usual cause; the next attempt uses a fresh one
+    refreshSasToken();
+    break;
+  default:
+    break;
+  }
   feederSystem.mqttConnected = false;
-  Serial.println("Failed to connect to Azure IoT Hub after all retries");
+  LOGW(TAG, "Next MQTT attempt in %lu s", (unsigned long)backoff.waitMs / 1000);
   return false;
 }
 
+bool connectMQTT()
+{
+  return connectFinished(mqttConnect(backoff, mqttTransport, millis(), esp_random()));
+}
+
+void resetMQTTBackoff()
+{
+  reconnectSucceeded(backoff);
+}
+
+// Swaps in a fresh token while the feeder is idle so the hub never sees an
+// expired one; the reconnect takes one TLS handshake
+static void renewSasConnection()
+{
+  if (!isSasRenewalDue() || feederSystem.dispensing || getFeedQueueStats().depth > 0)
+    return;
+
+  unsigned long now = millis();
+  if (lastRenewAttempt != 0 && now - lastRenewAttempt < MQTT_RECONNECT_INTERVAL)
+    return;
+  lastRenewAttempt = now;
+
+  if (!refreshSasToken())
+    return;
+
+  if (mqttClient.connected())
+  {
+    LOGI(TAG, "Reconnecting with renewed SAS token");
+    mqttClient.disconnect();
+    backoff.waitMs = 0;
+    connectMQTT();
+  }
+}
+
 void handleMQTTCallback(char *topic, byte *payload, unsigned int length)
 {
-  String message = String((char *)payload, length);
+  traceMqttMessage(topic, payload, length);
+
   String topicStr = String(topic);
 
-  Serial.printf("Message received on topic: %s\n", topic);
-  Serial.printf("Message content: %s\n", message.c_str());
+  LOGD(TAG, "Message received on topic: %s", topic);
+  LOGD(TAG, "Message content: %.*s", (int)length, (const char *)payload);
+
+#if FEEDER_ROLE == FEEDER_ROLE_LEAF
+  // Leaves receive methods fanned out by the gateway on the local broker
+  if (isLeafMethodTopic(topic))
+  {
+    handleLeafMethod(topic, payload, length);
+    return;
+  }
+#endif
 
   // Check if this is a direct method call
   if (topicStr.startsWith("$iothub/methods/POST/"))
   {
-    Serial.println("Direct method detected - routing to handleDirectMethod");
+    LOGD(TAG, "Direct method detected - routing to handleDirectMethod");
     handleDirectMethod(topic, payload, length);
   }
   // Check if this is a device twin update
   else if (topicStr.startsWith("$iothub/twin/PATCH/properties/desired/"))
   {
-    Serial.println("Device twin update received");
+    LOGI(TAG, "Device twin update received");
     // Handle device twin updates here if needed
   }
   else
   {
-    Serial.println("Unknown message type received");
+    LOGW(TAG, "Unknown message type received on %s", topic);
   }
 }
 
@@ -109,7 +233,7 @@ bool sendToDatabase()
 {
   if (WiFi.status() != WL_CONNECTED)
   {
-    Serial.println("ERROR: WiFi not connected");
+    LOGE(TAG, "WiFi not connected");
     return false;
   }
 
@@ -119,23 +243,23 @@ bool sendToDatabase()
   lcd.print("Testing Database");
   lcd.setCursor(0, 1);
   lcd.print("Connection...");
-  Serial.println("Testing database connection...");
+  LOGI(TAG, "Testing database connection...");
 
   HTTPClient https;
   https.setTimeout(3000); // Reduced to 3 second timeout
-  https.begin("https://petfeeder-embedded.azurewebsites.net/api/devices/status");
+  https.begin(DATABASE_STATUS_URL);
 
   https.addHeader("Content-Type", "application/json");
   https.addHeader("Accept", "application/json");
 
   // Fix payload format - use simpler structure to avoid 400 error
-  StaticJsonDocument<256> doc;
-  doc["deviceId"] = String(DEVICE_ID);
+  JsonDocument &doc = borrowJsonDocument();
+  doc["deviceId"] = iotHub.deviceId;
 
   // Use simpler timestamp format
   if (feederSystem.rtcReady)
   {
-    RtcDateTime now = getPhilippineTime();
+    RtcDateTime now = getLocalDateTime();
     doc["timestamp"] = formatDateTime(now);
   }
   else
@@ -145,31 +269,38 @@ bool sendToDatabase()
 
   // Ensure numeric values are properly formatted
   doc["bowlWeight"] = (float)sensors.weight;
-  doc["containerLevel"] = (int)sensors.foodLevel;
+  doc["containerLevel"] = getFoodLevelName(sensors.foodLevel);
   doc["petPresent"] = (bool)feederSystem.animalDetected;
   doc["status"] = "online";
 
   String jsonStr;
   serializeJson(doc, jsonStr);
 
-  Serial.println("Sending HTTP POST to database...");
-  Serial.println("JSON Payload: " + jsonStr);
+  LOGI(TAG, "Sending HTTP POST to database...");
+  LOGD(TAG, "JSON Payload: %s", jsonStr.c_str());
 
-  int httpCode = https.POST(jsonStr);
+  int httpCode;
+  {
+    STALL_REGION(REGION_HTTP_POST);
+#if FAULT_INJECTION
+    httpCode = injectHttpFault();
+    if (httpCode == 0)
+#endif
+      httpCode = https.POST(jsonStr);
+  }
 
   // Update LCD with database connection result - reduced delay
   lcd.clear();
   lcd.setCursor(0, 0);
   if (httpCode > 0)
   {
-    Serial.printf("Database Response Code: %d\n", httpCode);
     String response = https.getString();
-    Serial.printf("Response: %s\n", response.c_str());
+    LOGD(TAG, "Database response %d: %s", httpCode, response.c_str());
 
     if (httpCode == 200 || httpCode == 201)
     {
       lcd.print("Database: OK");
-      Serial.println("✓ Database connection successful");
+      LOGI(TAG, "✓ Database connection successful");
       feederSystem.backendConnected = true;
     }
     else
@@ -177,14 +308,13 @@ bool sendToDatabase()
       lcd.print("Database: ERROR");
       lcd.setCursor(0, 1);
       lcd.print("Code: " + String(httpCode));
-      Serial.printf("✗ Database error with code: %d\n", httpCode);
-      Serial.println("Response body: " + response);
+      LOGE(TAG, "✗ Database error with code %d: %s", httpCode, response.c_str());
       feederSystem.backendConnected = false;
     }
   }
   else
   {
-    Serial.printf("✗ HTTP POST failed, error: %s\n", https.errorToString(httpCode).c_str());
+    LOGE(TAG, "✗ HTTP POST failed, error: %s", https.errorToString(httpCode).c_str());
     lcd.print("Database: FAIL");
     lcd.setCursor(0, 1);
     lcd.print("Network Error");
@@ -197,76 +327,183 @@ bool sendToDatabase()
   return httpCode == 200 || httpCode == 201;
 }
 
-void sendSensorDataToAzure()
+bool sendSensorDataToAzure(uint8_t triggers)
 {
-  Serial.println("\n=== Attempting to send data to Azure IoT Hub ===");
+  STALL_REGION(REGION_TELEMETRY);
 
-  if (!mqttClient.connected())
+  ConnectOutcome link = mqttConnectForPublish(backoff, timing.lastMQTTReconnect, mqttTransport,
+                                              millis(), esp_random());
+  if (link == CONNECT_NOT_DUE)
+    return false;
+  if (!connectFinished(link))
   {
-    Serial.println("Reconnecting to MQTT...");
-    if (!connectMQTT())
-    {
-      Serial.println("✗ Failed to reconnect to MQTT");
-      return;
-    }
+    LOGE(TAG, "✗ Failed to reconnect to MQTT");
+    return false;
   }
 
-  StaticJsonDocument<512> doc; // Reduced size
+#if FEEDER_ROLE == FEEDER_ROLE_LEAF
+  // Leaves hand compact telemetry to the gateway instead of the hub
+  return publishLeafTelemetry();
+#endif
+
+  char triggerNames[48];
+  describeReportTriggers(triggers, triggerNames, sizeof(triggerNames));
+
+  JsonDocument &doc = borrowJsonDocument();
 
   // Simplified payload structure
-  doc["deviceId"] = String(DEVICE_ID);
-  doc["timestamp"] = feederSystem.rtcReady ? formatDateTime(getPhilippineTime()) : String(millis());
+  doc["deviceId"] = iotHub.deviceId;
+  doc["timestamp"] = feederSystem.rtcReady ? formatDateTime(getLocalDateTime()) : String(millis());
   doc["bowlWeight"] = (float)sensors.weight;
-  doc["containerLevel"] = (int)sensors.foodLevel;
+  doc["containerLevel"] = getFoodLevelName(sensors.foodLevel);
+  doc["hopperGrams"] = roundf(getHopperStats().grams);
+  doc["daysUntilEmpty"] = getHopperStats().daysUntilEmpty;
+  doc["stockAlert"] = getStockAlertName(getHopperStats().alert);
   doc["petPresent"] = (bool)feederSystem.animalDetected;
+  doc["mealsToday"] = getMealStats().mealsToday;
+  doc["intakeRate"] = getMealStats().intakeRate;
+  doc["visits24h"] = getVisitsLast24h();
+  doc["lastVisitS"] = getPresenceStats().lastVisit.durationMs / 1000;
+  doc["worstStallMs"] = getWorstStallMs();
+  const SamplingRates &rates = getSamplingRates();
+  doc["samplingMode"] = getSamplingModeName(getSamplingStats().mode);
+  doc["weightIntervalMs"] = rates.weightMs;
+  doc["levelIntervalMs"] = rates.ultrasonicMs;
   doc["messageType"] = "telemetry";
+  doc["trigger"] = triggerNames;
 
-  char payload[512];
-  size_t len = serializeJson(doc, payload, sizeof(payload));
+  char *payload = borrowJsonText();
+  size_t len = serializeJson(doc, payload, JSON_TEXT_SIZE);
 
-  String topic = String("devices/") + DEVICE_ID + "/messages/events/";
+  LOGD(TAG, "Publishing %u bytes to %s: %s", (unsigned)len, iotHub.telemetryTopic, payload);
 
-  Serial.println("JSON Payload:");
-  serializeJsonPretty(doc, Serial);
-  Serial.printf("\nPayload size: %d bytes\n", len);
-  Serial.printf("Publishing to topic: %s\n", topic.c_str());
-
-  if (mqttClient.publish(topic.c_str(), payload, len))
+  bool sent = FAULT_PUBLISH_OK() &&
+              mqttClient.publish(iotHub.telemetryTopic, (const uint8_t *)payload, len);
+  if (sent)
   {
-    Serial.println("✓ Data sent to Azure IoT Hub successfully");
+    LOGI(TAG, "✓ Telemetry sent (%s)", triggerNames);
     feederSystem.mqttConnected = true;
     feederSystem.backendConnected = true;
   }
   else
   {
-    Serial.println("✗ Failed to send data to Azure IoT Hub");
+    LOGE(TAG, "✗ Failed to send telemetry to Azure IoT Hub");
     feederSystem.mqttConnected = false;
     feederSystem.backendConnected = false;
   }
 
-  Serial.println("=== End of Azure IoT Hub transmission ===\n");
+  return sent;
+}
+
+static bool publishEventNow(const char *payload, size_t length)
+{
+  if (!mqttClient.connected())
+    return false;
+
+#if FEEDER_ROLE == FEEDER_ROLE_LEAF
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%s/t", LOCAL_TOPIC_ROOT, getFeederId());
+#else
+  const char *topic = iotHub.telemetryTopic;
+#endif
+
+  return FAULT_PUBLISH_OK() && mqttClient.publish(topic, (const uint8_t *)payload, length);
+}
+
+// Events (meals, alerts) happen once; hold the latest few while offline
+static char eventBacklog[TELEMETRY_BACKLOG_SLOTS][TELEMETRY_EVENT_MAX];
+static uint16_t eventBacklogLength[TELEMETRY_BACKLOG_SLOTS];
+static uint8_t eventBacklogHead = 0; // Oldest
+static uint8_t eventBacklogCount = 0;
+
+static void holdEvent(const char *payload, size_t length)
+{
+  if (length >= TELEMETRY_EVENT_MAX)
+  {
+    LOGW(TAG, "Event of %u bytes too large to hold for retry", (unsigned)length);
+    return;
+  }
+  if (eventBacklogCount == TELEMETRY_BACKLOG_SLOTS)
+  {
+    // Full: the oldest event gives way
+    eventBacklogHead = (eventBacklogHead + 1) % TELEMETRY_BACKLOG_SLOTS;
+    eventBacklogCount--;
+  }
+  uint8_t slot = (eventBacklogHead + eventBacklogCount) % TELEMETRY_BACKLOG_SLOTS;
+  memcpy(eventBacklog[slot], payload, length);
+  eventBacklogLength[slot] = length;
+  eventBacklogCount++;
+}
+
+// One held event per pass so a long backlog never blocks the loop
+static void replayEventBacklog()
+{
+  if (eventBacklogCount == 0 || !mqttClient.connected())
+    return;
+  if (!publishEventNow(eventBacklog[eventBacklogHead], eventBacklogLength[eventBacklogHead]))
+    return;
+  eventBacklogHead = (eventBacklogHead + 1) % TELEMETRY_BACKLOG_SLOTS;
+  eventBacklogCount--;
+}
+
+// Publishes a small, pre-serialized event on the telemetry path without
+// blocking on a reconnect; periodic telemetry takes care of reconnecting.
+// Events that can't go out now are held and replayed in order.
+bool publishTelemetryEvent(const char *payload, size_t length)
+{
+  if (eventBacklogCount == 0 && publishEventNow(payload, length))
+    return true;
+  holdEvent(payload, length);
+  return false;
+}
+
+uint8_t getTelemetryBacklogDepth()
+{
+  return eventBacklogCount;
 }
 
 void handleBackendCommunication()
 {
   unsigned long currentMillis = millis();
 
-  if (currentMillis - timing.lastDataSync >= DATA_SYNC_INTERVAL)
+  // Sensor values are already fresh: handleSensors() runs earlier in loop()
+  uint8_t triggers = getPendingReportTriggers(currentMillis);
+  if (triggers != REPORT_NONE && !isReportRateLimited(currentMillis))
+  {
+    if (sendSensorDataToAzure(triggers))
+    {
+      markReportSent(triggers, currentMillis);
+      timing.lastDataSync = currentMillis;
+    }
+  }
+
+  if (currentMillis - timing.lastCommandCheck >= DATA_SYNC_INTERVAL)
   {
-    handleSensors();         // ✅ Update sensor values first
-    sendSensorDataToAzure(); // ✅ Now you send up-to-date values
     checkForRemoteCommands();
-    timing.lastDataSync = currentMillis;
+    timing.lastCommandCheck = currentMillis;
   }
 
+#if FEEDER_ROLE != FEEDER_ROLE_LEAF
+  renewSasConnection();
+#endif
+
+  replayEventBacklog();
+
   if (mqttClient.connected())
   {
+    STALL_REGION(REGION_MQTT_LOOP);
+    FAULT_READ();
     mqttClient.loop();
   }
+
+#if FEEDER_ROLE == FEEDER_ROLE_GATEWAY
+  handleGateway();
+#endif
 }
 
 void setupTime()
 {
+  STALL_REGION(REGION_NTP_SYNC);
   configTime(0, 0, "pool.ntp.org", "time.nist.gov");
   Serial.print("Waiting for NTP time sync: ");
   time_t nowSecs = time(nullptr);
@@ -281,6 +518,9 @@ void setupTime()
   struct tm timeinfo;
   gmtime_r(&nowSecs, &timeinfo);
   Serial.printf("Current time: %s", asctime(&timeinfo));
+
+  // The DS1302 keeps UTC; NTP is the reference whenever we have it
+  syncRtcFromSystemClock(true);
 }
 
 bool checkForRemoteCommands()
@@ -288,85 +528,236 @@ bool checkForRemoteCommands()
   return true;
 }
 
-void handleDirectMethod(char *topic, byte *payload, unsigned int length)
+// Counters that are not part of telemetry, for diagnostics on demand
+static int handleGetStatsMethod(String &responsePayload)
 {
-  Serial.printf("Direct method received on topic: %s\n", topic);
-  Serial.printf("Payload length: %d\n", length);
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  doc["uptimeS"] = millis() / 1000;
+  doc["freeHeap"] = ESP.getFreeHeap();
+  doc["minFreeHeap"] = ESP.getMinFreeHeap();
+  doc["loopStackFree"] = (unsigned)uxTaskGetStackHighWaterMark(nullptr);
+  doc["eventsHeld"] = getTelemetryBacklogDepth();
+
+  const ReportStats &reports = getReportStats();
+  JsonObject report = doc.createNestedObject("reports");
+  report["sent"] = reports.published;
+  report["onChange"] = reports.changeReports;
+  report["heartbeat"] = reports.heartbeats;
+
+  LoggerStats logger = getLoggerStats();
+  JsonObject log = doc.createNestedObject("log");
+  log["written"] = logger.written;
+  log["dropped"] = logger.dropped;
+  log["avgUs"] = logger.avgEnqueueUs;
+  log["maxUs"] = logger.maxEnqueueUs;
+
+  const FeedQueueStats &feeds = getFeedQueueStats();
+  JsonObject queue = doc.createNestedObject("feedQueue");
+  queue["depth"] = feeds.depth;
+  queue["maxDepth"] = feeds.maxDepth;
+  queue["started"] = feeds.started;
+  queue["startFailed"] = feeds.startFailed;
+  queue["maxWaitMs"] = feeds.maxWaitMs;
+
+  const WebServerStats &webStats = getWebServerStats();
+  JsonObject web = doc.createNestedObject("web");
+  web["clients"] = webStats.clients;
+  web["frames"] = webStats.framesSent;
+  web["dropped"] = webStats.framesDropped;
+  web["refused"] = webStats.rejected;
+
+  const ButtonStats &buttonStats = getButtonStats();
+  JsonObject buttons = doc.createNestedObject("buttons");
+  buttons["actions"] = buttonStats.actions;
+  buttons["deferred"] = buttonStats.deferred;
+  buttons["lastUs"] = (unsigned long)buttonStats.lastLatencyUs;
+  buttons["maxUs"] = (unsigned long)buttonStats.maxLatencyUs;
+  buttons["overBudget"] = buttonStats.overBudget;
+  buttons["bounces"] = buttonStats.bounces;
+
+  const HistoryStats &historyStats = getHistoryStats();
+  JsonObject history = doc.createNestedObject("history");
+  history["samples"] = historyStats.samples;
+  history["checkpoints"] = historyStats.checkpoints;
+  history["failed"] = historyStats.checkpointFailures;
+
+  const CaptureStats &captureStats = getCaptureStats();
+  JsonObject capture = doc.createNestedObject("capture");
+  capture["conversions"] = captureStats.conversions;
+  capture["captures"] = captureStats.captures;
+  capture["truncated"] = captureStats.truncated;
+  capture["lost"] = captureStats.lost;
+
+  const MethodStreamStats &streamStats = getMethodStreamStats();
+  JsonObject streams = doc.createNestedObject("streams");
+  streams["count"] = streamStats.streams;
+  streams["failed"] = streamStats.failures;
+  streams["lastBps"] = (unsigned long)streamStats.lastBytesPerSec;
+
+  responsePayload = "";
+  serializeJson(doc, responsePayload);
+  return 200;
+}
 
-  // Print the payload for debugging
-  String payloadStr = "";
-  for (int i = 0; i < length; i++)
+int dispatchDirectMethod(const String &methodName, byte *payload, unsigned int length,
+                         String &responsePayload)
+{
+  if (methodName == "runMotors")
   {
-    payloadStr += (char)payload[i];
+    LOGI(TAG, "Processing runMotors command...");
+
+    // Queued behind any manual request; the policy decides when it runs and
+    // the sequence itself runs in the background
+    if (requestFeed(FEED_SOURCE_REMOTE))
+    {
+      LOGI(TAG, "Remote feeding request queued");
+
+      responsePayload = "{\"status\":\"success\",\"message\":\"Feed queued\",\"dispensing\":" +
+                        String(feederSystem.dispensing ? "true" : "false") + "}";
+      return 200;
+    }
+
+    // Cannot queue the request - send appropriate error
+    String reason = "Feed queue full";
+    LOGW(TAG, "Cannot run motors: %s", reason.c_str());
+
+    responsePayload = "{\"status\":\"error\",\"message\":\"Cannot run motors\",\"reason\":\"" + reason + "\"}";
+    return 400;
   }
-  Serial.println("Payload: " + payloadStr);
 
-  String topicStr = String(topic);
-  Serial.println("Full topic string: " + topicStr);
+  if (methodName == "feedPolicy")
+  {
+    return handleFeedPolicyMethod(payload, length, responsePayload);
+  }
 
-  int methodStart = topicStr.indexOf("POST/") + 5;
-  int methodEnd = topicStr.indexOf("/", methodStart);
+  if (methodName == "dispensePattern")
+  {
+    return handleDispensePatternMethod(payload, length, responsePayload);
+  }
 
-  Serial.printf("methodStart: %d, methodEnd: %d\n", methodStart, methodEnd);
+  if (methodName == "calibrate")
+  {
+    return handleCalibrationMethod(payload, length, responsePayload);
+  }
 
-  // Check if we found both markers
-  if (methodStart > 4 && methodEnd > methodStart)
+  if (methodName == "getStalls")
   {
-    String methodName = topicStr.substring(methodStart, methodEnd);
-    Serial.print("Method: ");
-    Serial.println(methodName);
+    return handleGetStallsMethod(responsePayload);
+  }
 
-    // Extract request ID for response
-    int ridStart = topicStr.indexOf("$rid=") + 5;
-    String requestId = topicStr.substring(ridStart);
+  if (methodName == "getStats")
+  {
+    return handleGetStatsMethod(responsePayload);
+  }
 
-    String responseTopic;
-    String responsePayload;
+  if (methodName == "logCosts")
+  {
+    return handleLogCostsMethod(responsePayload);
+  }
 
-    if (methodName == "runMotors")
-    {
-      Serial.println("Processing runMotors command...");
+  if (methodName == "trace")
+  {
+    return handleTraceMethod(payload, length, responsePayload);
+  }
 
-      // Use the exact same dispensing logic as manual button press
-      if (!feederSystem.dispensing)
-      {
-        // Call the EXACT same function as manual button press
-        Serial.println("Starting remote feeding sequence (using manual dispensing logic)...");
-        performManualFeed(); // Use the same function as manual button
-        Serial.println("Remote motors sequence executed successfully");
-
-        // Send success response
-        responseTopic = "$iothub/methods/res/200/?$rid=" + requestId;
-        responsePayload = "{\"status\":\"success\",\"message\":\"Motors started successfully\",\"dispensing\":true}";
-      }
-      else
+  if (methodName == "hopper")
+  {
+    return handleHopperMethod(payload, length, responsePayload);
+  }
+
+  if (methodName == "capture")
+  {
+    return handleCaptureMethod(payload, length, responsePayload);
+  }
+
+  if (methodName == "history")
+  {
+    return handleHistoryMethod(payload, length, responsePayload);
+  }
+
+  if (methodName == "sampling")
+  {
+    return handleSamplingMethod(payload, length, responsePayload);
+  }
+
+  if (methodName == "visits")
+  {
+    return handleVisitsMethod(payload, length, responsePayload);
+  }
+
+  if (methodName == "timezone")
+  {
+    return handleTimeZoneMethod(payload, length, responsePayload);
+  }
+
+  if (methodName == "sasKey")
+  {
+    return handleSasKeyMethod(payload, length, responsePayload);
+  }
+
+  LOGW(TAG, "Unknown method: %s", methodName.c_str());
+  responsePayload = "{\"status\":\"error\",\"message\":\"Method not found\"}";
+  return 404;
+}
+
+void handleDirectMethod(char *topic, byte *payload, unsigned int length)
+{
+  LOGD(TAG, "Direct method received on topic: %s", topic);
+  LOGD(TAG, "Payload (%u bytes): %.*s", length, (int)length, (const char *)payload);
+
+  char methodBuffer[METHOD_NAME_MAX];
+  char requestIdBuffer[REQUEST_ID_MAX];
+  bool parsed = parseMethodTopic(topic, methodBuffer, sizeof(methodBuffer),
+                                 requestIdBuffer, sizeof(requestIdBuffer));
+  String requestId = requestIdBuffer;
+
+  if (parsed)
+  {
+    String methodName = methodBuffer;
+    LOGI(TAG, "Method: %s", methodName.c_str());
+
+#if FEEDER_ROLE == FEEDER_ROLE_GATEWAY
+    // Methods addressed to a leaf are fanned out; its reply is forwarded
+    // upstream asynchronously by the gateway
+    StaticJsonDocument<256> request;
+    if (!deserializeJson(request, payload, length))
+    {
+      const char *target = request["target"] | "";
+      if (target[0] != '\0' && strcmp(target, getFeederId()) != 0)
       {
-        // Cannot dispense food - send appropriate error
-        String reason = "Motors already running";
-        Serial.println("Cannot run motors: " + reason);
+        if (forwardMethodToFeeder(target, methodName, requestId, payload, length))
+        {
+          LOGI(TAG, "Forwarded %s to feeder %s", methodName.c_str(), target);
+          return;
+        }
 
-        // Send error response with specific reason
-        responseTopic = "$iothub/methods/res/400/?$rid=" + requestId;
-        responsePayload = "{\"status\":\"error\",\"message\":\"Cannot run motors\",\"reason\":\"" + reason + "\"}";
+        String responseTopic = "$iothub/methods/res/404/?$rid=" + requestId;
+        mqttClient.publish(responseTopic.c_str(), "{\"status\":\"error\",\"message\":\"Unknown feeder\"}");
+        return;
       }
     }
-    else
+#endif
+
+    String responsePayload;
+    setMethodRequestId(requestIdBuffer);
+    int status = dispatchDirectMethod(methodName, payload, length, responsePayload);
+
+    // Too big for one publish: stream it and answer with a summary
+    if (responsePayload.length() + METHOD_RESPONSE_OVERHEAD > MQTT_BUFFER_SIZE &&
+        !streamOversizedResponse(responsePayload))
     {
-      Serial.println("Unknown method: " + methodName);
-      // Send method not found response
-      responseTopic = "$iothub/methods/res/404/?$rid=" + requestId;
-      responsePayload = "{\"status\":\"error\",\"message\":\"Method not found\"}";
+      status = 500;
     }
+    String responseTopic = "$iothub/methods/res/" + String(status) + "/?$rid=" + requestId;
 
     // Publish the response immediately
-    Serial.println("Sending response...");
-    Serial.println("Response Topic: " + responseTopic);
-    Serial.println("Response Payload: " + responsePayload);
+    LOGD(TAG, "Sending response on %s: %s", responseTopic.c_str(), responsePayload.c_str());
 
     bool published = mqttClient.publish(responseTopic.c_str(), responsePayload.c_str());
     if (published)
     {
-      Serial.println("✓ Response published successfully");
+      LOGI(TAG, "✓ Response published (%d)", status);
 
       // Force immediate transmission
       mqttClient.loop();
@@ -375,16 +766,15 @@ void handleDirectMethod(char *topic, byte *payload, unsigned int length)
     }
     else
     {
-      Serial.println("✗ Failed to publish response!");
-      Serial.printf("MQTT State: %d\n", mqttClient.state());
+      LOGE(TAG, "✗ Failed to publish response! (state %d)", mqttClient.state());
 
       // Try to reconnect and send again
       if (!mqttClient.connected())
       {
-        Serial.println("MQTT disconnected, attempting reconnection...");
+        LOGW(TAG, "MQTT disconnected, attempting reconnection...");
         if (connectMQTT())
         {
-          Serial.println("Reconnected, trying to send response again...");
+          LOGI(TAG, "Reconnected, trying to send response again...");
           mqttClient.publish(responseTopic.c_str(), responsePayload.c_str());
           mqttClient.loop();
         }
@@ -393,28 +783,24 @@ void handleDirectMethod(char *topic, byte *payload, unsigned int length)
   }
   else
   {
-    Serial.println("Could not extract method name properly");
-    Serial.printf("methodStart: %d, methodEnd: %d\n", methodStart, methodEnd);
+    LOGW(TAG, "Could not extract method name from %s", topic);
 
     // Send malformed request response
-    int ridStart = topicStr.indexOf("$rid=") + 5;
-    String requestId = topicStr.substring(ridStart);
     String responseTopic = "$iothub/methods/res/400/?$rid=" + requestId;
     String responsePayload = "{\"status\":\"error\",\"message\":\"Malformed method request\"}";
 
     bool published = mqttClient.publish(responseTopic.c_str(), responsePayload.c_str());
     if (published)
     {
-      Serial.println("✓ Error response sent for malformed request");
+      LOGI(TAG, "✓ Error response sent for malformed request");
       mqttClient.loop();
     }
     else
     {
-      Serial.println("✗ Failed to send error response");
+      LOGE(TAG, "✗ Failed to send error response");
     }
   }
 
-  Serial.println("Direct method processing complete");
 }
 
 bool verifyMessageDelivery()
@@ -440,7 +826,7 @@ void processMQTTLoop()
   else if (WiFi.status() == WL_CONNECTED)
   {
     // Try to reconnect if WiFi is still connected
-    Serial.println("MQTT disconnected, attempting reconnection...");
+    LOGW(TAG, "MQTT disconnected, attempting reconnection...");
     connectMQTT();
   }
 }
\ No newline at end of file
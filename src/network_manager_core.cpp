@@ -0,0 +1,99 @@
+#include "network_manager_core.h"
+#include <string.h>
+
+bool parseMethodTopic(const char *topic, char *methodName, size_t methodSize,
+                      char *requestId, size_t requestIdSize)
+{
+  methodName[0] = '\0';
+  requestId[0] = '\0';
+
+  // Request ID runs to the end of the topic or the next property
+  const char *rid = strstr(topic, "$rid=");
+  if (rid != nullptr)
+  {
+    rid += 5;
+    size_t ridLength = strcspn(rid, "&");
+    if (ridLength >= requestIdSize)
+      ridLength = requestIdSize - 1;
+    memcpy(requestId, rid, ridLength);
+    requestId[ridLength] = '\0';
+  }
+
+  const char *start = strstr(topic, "methods/POST/");
+  if (start == nullptr)
+    return false;
+  start += 13;
+
+  const char *end = strchr(start, '/');
+  if (end == nullptr || end == start || (size_t)(end - start) >= methodSize)
+    return false;
+
+  memcpy(methodName, start, end - start);
+  methodName[end - start] = '\0';
+  return requestId[0] != '\0';
+}
+
+bool reconnectDue(ReconnectBackoff &backoff, uint32_t nowMs)
+{
+  if (backoff.waitMs != 0 && nowMs - backoff.lastAttemptMs < backoff.waitMs)
+    return false;
+  backoff.lastAttemptMs = nowMs;
+  return true;
+}
+
+void reconnectFailed(ReconnectBackoff &backoff, bool authRejected, uint32_t random)
+{
+  if (authRejected)
+    backoff.authFailures++;
+
+  if (authRejected && backoff.authFailures >= MQTT_AUTH_FAILURE_LIMIT)
+  {
+    // Key revoked or device disabled: stop hammering the hub
+    backoff.waitMs = MQTT_AUTH_BACKOFF_MS;
+  }
+  else
+  {
+    backoff.waitMs = backoff.waitMs == 0 ? MQTT_BACKOFF_MIN_MS : backoff.waitMs * 2;
+    if (backoff.waitMs > MQTT_BACKOFF_MAX_MS)
+      backoff.waitMs = MQTT_BACKOFF_MAX_MS;
+  }
+  // Jitter keeps a site full of feeders from reconnecting in lockstep
+  backoff.waitMs += random % (backoff.waitMs / 4 + 1);
+}
+
+void reconnectSucceeded(ReconnectBackoff &backoff)
+{
+  backoff.waitMs = 0;
+  backoff.authFailures = 0;
+}
+
+ConnectOutcome mqttConnect(ReconnectBackoff &backoff, const MqttTransport &transport,
+                           uint32_t nowMs, uint32_t random)
+{
+  if (transport.connected(transport.context))
+    return CONNECT_ALREADY;
+  if (!reconnectDue(backoff, nowMs))
+    return CONNECT_NOT_DUE;
+
+  ConnectOutcome outcome = transport.connect(transport.context);
+  if (outcome == CONNECT_OK)
+    reconnectSucceeded(backoff);
+  else
+    reconnectFailed(backoff, outcome == CONNECT_REJECTED, random);
+  return outcome;
+}
+
+ConnectOutcome mqttConnectForPublish(ReconnectBackoff &backoff, unsigned long &lastReconnectMs,
+                                     const MqttTransport &transport, uint32_t nowMs,
+                                     uint32_t random)
+{
+  if (transport.connected(transport.context))
+    return CONNECT_ALREADY;
+
+  // Change-triggered reports can come every few seconds; only block on a
+  // reconnect once per interval
+  if (lastReconnectMs != 0 && (uint32_t)(nowMs - (uint32_t)lastReconnectMs) < MQTT_RECONNECT_INTERVAL)
+    return CONNECT_NOT_DUE;
+  lastReconnectMs = nowMs;
+  return mqttConnect(backoff, transport, nowMs, random);
+}
@@ -0,0 +1,141 @@
+#include "presence.h"
+#include "json_pool.h"
+#include "sensor_manager.h"
+#include "calendar.h"
+#include "trace_recorder.h"
+#include "history_store.h"
+#include "logger.h"
+#include <ArduinoJson.h>
+
+static const char *TAG = "presence";
+
+// Single producer (ISR) / single consumer (loop)
+static PirEdge edgeRing[PIR_EDGE_RING];
+static volatile uint8_t edgeHead = 0;
+static volatile uint8_t edgeTail = 0;
+static volatile uint32_t edgeOverflows = 0;
+
+static VisitHistogram visitHistogram;
+static Visit visitLog[VISIT_LOG_SIZE];
+static uint8_t visitLogNext = 0;
+static PresenceStats presenceStats;
+
+static void IRAM_ATTR pirEdgeIsr()
+{
+  uint8_t head = edgeHead;
+  uint8_t next = (head + 1) & (PIR_EDGE_RING - 1);
+  if (next == edgeTail)
+  {
+    edgeOverflows++;
+    return;
+  }
+  edgeRing[head].millis = millis();
+  edgeRing[head].level = digitalRead(PIR_PIN);
+  edgeHead = next;
+}
+
+// Hours since 1970 on the local clock; uptime hours without a clock
+static uint32_t currentLocalHour(uint32_t epoch)
+{
+  if (epoch == 0)
+    return millis() / 3600000UL;
+  return (epoch + getUtcOffset(epoch)) / 3600;
+}
+
+static void recordVisit(Visit &visit, uint32_t nowMillis)
+{
+  uint32_t epoch = currentEpoch();
+  if (epoch != 0)
+    visit.startEpoch = epoch - (nowMillis - sensorCore.presence.startMillis) / 1000;
+
+  visitLog[visitLogNext] = visit;
+  visitLogNext = (visitLogNext + 1) % VISIT_LOG_SIZE;
+  histogramAddVisit(visitHistogram, currentLocalHour(epoch), visit.durationMs / 1000);
+
+  presenceStats.visits++;
+  presenceStats.lastVisit = visit;
+  recordHistory(HISTORY_VISIT, 1.0f);
+  LOGI(TAG, "Visit: %lu s, %u motion pulses, bowl %+.1f g",
+       (unsigned long)(visit.durationMs / 1000), visit.motionEdges, -visit.bowlDeltaGrams);
+}
+
+void setupPresence()
+{
+  sensorCore.presence.motion = digitalRead(PIR_PIN) == HIGH;
+  if (sensorCore.presence.motion)
+  {
+    PirEdge edge = {(uint32_t)millis(), 1};
+    sensorPirStep(sensorCore, edge);
+  }
+  attachInterrupt(digitalPinToInterrupt(PIR_PIN), pirEdgeIsr, CHANGE);
+  Serial.println("✓ PIR edge capture enabled");
+}
+
+void handlePresence()
+{
+  while (edgeTail != edgeHead)
+  {
+    PirEdge edge = edgeRing[edgeTail];
+    edgeTail = (edgeTail + 1) & (PIR_EDGE_RING - 1);
+
+    presenceStats.edges++;
+    tracePirLevel(edge.level);
+    sensorPirStep(sensorCore, edge);
+  }
+  presenceStats.edgeOverflows = edgeOverflows;
+
+  uint32_t now = millis();
+  Visit visit;
+  if (sensorPresenceStep(sensorCore, now, visit))
+    recordVisit(visit, now);
+
+  setMotionDetected(sensorCore.presence.motion);
+  setPetPresent(sensorCore.presence.active);
+  if (sensorCore.presence.motion)
+    timing.lastMotionTime = now;
+}
+
+uint16_t getVisitsLast24h()
+{
+  uint32_t hour = currentLocalHour(currentEpoch());
+  return histogramVisitsSince(visitHistogram, hour >= VISIT_HOURS - 1 ? hour - (VISIT_HOURS - 1) : 0);
+}
+
+const PresenceStats &getPresenceStats()
+{
+  return presenceStats;
+}
+
+// {} -> recent visits (newest first) and visits per local hour over the last day
+int handleVisitsMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  doc["visits24h"] = getVisitsLast24h();
+  doc["edgeOverflows"] = presenceStats.edgeOverflows;
+
+  JsonArray visits = doc.createNestedArray("visits");
+  for (uint8_t i = 1; i <= VISIT_LOG_SIZE; i++)
+  {
+    const Visit &visit = visitLog[(visitLogNext + VISIT_LOG_SIZE - i) % VISIT_LOG_SIZE];
+    if (visit.durationMs == 0 && visit.motionEdges == 0)
+      break; // Unused slot
+    JsonObject entry = visits.createNestedObject();
+    entry["start"] = visit.startEpoch;
+    entry["s"] = visit.durationMs / 1000;
+    entry["pulses"] = visit.motionEdges;
+    entry["grams"] = roundf(visit.bowlDeltaGrams * 10) / 10;
+  }
+
+  // Bucket h is local hour of day h; buckets older than a day read as zero
+  uint32_t hour = currentLocalHour(currentEpoch());
+  JsonArray hourly = doc.createNestedArray("hourly");
+  for (uint8_t h = 0; h < VISIT_HOURS; h++)
+  {
+    bool fresh = hour - visitHistogram.hourStamp[h] < VISIT_HOURS;
+    hourly.add(fresh ? visitHistogram.visits[h] : 0);
+  }
+
+  serializeJson(doc, responsePayload);
+  return 200;
+}
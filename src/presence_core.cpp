@@ -0,0 +1,57 @@
+#include "presence_core.h"
+
+void presenceOnEdge(PresenceTracker &tracker, const PirEdge &edge, float weight)
+{
+  if (edge.level)
+  {
+    if (!tracker.active)
+    {
+      tracker.active = true;
+      tracker.startMillis = edge.millis;
+      tracker.startWeight = weight;
+      tracker.motionEdges = 0;
+    }
+    tracker.motionEdges++;
+  }
+  tracker.motion = edge.level != 0;
+  tracker.lastMotionMillis = edge.millis;
+}
+
+bool presenceCheckEnd(PresenceTracker &tracker, uint32_t nowMillis, float weight,
+                      uint32_t endGapMs, Visit &visit)
+{
+  if (!tracker.active || tracker.motion || nowMillis - tracker.lastMotionMillis < endGapMs)
+    return false;
+
+  visit.startEpoch = 0;
+  visit.durationMs = tracker.lastMotionMillis - tracker.startMillis;
+  visit.motionEdges = tracker.motionEdges;
+  visit.bowlDeltaGrams = tracker.startWeight - weight;
+  tracker.active = false;
+  return true;
+}
+
+void histogramAddVisit(VisitHistogram &histogram, uint32_t absoluteHour, uint32_t seconds)
+{
+  uint8_t bucket = absoluteHour % VISIT_HOURS;
+  if (histogram.hourStamp[bucket] != absoluteHour)
+  {
+    // Bucket still holds the same hour of an earlier day
+    histogram.hourStamp[bucket] = absoluteHour;
+    histogram.visits[bucket] = 0;
+    histogram.seconds[bucket] = 0;
+  }
+  histogram.visits[bucket]++;
+  histogram.seconds[bucket] += seconds;
+}
+
+uint16_t histogramVisitsSince(const VisitHistogram &histogram, uint32_t absoluteHour)
+{
+  uint16_t total = 0;
+  for (uint8_t i = 0; i < VISIT_HOURS; i++)
+  {
+    if (histogram.visits[i] > 0 && histogram.hourStamp[i] >= absoluteHour)
+      total += histogram.visits[i];
+  }
+  return total;
+}
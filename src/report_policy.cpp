@@ -0,0 +1,82 @@
+#include "report_policy.h"
+
+// Weight as last reported upstream; every other channel is a change bit
+static bool hasReported = false;
+static float reportedWeight = 0.0;
+static unsigned long lastReportMillis = 0;
+
+static ReportStats reportStats;
+
+uint8_t getPendingReportTriggers(unsigned long currentMillis)
+{
+  if (!hasReported)
+    return REPORT_HEARTBEAT; // First report after boot
+
+  uint8_t triggers = REPORT_NONE;
+  uint8_t changes = sensors.changes;
+
+  // Weight is noisy: a deadband against the reported value, not a change bit
+  if (fabs(sensors.weight - reportedWeight) >= REPORT_WEIGHT_DEADBAND)
+    triggers |= REPORT_WEIGHT;
+
+  if (changes & CHANGE_FOOD_LEVEL)
+    triggers |= REPORT_LEVEL;
+
+  if (changes & CHANGE_PET_PRESENT)
+    triggers |= REPORT_MOTION;
+
+  if (changes & CHANGE_DISPENSING)
+    triggers |= REPORT_FEEDING;
+
+  if (currentMillis - lastReportMillis >= REPORT_HEARTBEAT_INTERVAL)
+    triggers |= REPORT_HEARTBEAT;
+
+  return triggers;
+}
+
+bool isReportRateLimited(unsigned long currentMillis)
+{
+  if (hasReported && currentMillis - lastReportMillis < REPORT_MIN_INTERVAL)
+  {
+    reportStats.rateLimited++;
+    return true;
+  }
+  return false;
+}
+
+void markReportSent(uint8_t triggers, unsigned long currentMillis)
+{
+  hasReported = true;
+  reportedWeight = sensors.weight;
+  sensors.changes = 0;
+  lastReportMillis = currentMillis;
+
+  reportStats.published++;
+  if (triggers == REPORT_HEARTBEAT)
+    reportStats.heartbeats++;
+  else
+    reportStats.changeReports++;
+}
+
+void describeReportTriggers(uint8_t triggers, char *buffer, size_t size)
+{
+  static const char *names[] = {"weight", "level", "motion", "feeding", "heartbeat"};
+
+  size_t used = 0;
+  buffer[0] = '\0';
+  for (size_t i = 0; i < ARRAY_SIZE(names); i++)
+  {
+    if (triggers & (1 << i))
+    {
+      int written = snprintf(buffer + used, size - used, "%s%s", used ? "," : "", names[i]);
+      if (written < 0 || (size_t)written >= size - used)
+        break;
+      used += written;
+    }
+  }
+}
+
+const ReportStats &getReportStats()
+{
+  return reportStats;
+}
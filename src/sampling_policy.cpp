@@ -0,0 +1,171 @@
+#include "sampling_policy.h"
+#include "json_pool.h"
+#include "web_server.h"
+#include "dispense_capture.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <ArduinoJson.h>
+
+static const char *TAG = "sampling";
+
+static Preferences samplingPrefs;
+static SamplingPolicy samplingPolicy = defaultSamplingPolicy;
+static SamplingStats samplingStats;
+static uint32_t hopperActiveMillis = 0;
+static unsigned long loadSinceMillis = 0;
+
+static const char *modeKeys[] = {"idle", "presence", "dispense"};
+
+void setupSamplingPolicy()
+{
+  SamplingPolicy stored;
+  samplingPrefs.begin(SAMPLING_NVS_NAMESPACE, true);
+  size_t length = samplingPrefs.getBytes("policy", &stored, sizeof(stored));
+  samplingPrefs.end();
+
+  if (length == sizeof(stored) && stored.version == SAMPLING_POLICY_VERSION)
+  {
+    samplingPolicy = stored;
+    LOGI(TAG, "✓ Sampling policy loaded: idle weight %lu ms, level %lu ms",
+         (unsigned long)samplingPolicy.rates[SAMPLING_IDLE].weightMs,
+         (unsigned long)samplingPolicy.rates[SAMPLING_IDLE].ultrasonicMs);
+  }
+  loadSinceMillis = millis();
+}
+
+const SamplingRates &updateSamplingMode()
+{
+  // Someone watching the live dashboard wants fresh weights too
+  SamplingMode mode = samplingModeAt(hopperActiveMillis, millis(),
+                                     feederSystem.dispensing || feederSystem.refillMode,
+                                     feederSystem.animalDetected || getWebServerStats().clients > 0);
+  if (mode != samplingStats.mode)
+  {
+    LOGD(TAG, "Sampling %s -> %s", getSamplingModeName(samplingStats.mode), getSamplingModeName(mode));
+    samplingStats.mode = mode;
+    samplingStats.modeChanges++;
+  }
+  return samplingPolicy.rates[mode];
+}
+
+const SamplingRates &getSamplingRates()
+{
+  return samplingPolicy.rates[samplingStats.mode];
+}
+
+void recordWeightSample(uint32_t busyUs, uint8_t readings)
+{
+  samplingStats.weightReads++;
+  // An average of the sampler's ring, not a chip read; the sampler counts those
+  if (isScaleSamplerRunning())
+    return;
+  samplingStats.weightConversions += readings;
+  samplingStats.weightBusyUs += busyUs;
+}
+
+void recordWeightConversion(uint32_t busyUs)
+{
+  // The sampler is then the only writer of these two
+  samplingStats.weightConversions++;
+  samplingStats.weightBusyUs += busyUs;
+}
+
+void recordUltrasonicSample(uint32_t busyUs)
+{
+  samplingStats.ultrasonicReads++;
+  samplingStats.ultrasonicBusyUs += busyUs;
+}
+
+void getSamplingLoad(float &busyPercent, float &fixedRatePercent)
+{
+  samplingLoad(samplingStats, millis() - loadSinceMillis, busyPercent, fixedRatePercent);
+}
+
+const SamplingStats &getSamplingStats()
+{
+  return samplingStats;
+}
+
+static void samplingPolicyJson(String &responsePayload)
+{
+  float busyPercent, fixedRatePercent;
+  getSamplingLoad(busyPercent, fixedRatePercent);
+
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  doc["mode"] = getSamplingModeName(samplingStats.mode);
+  for (uint8_t m = 0; m < SAMPLING_MODE_COUNT; m++)
+  {
+    JsonObject rates = doc.createNestedObject(modeKeys[m]);
+    rates["weightMs"] = samplingPolicy.rates[m].weightMs;
+    rates["ultrasonicMs"] = samplingPolicy.rates[m].ultrasonicMs;
+    rates["weightReadings"] = samplingPolicy.rates[m].weightReadings;
+  }
+  doc["busyPercent"] = busyPercent;
+  doc["fixedRatePercent"] = fixedRatePercent;
+  doc["weightReads"] = samplingStats.weightReads;
+  doc["weightConversions"] = samplingStats.weightConversions;
+  doc["weightSource"] = isScaleSamplerRunning() ? "sampler" : "loop";
+  doc["ultrasonicReads"] = samplingStats.ultrasonicReads;
+  doc["modeChanges"] = samplingStats.modeChanges;
+  serializeJson(doc, responsePayload);
+}
+
+// {"action":"get"} or {"action":"set","idle":{"weightMs":n,"ultrasonicMs":n,"weightReadings":n},...}
+// "reset" restores the built-in rates and restarts the load measurement
+int handleSamplingMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<384> request;
+  if (deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  String action = request["action"] | "get";
+
+  if (action == "set")
+  {
+    SamplingPolicy updated = samplingPolicy;
+    for (uint8_t m = 0; m < SAMPLING_MODE_COUNT; m++)
+    {
+      JsonVariant rates = request[modeKeys[m]];
+      if (rates.isNull())
+        continue;
+      updated.rates[m].weightMs = rates["weightMs"] | updated.rates[m].weightMs;
+      updated.rates[m].ultrasonicMs = rates["ultrasonicMs"] | updated.rates[m].ultrasonicMs;
+      updated.rates[m].weightReadings = rates["weightReadings"] | updated.rates[m].weightReadings;
+      if (!samplingRatesValid(updated.rates[m]))
+      {
+        responsePayload = "{\"status\":\"error\",\"message\":\"Rates out of range\"}";
+        return 400;
+      }
+    }
+
+    samplingPolicy = updated;
+    samplingPrefs.begin(SAMPLING_NVS_NAMESPACE, false);
+    samplingPrefs.putBytes("policy", &samplingPolicy, sizeof(samplingPolicy));
+    samplingPrefs.end();
+    LOGI(TAG, "Sampling policy updated");
+  }
+  else if (action == "reset")
+  {
+    samplingPolicy = defaultSamplingPolicy;
+    samplingPrefs.begin(SAMPLING_NVS_NAMESPACE, false);
+    samplingPrefs.remove("policy");
+    samplingPrefs.end();
+
+    SamplingMode mode = samplingStats.mode;
+    samplingStats = SamplingStats();
+    samplingStats.mode = mode;
+    loadSinceMillis = millis();
+  }
+  else if (action != "get")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown sampling action\"}";
+    return 400;
+  }
+
+  samplingPolicyJson(responsePayload);
+  return 200;
+}
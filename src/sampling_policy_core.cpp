@@ -0,0 +1,66 @@
+#include "sampling_policy_core.h"
+
+const SamplingPolicy defaultSamplingPolicy = {
+    SAMPLING_POLICY_VERSION,
+    0,
+    {
+        {2000, 60000, SCALE_READINGS, {}},      // Idle
+        {200, 60000, 1, {}},                    // Presence; the hopper is untouched
+        {200, ULTRASONIC_READ_INTERVAL, 1, {}}, // Dispense
+    },
+};
+
+SamplingMode selectSamplingMode(bool hopperActive, bool petPresent)
+{
+  if (hopperActive)
+    return SAMPLING_DISPENSE;
+  return petPresent ? SAMPLING_PRESENCE : SAMPLING_IDLE;
+}
+
+SamplingMode samplingModeAt(uint32_t &hopperActiveMillis, uint32_t nowMs, bool hopperBusy,
+                            bool petPresent)
+{
+  if (hopperBusy)
+    hopperActiveMillis = nowMs;
+  bool hopperActive = hopperActiveMillis != 0 && nowMs - hopperActiveMillis < SAMPLING_DISPENSE_LINGER_MS;
+  return selectSamplingMode(hopperActive, petPresent);
+}
+
+// Meal tracking keeps sample gaps in 16 bits, hence the 60 s weight limit
+bool samplingRatesValid(const SamplingRates &rates)
+{
+  return rates.weightMs >= 100 && rates.weightMs <= 60000 &&
+         rates.ultrasonicMs >= 100 && rates.ultrasonicMs <= 600000 &&
+         rates.weightReadings >= 1 && rates.weightReadings <= 10;
+}
+
+const char *getSamplingModeName(SamplingMode mode)
+{
+  static const char *names[] = {"IDLE", "PRESENCE", "DISPENSE"};
+  return mode < sizeof(names) / sizeof(names[0]) ? names[mode] : "UNKNOWN";
+}
+
+void samplingLoad(const SamplingStats &stats, uint32_t elapsedMs, float &busyPercent,
+                  float &fixedRatePercent)
+{
+  busyPercent = 0.0f;
+  fixedRatePercent = 0.0f;
+  float elapsedUs = elapsedMs * 1000.0f;
+  if (elapsedUs <= 0.0f)
+    return;
+
+  busyPercent = 100.0f * (stats.weightBusyUs + stats.ultrasonicBusyUs) / elapsedUs;
+
+  float fixedUs = 0.0f;
+  if (stats.weightConversions > 0)
+  {
+    float perConversionUs = (float)stats.weightBusyUs / stats.weightConversions;
+    fixedUs += elapsedUs / (WEIGHT_READ_INTERVAL * 1000.0f) * SCALE_READINGS * perConversionUs;
+  }
+  if (stats.ultrasonicReads > 0)
+  {
+    float perEchoUs = (float)stats.ultrasonicBusyUs / stats.ultrasonicReads;
+    fixedUs += elapsedUs / (ULTRASONIC_READ_INTERVAL * 1000.0f) * perEchoUs;
+  }
+  fixedRatePercent = 100.0f * fixedUs / elapsedUs;
+}
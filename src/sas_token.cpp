@@ -0,0 +1,152 @@
+#include "sas_token.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include <mbedtls/md.h>
+#include <mbedtls/base64.h>
+#include <time.h>
+
+static const char *TAG = "sas";
+
+static Preferences sasPrefs;
+static uint8_t sasKey[SAS_KEY_MAX];
+static size_t sasKeyLength = 0;
+static char sasToken[SAS_TOKEN_MAX];
+static uint32_t sasExpiry = 0; // 0 = no generated token yet
+
+static bool hmacSha256(const uint8_t *key, size_t keyLength, const uint8_t *message,
+                       size_t messageLength, uint8_t *digest)
+{
+  return mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), key, keyLength,
+                         message, messageLength, digest) == 0;
+}
+
+size_t buildSasToken(const uint8_t *key, size_t keyLength, const char *resourceUri,
+                     uint32_t expiry, char *out, size_t outSize)
+{
+  return buildSasToken(hmacSha256, key, keyLength, resourceUri, expiry, out, outSize);
+}
+
+static bool decodeKey(const char *base64Key, uint8_t *key, size_t *keyLength)
+{
+  return mbedtls_base64_decode(key, SAS_KEY_MAX, keyLength, (const uint8_t *)base64Key,
+                               strlen(base64Key)) == 0 &&
+         *keyLength > 0;
+}
+
+static bool storeKey(const char *base64Key)
+{
+  uint8_t key[SAS_KEY_MAX];
+  size_t keyLength = 0;
+  if (!decodeKey(base64Key, key, &keyLength))
+    return false;
+
+  memcpy(sasKey, key, keyLength);
+  sasKeyLength = keyLength;
+  sasPrefs.begin(SAS_NVS_NAMESPACE, false);
+  sasPrefs.putBytes("key", sasKey, sasKeyLength);
+  sasPrefs.end();
+  return true;
+}
+
+void setupSasToken()
+{
+  sasPrefs.begin(SAS_NVS_NAMESPACE, true);
+  sasKeyLength = sasPrefs.getBytes("key", sasKey, sizeof(sasKey));
+  sasPrefs.end();
+
+  // First boot with a key in secrets.h: move it into NVS
+  if (sasKeyLength == 0 && strlen(SAS_KEY) > 0)
+  {
+    if (storeKey(SAS_KEY))
+      Serial.println("✓ Device key provisioned from secrets.h");
+    else
+      Serial.println("✗ ENV_SAS_KEY is not valid base64");
+  }
+
+  if (sasKeyLength == 0)
+  {
+    Serial.println("⚠️ No device key - using the static SAS token");
+    return;
+  }
+
+  if (refreshSasToken())
+    Serial.println("✓ SAS token generated on device");
+  else
+    Serial.println("⚠️ SAS token not generated yet (clock not synced)");
+}
+
+bool refreshSasToken()
+{
+  time_t now = time(nullptr);
+  if (sasKeyLength == 0 || now < 1600000000)
+    return false;
+
+  uint32_t expiry = (uint32_t)now + SAS_TOKEN_TTL_S;
+  char token[SAS_TOKEN_MAX];
+  if (buildSasToken(sasKey, sasKeyLength, MQTT_SERVER "/devices/" DEVICE_ID, expiry,
+                    token, sizeof(token)) == 0)
+  {
+    LOGE(TAG, "✗ SAS token does not fit in %d bytes", SAS_TOKEN_MAX);
+    return false;
+  }
+
+  strcpy(sasToken, token);
+  sasExpiry = expiry;
+  LOGI(TAG, "SAS token renewed, expires in %lu s", (unsigned long)SAS_TOKEN_TTL_S);
+  return true;
+}
+
+bool isSasRenewalDue()
+{
+  if (sasKeyLength == 0)
+    return false;
+  time_t now = time(nullptr);
+  if (now < 1600000000)
+    return false;
+  return sasExpiry == 0 || (uint32_t)now + SAS_RENEW_BEFORE_S >= sasExpiry;
+}
+
+const char *getSasToken()
+{
+  return sasExpiry != 0 ? sasToken : SAS_TOKEN;
+}
+
+// {"action":"status"} or {"action":"set","key":"<base64 device key>"}
+int handleSasKeyMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<192> request;
+  if (deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  String action = request["action"] | "status";
+
+  if (action == "set")
+  {
+    const char *key = request["key"] | "";
+    if (!storeKey(key))
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Key must be base64\"}";
+      return 400;
+    }
+    sasExpiry = 0; // Next idle pass reconnects with a token from the new key
+    LOGI(TAG, "Device key rotated (%u bytes)", (unsigned)sasKeyLength);
+  }
+  else if (action != "status")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown key action\"}";
+    return 400;
+  }
+
+  time_t now = time(nullptr);
+  long expiresIn = sasExpiry != 0 ? (long)sasExpiry - (long)now : 0;
+  char json[128];
+  snprintf(json, sizeof(json),
+           "{\"status\":\"success\",\"hasKey\":%s,\"generated\":%s,\"expiresIn\":%ld}",
+           sasKeyLength > 0 ? "true" : "false", sasExpiry != 0 ? "true" : "false", expiresIn);
+  responsePayload = json;
+  return 200;
+}
@@ -0,0 +1,88 @@
+#include "sas_token_core.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+size_t urlEncode(const char *in, size_t inLength, char *out, size_t outSize)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  size_t n = 0;
+  for (size_t i = 0; i < inLength; i++)
+  {
+    char c = in[i];
+    if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~')
+    {
+      if (n + 1 >= outSize)
+        return 0;
+      out[n++] = c;
+    }
+    else
+    {
+      if (n + 3 >= outSize)
+        return 0;
+      out[n++] = '%';
+      out[n++] = hex[(uint8_t)c >> 4];
+      out[n++] = hex[(uint8_t)c & 0x0F];
+    }
+  }
+  out[n] = '\0';
+  return n;
+}
+
+size_t base64Encode(const uint8_t *in, size_t inLength, char *out, size_t outSize)
+{
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t length = (inLength + 2) / 3 * 4;
+  if (length >= outSize)
+    return 0;
+
+  size_t n = 0;
+  for (size_t i = 0; i < inLength; i += 3)
+  {
+    uint32_t block = (uint32_t)in[i] << 16;
+    if (i + 1 < inLength)
+      block |= (uint32_t)in[i + 1] << 8;
+    if (i + 2 < inLength)
+      block |= in[i + 2];
+
+    out[n++] = alphabet[block >> 18 & 0x3F];
+    out[n++] = alphabet[block >> 12 & 0x3F];
+    out[n++] = i + 1 < inLength ? alphabet[block >> 6 & 0x3F] : '=';
+    out[n++] = i + 2 < inLength ? alphabet[block & 0x3F] : '=';
+  }
+  out[n] = '\0';
+  return n;
+}
+
+size_t buildSasToken(SasHmac hmac, const uint8_t *key, size_t keyLength, const char *resourceUri,
+                     uint32_t expiry, char *out, size_t outSize)
+{
+  char encodedUri[160];
+  size_t uriLength = urlEncode(resourceUri, strlen(resourceUri), encodedUri, sizeof(encodedUri));
+  if (uriLength == 0)
+    return 0;
+
+  // String to sign: url-encoded resource URI, newline, expiry
+  char toSign[180];
+  int signLength = snprintf(toSign, sizeof(toSign), "%s\n%lu", encodedUri, (unsigned long)expiry);
+  if (signLength < 0 || (size_t)signLength >= sizeof(toSign))
+    return 0;
+
+  uint8_t digest[SAS_DIGEST_BYTES];
+  if (!hmac(key, keyLength, (const uint8_t *)toSign, signLength, digest))
+    return 0;
+
+  char signature[48];
+  size_t signatureLength = base64Encode(digest, sizeof(digest), signature, sizeof(signature));
+  if (signatureLength == 0)
+    return 0;
+
+  char encodedSignature[136]; // Worst case: every base64 char escaped
+  if (urlEncode(signature, signatureLength, encodedSignature, sizeof(encodedSignature)) == 0)
+    return 0;
+
+  int length = snprintf(out, outSize, "SharedAccessSignature sr=%s&sig=%s&se=%lu",
+                        encodedUri, encodedSignature, (unsigned long)expiry);
+  return length > 0 && (size_t)length < outSize ? length : 0;
+}
@@ -1,118 +1,126 @@
 #include "sensor_manager.h"
 #include "feeding_control.h" // Access getFeedingStatus()
 #include "load_cell.h"       // Add this to use the new load cell functions
+#include "stall_watchdog.h"
+#include "trace_recorder.h"
+#include "logger.h"
+#include "presence.h"
+#include "hopper_model.h"
+#include "sampling_policy.h"
+#include "history_store.h"
+
+static const char *TAG = "sensors";
+
+SensorCore sensorCore;
 
 void handleSensors()
 {
+  STALL_REGION(REGION_SENSORS);
   unsigned long currentMillis = millis();
+  const SamplingRates &rates = updateSamplingMode();
 
   // Read ultrasonic sensor
-  if (currentMillis - timing.lastUltrasonicRead >= ULTRASONIC_READ_INTERVAL)
+  if (currentMillis - timing.lastUltrasonicRead >= rates.ultrasonicMs)
   {
-    sensors.distance = readUltrasonicDistance();
-    String level = getFoodLevel(sensors.distance);
-    strcpy(sensors.foodLevel, level.c_str()); // Copy String to char array
+    uint32_t startMicros = micros();
+    unsigned long echo = readUltrasonicEcho();
+    recordUltrasonicSample(micros() - startMicros);
+    // pulseIn() returns 0 on timeout; keep the last level instead of reading "full"
+    if (sensorEchoStep(sensorCore, echo))
+    {
+      sensors.distance = sensorCore.distance;
+      setFoodLevel(sensorCore.foodLevel);
+      updateHopperLevel(sensors.distance);
+      recordHistory(HISTORY_HOPPER, getHopperStats().grams);
+    }
     timing.lastUltrasonicRead = currentMillis;
   }
 
-  // Read weight sensor
-  if (currentMillis - timing.lastWeightRead >= WEIGHT_READ_INTERVAL)
+  // Read weight sensor (also feeds the meal tracker)
+  if (currentMillis - timing.lastWeightRead >= rates.weightMs)
   {
-    if (scale.is_ready())
+    if (isScaleReady())
     {
-      sensors.weight = getWeight();
-      String status = getBowlStatus(sensors.weight);
-      strcpy(sensors.bowlStatus, status.c_str()); // Copy String to char array
+      uint32_t startMicros = micros();
+      updateBowlWeight(rates.weightReadings);
+      recordWeightSample(micros() - startMicros, rates.weightReadings);
+      recordHistory(HISTORY_WEIGHT, sensors.weight);
     }
     timing.lastWeightRead = currentMillis;
   }
 
-  // Read PIR sensor
-  sensors.motionDetected = digitalRead(PIR_PIN);
-  if (sensors.motionDetected)
-  {
-    feederSystem.animalDetected = true;
-    timing.lastMotionTime = currentMillis;
-  }
-  else if (currentMillis - timing.lastMotionTime > PIR_TIMEOUT)
-  {
-    feederSystem.animalDetected = false;
-  }
+  // PIR edges arrive by interrupt; fold them into visits
+  handlePresence();
 
   // Update feeding status
-  String status = getFeedingStatus();
-  strcpy(sensors.feedingStatus, status.c_str()); // Copy String to char array
+  setFeedingStatus(getFeedingStatus());
 }
 
-float readUltrasonicDistance()
+unsigned long readUltrasonicEcho()
 {
+  STALL_REGION(REGION_ULTRASONIC);
+
   digitalWrite(ULTRASONIC_TRIG_PIN, LOW);
   delayMicroseconds(2);
   digitalWrite(ULTRASONIC_TRIG_PIN, HIGH);
   delayMicroseconds(10);
   digitalWrite(ULTRASONIC_TRIG_PIN, LOW);
 
-  long duration = pulseIn(ULTRASONIC_ECHO_PIN, HIGH);
-  float distanceCm = duration * 0.034 / 2;
-
-  // Return directly in cm to avoid unit confusion
-  return distanceCm;
+  unsigned long duration = pulseIn(ULTRASONIC_ECHO_PIN, HIGH);
+  traceEchoMicros(duration);
+  return duration;
 }
 
-String getFoodLevel(float distanceCm)
+void setFoodLevel(FoodLevel level)
 {
-  // Use constants from config.h and implement the exact logic requested
-  if (distanceCm <= FOOD_FULL_DISTANCE) // ≤ 9cm
+  if (level != sensors.foodLevel)
   {
-    return String(FOOD_LEVEL_FULL);
+    sensors.foodLevel = level;
+    sensors.changes |= CHANGE_FOOD_LEVEL;
   }
-  else if (distanceCm <= FOOD_HALF_DISTANCE && distanceCm >= FOOD_EMPTY_DISTANCE) // > 9cm and ≤ 13.5cm
+}
+
+void setBowlStatus(BowlStatus status)
+{
+  if (status != sensors.bowlStatus)
   {
-    return String(FOOD_LEVEL_HALF);
+    sensors.bowlStatus = status;
+    sensors.changes |= CHANGE_BOWL_STATUS;
   }
-  else // > 18cm
+}
+
+void setFeedingStatus(FeedingStatus status)
+{
+  if (status != sensors.feedingStatus)
   {
-    return String(FOOD_LEVEL_EMPTY);
+    sensors.feedingStatus = status;
+    sensors.changes |= CHANGE_FEEDING_STATUS;
   }
 }
 
-String getBowlStatus(float currentWeight)
+void setMotionDetected(bool motion)
 {
-  if (currentWeight <= EMPTY_BOWL_THRESHOLD)
-    return String(BOWL_STATUS_EMPTY);
-
-  if (currentWeight >= FULL_BOWL_THRESHOLD)
-    return String(BOWL_STATUS_FULL);
-
-  return String(BOWL_STATUS_PARTIAL);
+  if (motion != sensors.motionDetected)
+  {
+    sensors.motionDetected = motion;
+    sensors.changes |= CHANGE_MOTION;
+  }
 }
 
-void updateLoadCellReading()
+void setPetPresent(bool present)
 {
-  if (scale.is_ready())
+  if (present != feederSystem.animalDetected)
   {
-    float weight = getWeight(); // Use new function
-    sensors.weight = weight;
-    Serial.printf("Load Cell Weight: %.2f grams\n", weight);
-
-    // Optional: Set bowl status based on weight
-    if (weight < 10.0)
-    {
-      strcpy(sensors.bowlStatus, "Empty");
-    }
-    else if (weight < 50.0)
-    {
-      strcpy(sensors.bowlStatus, "Low");
-    }
-    else
-    {
-      strcpy(sensors.bowlStatus, "OK");
-    }
+    feederSystem.animalDetected = present;
+    sensors.changes |= CHANGE_PET_PRESENT;
   }
-  else
+}
+
+void setDispensing(bool dispensing)
+{
+  if (dispensing != feederSystem.dispensing)
   {
-    Serial.println("HX711 not ready.");
-    sensors.weight = -1;
-    strcpy(sensors.bowlStatus, "Error");
+    feederSystem.dispensing = dispensing;
+    sensors.changes |= CHANGE_DISPENSING;
   }
 }
@@ -0,0 +1,87 @@
+#include "sensor_manager_core.h"
+
+float echoToDistanceCm(unsigned long echoMicros)
+{
+  // Sound travels 0.034 cm/us; the echo covers the distance twice
+  return echoMicros * 0.034 / 2;
+}
+
+FoodLevel getFoodLevel(float distanceCm)
+{
+  // Thresholds come from the active board profile
+  if (distanceCm <= FOOD_FULL_DISTANCE) // ≤ 9cm
+  {
+    return FOOD_LEVEL_FULL;
+  }
+  else if (distanceCm <= FOOD_EMPTY_DISTANCE) // > 9cm and ≤ 18cm (half mark at 13.5cm)
+  {
+    return FOOD_LEVEL_HALF;
+  }
+  else // > 18cm
+  {
+    return FOOD_LEVEL_EMPTY;
+  }
+}
+
+BowlStatus getBowlStatus(float currentWeight)
+{
+  if (currentWeight <= EMPTY_BOWL_THRESHOLD)
+    return BOWL_STATUS_EMPTY;
+
+  if (currentWeight >= FULL_BOWL_THRESHOLD)
+    return BOWL_STATUS_FULL;
+
+  return BOWL_STATUS_PARTIAL;
+}
+
+const char *getFoodLevelName(FoodLevel level)
+{
+  static const char *names[] = {"EMPTY", "HALF", "FULL"};
+  return level < sizeof(names) / sizeof(names[0]) ? names[level] : "UNKNOWN";
+}
+
+const char *getBowlStatusName(BowlStatus status)
+{
+  static const char *names[] = {"EMPTY", "PARTIAL", "FULL", "ERROR"};
+  return status < sizeof(names) / sizeof(names[0]) ? names[status] : "UNKNOWN";
+}
+
+const char *getFeedingStatusName(FeedingStatus status)
+{
+  static const char *names[] = {"Ready to feed", "Daily limit reached", "Too soon", "No food",
+                                "REFILL MODE"};
+  return status < sizeof(names) / sizeof(names[0]) ? names[status] : "Unknown";
+}
+
+bool sensorEchoStep(SensorCore &core, unsigned long echoMicros)
+{
+  if (echoMicros == 0)
+    return false;
+  core.distance = echoToDistanceCm(echoMicros);
+  core.foodLevel = getFoodLevel(core.distance);
+  return true;
+}
+
+bool sensorWeightStep(SensorCore &core, uint32_t nowMs, float weight, bool dispensing,
+                      MealEvent &meal)
+{
+  core.weight = weight;
+  core.bowlStatus = getBowlStatus(weight);
+  return mealTrackerUpdate(core.meals, nowMs, weight, core.presence.active, dispensing, meal);
+}
+
+void sensorWeightLost(SensorCore &core)
+{
+  core.weight = 0.0f;
+  core.bowlStatus = BOWL_STATUS_ERROR;
+}
+
+void sensorPirStep(SensorCore &core, const PirEdge &edge)
+{
+  presenceOnEdge(core.presence, edge, core.weight);
+}
+
+bool sensorPresenceStep(SensorCore &core, uint32_t nowMs, Visit &visit)
+{
+  return presenceCheckEnd(core.presence, nowMs, core.weight, PIR_TIMEOUT, visit);
+}
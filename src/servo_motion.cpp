@@ -0,0 +1,356 @@
+#include "servo_motion.h"
+#include "json_pool.h"
+#include "logger.h"
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+
+static const char *TAG = "motion";
+
+struct MotionSegment
+{
+  uint8_t targetAngle;
+  uint8_t cycle;    // 1-based dispense cycle this segment belongs to
+  bool cue;         // Play the move cue when the segment starts
+  uint16_t moveMs;
+  uint16_t holdMs;  // Stay at the target afterwards
+};
+
+static Preferences motionPrefs;
+static DispensePattern dispensePattern = DEFAULT_DISPENSE_PATTERN;
+static esp_timer_handle_t motionTimer = nullptr;
+
+// Built by the loop or the button task, handed to the tick under motionMux
+static portMUX_TYPE motionMux = portMUX_INITIALIZER_UNLOCKED;
+static MotionSegment pendingSegments[MOTION_MAX_SEGMENTS];
+static uint8_t pendingCount = 0;
+static uint8_t pendingProfile = PROFILE_SCURVE;
+static const IndicatorPattern *pendingCue = nullptr;
+static bool motionPending = false;
+static bool stopPending = false;
+
+// Owned by the tick
+static MotionSegment segments[MOTION_MAX_SEGMENTS];
+static uint8_t segmentCount = 0;
+static uint8_t segmentIndex = 0;
+static uint8_t activeProfile = PROFILE_SCURVE;
+static const IndicatorPattern *activeCue = nullptr;
+static float segmentStartAngle = SERVO_REST_ANGLE;
+static volatile float currentAngle = SERVO_REST_ANGLE;
+static unsigned long segmentStart = 0;
+static volatile bool motionActive = false;
+static volatile uint8_t activeCycle = 0;
+
+static void writeServoAngle(float angle)
+{
+  currentAngle = angle;
+  myServo.writeMicroseconds(SERVO_MIN_US + (int)(angle * (SERVO_MAX_US - SERVO_MIN_US) / 180.0f + 0.5f));
+}
+
+static void beginSegment(unsigned long now)
+{
+  const MotionSegment &segment = segments[segmentIndex];
+  segmentStartAngle = currentAngle;
+  segmentStart = now;
+  activeCycle = segment.cycle;
+  if (segment.cue && activeCue != nullptr)
+    startIndicatorPattern(*activeCue);
+}
+
+static void motionTick(void *)
+{
+  bool newMotion = false;
+
+  portENTER_CRITICAL(&motionMux);
+  if (motionPending)
+  {
+    memcpy(segments, pendingSegments, pendingCount * sizeof(MotionSegment));
+    segmentCount = pendingCount;
+    activeProfile = pendingProfile;
+    activeCue = pendingCue;
+    motionPending = false;
+    newMotion = true;
+  }
+  else if (stopPending)
+  {
+    // Single gentle move back to rest replaces whatever was running
+    segments[0] = {dispensePattern.restAngle, 0, false, dispensePattern.moveMs, 0};
+    segmentCount = 1;
+    activeProfile = PROFILE_SCURVE;
+    activeCue = nullptr;
+    newMotion = true;
+  }
+  stopPending = false;
+  portEXIT_CRITICAL(&motionMux);
+
+  unsigned long now = millis();
+
+  if (newMotion)
+  {
+    segmentIndex = 0;
+    motionActive = segmentCount > 0;
+    if (motionActive)
+      beginSegment(now);
+  }
+
+  if (!motionActive)
+    return;
+
+  const MotionSegment &segment = segments[segmentIndex];
+  unsigned long elapsed = now - segmentStart;
+
+  if (elapsed < segment.moveMs)
+  {
+    float t = (float)elapsed / segment.moveMs;
+    float fraction = motionProfilePosition((MotionProfile)activeProfile, t);
+    writeServoAngle(segmentStartAngle + (segment.targetAngle - segmentStartAngle) * fraction);
+    return;
+  }
+
+  if (currentAngle != segment.targetAngle)
+    writeServoAngle(segment.targetAngle);
+
+  if (elapsed < (unsigned long)segment.moveMs + segment.holdMs)
+    return;
+
+  if (++segmentIndex >= segmentCount)
+  {
+    motionActive = false;
+    activeCycle = 0;
+    return;
+  }
+  beginSegment(now);
+}
+
+// Expands a pattern into timed moves; returns the segment count (0 = too long)
+static uint8_t buildSegments(const DispensePattern &pattern, MotionSegment *out)
+{
+  int count = 0;
+  for (uint8_t cycle = 1; cycle <= pattern.cycles; cycle++)
+  {
+    int needed = 2 + pattern.wiggleCount + (pattern.wiggleCount > 0 ? 1 : 0);
+    if (count + needed > MOTION_MAX_SEGMENTS)
+      return 0;
+
+    out[count++] = {pattern.openAngle, cycle, true, pattern.moveMs,
+                    pattern.wiggleCount > 0 ? (uint16_t)0 : pattern.dwellMs};
+
+    if (pattern.wiggleCount > 0)
+    {
+      for (uint8_t w = 0; w < pattern.wiggleCount; w++)
+      {
+        uint8_t angle = (w % 2 == 0) ? pattern.openAngle - pattern.wiggleDegrees
+                                     : pattern.openAngle + pattern.wiggleDegrees;
+        out[count++] = {angle, cycle, false, pattern.wiggleMs, 0};
+      }
+      out[count++] = {pattern.openAngle, cycle, false, pattern.wiggleMs, pattern.dwellMs};
+    }
+
+    out[count++] = {pattern.restAngle, cycle, true, pattern.moveMs,
+                    cycle < pattern.cycles ? pattern.pauseMs : (uint16_t)0};
+  }
+  return (uint8_t)count;
+}
+
+static void loadDispensePattern()
+{
+  DispensePattern stored;
+  motionPrefs.begin(MOTION_NVS_NAMESPACE, true);
+  size_t length = motionPrefs.getBytes("pattern", &stored, sizeof(stored));
+  motionPrefs.end();
+
+  if (length == sizeof(stored) && isValidDispensePattern(stored))
+  {
+    dispensePattern = stored;
+    LOGI(TAG, "✓ Dispense pattern loaded: %u cycles, %u->%u deg, %u wiggles",
+         stored.cycles, stored.restAngle, stored.openAngle, stored.wiggleCount);
+  }
+}
+
+static bool saveDispensePattern()
+{
+  motionPrefs.begin(MOTION_NVS_NAMESPACE, false);
+  size_t written = motionPrefs.putBytes("pattern", &dispensePattern, sizeof(dispensePattern));
+  motionPrefs.end();
+  return written == sizeof(dispensePattern);
+}
+
+void setupServoMotion()
+{
+  loadDispensePattern();
+
+  myServo.attach(SERVO_PIN, SERVO_MIN_US, SERVO_MAX_US);
+  writeServoAngle(dispensePattern.restAngle);
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = motionTick;
+  timerArgs.name = "motion";
+  if (esp_timer_create(&timerArgs, &motionTimer) == ESP_OK)
+  {
+    esp_timer_start_periodic(motionTimer, MOTION_TICK_US);
+  }
+  else
+  {
+    Serial.println("✗ Motion timer unavailable");
+  }
+}
+
+static bool queueMotion(const MotionSegment *source, uint8_t count, MotionProfile profile,
+                        const IndicatorPattern *cue)
+{
+  if (motionTimer == nullptr || count == 0)
+    return false;
+
+  // Checked under the lock: the loop and the button task both start motion
+  portENTER_CRITICAL(&motionMux);
+  if (isServoMotionActive())
+  {
+    portEXIT_CRITICAL(&motionMux);
+    return false;
+  }
+  memcpy(pendingSegments, source, count * sizeof(MotionSegment));
+  pendingCount = count;
+  pendingProfile = profile;
+  pendingCue = cue;
+  motionPending = true;
+  portEXIT_CRITICAL(&motionMux);
+  return true;
+}
+
+bool startDispenseMotion(const DispensePattern &pattern, const IndicatorPattern *moveCue)
+{
+  MotionSegment built[MOTION_MAX_SEGMENTS]; // On the caller's stack; callers run on two tasks
+  uint8_t count = buildSegments(pattern, built);
+  return queueMotion(built, count, (MotionProfile)pattern.profile, moveCue);
+}
+
+bool moveServoTo(uint8_t angle, uint16_t durationMs)
+{
+  MotionSegment move = {angle, 0, false, durationMs, 0};
+  return queueMotion(&move, 1, (MotionProfile)dispensePattern.profile, nullptr);
+}
+
+void stopServoMotion()
+{
+  portENTER_CRITICAL(&motionMux);
+  motionPending = false;
+  stopPending = true;
+  portEXIT_CRITICAL(&motionMux);
+}
+
+bool isServoMotionActive()
+{
+  return motionActive || motionPending || stopPending;
+}
+
+uint8_t getDispenseCycle()
+{
+  return activeCycle;
+}
+
+uint8_t getServoAngle()
+{
+  return (uint8_t)(currentAngle + 0.5f);
+}
+
+const DispensePattern &getDispensePattern()
+{
+  return dispensePattern;
+}
+
+static String dispensePatternJson()
+{
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  doc["profile"] = dispensePattern.profile == PROFILE_SCURVE ? "scurve" : "trapezoid";
+  doc["restAngle"] = dispensePattern.restAngle;
+  doc["openAngle"] = dispensePattern.openAngle;
+  doc["cycles"] = dispensePattern.cycles;
+  doc["moveMs"] = dispensePattern.moveMs;
+  doc["dwellMs"] = dispensePattern.dwellMs;
+  doc["pauseMs"] = dispensePattern.pauseMs;
+  doc["wiggleCount"] = dispensePattern.wiggleCount;
+  doc["wiggleDegrees"] = dispensePattern.wiggleDegrees;
+  doc["wiggleMs"] = dispensePattern.wiggleMs;
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+// Leaves the field untouched when the key is absent; false if out of range
+template <typename T>
+static bool readPatternField(JsonDocument &request, const char *key, long minValue, long maxValue, T &field)
+{
+  if (!request.containsKey(key))
+    return true;
+  long value = request[key] | -1L;
+  if (value < minValue || value > maxValue)
+    return false;
+  field = (T)value;
+  return true;
+}
+
+// {"action":"get"|"set"|"reset", <any DispensePattern field>, "profile":"scurve"|"trapezoid"}
+int handleDispensePatternMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<384> request;
+  if (deserializeJson(request, payload, length))
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Invalid JSON\"}";
+    return 400;
+  }
+
+  String action = request["action"] | "get";
+
+  if (action == "set" || action == "reset")
+  {
+    if (isServoMotionActive())
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Dispense in progress\"}";
+      return 409;
+    }
+
+    DispensePattern updated = DEFAULT_DISPENSE_PATTERN;
+    if (action == "set")
+    {
+      updated = dispensePattern;
+      String profile = request["profile"] | (updated.profile == PROFILE_SCURVE ? "scurve" : "trapezoid");
+      updated.profile = profile == "trapezoid" ? PROFILE_TRAPEZOID : PROFILE_SCURVE;
+      bool inRange = readPatternField(request, "restAngle", 0, 180, updated.restAngle) &&
+                     readPatternField(request, "openAngle", 0, 180, updated.openAngle) &&
+                     readPatternField(request, "cycles", 1, 10, updated.cycles) &&
+                     readPatternField(request, "moveMs", 0, 65535, updated.moveMs) &&
+                     readPatternField(request, "dwellMs", 0, 65535, updated.dwellMs) &&
+                     readPatternField(request, "pauseMs", 0, 65535, updated.pauseMs) &&
+                     readPatternField(request, "wiggleCount", 0, 255, updated.wiggleCount) &&
+                     readPatternField(request, "wiggleDegrees", 0, 180, updated.wiggleDegrees) &&
+                     readPatternField(request, "wiggleMs", 0, 65535, updated.wiggleMs);
+      if (!inRange)
+      {
+        responsePayload = "{\"status\":\"error\",\"message\":\"Pattern out of range\"}";
+        return 400;
+      }
+    }
+
+    if (!isValidDispensePattern(updated))
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Pattern out of range\"}";
+      return 400;
+    }
+
+    dispensePattern = updated;
+    saveDispensePattern();
+    moveServoTo(dispensePattern.restAngle, dispensePattern.moveMs);
+    LOGI(TAG, "Dispense pattern updated: %u cycles, %u->%u deg, %u wiggles",
+         updated.cycles, updated.restAngle, updated.openAngle, updated.wiggleCount);
+  }
+  else if (action != "get")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown pattern action\"}";
+    return 400;
+  }
+
+  responsePayload = dispensePatternJson();
+  return 200;
+}
@@ -0,0 +1,51 @@
+#include "servo_motion_core.h"
+
+float motionProfilePosition(MotionProfile profile, float t)
+{
+  if (t <= 0.0f)
+    return 0.0f;
+  if (t >= 1.0f)
+    return 1.0f;
+
+  if (profile == PROFILE_SCURVE)
+  {
+    // Minimum jerk: zero velocity and acceleration at both ends. The second
+    // half is mirrored from the first; evaluated directly near t = 1 the
+    // polynomial loses enough float precision to step backwards.
+    float u = t <= 0.5f ? t : 1.0f - t;
+    float position = u * u * u * (10.0f + u * (-15.0f + 6.0f * u));
+    return t <= 0.5f ? position : 1.0f - position;
+  }
+
+  // Trapezoid: accelerate for the first third, cruise, decelerate for the last
+  const float accel = 1.0f / 3.0f;
+  const float peak = 1.0f / (1.0f - accel);
+  if (t < accel)
+    return peak * t * t / (2.0f * accel);
+  if (t <= 1.0f - accel)
+    return peak * (t - accel / 2.0f);
+  float remaining = 1.0f - t;
+  return 1.0f - peak * remaining * remaining / (2.0f * accel);
+}
+
+bool isValidDispensePattern(const DispensePattern &pattern)
+{
+  return pattern.version == MOTION_PATTERN_VERSION &&
+         pattern.profile <= PROFILE_SCURVE &&
+         pattern.restAngle <= 180 && pattern.openAngle <= 180 &&
+         pattern.cycles >= 1 && pattern.cycles <= 10 &&
+         pattern.wiggleCount <= 6 &&
+         pattern.openAngle >= pattern.wiggleDegrees &&
+         pattern.openAngle + pattern.wiggleDegrees <= 180 &&
+         pattern.moveMs >= 50 && pattern.moveMs <= 3000 &&
+         pattern.dwellMs <= 5000 && pattern.pauseMs <= 5000 &&
+         (pattern.wiggleCount == 0 || pattern.wiggleMs >= 40);
+}
+
+uint32_t dispensePatternDurationMs(const DispensePattern &pattern)
+{
+  uint32_t perCycle = 2UL * pattern.moveMs + pattern.dwellMs;
+  if (pattern.wiggleCount > 0)
+    perCycle += (pattern.wiggleCount + 1UL) * pattern.wiggleMs;
+  return perCycle * pattern.cycles + (pattern.cycles - 1UL) * pattern.pauseMs;
+}
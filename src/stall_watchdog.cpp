@@ -0,0 +1,268 @@
+#include "stall_watchdog.h"
+#include "json_pool.h"
+#include "logger.h"
+#include <ArduinoJson.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <time.h>
+
+#define STALL_LOG_MAGIC 0x53544C32u // "STL2"; bumped when StallRecord changes
+#define SETUP_STALL_BUDGET_MS 30000 // setup() is one long pass; matches its timeout
+
+static const char *TAG = "stall";
+
+// Lives in RTC slow memory: survives software and watchdog resets, not power loss
+struct StallLog
+{
+  uint32_t magic;
+  uint16_t bootCount;
+  uint8_t count;
+  uint8_t inProgressValid; // A stall was ongoing when the last snapshot was taken
+  StallRecord inProgress;
+  StallRecord worst[STALL_LOG_SIZE];
+};
+
+RTC_NOINIT_ATTR static StallLog stallLog;
+
+static const char *regionNames[REGION_COUNT] = {
+    "none", "setup", "buttons", "dispense", "sensors", "ultrasonic", "scale",
+    "mqttConnect", "mqttLoop", "telemetry", "httpPost", "ntpSync", "lcd", "flash"};
+
+// Written by the loop task, read by the watchdog task (aligned 32-bit/8-bit stores)
+static volatile unsigned long lastCheckIn = 0;
+static volatile uint8_t currentRegion = REGION_NONE;
+static volatile unsigned long regionStart = 0;
+static volatile bool stallActive = false;
+static volatile unsigned long stallBudgetMs = SETUP_STALL_BUDGET_MS;
+static unsigned long stallRegionStart = 0; // Start of the region the stall is attributed to (watchdog task)
+
+static portMUX_TYPE stallMux = portMUX_INITIALIZER_UNLOCKED;
+static bool hardwareWatchdogArmed = false;
+static bool previousBootEndedInStall = false;
+
+StallRegionScope::StallRegionScope(StallRegion region)
+    : previousRegion((StallRegion)currentRegion), previousStart(regionStart)
+{
+  regionStart = millis();
+  currentRegion = region;
+}
+
+StallRegionScope::~StallRegionScope()
+{
+  currentRegion = previousRegion;
+  regionStart = previousStart;
+}
+
+static uint32_t currentEpoch()
+{
+  time_t now = time(nullptr);
+  return now > 1600000000 ? (uint32_t)now : 0; // Only once NTP has synced
+}
+
+// Keeps the STALL_LOG_SIZE longest stalls; caller holds stallMux
+static void commitStall(const StallRecord &record)
+{
+  if (stallLog.count < STALL_LOG_SIZE)
+  {
+    stallLog.worst[stallLog.count++] = record;
+    return;
+  }
+
+  int shortest = 0;
+  for (int i = 1; i < STALL_LOG_SIZE; i++)
+  {
+    if (stallLog.worst[i].durationMs < stallLog.worst[shortest].durationMs)
+      shortest = i;
+  }
+  if (record.durationMs > stallLog.worst[shortest].durationMs)
+    stallLog.worst[shortest] = record;
+}
+
+static void stallWatchdogTask(void *)
+{
+  for (;;)
+  {
+    vTaskDelay(pdMS_TO_TICKS(STALL_POLL_MS));
+
+    unsigned long now = millis();
+    unsigned long sinceCheckIn = now - lastCheckIn;
+    if (sinceCheckIn < stallBudgetMs)
+      continue;
+
+    uint8_t region = currentRegion;
+    unsigned long start = regionStart;
+
+    bool started = false;
+    portENTER_CRITICAL(&stallMux);
+    if (!stallActive)
+    {
+      // Attribute the stall to the region active now; once the blocking call
+      // returns its scope restores the outer region, which must not replace it
+      stallActive = true;
+      started = true;
+      stallRegionStart = start;
+      stallLog.inProgress = {};
+      stallLog.inProgress.uptimeMs = lastCheckIn;
+      uint32_t epoch = currentEpoch();
+      stallLog.inProgress.epoch = epoch ? epoch - sinceCheckIn / 1000 : 0;
+      stallLog.inProgress.bootCount = stallLog.bootCount;
+      stallLog.inProgress.region = region;
+      stallLog.inProgressValid = 1;
+    }
+    // Keep the RTC snapshot current in case the hardware watchdog fires; the
+    // region time stops growing once that region has been left
+    stallLog.inProgress.durationMs = sinceCheckIn;
+    if (region == stallLog.inProgress.region && start == stallRegionStart)
+      stallLog.inProgress.regionMs = now - stallRegionStart;
+    portEXIT_CRITICAL(&stallMux);
+
+    if (started)
+    {
+      LOGW(TAG, "⚠️ loop() stalled in '%s' (region active %lu ms)",
+                getStallRegionName(region), now - start);
+    }
+  }
+}
+
+void setupStallWatchdog()
+{
+  if (stallLog.magic != STALL_LOG_MAGIC)
+  {
+    memset(&stallLog, 0, sizeof(stallLog));
+    stallLog.magic = STALL_LOG_MAGIC;
+  }
+  stallLog.bootCount++;
+
+  // A stall snapshot left over means the previous boot never recovered
+  if (stallLog.inProgressValid)
+  {
+    esp_reset_reason_t reason = esp_reset_reason();
+    stallLog.inProgress.fatal = (reason == ESP_RST_TASK_WDT || reason == ESP_RST_INT_WDT ||
+                                 reason == ESP_RST_WDT || reason == ESP_RST_PANIC)
+                                    ? 1
+                                    : 0;
+    commitStall(stallLog.inProgress);
+    stallLog.inProgressValid = 0;
+    previousBootEndedInStall = true;
+  }
+
+  lastCheckIn = millis();
+  regionStart = lastCheckIn;
+  currentRegion = REGION_SETUP;
+
+  xTaskCreatePinnedToCore(stallWatchdogTask, "stallWdt", 2048, nullptr, 2, nullptr, 0);
+}
+
+void armHardwareWatchdog()
+{
+  // From here on loop() must check in every STALL_BUDGET_MS
+  currentRegion = REGION_NONE;
+  stallBudgetMs = STALL_BUDGET_MS;
+  lastCheckIn = millis();
+
+  // The core may already have initialized the TWDT; re-init just updates it
+  esp_task_wdt_init(HW_WATCHDOG_TIMEOUT_S, true);
+  hardwareWatchdogArmed = esp_task_wdt_add(nullptr) == 0;
+
+  LOGI(TAG, "✓ Stall watchdog armed: budget %d ms, hardware %s (%ds), boot #%u, %u stalls logged",
+            STALL_BUDGET_MS, hardwareWatchdogArmed ? "on" : "unavailable",
+            HW_WATCHDOG_TIMEOUT_S, stallLog.bootCount, stallLog.count);
+  if (previousBootEndedInStall)
+  {
+    LOGW(TAG, "⚠️ Previous boot ended during a loop stall - see getStalls");
+  }
+}
+
+void stallWatchdogCheckIn()
+{
+  unsigned long now = millis();
+
+  if (stallActive)
+  {
+    StallRecord record;
+    portENTER_CRITICAL(&stallMux);
+    stallLog.inProgress.durationMs = now - lastCheckIn;
+    record = stallLog.inProgress;
+    commitStall(record);
+    stallLog.inProgressValid = 0;
+    stallActive = false;
+    portEXIT_CRITICAL(&stallMux);
+
+    LOGI(TAG, "Loop recovered after %lu ms stall in '%s' (%lu ms in that region)",
+              (unsigned long)record.durationMs, getStallRegionName(record.region),
+              (unsigned long)record.regionMs);
+  }
+
+  lastCheckIn = now;
+
+  if (hardwareWatchdogArmed)
+  {
+    esp_task_wdt_reset();
+  }
+}
+
+const char *getStallRegionName(uint8_t region)
+{
+  return region < REGION_COUNT ? regionNames[region] : "unknown";
+}
+
+int getStallRecords(StallRecord *records, int maxRecords)
+{
+  portENTER_CRITICAL(&stallMux);
+  int count = stallLog.count < maxRecords ? stallLog.count : maxRecords;
+  StallRecord all[STALL_LOG_SIZE];
+  memcpy(all, stallLog.worst, sizeof(StallRecord) * stallLog.count);
+  int total = stallLog.count;
+  portEXIT_CRITICAL(&stallMux);
+
+  // Insertion sort, worst first (at most STALL_LOG_SIZE entries)
+  for (int i = 1; i < total; i++)
+  {
+    StallRecord key = all[i];
+    int j = i - 1;
+    while (j >= 0 && all[j].durationMs < key.durationMs)
+    {
+      all[j + 1] = all[j];
+      j--;
+    }
+    all[j + 1] = key;
+  }
+
+  memcpy(records, all, sizeof(StallRecord) * count);
+  return count;
+}
+
+uint32_t getWorstStallMs()
+{
+  StallRecord worst;
+  return getStallRecords(&worst, 1) ? worst.durationMs : 0;
+}
+
+int handleGetStallsMethod(String &responsePayload)
+{
+  StallRecord records[STALL_LOG_SIZE];
+  int count = getStallRecords(records, STALL_LOG_SIZE);
+
+  JsonDocument &doc = borrowJsonDocument();
+  doc["status"] = "success";
+  doc["bootCount"] = stallLog.bootCount;
+  doc["budgetMs"] = STALL_BUDGET_MS;
+  JsonArray stalls = doc.createNestedArray("stalls");
+  for (int i = 0; i < count; i++)
+  {
+    JsonObject stall = stalls.createNestedObject();
+    stall["region"] = getStallRegionName(records[i].region);
+    stall["ms"] = records[i].durationMs;
+    stall["regionMs"] = records[i].regionMs;
+    stall["uptime"] = records[i].uptimeMs;
+    stall["epoch"] = records[i].epoch;
+    stall["boot"] = records[i].bootCount;
+    stall["fatal"] = records[i].fatal;
+  }
+
+  responsePayload = "";
+  serializeJson(doc, responsePayload);
+  return 200;
+}
@@ -1,6 +1,17 @@
 #include "system_init.h"
 #include "network_manager.h"
 #include "load_cell.h" // Add this include
+#include "calibration.h"
+#include "trace_recorder.h"
+#include "logger.h"
+#include "servo_motion.h"
+#include "web_server.h"
+#include "calendar.h"
+#include "presence.h"
+#include "hopper_model.h"
+#include "sampling_policy.h"
+#include "history_store.h"
+#include "dispense_capture.h"
 
 void initializeLCD();
 void initializeRTC();
@@ -12,14 +23,18 @@ void systemStart()
 {
   Serial.begin(115200);
   delay(100); // Allow serial to initialize
+  setupLogger();
 
   Serial.println("\n=== System Starting ===");
 
   initializePins();
+  setupTraceRecorder(); // Mount storage early so boot inputs can be traced
+  setupCalendar();
   initializeLCD();
   initializeRTC();
   initializeWiFi();
   initializeSensors();
+  setupWebServer(); // Serves once WiFi is up, even if it connects later
 
   // Only setup MQTT once after WiFi is connected
   if (WiFi.status() == WL_CONNECTED)
@@ -58,8 +73,9 @@ void initializeRTC()
     lcd.setCursor(0, 1);
     lcd.print("DateTime Error!");
 
-    // Set date and time from compile time
-    rtc.SetDateTime(RtcDateTime(__DATE__, __TIME__));
+    // Set date and time from compile time (local) until NTP corrects it
+    uint32_t built = unixFromLocal(unixFromRtc(RtcDateTime(__DATE__, __TIME__)));
+    rtc.SetDateTime(rtcFromUnix(built));
     delay(100); // Reduced from 200
 
     // Verify the setting worked
@@ -91,9 +107,10 @@ void initializeRTC()
   }
 
   // Verify RTC is working properly
-  RtcDateTime now = rtc.GetDateTime();
-  if (now.IsValid())
+  RtcDateTime utc = rtc.GetDateTime();
+  if (utc.IsValid())
   {
+    RtcDateTime now = toLocalTime(utc);
     feederSystem.rtcReady = true;
     timeData.lastAutoFeedTime = now;
     timeData.nextScheduledFeed = getNextScheduledFeedTime(now);
@@ -143,15 +160,15 @@ void initializePins()
   pinMode(PIR_PIN, INPUT);
   pinMode(HX711_DOUT_PIN, INPUT);
   pinMode(HX711_SCK_PIN, OUTPUT);
-  pinMode(RED_PIN, OUTPUT);
-  pinMode(GREEN_PIN, OUTPUT);
-  pinMode(BLUE_PIN, OUTPUT);
-  pinMode(BUZZER_PIN, OUTPUT);
 
-  // Initialize servo to resting position (90 degrees)
-  myServo.attach(SERVO_PIN);
-  myServo.write(90);
-  delay(500); // Allow servo to reach position
+  // RGB LED and buzzer are LEDC channels driven by the pattern engine
+  setupIndicators();
+
+  // Initialize servo to resting position (90 degrees) and start the motion controller
+  setupServoMotion();
+  setupFeedQueue();
+  setupPresence();
+  setupSamplingPolicy();
 
   Serial.println("✓ GPIO pins initialized successfully");
   Serial.println("✓ Servo initialized to 90° resting position");
@@ -262,7 +279,7 @@ void initializeSensors()
   Serial.println("Initializing Load Cell...");
   delay(100); // Reduced from 300
 
-  if (!scale.is_ready())
+  if (!isScaleReady())
   {
     Serial.println("✗ HX711 not found.");
     lcd.setCursor(0, 1);
@@ -271,29 +288,24 @@ void initializeSensors()
   }
   else
   {
+    // Calibration was loaded from NVS and checked in setupLoadCell()
+    const CalibrationStatus &calibrationStatus = getCalibrationStatus();
     Serial.println("✓ HX711 Ready.");
     lcd.setCursor(0, 1);
-    lcd.print("Scale: OK      ");
+    if (!calibrationStatus.validated)
+    {
+      lcd.print("Scale: CHECK CAL");
+      Serial.println("✗ Stored calibration failed the stability check - use the calibrate method");
+    }
+    else if (calibrationStatus.loaded)
+    {
+      lcd.print("Scale: OK (NVS) ");
+    }
+    else
+    {
+      lcd.print("Scale: TARED    ");
+    }
     delay(100); // Reduced from 300
-
-    Serial.println("Taring scale... (make sure scale is empty)");
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("Scale Taring");
-    lcd.setCursor(0, 1);
-    lcd.print("Please wait...");
-
-    scale.tare(10); // Use 10 readings for more accurate tare
-    delay(200);     // Reduced from 500
-
-    // Test reading
-    float weight = getWeight();
-    Serial.printf("Initial weight reading: %.2f grams\n", weight);
-
-    lcd.setCursor(0, 1);
-    lcd.print("Tare Complete! ");
-    Serial.println("✓ Scale tare complete. Now place a known weight.");
-    delay(200); // Reduced from 500
   }
 
   // Show ultrasonic sensor initialization
@@ -307,6 +319,9 @@ void initializeSensors()
   lcd.setCursor(0, 1);
   lcd.print("Ready!         ");
   Serial.println("✓ Ultrasonic sensor ready");
+  setupHopper();
+  setupHistory(); // After the RTC, so today's bucket can be recognized
+  setupDispenseCapture(); // From here on the sampler task reads the HX711
   delay(50); // Reduced from 200
 
   // Show PIR sensor initialization with VERY strict timeout protection
@@ -0,0 +1,43 @@
+#include "time_manager_core.h"
+#include <stdlib.h>
+
+uint32_t nextScheduledFeedSeconds(uint32_t nowSeconds, const int *times, int count)
+{
+  int currentMinutes = (int)(nowSeconds % SECONDS_PER_DAY / 60);
+  uint32_t midnight = nowSeconds - nowSeconds % SECONDS_PER_DAY;
+
+  // Earliest feeding time still ahead today, else the earliest one tomorrow
+  int nextToday = -1;
+  int firstTomorrow = -1;
+  for (int i = 0; i < count; i++)
+  {
+    if (times[i] > currentMinutes && (nextToday < 0 || times[i] < nextToday))
+      nextToday = times[i];
+    if (firstTomorrow < 0 || times[i] < firstTomorrow)
+      firstTomorrow = times[i];
+  }
+
+  if (nextToday >= 0)
+    return midnight + (uint32_t)nextToday * 60;
+  return midnight + SECONDS_PER_DAY + (uint32_t)firstTomorrow * 60;
+}
+
+bool isScheduledFeedDue(int minuteOfDay, const int *times, int count,
+                        uint32_t nowSeconds, uint32_t lastFeedSeconds)
+{
+  // Fed within the last hour: this window is already served
+  if (lastFeedSeconds != 0 && nowSeconds - lastFeedSeconds < 3600)
+    return false;
+
+  for (int i = 0; i < count; i++)
+  {
+    // Distance on the 24 h clock, so 23:59 is one minute from 00:00
+    int distance = abs(minuteOfDay - times[i]);
+    if (distance > MINUTES_PER_DAY / 2)
+      distance = MINUTES_PER_DAY - distance;
+
+    if (distance <= 1) // Within 1 minute
+      return true;
+  }
+  return false;
+}
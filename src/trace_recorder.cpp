@@ -0,0 +1,262 @@
+#include "trace_recorder.h"
+#include "method_stream.h"
+#include "logger.h"
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <time.h>
+
+static const char *TAG = "trace";
+
+static uint8_t traceBuffer[TRACE_BUFFER_SIZE];
+static size_t traceBufferLength = 0;
+static File traceFile;
+static bool filesystemReady = false;
+static unsigned long lastFlushMillis = 0;
+static TraceEncoder traceEncoder;
+
+static TraceStats traceStats;
+
+static void flushTraceBuffer()
+{
+  if (traceBufferLength == 0 || !traceFile)
+    return;
+
+  traceFile.write(traceBuffer, traceBufferLength);
+  traceFile.flush();
+  traceStats.bytesWritten += traceBufferLength;
+  traceBufferLength = 0;
+  lastFlushMillis = millis();
+
+  if (traceStats.bytesWritten >= TRACE_MAX_FILE_BYTES)
+  {
+    LOGW(TAG, "Trace file full - recording stopped");
+    stopTraceRecording();
+  }
+}
+
+static void appendRecord(const uint8_t *record, size_t length)
+{
+  if (traceBufferLength + length > sizeof(traceBuffer))
+  {
+    traceStats.overruns++;
+    return;
+  }
+  memcpy(traceBuffer + traceBufferLength, record, length);
+  traceBufferLength += length;
+  traceStats.records++;
+}
+
+void setupTraceRecorder()
+{
+  filesystemReady = LittleFS.begin(true);
+  if (!filesystemReady)
+  {
+    LOGE(TAG, "✗ LittleFS mount failed - trace recording unavailable");
+    return;
+  }
+
+#if TRACE_RECORD_AT_BOOT
+  startTraceRecording();
+#endif
+}
+
+bool startTraceRecording()
+{
+  if (!filesystemReady)
+    return false;
+  if (traceStats.recording)
+    return true;
+
+  traceFile = LittleFS.open(TRACE_FILE_PATH, FILE_WRITE);
+  if (!traceFile)
+  {
+    LOGE(TAG, "✗ Could not create trace file");
+    return false;
+  }
+
+  time_t now = time(nullptr);
+  uint32_t epoch = now > 1600000000 ? (uint32_t)now : 0;
+  uint32_t startMillis = millis();
+  uint8_t header[TRACE_HEADER_BYTES];
+  traceFile.write(header, traceEncodeHeader(traceEncoder, header, epoch, startMillis));
+
+  traceStats = TraceStats();
+  traceStats.recording = true;
+  traceStats.bytesWritten = sizeof(header);
+  traceBufferLength = 0;
+  lastFlushMillis = startMillis;
+
+  LOGI(TAG, "✓ Trace recording started");
+  return true;
+}
+
+void stopTraceRecording()
+{
+  if (!traceStats.recording)
+    return;
+
+  traceStats.recording = false;
+  if (traceBufferLength > 0 && traceFile)
+  {
+    traceFile.write(traceBuffer, traceBufferLength);
+    traceStats.bytesWritten += traceBufferLength;
+    traceBufferLength = 0;
+  }
+  traceFile.close();
+
+  LOGI(TAG, "Trace recording stopped: %lu records, %lu bytes, %lu overruns",
+       traceStats.records, traceStats.bytesWritten, traceStats.overruns);
+}
+
+void handleTraceRecorder()
+{
+  if (!traceStats.recording)
+    return;
+
+  // Flush early when half full so a burst of MQTT traffic doesn't overrun
+  if (traceBufferLength >= sizeof(traceBuffer) / 2 ||
+      millis() - lastFlushMillis >= TRACE_FLUSH_INTERVAL)
+  {
+    flushTraceBuffer();
+  }
+}
+
+void traceScaleRaw(long raw)
+{
+  if (!traceStats.recording)
+    return;
+
+  uint8_t record[16];
+  appendRecord(record, traceEncodeScaleRaw(traceEncoder, record, millis(), (int32_t)raw));
+}
+
+void traceEchoMicros(unsigned long echoMicros)
+{
+  if (!traceStats.recording)
+    return;
+
+  uint8_t record[16];
+  appendRecord(record, traceEncodeEcho(traceEncoder, record, millis(), echoMicros));
+}
+
+void tracePirLevel(bool level)
+{
+  if (!traceStats.recording)
+    return;
+
+  uint8_t record[8];
+  appendRecord(record, traceEncodePir(traceEncoder, record, millis(), level));
+}
+
+void traceButtonLevel(uint8_t button, bool level)
+{
+  if (!traceStats.recording)
+    return;
+
+  uint8_t record[8];
+  appendRecord(record, traceEncodeButton(traceEncoder, record, millis(), button, level));
+}
+
+void traceMqttMessage(const char *topic, const byte *payload, unsigned int length)
+{
+  if (!traceStats.recording)
+    return;
+
+  uint8_t record[TRACE_RECORD_MAX];
+  appendRecord(record, traceEncodeMqtt(traceEncoder, record, millis(), topic, payload, length));
+}
+
+// Streams up to maxBytes of the trace file from 'cursor' as binary chunks;
+// the response carries the cursor for the next page (-1 at the end)
+static int uploadTracePage(uint32_t cursor, uint32_t maxBytes, String &responsePayload)
+{
+  File file = LittleFS.open(TRACE_FILE_PATH, FILE_READ);
+  if (!file)
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"No trace file\"}";
+    return 404;
+  }
+
+  uint32_t size = file.size();
+  if (cursor > size || !file.seek(cursor))
+  {
+    file.close();
+    responsePayload = "{\"status\":\"error\",\"message\":\"Cursor past end of trace\"}";
+    return 400;
+  }
+
+  MethodStream &stream = openMethodStream(METHOD_CT_BINARY);
+  uint8_t chunk[128];
+  uint32_t remaining = maxBytes;
+  size_t n;
+  while (remaining > 0 &&
+         (n = file.read(chunk, remaining < sizeof(chunk) ? remaining : sizeof(chunk))) > 0)
+  {
+    if (stream.write(chunk, n) != n)
+      break;
+    remaining -= n;
+  }
+  file.close();
+
+  if (!stream.end())
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Upload interrupted\"}";
+    return 503;
+  }
+
+  uint32_t next = cursor + stream.bytes();
+  char json[160];
+  snprintf(json, sizeof(json),
+           "{\"status\":\"success\",\"size\":%lu,\"cursor\":%lu,\"bytes\":%lu,\"chunks\":%u,\"next\":%ld}",
+           (unsigned long)size, (unsigned long)cursor, (unsigned long)stream.bytes(),
+           stream.chunks(), next < size ? (long)next : -1L);
+  responsePayload = json;
+  return 200;
+}
+
+// {"action":"start"|"stop"|"status"} or {"action":"upload","cursor":n,"maxBytes":n}
+int handleTraceMethod(byte *payload, unsigned int length, String &responsePayload)
+{
+  StaticJsonDocument<96> request;
+  deserializeJson(request, payload, length);
+  String action = request["action"] | "status";
+
+  if (action == "start")
+  {
+    if (!startTraceRecording())
+    {
+      responsePayload = "{\"status\":\"error\",\"message\":\"Trace storage unavailable\"}";
+      return 503;
+    }
+  }
+  else if (action == "stop")
+  {
+    stopTraceRecording();
+  }
+  else if (action == "upload")
+  {
+    uint32_t maxBytes = request["maxBytes"] | (uint32_t)TRACE_UPLOAD_PAGE;
+    if (maxBytes == 0 || maxBytes > TRACE_UPLOAD_PAGE_MAX)
+      maxBytes = TRACE_UPLOAD_PAGE_MAX;
+    stopTraceRecording();
+    return uploadTracePage(request["cursor"] | 0UL, maxBytes, responsePayload);
+  }
+  else if (action != "status")
+  {
+    responsePayload = "{\"status\":\"error\",\"message\":\"Unknown trace action\"}";
+    return 400;
+  }
+
+  char json[160];
+  snprintf(json, sizeof(json),
+           "{\"status\":\"success\",\"recording\":%s,\"records\":%lu,\"bytes\":%lu,\"overruns\":%lu}",
+           traceStats.recording ? "true" : "false", traceStats.records,
+           traceStats.bytesWritten, traceStats.overruns);
+  responsePayload = json;
+  return 200;
+}
+
+const TraceStats &getTraceStats()
+{
+  return traceStats;
+}
@@ -0,0 +1,225 @@
+#include "trace_recorder_core.h"
+#include <string.h>
+
+size_t putVarint(uint8_t *out, uint32_t value)
+{
+  size_t n = 0;
+  while (value >= 0x80)
+  {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+uint32_t zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t unzigzag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static void putU32(uint8_t *out, uint32_t value)
+{
+  for (int i = 0; i < 4; i++)
+    out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t getU32(const uint8_t *in)
+{
+  return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+size_t traceEncodeHeader(TraceEncoder &encoder, uint8_t *out, uint32_t epoch, uint32_t startMillis)
+{
+  memcpy(out, "PFTR", 4);
+  out[4] = TRACE_VERSION;
+  putU32(out + 5, epoch);
+  putU32(out + 9, startMillis);
+  encoder.lastMillis = startMillis;
+  encoder.lastScaleRaw = 0;
+  return TRACE_HEADER_BYTES;
+}
+
+// Common record prefix: time since the previous record, then the type
+static size_t beginRecord(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, TraceRecordType type)
+{
+  size_t n = putVarint(out, nowMillis - encoder.lastMillis);
+  encoder.lastMillis = nowMillis;
+  out[n++] = type;
+  return n;
+}
+
+size_t traceEncodeScaleRaw(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, int32_t raw)
+{
+  size_t n = beginRecord(encoder, out, nowMillis, TRACE_HX711);
+  n += putVarint(out + n, zigzag(raw - encoder.lastScaleRaw));
+  encoder.lastScaleRaw = raw;
+  return n;
+}
+
+size_t traceEncodeEcho(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, uint32_t echoMicros)
+{
+  size_t n = beginRecord(encoder, out, nowMillis, TRACE_ECHO);
+  return n + putVarint(out + n, echoMicros);
+}
+
+size_t traceEncodePir(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, bool level)
+{
+  size_t n = beginRecord(encoder, out, nowMillis, TRACE_PIR);
+  out[n++] = level ? 1 : 0;
+  return n;
+}
+
+size_t traceEncodeButton(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, uint8_t button,
+                         bool level)
+{
+  size_t n = beginRecord(encoder, out, nowMillis, TRACE_BUTTON);
+  out[n++] = (uint8_t)((button << 1) | (level ? 1 : 0));
+  return n;
+}
+
+size_t traceEncodeMqtt(TraceEncoder &encoder, uint8_t *out, uint32_t nowMillis, const char *topic,
+                       const uint8_t *payload, size_t length)
+{
+  size_t topicLength = strlen(topic);
+  if (topicLength > TRACE_TOPIC_MAX)
+    topicLength = TRACE_TOPIC_MAX;
+  if (length > TRACE_MQTT_MAX)
+    length = TRACE_MQTT_MAX;
+
+  size_t n = beginRecord(encoder, out, nowMillis, TRACE_MQTT);
+  n += putVarint(out + n, topicLength);
+  memcpy(out + n, topic, topicLength);
+  n += topicLength;
+  n += putVarint(out + n, length);
+  memcpy(out + n, payload, length);
+  return n + length;
+}
+
+bool traceOpen(TracePlayer &player, const uint8_t *data, size_t length)
+{
+  memset(&player, 0, sizeof(player));
+  if (length < TRACE_HEADER_BYTES || memcmp(data, "PFTR", 4) != 0 || data[4] != TRACE_VERSION)
+    return false;
+
+  player.data = data;
+  player.length = length;
+  player.offset = TRACE_HEADER_BYTES;
+  player.epoch = getU32(data + 5);
+  player.startMillis = getU32(data + 9);
+  player.millis = player.startMillis;
+  return true;
+}
+
+// False if the trace ends inside the varint or it is longer than 32 bits
+static bool readVarint(TracePlayer &player, uint32_t &value)
+{
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7)
+  {
+    if (player.offset >= player.length)
+      return false;
+    uint8_t byte = player.data[player.offset++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+// Length-prefixed bytes inside the trace
+static bool readBytes(TracePlayer &player, size_t limit, const uint8_t *&bytes, size_t &length)
+{
+  uint32_t value;
+  if (!readVarint(player, value) || value > limit || value > player.length - player.offset)
+    return false;
+  bytes = player.data + player.offset;
+  length = value;
+  player.offset += value;
+  return true;
+}
+
+static bool decodeRecord(TracePlayer &player, TraceRecord &record)
+{
+  uint32_t delta, value;
+  if (!readVarint(player, delta) || player.offset >= player.length)
+    return false;
+  player.millis += delta;
+
+  memset(&record, 0, sizeof(record));
+  record.type = (TraceRecordType)player.data[player.offset++];
+  record.millis = player.millis;
+
+  switch (record.type)
+  {
+  case TRACE_HX711:
+    if (!readVarint(player, value))
+      return false;
+    player.scaleRaw += unzigzag(value);
+    record.scaleRaw = player.scaleRaw;
+    return true;
+  case TRACE_ECHO:
+    return readVarint(player, record.echoMicros);
+  case TRACE_PIR:
+  case TRACE_BUTTON:
+    if (player.offset >= player.length)
+      return false;
+    value = player.data[player.offset++];
+    record.level = (value & 1) != 0;
+    record.button = record.type == TRACE_BUTTON ? (uint8_t)(value >> 1) : 0;
+    return true;
+  case TRACE_MQTT:
+  {
+    const uint8_t *topic;
+    if (!readBytes(player, TRACE_TOPIC_MAX, topic, record.topicLength) ||
+        !readBytes(player, TRACE_MQTT_MAX, record.payload, record.payloadLength))
+      return false;
+    record.topic = (const char *)topic;
+    return true;
+  }
+  default:
+    return false; // Unknown type: the rest cannot be framed
+  }
+}
+
+bool traceNext(TracePlayer &player, TraceRecord &record)
+{
+  if (player.data == nullptr || player.corrupt || player.offset >= player.length)
+    return false;
+  if (decodeRecord(player, record))
+    return true;
+  player.corrupt = true;
+  return false;
+}
+
+void traceReplayRecord(SensorCore &core, const TraceRecord &record, long offset, float scale,
+                       TraceReplayEvents &events)
+{
+  events.levelRead = false;
+  events.mealEnded = false;
+  events.visitEnded = sensorPresenceStep(core, record.millis, events.visit);
+
+  switch (record.type)
+  {
+  case TRACE_HX711:
+    events.mealEnded = sensorWeightStep(core, record.millis, (record.scaleRaw - offset) / scale,
+                                        false, events.meal);
+    break;
+  case TRACE_ECHO:
+    events.levelRead = sensorEchoStep(core, record.echoMicros);
+    break;
+  case TRACE_PIR:
+  {
+    PirEdge edge = {record.millis, (uint8_t)record.level};
+    sensorPirStep(core, edge);
+    break;
+  }
+  default:
+    break;
+  }
+}
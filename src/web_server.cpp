@@ -0,0 +1,147 @@
+#include "web_server.h"
+#include "sensor_manager.h"
+#include "logger.h"
+#include <ESPAsyncWebServer.h>
+
+static const char *TAG = "web";
+
+static const char DASHBOARD_HTML[] PROGMEM = R"HTML(<!DOCTYPE html>
+<html><head><meta name="viewport" content="width=device-width">
+<title>Pet Feeder</title></head>
+<body style="font-family:sans-serif">
+<h3>Pet Feeder</h3>
+<p>Bowl: <b id="w">-</b> g</p>
+<p>Hopper: <b id="l">-</b> (<span id="d">-</span> cm)</p>
+<p>Bowl status: <b id="b">-</b></p>
+<p>Pet present: <b id="m">-</b></p>
+<p>Dispensing: <b id="f">-</b></p>
+<script>
+var ws = new WebSocket('ws://' + location.host + '/ws');
+ws.onmessage = function (e) {
+  var s = JSON.parse(e.data);
+  w.textContent = s.w.toFixed(1); l.textContent = s.l; d.textContent = s.d.toFixed(1);
+  b.textContent = s.b; m.textContent = s.m ? 'yes' : 'no'; f.textContent = s.f ? 'yes' : 'no';
+};
+</script></body></html>)HTML";
+
+static AsyncWebServer server(WEB_SERVER_PORT);
+static AsyncWebSocket ws("/ws");
+
+static portMUX_TYPE webMux = portMUX_INITIALIZER_UNLOCKED;
+static WebSnapshot snapshot;
+static WebClientTable clients;
+
+static WebServerStats webStats;
+static unsigned long lastStreamMillis = 0;
+
+static WebSnapshot takeSnapshot()
+{
+  portENTER_CRITICAL(&webMux);
+  WebSnapshot copy = snapshot;
+  portEXIT_CRITICAL(&webMux);
+  return copy;
+}
+
+static void handleStatusRequest(AsyncWebServerRequest *request)
+{
+  WebSnapshot s = takeSnapshot();
+  webStats.statusRequests++;
+
+  char json[WEB_STATUS_MAX];
+  formatStatusJson(json, sizeof(json), s, webStats);
+  request->send(200, "application/json", json);
+}
+
+static void onWebSocketEvent(AsyncWebSocket *socket, AsyncWebSocketClient *client,
+                             AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+  if (type == WS_EVT_CONNECT)
+  {
+    portENTER_CRITICAL(&webMux);
+    bool accepted = webClientConnect(clients, client->id(), webStats);
+    portEXIT_CRITICAL(&webMux);
+
+    if (!accepted)
+    {
+      client->close(WEB_CLOSE_TRY_AGAIN, "Too many clients");
+      LOGW(TAG, "⚠️ Dashboard client %s refused (limit %d)",
+           client->remoteIP().toString().c_str(), WEB_MAX_CLIENTS);
+    }
+    else
+    {
+      LOGI(TAG, "Dashboard client %s connected", client->remoteIP().toString().c_str());
+    }
+  }
+  else if (type == WS_EVT_DISCONNECT)
+  {
+    portENTER_CRITICAL(&webMux);
+    webClientDisconnect(clients, client->id(), webStats);
+    portEXIT_CRITICAL(&webMux);
+  }
+  // Incoming frames are ignored; the stream is one way
+}
+
+static WebSendResult sendToClient(void *context, uint32_t clientId, const char *frame,
+                                  size_t length)
+{
+  AsyncWebSocketClient *client = ws.client(clientId);
+  bool connected = client != nullptr && client->status() == WS_CONNECTED;
+  WebSendResult result = webSendResultFor(connected, connected && client->queueIsFull());
+  if (result == WEB_SEND_OK)
+    client->text(frame, length);
+  return result;
+}
+
+void setupWebServer()
+{
+  ws.onEvent(onWebSocketEvent);
+  server.addHandler(&ws);
+  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request)
+            { request->send_P(200, "text/html", DASHBOARD_HTML); });
+  server.on("/status", HTTP_GET, handleStatusRequest);
+  server.onNotFound([](AsyncWebServerRequest *request)
+                    { request->send(404, "text/plain", "Not found"); });
+  server.begin();
+
+  Serial.printf("✓ Local dashboard on port %d (max %d live clients)\n",
+                WEB_SERVER_PORT, WEB_MAX_CLIENTS);
+}
+
+void handleWebServer()
+{
+  unsigned long currentMillis = millis();
+  if (currentMillis - lastStreamMillis < WEB_STREAM_INTERVAL_MS)
+    return;
+  lastStreamMillis = currentMillis;
+
+  WebSnapshot s;
+  s.uptimeMs = currentMillis;
+  s.weight = sensors.weight;
+  s.distance = sensors.distance;
+  s.dailyFoodDispensed = sensors.dailyFoodDispensed;
+  s.foodLevel = sensors.foodLevel;
+  s.bowlStatus = sensors.bowlStatus;
+  s.feedingStatus = sensors.feedingStatus;
+  s.motion = feederSystem.animalDetected;
+  s.dispensing = feederSystem.dispensing;
+
+  WebClientTable targets;
+  portENTER_CRITICAL(&webMux);
+  snapshot = s;
+  targets = clients;
+  portEXIT_CRITICAL(&webMux);
+
+  if (targets.count == 0)
+    return;
+
+  char frame[WEB_FRAME_MAX];
+  int len = formatStreamFrame(frame, sizeof(frame), s);
+  webFanOut(targets, frame, len, sendToClient, nullptr, webStats);
+
+  ws.cleanupClients(WEB_MAX_CLIENTS);
+}
+
+const WebServerStats &getWebServerStats()
+{
+  return webStats;
+}
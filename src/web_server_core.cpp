@@ -0,0 +1,95 @@
+#include "web_server_core.h"
+#include <stdio.h>
+
+bool webClientAdmit(WebClientTable &table, uint32_t id)
+{
+  if (table.count >= WEB_MAX_CLIENTS)
+    return false;
+  table.ids[table.count++] = id;
+  return true;
+}
+
+bool webClientRemove(WebClientTable &table, uint32_t id)
+{
+  for (uint8_t i = 0; i < table.count; i++)
+  {
+    if (table.ids[i] == id)
+    {
+      table.ids[i] = table.ids[--table.count];
+      return true;
+    }
+  }
+  return false;
+}
+
+bool webClientConnect(WebClientTable &table, uint32_t id, WebServerStats &stats)
+{
+  bool admitted = webClientAdmit(table, id);
+  if (!admitted)
+    stats.rejected++;
+  stats.clients = table.count;
+  return admitted;
+}
+
+void webClientDisconnect(WebClientTable &table, uint32_t id, WebServerStats &stats)
+{
+  // Refused clients disconnect too, but were never in the table
+  webClientRemove(table, id);
+  stats.clients = table.count;
+}
+
+static int clampLength(int len, size_t size)
+{
+  if (len < 0)
+    return 0;
+  return (size_t)len < size ? len : (int)size - 1;
+}
+
+int formatStreamFrame(char *out, size_t size, const WebSnapshot &s)
+{
+  int len = snprintf(out, size,
+                     "{\"t\":%lu,\"w\":%.1f,\"d\":%.1f,\"l\":\"%s\",\"b\":\"%s\",\"m\":%d,\"f\":%d}",
+                     s.uptimeMs, s.weight, s.distance, getFoodLevelName(s.foodLevel),
+                     getBowlStatusName(s.bowlStatus), s.motion ? 1 : 0, s.dispensing ? 1 : 0);
+  return clampLength(len, size);
+}
+
+int formatStatusJson(char *out, size_t size, const WebSnapshot &s, const WebServerStats &stats)
+{
+  int len = snprintf(out, size,
+                     "{\"uptimeMs\":%lu,\"bowlWeight\":%.1f,\"distance\":%.1f,\"containerLevel\":\"%s\","
+                     "\"bowlStatus\":\"%s\",\"feedingStatus\":\"%s\",\"motion\":%s,\"dispensing\":%s,"
+                     "\"dailyFoodDispensed\":%.1f,\"clients\":%u,\"framesDropped\":%lu}",
+                     s.uptimeMs, s.weight, s.distance, getFoodLevelName(s.foodLevel),
+                     getBowlStatusName(s.bowlStatus), getFeedingStatusName(s.feedingStatus),
+                     s.motion ? "true" : "false", s.dispensing ? "true" : "false",
+                     s.dailyFoodDispensed, stats.clients, stats.framesDropped);
+  return clampLength(len, size);
+}
+
+WebSendResult webSendResultFor(bool connected, bool queueFull)
+{
+  if (!connected)
+    return WEB_SEND_GONE;
+  return queueFull ? WEB_SEND_FULL : WEB_SEND_OK;
+}
+
+void webFanOut(const WebClientTable &clients, const char *frame, size_t length, WebSendFrame send,
+               void *context, WebServerStats &stats)
+{
+  for (uint8_t i = 0; i < clients.count; i++)
+  {
+    // A slow browser loses samples instead of growing a backlog
+    switch (send(context, clients.ids[i], frame, length))
+    {
+    case WEB_SEND_OK:
+      stats.framesSent++;
+      break;
+    case WEB_SEND_FULL:
+      stats.framesDropped++;
+      break;
+    default:
+      break;
+    }
+  }
+}
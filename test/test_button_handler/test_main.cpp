@@ -0,0 +1,149 @@
+#include <unity.h>
+#include "button_handler_core.h"
+
+// uint32_t like micros(), so sums wrap as they do on the device
+static const uint32_t LONG_US = 1500000;
+static const uint32_t DOUBLE_US = 300000;
+static const uint32_t REPEAT_US = 2000000;
+
+static GestureTracker tracker;
+
+static void configure(uint32_t doubleUs, uint32_t repeatUs)
+{
+  tracker = GestureTracker();
+  tracker.longUs = LONG_US;
+  tracker.doubleUs = doubleUs;
+  tracker.repeatUs = repeatUs;
+}
+
+// Time-driven gesture at nowUs, if any
+static ButtonGesture poll(uint32_t nowUs, uint32_t &decidedUs)
+{
+  decidedUs = 0;
+  return gestureOnTime(tracker, nowUs, decidedUs);
+}
+
+void setUp(void)
+{
+  configure(0, 0);
+}
+
+void tearDown(void) {}
+
+static void test_press_and_click(void)
+{
+  uint32_t decided;
+  TEST_ASSERT_EQUAL(GESTURE_PRESS, gestureOnEdge(tracker, true, 1000));
+  TEST_ASSERT_EQUAL(GESTURE_NONE, gestureOnEdge(tracker, true, 1100)); // Already down
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(1000 + LONG_US - 1, decided));
+  TEST_ASSERT_EQUAL(GESTURE_CLICK, gestureOnEdge(tracker, false, 200000));
+  TEST_ASSERT_EQUAL(GESTURE_NONE, gestureOnEdge(tracker, false, 200100)); // Already up
+  TEST_ASSERT_FALSE(gestureNextDeadline(tracker, decided));
+}
+
+static void test_single_click_decided_after_double_window(void)
+{
+  configure(DOUBLE_US, 0);
+  uint32_t decided, deadline;
+  gestureOnEdge(tracker, true, 0);
+  TEST_ASSERT_EQUAL(GESTURE_NONE, gestureOnEdge(tracker, false, 100000));
+
+  TEST_ASSERT_TRUE(gestureNextDeadline(tracker, deadline));
+  TEST_ASSERT_EQUAL_UINT32(100000 + DOUBLE_US, deadline);
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(deadline - 1, decided));
+  TEST_ASSERT_EQUAL(GESTURE_CLICK, poll(deadline + 5000, decided));
+  TEST_ASSERT_EQUAL_UINT32(deadline, decided); // Latency counts from the deadline
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(deadline + 10000, decided));
+}
+
+static void test_double_click(void)
+{
+  configure(DOUBLE_US, 0);
+  uint32_t decided;
+  gestureOnEdge(tracker, true, 0);
+  gestureOnEdge(tracker, false, 80000);
+  TEST_ASSERT_EQUAL(GESTURE_PRESS, gestureOnEdge(tracker, true, 200000));
+  TEST_ASSERT_EQUAL(GESTURE_DOUBLE, gestureOnEdge(tracker, false, 280000));
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(2000000, decided)); // No trailing CLICK
+}
+
+static void test_long_press_and_repeats(void)
+{
+  configure(0, REPEAT_US);
+  uint32_t decided, deadline;
+  gestureOnEdge(tracker, true, 5000);
+  TEST_ASSERT_TRUE(gestureNextDeadline(tracker, deadline));
+  TEST_ASSERT_EQUAL_UINT32(5000 + LONG_US, deadline);
+
+  TEST_ASSERT_EQUAL(GESTURE_LONG, poll(5000 + LONG_US + 300, decided));
+  TEST_ASSERT_EQUAL_UINT32(5000 + LONG_US, decided);
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(5000 + LONG_US + 400, decided));
+
+  // Late poll: each missed repeat is reported with its own deadline
+  uint32_t late = 5000 + LONG_US + 2 * REPEAT_US + 100;
+  TEST_ASSERT_EQUAL(GESTURE_REPEAT, poll(late, decided));
+  TEST_ASSERT_EQUAL_UINT32(5000 + LONG_US + REPEAT_US, decided);
+  TEST_ASSERT_EQUAL(GESTURE_REPEAT, poll(late, decided));
+  TEST_ASSERT_EQUAL_UINT32(5000 + LONG_US + 2 * REPEAT_US, decided);
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(late, decided));
+
+  // Release after a hold is not a click
+  TEST_ASSERT_EQUAL(GESTURE_NONE, gestureOnEdge(tracker, false, late + 1000));
+  TEST_ASSERT_FALSE(gestureNextDeadline(tracker, deadline));
+}
+
+static void test_click_then_hold_is_a_hold(void)
+{
+  configure(DOUBLE_US, 0);
+  uint32_t decided;
+  gestureOnEdge(tracker, true, 0);
+  gestureOnEdge(tracker, false, 50000);
+  gestureOnEdge(tracker, true, 150000);
+  TEST_ASSERT_EQUAL(GESTURE_LONG, poll(150000 + LONG_US, decided));
+  TEST_ASSERT_EQUAL(GESTURE_NONE, gestureOnEdge(tracker, false, 150000 + LONG_US + 1000));
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(150000 + LONG_US + 1000 + DOUBLE_US, decided));
+}
+
+// Held through boot (firmware marks it held): no gesture until released
+static void test_held_at_boot(void)
+{
+  uint32_t decided;
+  tracker.pressed = true;
+  tracker.held = true;
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(10 * LONG_US, decided));
+  TEST_ASSERT_EQUAL(GESTURE_NONE, gestureOnEdge(tracker, false, 10 * LONG_US));
+  TEST_ASSERT_EQUAL(GESTURE_PRESS, gestureOnEdge(tracker, true, 11 * LONG_US));
+}
+
+// micros() wraps every 71 minutes; a gesture across the wrap behaves the same
+static void test_micros_wraparound(void)
+{
+  configure(DOUBLE_US, REPEAT_US);
+  uint32_t decided;
+  uint32_t start = 0xFFFFFFFFu - 500000;
+  gestureOnEdge(tracker, true, start);
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(start + 400000, decided));
+  TEST_ASSERT_EQUAL(GESTURE_LONG, poll(start + LONG_US, decided));
+  TEST_ASSERT_EQUAL_UINT32(start + LONG_US, decided);
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(start + LONG_US + REPEAT_US - 1, decided));
+  TEST_ASSERT_EQUAL(GESTURE_REPEAT, poll(start + LONG_US + REPEAT_US, decided));
+
+  configure(DOUBLE_US, 0);
+  gestureOnEdge(tracker, true, start);
+  gestureOnEdge(tracker, false, start + 400000); // Released after the wrap
+  TEST_ASSERT_EQUAL(GESTURE_NONE, poll(start + 400000 + DOUBLE_US - 1, decided));
+  TEST_ASSERT_EQUAL(GESTURE_CLICK, poll(start + 400000 + DOUBLE_US, decided));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_press_and_click);
+  RUN_TEST(test_single_click_decided_after_double_window);
+  RUN_TEST(test_double_click);
+  RUN_TEST(test_long_press_and_repeats);
+  RUN_TEST(test_click_then_hold_is_a_hold);
+  RUN_TEST(test_held_at_boot);
+  RUN_TEST(test_micros_wraparound);
+  return UNITY_END();
+}
@@ -0,0 +1,254 @@
+#include <unity.h>
+#include "calendar_core.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static uint32_t utc(int year, int month, int day, int hour, int minute, int second = 0)
+{
+  CivilTime civil = {(uint16_t)year, (uint8_t)month, (uint8_t)day,
+                     (uint8_t)hour, (uint8_t)minute, (uint8_t)second, 0};
+  return unixFromCivil(civil);
+}
+
+static TimeZoneRule zone(const char *tz)
+{
+  TimeZoneRule rule;
+  TEST_ASSERT_TRUE_MESSAGE(parsePosixTz(tz, rule), tz);
+  return rule;
+}
+
+// Offset one second before and at a transition instant
+static void assertSwitch(const TimeZoneRule &rule, uint32_t at, int32_t before, int32_t after)
+{
+  TEST_ASSERT_EQUAL_INT32(before, utcOffsetAt(rule, at - 1));
+  TEST_ASSERT_EQUAL_INT32(after, utcOffsetAt(rule, at));
+}
+
+static void test_civil_round_trip(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(0, utc(1970, 1, 1, 0, 0));
+  TEST_ASSERT_EQUAL_UINT32(UNIX_EPOCH_2000, utc(2000, 1, 1, 0, 0));
+  TEST_ASSERT_EQUAL_UINT32(951782400UL, utc(2000, 2, 29, 0, 0));
+  TEST_ASSERT_EQUAL_UINT32(4107542400UL, utc(2100, 3, 1, 0, 0));
+
+  // Every day from 1970 to 2105, a day apart, counting civil dates by hand
+  int year = 1970, month = 1, day = 1, weekday = 4; // Thursday
+  for (uint32_t days = 0; days < 49000; days++)
+  {
+    CivilTime civil = civilFromUnix(days * SECONDS_PER_DAY + 43199);
+    TEST_ASSERT_EQUAL(year, civil.year);
+    TEST_ASSERT_EQUAL(month, civil.month);
+    TEST_ASSERT_EQUAL(day, civil.day);
+    TEST_ASSERT_EQUAL(weekday, civil.weekday);
+    TEST_ASSERT_EQUAL(11, civil.hour);
+    TEST_ASSERT_EQUAL(59, civil.second);
+    TEST_ASSERT_EQUAL_UINT32(days * SECONDS_PER_DAY + 43199, unixFromCivil(civil));
+
+    weekday = (weekday + 1) % 7;
+    if (++day > daysInMonth(year, month))
+    {
+      day = 1;
+      if (++month > 12)
+      {
+        month = 1;
+        year++;
+      }
+    }
+  }
+}
+
+static void test_leap_years(void)
+{
+  TEST_ASSERT_TRUE(isLeapYear(2000));
+  TEST_ASSERT_TRUE(isLeapYear(2024));
+  TEST_ASSERT_FALSE(isLeapYear(2100));
+  TEST_ASSERT_FALSE(isLeapYear(2023));
+  TEST_ASSERT_EQUAL(29, daysInMonth(2024, 2));
+  TEST_ASSERT_EQUAL(28, daysInMonth(2100, 2));
+
+  CivilTime leap = civilFromUnix(utc(2024, 2, 29, 23, 59, 59) + 1);
+  TEST_ASSERT_EQUAL(3, leap.month);
+  TEST_ASSERT_EQUAL(1, leap.day);
+  CivilTime noLeap = civilFromUnix(utc(2100, 2, 28, 23, 59, 59) + 1);
+  TEST_ASSERT_EQUAL(3, noLeap.month);
+  TEST_ASSERT_EQUAL(1, noLeap.day);
+}
+
+static void test_parse_rules(void)
+{
+  TimeZoneRule rule = zone("PHT-8");
+  TEST_ASSERT_FALSE(rule.hasDst);
+  TEST_ASSERT_EQUAL_INT32(8 * 3600, rule.stdOffset);
+  TEST_ASSERT_EQUAL_STRING("PHT", rule.stdName);
+
+  rule = zone("<+0530>-5:30");
+  TEST_ASSERT_EQUAL_INT32(5 * 3600 + 1800, rule.stdOffset);
+  TEST_ASSERT_EQUAL_STRING("+0530", rule.stdName);
+
+  rule = zone("CET-1CEST,M3.5.0,M10.5.0/3");
+  TEST_ASSERT_TRUE(rule.hasDst);
+  TEST_ASSERT_EQUAL_INT32(3600, rule.stdOffset);
+  TEST_ASSERT_EQUAL_INT32(7200, rule.dstOffset);
+  TEST_ASSERT_EQUAL(3, rule.dstStart.month);
+  TEST_ASSERT_EQUAL(5, rule.dstStart.week);
+  TEST_ASSERT_EQUAL_INT32(2 * 3600, rule.dstStart.timeOfDay);
+  TEST_ASSERT_EQUAL_INT32(3 * 3600, rule.dstEnd.timeOfDay);
+
+  // No rule: the US one
+  rule = zone("EST5EDT");
+  TEST_ASSERT_EQUAL_INT32(-5 * 3600, rule.stdOffset);
+  TEST_ASSERT_EQUAL_INT32(-4 * 3600, rule.dstOffset);
+  TEST_ASSERT_EQUAL(3, rule.dstStart.month);
+  TEST_ASSERT_EQUAL(2, rule.dstStart.week);
+  TEST_ASSERT_EQUAL(11, rule.dstEnd.month);
+
+  TimeZoneRule bad;
+  TEST_ASSERT_FALSE(parsePosixTz("", bad));
+  TEST_ASSERT_FALSE(parsePosixTz("UT0", bad)); // Name too short
+  TEST_ASSERT_FALSE(parsePosixTz("CET", bad)); // No offset
+  TEST_ASSERT_FALSE(parsePosixTz("<+08-8", bad));
+  TEST_ASSERT_FALSE(parsePosixTz("CET-1CEST,M13.5.0,M10.5.0/3", bad));
+  TEST_ASSERT_FALSE(parsePosixTz("CET-1CEST,M3.6.0,M10.5.0/3", bad));
+  TEST_ASSERT_FALSE(parsePosixTz("CET-1CEST,J60,M10.5.0/3", bad)); // Julian days unsupported
+  TEST_ASSERT_FALSE(parsePosixTz("CET-1CEST,M3.5.0", bad));
+  TEST_ASSERT_FALSE(parsePosixTz("CET-1CEST,M3.5.0,M10.5.0/3x", bad));
+}
+
+static void test_fixed_offset(void)
+{
+  TimeZoneRule rule = zone("PHT-8");
+  TEST_ASSERT_EQUAL_INT32(8 * 3600, utcOffsetAt(rule, 0));
+  TEST_ASSERT_EQUAL_INT32(8 * 3600, utcOffsetAt(rule, utc(2024, 7, 1, 0, 0)));
+
+  // Local midnight on New Year is still the previous year in UTC
+  uint32_t local = utc(2025, 1, 1, 0, 0);
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 12, 31, 16, 0), utcFromLocal(rule, local));
+}
+
+// EU: last Sunday of March 01:00 UTC to last Sunday of October 01:00 UTC
+static void test_central_europe(void)
+{
+  TimeZoneRule rule = zone("CET-1CEST,M3.5.0,M10.5.0/3");
+  assertSwitch(rule, utc(2024, 3, 31, 1, 0), 3600, 7200);
+  assertSwitch(rule, utc(2024, 10, 27, 1, 0), 7200, 3600);
+  assertSwitch(rule, utc(2025, 3, 30, 1, 0), 3600, 7200);
+  assertSwitch(rule, utc(2025, 10, 26, 1, 0), 7200, 3600);
+  TEST_ASSERT_EQUAL_INT32(3600, utcOffsetAt(rule, utc(2024, 12, 31, 23, 30)));
+  TEST_ASSERT_EQUAL_INT32(3600, utcOffsetAt(rule, utc(2025, 1, 1, 0, 30)));
+
+  // "Week 5" is the last Sunday whether the month has four or five
+  for (int year = 2000; year <= 2100; year++)
+  {
+    uint32_t summer = utc(year, 7, 1, 0, 0);
+    TEST_ASSERT_EQUAL_INT32(7200, utcOffsetAt(rule, summer));
+
+    int changes = 0;
+    for (int day = 22; day <= 31; day++)
+    {
+      uint32_t at = utc(year, 3, day, 1, 0);
+      if (utcOffsetAt(rule, at - 1) != utcOffsetAt(rule, at))
+      {
+        changes++;
+        TEST_ASSERT_EQUAL(0, civilFromUnix(at).weekday);
+        TEST_ASSERT_GREATER_THAN(31, day + 7);
+      }
+    }
+    TEST_ASSERT_EQUAL(1, changes);
+  }
+}
+
+// US: second Sunday of March 02:00 local to first Sunday of November 02:00
+static void test_us_eastern(void)
+{
+  TimeZoneRule rule = zone("EST5EDT,M3.2.0,M11.1.0");
+  assertSwitch(rule, utc(2024, 3, 10, 7, 0), -5 * 3600, -4 * 3600);
+  assertSwitch(rule, utc(2024, 11, 3, 6, 0), -4 * 3600, -5 * 3600);
+
+  // 2026: March 1st is a Sunday, so the second Sunday is the 8th
+  assertSwitch(rule, utc(2026, 3, 8, 7, 0), -5 * 3600, -4 * 3600);
+  assertSwitch(rule, utc(2026, 11, 1, 6, 0), -4 * 3600, -5 * 3600);
+
+  // New Year's Eve in New York is already next year in UTC
+  TEST_ASSERT_EQUAL_INT32(-5 * 3600, utcOffsetAt(rule, utc(2025, 1, 1, 3, 0)));
+}
+
+// Southern hemisphere: DST spans the new year
+static void test_australia_east(void)
+{
+  TimeZoneRule rule = zone("AEST-10AEDT,M10.1.0,M4.1.0/3");
+  assertSwitch(rule, utc(2024, 4, 6, 16, 0), 11 * 3600, 10 * 3600);
+  assertSwitch(rule, utc(2024, 10, 5, 16, 0), 10 * 3600, 11 * 3600);
+
+  TEST_ASSERT_EQUAL_INT32(11 * 3600, utcOffsetAt(rule, utc(2024, 12, 31, 12, 59)));
+  TEST_ASSERT_EQUAL_INT32(11 * 3600, utcOffsetAt(rule, utc(2024, 12, 31, 13, 0)));
+  TEST_ASSERT_EQUAL_INT32(11 * 3600, utcOffsetAt(rule, utc(2025, 1, 15, 0, 0)));
+  TEST_ASSERT_EQUAL_INT32(10 * 3600, utcOffsetAt(rule, utc(2025, 7, 1, 0, 0)));
+}
+
+// Transition times outside 0-24h: "/-1" is 23:00 the day before
+static void test_negative_transition_time(void)
+{
+  TimeZoneRule rule = zone("<-02>2<-01>,M3.5.0/-1,M10.5.0/0");
+  TEST_ASSERT_EQUAL_STRING("-02", rule.stdName);
+  TEST_ASSERT_EQUAL_INT32(-3600, rule.dstStart.timeOfDay);
+  assertSwitch(rule, utc(2024, 3, 31, 1, 0), -2 * 3600, -3600);
+  assertSwitch(rule, utc(2024, 10, 27, 1, 0), -3600, -2 * 3600);
+}
+
+static void test_local_to_utc_gap_and_overlap(void)
+{
+  TimeZoneRule rule = zone("CET-1CEST,M3.5.0,M10.5.0/3");
+
+  // Spring: 02:00-03:00 does not exist; those readings move an hour on
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 3, 31, 0, 59), utcFromLocal(rule, utc(2024, 3, 31, 1, 59)));
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 3, 31, 1, 0), utcFromLocal(rule, utc(2024, 3, 31, 2, 0)));
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 3, 31, 1, 30), utcFromLocal(rule, utc(2024, 3, 31, 2, 30)));
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 3, 31, 1, 0), utcFromLocal(rule, utc(2024, 3, 31, 3, 0)));
+
+  // Autumn: 02:00-03:00 happens twice; the first (CEST) one is taken
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 10, 26, 23, 59), utcFromLocal(rule, utc(2024, 10, 27, 1, 59)));
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 10, 27, 0, 0), utcFromLocal(rule, utc(2024, 10, 27, 2, 0)));
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 10, 27, 0, 30), utcFromLocal(rule, utc(2024, 10, 27, 2, 30)));
+  TEST_ASSERT_EQUAL_UINT32(utc(2024, 10, 27, 2, 0), utcFromLocal(rule, utc(2024, 10, 27, 3, 0)));
+}
+
+// Every UTC minute of a year maps to a local time that maps back to it,
+// except the repeated hour, which maps back to its first occurrence
+static void test_local_round_trip(void)
+{
+  const char *zones[] = {"CET-1CEST,M3.5.0,M10.5.0/3", "EST5EDT,M3.2.0,M11.1.0",
+                         "AEST-10AEDT,M10.1.0,M4.1.0/3", "PHT-8"};
+  for (unsigned z = 0; z < sizeof(zones) / sizeof(zones[0]); z++)
+  {
+    TimeZoneRule rule = zone(zones[z]);
+    int repeated = 0;
+    for (uint32_t t = utc(2024, 1, 1, 0, 0); t < utc(2025, 1, 1, 0, 0); t += 60)
+    {
+      uint32_t local = t + utcOffsetAt(rule, t);
+      uint32_t back = utcFromLocal(rule, local);
+      if (back != t)
+      {
+        repeated++;
+        TEST_ASSERT_EQUAL_UINT32(t - 3600, back);
+      }
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(rule.hasDst ? 60 : 0, repeated, zones[z]);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_civil_round_trip);
+  RUN_TEST(test_leap_years);
+  RUN_TEST(test_parse_rules);
+  RUN_TEST(test_fixed_offset);
+  RUN_TEST(test_central_europe);
+  RUN_TEST(test_us_eastern);
+  RUN_TEST(test_australia_east);
+  RUN_TEST(test_negative_transition_time);
+  RUN_TEST(test_local_to_utc_gap_and_overlap);
+  RUN_TEST(test_local_round_trip);
+  return UNITY_END();
+}
@@ -0,0 +1,370 @@
+#include <unity.h>
+#include <string.h>
+#include "fault_injection_core.h"
+#include "network_manager_core.h"
+
+// The firmware's scenario runner, traffic choice and connect logic
+// (faultRunnerPass, faultTrafficFor, mqttConnect, mqttConnectForPublish) on
+// a simulated clock. Only the transport is simulated: each loop pass costs
+// LOOP_WORK_MS, and a call advances the clock by however long the fault
+// model says the real call would block.
+#define LOOP_WORK_MS 2
+#define DATABASE_LCD_HOLD_MS 750 // sendToDatabase() shows its result this long
+
+struct Sim
+{
+  uint32_t now;
+  NetFault fault;
+  uint32_t param;
+  ReconnectBackoff backoff;
+  unsigned long lastPublishReconnect;
+  bool connected;
+  uint32_t connects;
+  uint32_t attemptAt[64];
+  uint32_t published;
+  uint32_t lost;
+  uint32_t seed;
+};
+
+static Sim sim;
+
+void setUp(void)
+{
+  memset(&sim, 0, sizeof(sim));
+  sim.now = 1000;
+  sim.connected = true;
+  sim.seed = 1;
+}
+void tearDown(void) {}
+
+static uint32_t nextRandom()
+{
+  sim.seed = sim.seed * 1103515245 + 12345;
+  return sim.seed >> 1;
+}
+
+static bool simConnected(void *)
+{
+  return sim.connected;
+}
+
+// PubSubClient::connect() behind injectConnectFault()
+static ConnectOutcome simConnect(void *)
+{
+  if (sim.connects < sizeof(sim.attemptAt) / sizeof(sim.attemptAt[0]))
+    sim.attemptAt[sim.connects] = sim.now;
+  sim.connects++;
+
+  FaultEffect effect = connectFaultEffect(sim.fault, sim.param);
+  sim.now += effect.blockMs;
+  switch (effect.result)
+  {
+  case FAULT_RESULT_OK:
+    sim.connected = true;
+    return CONNECT_OK;
+  case FAULT_RESULT_REJECTED:
+    return CONNECT_REJECTED;
+  default:
+    return CONNECT_FAILED;
+  }
+}
+
+static const MqttTransport simTransport = {nullptr, simConnected, simConnect};
+
+// generateTraffic()
+static void simTraffic()
+{
+  switch (faultTrafficFor(sim.fault))
+  {
+  case FAULT_TRAFFIC_RECONNECT:
+    sim.connected = false;
+    mqttConnect(sim.backoff, simTransport, sim.now, nextRandom());
+    break;
+  case FAULT_TRAFFIC_HTTP_POST:
+    sim.now += httpFaultEffect(sim.fault, sim.param).blockMs + DATABASE_LCD_HOLD_MS;
+    break;
+  default:
+  {
+    ConnectOutcome link = mqttConnectForPublish(sim.backoff, sim.lastPublishReconnect, simTransport,
+                                                sim.now, nextRandom());
+    if (link != CONNECT_ALREADY && link != CONNECT_OK)
+      break;
+    FaultEffect effect = publishFaultEffect(sim.fault, sim.param, nextRandom());
+    sim.now += effect.blockMs;
+    if (effect.result == FAULT_RESULT_OK)
+      sim.published++;
+    else
+      sim.lost++;
+    break;
+  }
+  }
+}
+
+// handleFaultScenarios() for one scenario
+static FaultReport runScenario(NetFault fault, uint32_t param, uint32_t durationMs = FAULT_SCENARIO_MS)
+{
+  sim.fault = fault;
+  sim.param = param;
+
+  FaultRunner runner;
+  faultRunnerStart(runner, sim.now);
+  for (;;)
+  {
+    FaultStep step = faultRunnerPass(runner, sim.now, nextRandom(), durationMs);
+    if (step == FAULT_STEP_DONE)
+      break;
+    if (step == FAULT_STEP_TRAFFIC)
+      simTraffic();
+    sim.now += readFaultDelay(sim.fault, sim.param) + LOOP_WORK_MS;
+  }
+  return faultMeterFinish(runner.meter);
+}
+
+static void test_fault_models(void)
+{
+  FaultEffect effect = connectFaultEffect(FAULT_AUTH_REJECT, FAULT_TLS_HANDSHAKE_MS);
+  TEST_ASSERT_EQUAL_UINT32(FAULT_TLS_HANDSHAKE_MS, effect.blockMs);
+  TEST_ASSERT_EQUAL(FAULT_RESULT_REJECTED, effect.result);
+  TEST_ASSERT_EQUAL(FAULT_RESULT_REFUSED, connectFaultEffect(FAULT_DNS_FAIL, 2000).result);
+  TEST_ASSERT_EQUAL(FAULT_RESULT_TIMEOUT, connectFaultEffect(FAULT_HALF_OPEN, 1).result);
+  TEST_ASSERT_EQUAL(FAULT_RESULT_OK, connectFaultEffect(FAULT_LATENCY, 800).result);
+  TEST_ASSERT_EQUAL_UINT32(0, connectFaultEffect(FAULT_LATENCY, 800).blockMs);
+
+  effect = publishFaultEffect(FAULT_HALF_OPEN, FAULT_SOCKET_TIMEOUT_MS, 0);
+  TEST_ASSERT_EQUAL_UINT32(FAULT_SOCKET_TIMEOUT_MS, effect.blockMs);
+  TEST_ASSERT_EQUAL(FAULT_RESULT_FAILED, effect.result);
+  TEST_ASSERT_EQUAL_UINT32(800, publishFaultEffect(FAULT_LATENCY, 800, 0).blockMs);
+  TEST_ASSERT_EQUAL(FAULT_RESULT_OK, publishFaultEffect(FAULT_SLOW_READ, 300, 0).result);
+
+  TEST_ASSERT_EQUAL_UINT32(300, readFaultDelay(FAULT_SLOW_READ, 300));
+  TEST_ASSERT_EQUAL_UINT32(0, readFaultDelay(FAULT_LATENCY, 300));
+  TEST_ASSERT_EQUAL(FAULT_RESULT_TIMEOUT, httpFaultEffect(FAULT_HTTP_TIMEOUT, 3000).result);
+  TEST_ASSERT_EQUAL(FAULT_RESULT_OK, httpFaultEffect(FAULT_HALF_OPEN, 3000).result);
+
+  int lost = 0;
+  for (int i = 0; i < 10000; i++)
+  {
+    if (publishFaultEffect(FAULT_DROP, 30, nextRandom()).result != FAULT_RESULT_OK)
+      lost++;
+  }
+  TEST_ASSERT_INT_WITHIN(300, 3000, lost);
+}
+
+static void test_meter_counts_missed_feeds(void)
+{
+  FaultMeter meter;
+  faultMeterStart(meter, 0);
+  faultMeterPass(meter, 100, 0);
+  faultMeterPass(meter, 59990, 0); // Feed due at 60 s, loop still within its minute
+  faultMeterPass(meter, 60010, 0);
+  faultMeterPass(meter, 185000, 0); // Blocked past the 120 s feed's window
+  const FaultReport &report = faultMeterFinish(meter);
+
+  TEST_ASSERT_EQUAL(3, report.feedsDue);
+  TEST_ASSERT_EQUAL(1, report.feedsMissed);
+  TEST_ASSERT_EQUAL_UINT32(124990, report.maxLoopMs);
+  TEST_ASSERT_FALSE(report.passed);
+  TEST_ASSERT_EQUAL(0, latencyBucket(1));
+  TEST_ASSERT_EQUAL(1, latencyBucket(2));
+  TEST_ASSERT_EQUAL(2, latencyBucket(3));
+  TEST_ASSERT_EQUAL(FAULT_LATENCY_BUCKETS - 1, latencyBucket(100000));
+}
+
+static void test_backoff_doubles_to_cap(void)
+{
+  ReconnectBackoff backoff = {};
+  TEST_ASSERT_TRUE(reconnectDue(backoff, 0));
+
+  uint32_t expected = MQTT_BACKOFF_MIN_MS;
+  uint32_t now = 0;
+  for (int failure = 0; failure < 12; failure++)
+  {
+    reconnectFailed(backoff, false, nextRandom());
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(expected, backoff.waitMs);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(expected + expected / 4, backoff.waitMs);
+
+    // Not before the wait is over, then exactly once
+    TEST_ASSERT_FALSE(reconnectDue(backoff, now + backoff.waitMs - 1));
+    now += backoff.waitMs;
+    TEST_ASSERT_TRUE(reconnectDue(backoff, now));
+    TEST_ASSERT_FALSE(reconnectDue(backoff, now + 1));
+
+    expected = backoff.waitMs * 2;
+    if (expected > MQTT_BACKOFF_MAX_MS)
+      expected = MQTT_BACKOFF_MAX_MS;
+  }
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(MQTT_BACKOFF_MAX_MS + MQTT_BACKOFF_MAX_MS / 4, backoff.waitMs);
+
+  reconnectSucceeded(backoff);
+  TEST_ASSERT_TRUE(reconnectDue(backoff, now + 1));
+}
+
+// Survives millis() wrapping mid-wait
+static void test_backoff_across_millis_wrap(void)
+{
+  ReconnectBackoff backoff = {};
+  uint32_t now = 0xFFFFF000UL;
+  TEST_ASSERT_TRUE(reconnectDue(backoff, now));
+  reconnectFailed(backoff, false, 0);
+  TEST_ASSERT_FALSE(reconnectDue(backoff, now + 4000)); // Wrapped past zero
+  TEST_ASSERT_TRUE(reconnectDue(backoff, now + MQTT_BACKOFF_MIN_MS));
+}
+
+static void test_auth_rejects_back_off_long(void)
+{
+  ReconnectBackoff backoff = {};
+  reconnectFailed(backoff, true, 0);
+  reconnectFailed(backoff, true, 0);
+  TEST_ASSERT_LESS_THAN_UINT32(MQTT_BACKOFF_MAX_MS, backoff.waitMs);
+  reconnectFailed(backoff, true, 0);
+  TEST_ASSERT_EQUAL_UINT32(MQTT_AUTH_BACKOFF_MS, backoff.waitMs);
+
+  // A transport failure afterwards drops back to the normal ceiling
+  reconnectFailed(backoff, false, 0);
+  TEST_ASSERT_EQUAL_UINT32(MQTT_BACKOFF_MAX_MS, backoff.waitMs);
+
+  reconnectSucceeded(backoff);
+  TEST_ASSERT_EQUAL(0, backoff.authFailures);
+}
+
+// A site full of feeders that lost the broker together does not come back
+// in lockstep
+static void test_jitter_spreads_retries(void)
+{
+  const int feeders = 50;
+  uint32_t earliest = 0xFFFFFFFFUL, latest = 0;
+  for (int i = 0; i < feeders; i++)
+  {
+    ReconnectBackoff backoff = {};
+    for (int failure = 0; failure < 4; failure++)
+      reconnectFailed(backoff, false, nextRandom());
+    if (backoff.waitMs < earliest)
+      earliest = backoff.waitMs;
+    if (backoff.waitMs > latest)
+      latest = backoff.waitMs;
+  }
+  TEST_ASSERT_GREATER_THAN_UINT32(10000, latest - earliest);
+}
+
+// Scenario budget verdicts; only faults that never block pass
+static void test_scenario_verdicts(void)
+{
+  struct
+  {
+    NetFault fault;
+    uint32_t param;
+    bool passes;
+  } cases[] = {
+      {FAULT_NONE, 0, true},
+      {FAULT_DROP, 50, true},
+      {FAULT_LATENCY, 800, false},
+      {FAULT_SLOW_READ, 300, false},
+      {FAULT_HALF_OPEN, FAULT_SOCKET_TIMEOUT_MS, false},
+      {FAULT_HTTP_TIMEOUT, 3000, false},
+  };
+  for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+  {
+    setUp();
+    FaultReport report = runScenario(cases[i].fault, cases[i].param);
+    TEST_ASSERT_EQUAL_MESSAGE(cases[i].passes, report.passed, "verdict");
+    TEST_ASSERT_EQUAL(0, report.feedsMissed);
+    TEST_ASSERT_GREATER_THAN(0, report.presses);
+    if (cases[i].passes)
+      TEST_ASSERT_LESS_OR_EQUAL_UINT32(FAULT_LOOP_BUDGET_MS, report.maxLoopMs);
+    else
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(cases[i].param, report.maxLoopMs);
+  }
+
+  setUp();
+  runScenario(FAULT_DROP, 50);
+  TEST_ASSERT_EQUAL_UINT32(12, sim.published + sim.lost);
+  TEST_ASSERT_GREATER_THAN(0, sim.lost);
+}
+
+// DNS down: traffic asks for a connect every 5 s, the backoff spaces the
+// attempts out, and each one holds the loop for the lookup timeout
+static void test_scenario_dns_fail_backs_off(void)
+{
+  FaultReport report = runScenario(FAULT_DNS_FAIL, 2000);
+  TEST_ASSERT_FALSE(report.passed);
+  TEST_ASSERT_EQUAL_UINT32(2000 + LOOP_WORK_MS, report.maxLoopMs);
+
+  // 12 requests, but only the first and the ones after each wait go out
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3, sim.connects);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(5, sim.connects);
+  for (uint32_t i = 1; i < sim.connects; i++)
+  {
+    uint32_t gap = sim.attemptAt[i] - sim.attemptAt[i - 1];
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(MQTT_BACKOFF_MIN_MS << (i - 1), gap);
+  }
+
+  // Network back: the next due attempt connects and clears the backoff
+  uint32_t before = sim.connects;
+  runScenario(FAULT_NONE, 0, 10 * 60000UL);
+  TEST_ASSERT_TRUE(sim.connected);
+  TEST_ASSERT_EQUAL_UINT32(before + 1, sim.connects);
+  TEST_ASSERT_EQUAL_UINT32(0, sim.backoff.waitMs);
+}
+
+// Hub rejecting the key: three tries, then one every half hour
+static void test_scenario_auth_reject(void)
+{
+  FaultReport report = runScenario(FAULT_AUTH_REJECT, FAULT_TLS_HANDSHAKE_MS);
+  TEST_ASSERT_FALSE(report.passed);
+  TEST_ASSERT_EQUAL_UINT32(MQTT_AUTH_FAILURE_LIMIT, sim.connects);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(MQTT_AUTH_BACKOFF_MS, sim.backoff.waitMs);
+
+  runScenario(FAULT_AUTH_REJECT, FAULT_TLS_HANDSHAKE_MS, 2 * 3600000UL);
+  TEST_ASSERT_INT_WITHIN(1, MQTT_AUTH_FAILURE_LIMIT + 3, sim.connects);
+  for (uint32_t i = MQTT_AUTH_FAILURE_LIMIT; i < sim.connects; i++)
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(MQTT_AUTH_BACKOFF_MS,
+                                        sim.attemptAt[i] - sim.attemptAt[i - 1]);
+}
+
+// Telemetry every 5 s while the broker is down: reconnects go out at most
+// once per MQTT_RECONNECT_INTERVAL, and the backoff stretches them further
+static void test_publish_reconnects_are_spaced(void)
+{
+  sim.connected = false;
+  sim.fault = FAULT_DNS_FAIL;
+  sim.param = 2000;
+  unsigned long outcomes[CONNECT_REJECTED + 1] = {};
+  for (int i = 0; i < 120; i++) // Ten minutes
+  {
+    sim.now += FAULT_TRAFFIC_INTERVAL;
+    outcomes[mqttConnectForPublish(sim.backoff, sim.lastPublishReconnect, simTransport, sim.now,
+                                   nextRandom())]++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(sim.connects, outcomes[CONNECT_FAILED]);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(600000 / MQTT_RECONNECT_INTERVAL, sim.connects);
+  for (uint32_t i = 1; i < sim.connects; i++)
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(MQTT_RECONNECT_INTERVAL, sim.attemptAt[i] - sim.attemptAt[i - 1]);
+
+  // Broker back: the next allowed attempt connects, after that no attempts
+  sim.fault = FAULT_NONE;
+  uint32_t before = sim.connects;
+  for (int i = 0; i < 120; i++)
+  {
+    sim.now += FAULT_TRAFFIC_INTERVAL;
+    mqttConnectForPublish(sim.backoff, sim.lastPublishReconnect, simTransport, sim.now, nextRandom());
+  }
+  TEST_ASSERT_TRUE(sim.connected);
+  TEST_ASSERT_EQUAL_UINT32(before + 1, sim.connects);
+  TEST_ASSERT_EQUAL(CONNECT_ALREADY, mqttConnect(sim.backoff, simTransport, sim.now, 0));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_fault_models);
+  RUN_TEST(test_meter_counts_missed_feeds);
+  RUN_TEST(test_backoff_doubles_to_cap);
+  RUN_TEST(test_backoff_across_millis_wrap);
+  RUN_TEST(test_auth_rejects_back_off_long);
+  RUN_TEST(test_jitter_spreads_retries);
+  RUN_TEST(test_scenario_verdicts);
+  RUN_TEST(test_scenario_dns_fail_backs_off);
+  RUN_TEST(test_scenario_auth_reject);
+  RUN_TEST(test_publish_reconnects_are_spaced);
+  return UNITY_END();
+}
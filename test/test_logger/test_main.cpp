@@ -0,0 +1,191 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "logger_core.h"
+
+// The ring and the cost table, then the caller-side cost of real call sites:
+// each one below is a LOG line from src/ with its module's TAG, pushed and
+// drained the way logWrite() and the drain task do, and timed into a cost
+// table like the one behind the logCosts method.
+
+static LogRing ring;
+static LogCostTable costs;
+
+void setUp(void)
+{
+  logRingInit(ring);
+  memset((void *)&costs, 0, sizeof(costs));
+}
+void tearDown(void) {}
+
+static bool push(const char *tag, const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  bool queued = logRingPush(ring, 1234, LOG_LEVEL_INFO, tag, format, args);
+  va_end(args);
+  return queued;
+}
+
+static uint32_t drainAll()
+{
+  uint32_t count = 0;
+  while (logRingPeek(ring) != nullptr)
+  {
+    logRingPop(ring);
+    count++;
+  }
+  return count;
+}
+
+static void test_ring_keeps_order_and_fields()
+{
+  static const char *TAG = "feedq";
+  TEST_ASSERT_TRUE(push(TAG, "Feed request (%s) rejected: %s", "manual", "hopper empty"));
+  TEST_ASSERT_TRUE(push(TAG, "second %d", 2));
+
+  const LogSlot *slot = logRingPeek(ring);
+  TEST_ASSERT_NOT_NULL(slot);
+  TEST_ASSERT_EQUAL_STRING("Feed request (manual) rejected: hopper empty", slot->message);
+  TEST_ASSERT_TRUE(slot->tag == TAG);
+  TEST_ASSERT_EQUAL_UINT32(1234, slot->millis);
+  TEST_ASSERT_EQUAL(LOG_LEVEL_INFO, slot->level);
+  logRingPop(ring);
+  TEST_ASSERT_EQUAL_STRING("second 2", logRingPeek(ring)->message);
+  logRingPop(ring);
+  TEST_ASSERT_NULL(logRingPeek(ring));
+  TEST_ASSERT_EQUAL_UINT32(2, ring.written.load());
+}
+
+static void test_full_ring_drops_and_counts()
+{
+  for (int i = 0; i < LOG_SLOT_COUNT; i++)
+    TEST_ASSERT_TRUE(push("t", "message %d", i));
+  TEST_ASSERT_FALSE(push("t", "one too many"));
+  TEST_ASSERT_FALSE(push("t", "and another"));
+  TEST_ASSERT_EQUAL_UINT32(2, ring.dropped.load());
+
+  // Draining frees the slots again, in order, across the wrap
+  TEST_ASSERT_EQUAL_STRING("message 0", logRingPeek(ring)->message);
+  TEST_ASSERT_EQUAL_UINT32(LOG_SLOT_COUNT, drainAll());
+  for (int i = 0; i < 3 * LOG_SLOT_COUNT; i++)
+  {
+    TEST_ASSERT_TRUE(push("t", "wrap %d", i));
+    char expected[16];
+    snprintf(expected, sizeof(expected), "wrap %d", i);
+    TEST_ASSERT_EQUAL_STRING(expected, logRingPeek(ring)->message);
+    logRingPop(ring);
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, ring.dropped.load());
+}
+
+static void test_long_message_is_truncated()
+{
+  char payload[400];
+  memset(payload, 'x', sizeof(payload) - 1);
+  payload[sizeof(payload) - 1] = '\0';
+  TEST_ASSERT_TRUE(push("mqtt", "Payload (%u bytes): %s", 399u, payload));
+  TEST_ASSERT_EQUAL_UINT32(LOG_MESSAGE_MAX - 1, strlen(logRingPeek(ring)->message));
+}
+
+static void test_costs_are_kept_per_tag_address()
+{
+  static const char tagA[] = "web";
+  static const char tagB[] = "web"; // Same text, different module: separate entry
+  logCostRecord(costs, tagA, 10);
+  logCostRecord(costs, tagA, 30);
+  logCostRecord(costs, tagB, 5);
+
+  TEST_ASSERT_TRUE(costs.tags[0].tag.load() == tagA);
+  TEST_ASSERT_EQUAL_UINT32(2, costs.tags[0].calls.load());
+  TEST_ASSERT_EQUAL_UINT32(40, costs.tags[0].totalUs.load());
+  TEST_ASSERT_EQUAL_UINT32(30, costs.tags[0].maxUs.load());
+  TEST_ASSERT_TRUE(costs.tags[1].tag.load() == tagB);
+  TEST_ASSERT_EQUAL_UINT32(1, costs.tags[1].calls.load());
+  TEST_ASSERT_EQUAL_UINT32(0, costs.untracked.load());
+}
+
+static void test_costs_past_the_table_are_untracked()
+{
+  static char tags[LOG_TAG_MAX + 3][4];
+  for (int i = 0; i < LOG_TAG_MAX + 3; i++)
+    logCostRecord(costs, tags[i], 1);
+  TEST_ASSERT_EQUAL_UINT32(3, costs.untracked.load());
+  logCostRecord(costs, tags[0], 1); // Known tags still count
+  TEST_ASSERT_EQUAL_UINT32(2, costs.tags[0].calls.load());
+}
+
+// One TAG per module, as in src/
+static const char *TAG_MAIN = "main";
+static const char *TAG_FEEDQ = "feedq";
+static const char *TAG_MQTT = "mqtt";
+static const char *TAG_CALIB = "calib";
+static const char *TAG_STREAM = "stream";
+static const char *TAG_GATEWAY = "gateway";
+static const char *TAG_MEAL = "meal";
+
+static uint64_t nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define SITE_CALLS 20000
+
+// Times one call site into the table (in ns rather than the device's us,
+// a host call is well under a microsecond)
+#define TIME_SITE(tag, ...)                                      \
+  for (int i = 0; i < SITE_CALLS; i++)                           \
+  {                                                              \
+    uint64_t start = nowNs();                                    \
+    push(tag, __VA_ARGS__);                                      \
+    logCostRecord(costs, tag, (uint32_t)(nowNs() - start));      \
+    if ((i & 7) == 7)                                            \
+      drainAll(); /* The drain task runs every 10 ms */          \
+  }
+
+static void test_call_site_costs()
+{
+  char payload[256];
+  memset(payload, '{', sizeof(payload) - 1);
+  payload[sizeof(payload) - 1] = '\0';
+
+  TIME_SITE(TAG_MAIN, "up %lus wifi %d dBm mqtt %s heap %u (min %u) stack %u held %u logdrop %lu",
+            86400UL, -61, "ok", 181234u, 150020u, 2210u, 0u, 0UL);
+  TIME_SITE(TAG_FEEDQ, "Feed request (%s) expired after %lu ms", "manual", 30010UL);
+  TIME_SITE(TAG_MQTT, "Payload (%u bytes): %.*s", 255u, 255, payload);
+  TIME_SITE(TAG_CALIB, "✓ Calibration fitted: offset %ld, scale %.2f, rms %.2f g", -84211L, 419.73, 0.41);
+  TIME_SITE(TAG_STREAM, "Streamed %lu bytes in %u chunks (%lu B/s)", 1048576UL, 1366u, 61234UL);
+  TIME_SITE(TAG_GATEWAY, "Gateway: new feeder %s (%d total)", "feeder-a1b2c3", 12);
+  TIME_SITE(TAG_MEAL, "✓ Meal event sent: %.1fg in %lus", 41.5, 312UL);
+
+  printf("log call cost per site (%d calls each):\n", SITE_CALLS);
+  for (int i = 0; i < LOG_TAG_MAX; i++)
+  {
+    const LogTagCost &entry = costs.tags[i];
+    if (entry.tag.load() == nullptr)
+      break;
+    uint32_t calls = entry.calls.load();
+    printf("  %-8s avg %5lu ns  max %7lu ns\n", entry.tag.load(),
+           (unsigned long)(entry.totalUs.load() / calls), (unsigned long)entry.maxUs.load());
+    TEST_ASSERT_EQUAL_UINT32(SITE_CALLS, calls);
+    // A log call formats into RAM and returns; anything near a millisecond
+    // means it waited on something
+    TEST_ASSERT_LESS_THAN_UINT32(1000000, entry.totalUs.load() / calls);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, ring.dropped.load());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_keeps_order_and_fields);
+  RUN_TEST(test_full_ring_drops_and_counts);
+  RUN_TEST(test_long_message_is_truncated);
+  RUN_TEST(test_costs_are_kept_per_tag_address);
+  RUN_TEST(test_costs_past_the_table_are_untracked);
+  RUN_TEST(test_call_site_costs);
+  return UNITY_END();
+}
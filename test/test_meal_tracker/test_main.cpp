@@ -0,0 +1,155 @@
+#include <unity.h>
+#include "meal_tracker.h"
+
+static MealTracker tracker;
+static MealEvent event;
+static int meals;
+
+// One sample; counts and keeps the meal if one ends
+static void sample(unsigned long now, float weight, bool present, bool dispensing = false)
+{
+  if (mealTrackerUpdate(tracker, now, weight, present, dispensing, event))
+    meals++;
+}
+
+// Rate from the ring contents, without the running sums
+static float ringRate(const MealTracker &t)
+{
+  float grams = 0.0f;
+  unsigned long elapsed = 0;
+  for (int i = 0; i < MEAL_RATE_WINDOW; i++)
+  {
+    grams += t.consumed[i];
+    elapsed += t.elapsed[i];
+  }
+  return elapsed == 0 ? 0.0f : grams * 60000.0f / elapsed;
+}
+
+void setUp(void)
+{
+  tracker = MealTracker();
+  event = MealEvent();
+  meals = 0;
+}
+
+void tearDown(void) {}
+
+static void test_meal_detected(void)
+{
+  unsigned long t = 1000;
+  sample(t, 100.0f, true);
+  for (int i = 1; i <= 20; i++) // 1 g every 5 s
+    sample(t += 5000, 100.0f - i, true);
+  TEST_ASSERT_EQUAL(MEAL_EATING, tracker.state);
+
+  sample(t += 30000, 80.0f, false);
+  TEST_ASSERT_EQUAL(0, meals);
+  sample(t += 40000, 80.0f, false); // Quiet for MEAL_END_QUIET_MS and the pet left
+  TEST_ASSERT_EQUAL(1, meals);
+  TEST_ASSERT_EQUAL(MEAL_IDLE, tracker.state);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.0f, event.gramsEaten);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, event.startWeight);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 80.0f, event.endWeight);
+  TEST_ASSERT_EQUAL(1000 + 2 * 5000, event.startMillis); // Opened once the drop passed MEAL_START_DROP_GRAMS
+  TEST_ASSERT_EQUAL(1000 + 20 * 5000, event.endMillis);
+  TEST_ASSERT_TRUE(event.peakRate > 0.0f);
+}
+
+static void test_meal_ends_while_pet_stays(void)
+{
+  unsigned long t = 0;
+  sample(t, 100.0f, true);
+  sample(t += 1000, 90.0f, true);
+  sample(t += 2 * MEAL_END_QUIET_MS - 1000, 90.0f, true);
+  TEST_ASSERT_EQUAL(0, meals);
+  sample(t += 1000, 90.0f, true);
+  TEST_ASSERT_EQUAL(1, meals);
+}
+
+static void test_drift_and_noise_are_not_meals(void)
+{
+  unsigned long t = 0;
+  float weight = 100.0f;
+  sample(t, weight, false);
+  for (int i = 0; i < 200; i++) // Creep with nobody there
+    sample(t += 500, weight -= 0.1f, false);
+  for (int i = 0; i < 200; i++) // Jitter with the pet there
+    sample(t += 500, weight + (i % 2 ? 0.5f : -0.5f), true);
+  sample(t += 200000, weight, false);
+  TEST_ASSERT_EQUAL(0, meals);
+  TEST_ASSERT_EQUAL(MEAL_IDLE, tracker.state);
+}
+
+static void test_dispense_is_not_eating(void)
+{
+  unsigned long t = 0;
+  sample(t, 10.0f, true);
+  sample(t += 500, 35.0f, true, true); // Filling
+  sample(t += 500, 30.0f, true, true); // Settling while the servo still moves
+  sample(t += 500, 35.0f, true);
+  TEST_ASSERT_EQUAL(MEAL_IDLE, tracker.state);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, mealTrackerIntakeRate(tracker));
+}
+
+static void test_short_meal_discarded(void)
+{
+  unsigned long t = 0;
+  sample(t, 100.0f, true);
+  sample(t += 1000, 97.5f, true); // Opens a meal, below MEAL_MIN_GRAMS in total
+  TEST_ASSERT_EQUAL(MEAL_EATING, tracker.state);
+  sample(t += 2 * MEAL_END_QUIET_MS, 97.5f, false);
+  TEST_ASSERT_EQUAL(MEAL_IDLE, tracker.state);
+  TEST_ASSERT_EQUAL(0, meals);
+}
+
+// The running sums match the ring after it wraps many times
+static void test_rate_ring_matches_contents(void)
+{
+  unsigned long t = 0;
+  float weight = 500.0f;
+  sample(t, weight, true);
+  for (int i = 0; i < 10 * MEAL_RATE_WINDOW + 7; i++)
+  {
+    t += 200 + (i % 7) * 100;
+    if (i % 3 == 0)
+      weight -= 1.0f + (i % 5) * 0.25f;
+    sample(t, weight, true);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, ringRate(tracker), mealTrackerIntakeRate(tracker));
+  }
+  TEST_ASSERT_EQUAL((10 * MEAL_RATE_WINDOW + 7) % MEAL_RATE_WINDOW, tracker.head);
+}
+
+static void test_rate_ring_clamps_long_gaps(void)
+{
+  sample(0, 100.0f, true);
+  sample(100000, 100.0f, true); // Gap beyond a 16-bit slot
+  TEST_ASSERT_EQUAL(0xFFFF, tracker.elapsedSum);
+}
+
+// A meal that straddles the millis() wrap is timed correctly
+static void test_millis_wraparound(void)
+{
+  unsigned long t = (unsigned long)-1 - 12000;
+  sample(t, 100.0f, true);
+  for (int i = 1; i <= 10; i++)
+    sample(t += 5000, 100.0f - 2 * i, true);
+  TEST_ASSERT_TRUE(t < 100000); // Wrapped
+  sample(t += MEAL_END_QUIET_MS, 80.0f, false);
+  TEST_ASSERT_EQUAL(1, meals);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.0f, event.gramsEaten);
+  TEST_ASSERT_EQUAL(45000, event.endMillis - event.startMillis);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_meal_detected);
+  RUN_TEST(test_meal_ends_while_pet_stays);
+  RUN_TEST(test_drift_and_noise_are_not_meals);
+  RUN_TEST(test_dispense_is_not_eating);
+  RUN_TEST(test_short_meal_discarded);
+  RUN_TEST(test_rate_ring_matches_contents);
+  RUN_TEST(test_rate_ring_clamps_long_gaps);
+  RUN_TEST(test_millis_wraparound);
+  return UNITY_END();
+}
@@ -0,0 +1,309 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "method_stream_core.h"
+#include "history_store_core.h"
+
+// Receiving end of a stream: checks the framing of every chunk and
+// reassembles the current message
+struct Receiver
+{
+  uint32_t chunks;
+  uint32_t bytes;
+  uint16_t nextSequence;
+  size_t largestChunk;
+  bool sawLast;
+  bool outOfOrder;
+  uint32_t failAtSequence; // Sink refuses this chunk; 0 = never
+  char message[80 * 1024];
+  size_t messageLength;
+};
+
+static Receiver rx;
+
+void setUp(void)
+{
+  memset(&rx, 0, sizeof(rx));
+}
+void tearDown(void) {}
+
+static bool receive(void *context, const uint8_t *data, size_t length, uint16_t sequence, bool last)
+{
+  Receiver &r = *(Receiver *)context;
+  if (r.failAtSequence != 0 && sequence == r.failAtSequence)
+    return false;
+  if (sequence != r.nextSequence || r.sawLast)
+    r.outOfOrder = true;
+  r.nextSequence = sequence + 1;
+  r.chunks++;
+  r.bytes += length;
+  if (length > r.largestChunk)
+    r.largestChunk = length;
+  if (r.messageLength + length <= sizeof(r.message))
+    memcpy(r.message + r.messageLength, data, length);
+  r.messageLength += length;
+  r.sawLast = last;
+  return true;
+}
+
+static void startMessage()
+{
+  rx.nextSequence = 0;
+  rx.sawLast = false;
+  rx.messageLength = 0;
+}
+
+static void test_chunk_boundaries(void)
+{
+  uint8_t buffer[METHOD_CHUNK_BYTES];
+  uint8_t data[METHOD_CHUNK_BYTES * 2 + 1];
+  memset(data, 'x', sizeof(data));
+  ChunkWriter writer;
+
+  // Empty result: one empty last chunk
+  chunkWriterOpen(writer, buffer, sizeof(buffer), receive, &rx);
+  TEST_ASSERT_TRUE(chunkWriterEnd(writer));
+  TEST_ASSERT_EQUAL_UINT32(1, rx.chunks);
+  TEST_ASSERT_EQUAL_UINT32(0, rx.bytes);
+  TEST_ASSERT_TRUE(rx.sawLast);
+
+  // Exactly two chunks' worth: the last one is empty
+  setUp();
+  chunkWriterOpen(writer, buffer, sizeof(buffer), receive, &rx);
+  TEST_ASSERT_EQUAL(METHOD_CHUNK_BYTES * 2, chunkWriterWrite(writer, data, METHOD_CHUNK_BYTES * 2));
+  TEST_ASSERT_TRUE(chunkWriterEnd(writer));
+  TEST_ASSERT_EQUAL_UINT32(3, rx.chunks);
+  TEST_ASSERT_EQUAL(3, writer.sequence);
+
+  // One byte more goes in the last chunk
+  setUp();
+  chunkWriterOpen(writer, buffer, sizeof(buffer), receive, &rx);
+  chunkWriterWrite(writer, data, sizeof(data));
+  TEST_ASSERT_TRUE(chunkWriterEnd(writer));
+  TEST_ASSERT_EQUAL_UINT32(3, rx.chunks);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(data), rx.bytes);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(data), writer.total);
+  TEST_ASSERT_EQUAL(METHOD_CHUNK_BYTES, rx.largestChunk);
+  TEST_ASSERT_FALSE(rx.outOfOrder);
+}
+
+// Byte-at-a-time writes (Print::write(uint8_t)) frame the same way
+static void test_small_writes(void)
+{
+  uint8_t buffer[64];
+  ChunkWriter writer;
+  chunkWriterOpen(writer, buffer, sizeof(buffer), receive, &rx);
+  for (int i = 0; i < 1000; i++)
+  {
+    uint8_t c = (uint8_t)('a' + i % 26);
+    TEST_ASSERT_EQUAL(1, chunkWriterWrite(writer, &c, 1));
+  }
+  TEST_ASSERT_TRUE(chunkWriterEnd(writer));
+  TEST_ASSERT_EQUAL_UINT32(1000 / 64 + 1, rx.chunks);
+  TEST_ASSERT_EQUAL_UINT32(1000, rx.messageLength);
+  TEST_ASSERT_EQUAL('a' + 999 % 26, rx.message[999]);
+  TEST_ASSERT_FALSE(rx.outOfOrder);
+}
+
+// A failed publish stops the stream; nothing after it is sent
+static void test_sink_failure_stops_stream(void)
+{
+  uint8_t buffer[100];
+  uint8_t data[1000];
+  memset(data, 'y', sizeof(data));
+  rx.failAtSequence = 3;
+
+  ChunkWriter writer;
+  chunkWriterOpen(writer, buffer, sizeof(buffer), receive, &rx);
+  size_t written = chunkWriterWrite(writer, data, sizeof(data));
+  TEST_ASSERT_EQUAL(400, written);
+  TEST_ASSERT_EQUAL(0, chunkWriterWrite(writer, data, 10));
+  TEST_ASSERT_FALSE(chunkWriterEnd(writer));
+  TEST_ASSERT_EQUAL_UINT32(3, rx.chunks);
+  TEST_ASSERT_FALSE(rx.sawLast);
+}
+
+static void test_history_format(void)
+{
+  char text[HISTORY_TEXT_MAX];
+  HistoryPoint point = {HISTORY_NO_WEIGHT, HISTORY_NO_HOPPER, 0, 0, 0, 1};
+  size_t n = historyFormatPoint(text, sizeof(text), 1700000000UL, point, true);
+  TEST_ASSERT_EQUAL_STRING("[1700000000,null,null,0.0,0,0]", text);
+  TEST_ASSERT_EQUAL(strlen(text), n);
+
+  // The widest point still fits
+  HistoryPoint wide = {-32767, 65534, 65535, 65535, 65535, 65535};
+  n = historyFormatPoint(text, sizeof(text), 0xFFFFFFFFUL, wide, false);
+  TEST_ASSERT_EQUAL_STRING(",[4294967295,-3276.7,65534,6553.5,65535,65535]", text);
+  TEST_ASSERT_LESS_THAN(HISTORY_TEXT_MAX, n);
+
+  n = historyFormatHeader(text, sizeof(text), "minute", 60);
+  TEST_ASSERT_EQUAL(strlen(text), n);
+  TEST_ASSERT_LESS_THAN(HISTORY_TEXT_MAX - 1, n);
+  TEST_ASSERT_EQUAL('[', text[n - 1]);
+  historyFormatTrailer(text, sizeof(text), -1);
+  TEST_ASSERT_EQUAL_STRING("],\"next\":-1}", text);
+
+  // Cut, not overrun, when the buffer is short
+  n = historyFormatPoint(text, 8, 1700000000UL, point, true);
+  TEST_ASSERT_EQUAL(7, n);
+  TEST_ASSERT_EQUAL(7, strlen(text));
+}
+
+#define DAY_MINUTES 1440
+#define START_LOCAL 1699920000UL // A midnight, so bucket numbers line up with days
+
+static HistoryPoint minutePoints[DAY_MINUTES];
+static HistoryTier minuteTier = {60, DAY_MINUTES, minutePoints, 0, 0, {}};
+
+// A full day of samples, visits and meals in every minute bucket; the last
+// one is still open
+static void fillDay(HistoryTier &tier)
+{
+  historyClear(tier);
+  for (uint32_t m = 0; m < DAY_MINUTES; m++)
+  {
+    uint32_t t = START_LOCAL + m * 60;
+    historyAdd(tier, t, HISTORY_WEIGHT, 100.0f + m % 300);
+    historyAdd(tier, t + 10, HISTORY_HOPPER, 2500.0f - m % 1000);
+    historyAdd(tier, t + 20, HISTORY_VISIT, 1);
+    historyAdd(tier, t + 30, HISTORY_INTAKE, 2.5f);
+    historyAdd(tier, t + 40, HISTORY_DISPENSED, 5.0f);
+  }
+}
+
+// The page writer from history_store.cpp, in UTC
+static uint16_t writePage(ChunkWriter &writer, const HistoryTier &tier, const HistoryPage &page)
+{
+  char text[HISTORY_TEXT_MAX];
+  chunkWriterWrite(writer, (const uint8_t *)text,
+                   historyFormatHeader(text, sizeof(text), "minute", tier.periodS));
+  uint16_t written = 0;
+  for (uint32_t bucket = page.first; bucket <= page.end; bucket++)
+  {
+    HistoryPoint point;
+    if (!historyLookup(tier, bucket, point))
+      continue;
+    chunkWriterWrite(writer, (const uint8_t *)text,
+                     historyFormatPoint(text, sizeof(text), bucket * tier.periodS, point,
+                                        written == 0));
+    written++;
+  }
+  long next = page.more ? (long)((page.end + 1) * tier.periodS) : -1L;
+  chunkWriterWrite(writer, (const uint8_t *)text, historyFormatTrailer(text, sizeof(text), next));
+  return written;
+}
+
+// Following "next" visits every bucket once, however the page size divides
+static void test_cursor_covers_range(void)
+{
+  fillDay(minuteTier);
+  uint32_t first = START_LOCAL / 60;
+  uint32_t last = first + DAY_MINUTES - 1;
+  uint32_t pageSizes[] = {1, 7, 360, 1439, 1440, 5000};
+
+  for (unsigned s = 0; s < sizeof(pageSizes) / sizeof(pageSizes[0]); s++)
+  {
+    uint32_t cursor = first, seen = 0, pages = 0;
+    while (true)
+    {
+      HistoryPage page = historyPageRange(minuteTier, cursor, last, pageSizes[s]);
+      TEST_ASSERT_EQUAL_UINT32(cursor, page.first);
+      TEST_ASSERT_LESS_OR_EQUAL(pageSizes[s], page.end - page.first + 1);
+      seen += page.end - page.first + 1;
+      pages++;
+      if (!page.more)
+        break;
+      cursor = page.end + 1;
+    }
+    TEST_ASSERT_EQUAL_UINT32(DAY_MINUTES, seen);
+    TEST_ASSERT_EQUAL_UINT32((DAY_MINUTES + pageSizes[s] - 1) / pageSizes[s], pages);
+  }
+
+  // Older than the ring: starts at its oldest bucket
+  HistoryPage page = historyPageRange(minuteTier, 0, last, 10);
+  TEST_ASSERT_EQUAL_UINT32(minuteTier.open.bucket - DAY_MINUTES + 1, page.first);
+  // 'from' after 'to' collapses to one bucket
+  page = historyPageRange(minuteTier, last + 5, last, 10);
+  TEST_ASSERT_EQUAL_UINT32(last, page.first);
+  TEST_ASSERT_EQUAL_UINT32(last, page.end);
+  TEST_ASSERT_FALSE(page.more);
+}
+
+// Pages a full day of minute history again and again through a chunk
+// buffer of 'capacity' bytes until 'target' bytes have gone out
+static double streamHistory(size_t capacity, uint32_t target, uint32_t &chunks)
+{
+  static uint8_t buffer[METHOD_CHUNK_BYTES];
+  uint32_t first = START_LOCAL / 60;
+  uint32_t last = first + DAY_MINUTES - 1;
+  uint32_t total = 0;
+  chunks = 0;
+
+  clock_t start = clock();
+  while (total < target)
+  {
+    uint32_t cursor = first;
+    while (true)
+    {
+      HistoryPage page = historyPageRange(minuteTier, cursor, last, 360);
+      startMessage();
+      ChunkWriter writer;
+      chunkWriterOpen(writer, buffer, capacity, receive, &rx);
+      uint16_t points = writePage(writer, minuteTier, page);
+      TEST_ASSERT_TRUE(chunkWriterEnd(writer));
+
+      // Every page arrives whole, in order, and is one JSON object
+      TEST_ASSERT_EQUAL(360, points);
+      TEST_ASSERT_TRUE(rx.sawLast);
+      TEST_ASSERT_FALSE(rx.outOfOrder);
+      TEST_ASSERT_EQUAL_UINT32(writer.total, rx.messageLength);
+      TEST_ASSERT_EQUAL('{', rx.message[0]);
+      TEST_ASSERT_EQUAL('}', rx.message[rx.messageLength - 1]);
+
+      total += writer.total;
+      chunks += writer.sequence;
+      if (!page.more)
+        break;
+      cursor = page.end + 1;
+    }
+  }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  return seconds;
+}
+
+// The full result never sits in RAM: only the chunk buffer and one line of
+// text do, whatever the size of the result
+static void test_history_throughput(void)
+{
+  fillDay(minuteTier);
+  const uint32_t target = 8UL * 1024 * 1024;
+  size_t capacities[] = {METHOD_CHUNK_BYTES, 256, 64};
+
+  for (unsigned c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++)
+  {
+    setUp();
+    uint32_t chunks;
+    double seconds = streamHistory(capacities[c], target, chunks);
+    TEST_ASSERT_GREATER_OR_EQUAL(target, rx.bytes);
+    TEST_ASSERT_LESS_OR_EQUAL(capacities[c], rx.largestChunk);
+    TEST_ASSERT_EQUAL_UINT32(rx.chunks, chunks);
+
+    double mb = rx.bytes / (1024.0 * 1024.0);
+    printf("history stream: %.1f MB in %lu chunks of %u bytes, %.1f MB/s\n", mb,
+           (unsigned long)chunks, (unsigned)capacities[c], seconds > 0 ? mb / seconds : 0.0);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_chunk_boundaries);
+  RUN_TEST(test_small_writes);
+  RUN_TEST(test_sink_failure_stops_stream);
+  RUN_TEST(test_history_format);
+  RUN_TEST(test_cursor_covers_range);
+  RUN_TEST(test_history_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,83 @@
+#include <unity.h>
+#include <string.h>
+#include "network_manager_core.h"
+
+static char method[32];
+static char requestId[40];
+
+static bool parse(const char *topic)
+{
+  return parseMethodTopic(topic, method, sizeof(method), requestId, sizeof(requestId));
+}
+
+void setUp(void)
+{
+  // Garbage, so a missing terminator shows up
+  memset(method, 'x', sizeof(method));
+  memset(requestId, 'x', sizeof(requestId));
+}
+
+void tearDown(void) {}
+
+static void test_method_topic_parsed(void)
+{
+  TEST_ASSERT_TRUE(parse("$iothub/methods/POST/runMotors/?$rid=42"));
+  TEST_ASSERT_EQUAL_STRING("runMotors", method);
+  TEST_ASSERT_EQUAL_STRING("42", requestId);
+}
+
+static void test_request_id_stops_at_next_property(void)
+{
+  TEST_ASSERT_TRUE(parse("$iothub/methods/POST/trace/?$rid=a1b2&$version=3"));
+  TEST_ASSERT_EQUAL_STRING("trace", method);
+  TEST_ASSERT_EQUAL_STRING("a1b2", requestId);
+}
+
+static void test_missing_request_id(void)
+{
+  TEST_ASSERT_FALSE(parse("$iothub/methods/POST/runMotors/"));
+  TEST_ASSERT_EQUAL_STRING("runMotors", method);
+  TEST_ASSERT_EQUAL_STRING("", requestId);
+}
+
+static void test_missing_or_empty_method(void)
+{
+  TEST_ASSERT_FALSE(parse("$iothub/twin/res/200/?$rid=7"));
+  TEST_ASSERT_EQUAL_STRING("", method);
+  TEST_ASSERT_EQUAL_STRING("7", requestId); // Still there for an error response
+
+  TEST_ASSERT_FALSE(parse("$iothub/methods/POST//?$rid=7"));
+  TEST_ASSERT_EQUAL_STRING("", method);
+
+  TEST_ASSERT_FALSE(parse("$iothub/methods/POST/runMotors"));
+  TEST_ASSERT_EQUAL_STRING("", method);
+}
+
+static void test_method_name_too_long(void)
+{
+  TEST_ASSERT_FALSE(parse("$iothub/methods/POST/abcdefghijklmnopqrstuvwxyz0123456789/?$rid=1"));
+  TEST_ASSERT_EQUAL_STRING("", method);
+
+  // 31 characters plus the terminator just fit
+  TEST_ASSERT_TRUE(parse("$iothub/methods/POST/abcdefghijklmnopqrstuvwxyz01234/?$rid=1"));
+  TEST_ASSERT_EQUAL_STRING("abcdefghijklmnopqrstuvwxyz01234", method);
+}
+
+static void test_long_request_id_truncated(void)
+{
+  TEST_ASSERT_TRUE(parse("$iothub/methods/POST/m/?$rid=0123456789012345678901234567890123456789XYZ"));
+  TEST_ASSERT_EQUAL(39, strlen(requestId));
+  TEST_ASSERT_EQUAL_STRING("012345678901234567890123456789012345678", requestId);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_method_topic_parsed);
+  RUN_TEST(test_request_id_stops_at_next_property);
+  RUN_TEST(test_missing_request_id);
+  RUN_TEST(test_missing_or_empty_method);
+  RUN_TEST(test_method_name_too_long);
+  RUN_TEST(test_long_request_id_truncated);
+  return UNITY_END();
+}
@@ -0,0 +1,278 @@
+#include <unity.h>
+#include <stdio.h>
+#include "sampling_policy_core.h"
+
+// A day of feeder activity on a 10 ms loop tick, read the way
+// handleSensors() reads: updateSamplingMode(), then each sensor when
+// now - last >= its rate. The read costs are assumptions, not
+// measurements: an HX711 at its default 10 SPS blocks ~100 ms per
+// conversion, an echo from a half-full hopper takes ~2 ms of pulseIn().
+// The clock is not stretched by the reads, so both policies get the same
+// schedule of reads they would ask for. This is the loop reading the chip
+// itself, as it does when the dispense capture sampler is not running; with
+// the sampler every conversion is read once whatever the mode.
+#define TICK_MS 10
+#define DAY_MS (24UL * 3600 * 1000)
+#define HX711_CONVERSION_US 100000
+#define ECHO_US 2000
+
+struct Span
+{
+  uint32_t startMs;
+  uint32_t lengthMs;
+};
+
+#define HOURS(h) ((uint32_t)((h) * 3600.0 * 1000))
+
+// Four scheduled feeds (FEEDING_TIME_1..4); the hopper runs 6 s each
+static const Span dispenses[] = {
+    {HOURS(7), 6000},
+    {HOURS(12), 6000},
+    {HOURS(18), 6000},
+    {HOURS(22), 6000},
+};
+
+// A meal 30 s after each feed, and a short look-in every other hour
+static const Span visits[] = {
+    {HOURS(7) + 30000, 8 * 60000},  {HOURS(12) + 30000, 8 * 60000},
+    {HOURS(18) + 30000, 8 * 60000}, {HOURS(22) + 30000, 8 * 60000},
+    {HOURS(1.5), 45000},            {HOURS(3.5), 45000},
+    {HOURS(5.5), 45000},            {HOURS(9.5), 45000},
+    {HOURS(13.5), 45000},           {HOURS(15.5), 45000},
+    {HOURS(19.5), 45000},           {HOURS(23.5), 45000},
+};
+
+static bool within(const Span *spans, size_t count, uint32_t now)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (now >= spans[i].startMs && now - spans[i].startMs < spans[i].lengthMs)
+      return true;
+  }
+  return false;
+}
+
+struct DayResult
+{
+  SamplingStats stats;
+  uint32_t worstPresenceWeightGapMs; // Between reads while the pet is there
+  uint32_t worstPresenceStartMs;     // Arrival to first weight read
+  uint32_t worstDispenseLevelGapMs;  // Between reads in DISPENSE mode
+  uint32_t worstDispenseStartMs;     // Hopper start to first level read
+  uint32_t worstIdleLevelGapMs;
+};
+
+static DayResult runDay(const SamplingPolicy &policy)
+{
+  DayResult result = DayResult();
+
+  uint32_t hopperActiveMillis = 0;
+  uint32_t lastWeight = 0, lastLevel = 0;
+  uint32_t presenceSince = 0, dispenseSince = 0;
+  bool wasPresent = false, wasDispensing = false;
+  bool presenceRead = false, dispenseRead = false;
+  SamplingMode lastLevelMode = SAMPLING_IDLE;
+
+  for (uint32_t now = TICK_MS; now <= DAY_MS; now += TICK_MS)
+  {
+    bool dispensing = within(dispenses, sizeof(dispenses) / sizeof(dispenses[0]), now);
+    bool present = within(visits, sizeof(visits) / sizeof(visits[0]), now);
+    SamplingMode mode = samplingModeAt(hopperActiveMillis, now, dispensing, present);
+    if (mode != result.stats.mode)
+    {
+      result.stats.mode = mode;
+      result.stats.modeChanges++;
+    }
+    const SamplingRates &rates = policy.rates[mode];
+
+    if (present && !wasPresent)
+    {
+      presenceSince = now;
+      presenceRead = false;
+    }
+    if (dispensing && !wasDispensing)
+    {
+      dispenseSince = now;
+      dispenseRead = false;
+    }
+    wasPresent = present;
+    wasDispensing = dispensing;
+
+    if (now - lastLevel >= rates.ultrasonicMs)
+    {
+      result.stats.ultrasonicReads++;
+      result.stats.ultrasonicBusyUs += ECHO_US;
+      uint32_t gap = now - lastLevel;
+      if (mode == SAMPLING_DISPENSE && lastLevelMode == SAMPLING_DISPENSE &&
+          gap > result.worstDispenseLevelGapMs)
+        result.worstDispenseLevelGapMs = gap;
+      if (mode == SAMPLING_IDLE && gap > result.worstIdleLevelGapMs)
+        result.worstIdleLevelGapMs = gap;
+      if (dispensing && !dispenseRead)
+      {
+        dispenseRead = true;
+        if (now - dispenseSince > result.worstDispenseStartMs)
+          result.worstDispenseStartMs = now - dispenseSince;
+      }
+      lastLevel = now;
+      lastLevelMode = mode;
+    }
+
+    if (now - lastWeight >= rates.weightMs)
+    {
+      result.stats.weightReads++;
+      result.stats.weightConversions += rates.weightReadings;
+      result.stats.weightBusyUs += (uint64_t)rates.weightReadings * HX711_CONVERSION_US;
+      if (present)
+      {
+        if (presenceRead && now - lastWeight > result.worstPresenceWeightGapMs)
+          result.worstPresenceWeightGapMs = now - lastWeight;
+        if (!presenceRead && now - presenceSince > result.worstPresenceStartMs)
+          result.worstPresenceStartMs = now - presenceSince;
+        presenceRead = true;
+      }
+      lastWeight = now;
+    }
+  }
+  return result;
+}
+
+static SamplingPolicy fixedRatePolicy()
+{
+  SamplingPolicy policy = defaultSamplingPolicy;
+  for (uint8_t m = 0; m < SAMPLING_MODE_COUNT; m++)
+  {
+    policy.rates[m].weightMs = WEIGHT_READ_INTERVAL;
+    policy.rates[m].ultrasonicMs = ULTRASONIC_READ_INTERVAL;
+    policy.rates[m].weightReadings = SCALE_READINGS;
+  }
+  return policy;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_mode_selection()
+{
+  TEST_ASSERT_EQUAL(SAMPLING_IDLE, selectSamplingMode(false, false));
+  TEST_ASSERT_EQUAL(SAMPLING_PRESENCE, selectSamplingMode(false, true));
+  TEST_ASSERT_EQUAL(SAMPLING_DISPENSE, selectSamplingMode(true, false));
+  TEST_ASSERT_EQUAL(SAMPLING_DISPENSE, selectSamplingMode(true, true));
+}
+
+static void test_dispense_lingers_then_drops()
+{
+  uint32_t hopperActiveMillis = 0;
+  TEST_ASSERT_EQUAL(SAMPLING_IDLE, samplingModeAt(hopperActiveMillis, 5000, false, false));
+  TEST_ASSERT_EQUAL(SAMPLING_DISPENSE, samplingModeAt(hopperActiveMillis, 6000, true, false));
+  TEST_ASSERT_EQUAL(SAMPLING_DISPENSE, samplingModeAt(hopperActiveMillis, 12000, true, false));
+  TEST_ASSERT_EQUAL(SAMPLING_DISPENSE,
+                    samplingModeAt(hopperActiveMillis, 12000 + SAMPLING_DISPENSE_LINGER_MS - 1, false, false));
+  TEST_ASSERT_EQUAL(SAMPLING_PRESENCE,
+                    samplingModeAt(hopperActiveMillis, 12000 + SAMPLING_DISPENSE_LINGER_MS, false, true));
+  TEST_ASSERT_EQUAL(SAMPLING_IDLE,
+                    samplingModeAt(hopperActiveMillis, 12000 + SAMPLING_DISPENSE_LINGER_MS, false, false));
+}
+
+static void test_rate_bounds()
+{
+  SamplingRates rates = {500, 1000, 3, {}};
+  TEST_ASSERT_TRUE(samplingRatesValid(rates));
+  rates.weightMs = 99;
+  TEST_ASSERT_FALSE(samplingRatesValid(rates));
+  rates.weightMs = 60001; // Meal tracker gaps are 16-bit
+  TEST_ASSERT_FALSE(samplingRatesValid(rates));
+  rates.weightMs = 500;
+  rates.weightReadings = 0;
+  TEST_ASSERT_FALSE(samplingRatesValid(rates));
+  rates.weightReadings = 3;
+  rates.ultrasonicMs = 600001;
+  TEST_ASSERT_FALSE(samplingRatesValid(rates));
+
+  for (uint8_t m = 0; m < SAMPLING_MODE_COUNT; m++)
+    TEST_ASSERT_TRUE(samplingRatesValid(defaultSamplingPolicy.rates[m]));
+  TEST_ASSERT_TRUE(samplingRatesValid(fixedRatePolicy().rates[SAMPLING_IDLE]));
+}
+
+static void test_mode_names()
+{
+  TEST_ASSERT_EQUAL_STRING("IDLE", getSamplingModeName(SAMPLING_IDLE));
+  TEST_ASSERT_EQUAL_STRING("PRESENCE", getSamplingModeName(SAMPLING_PRESENCE));
+  TEST_ASSERT_EQUAL_STRING("DISPENSE", getSamplingModeName(SAMPLING_DISPENSE));
+  TEST_ASSERT_EQUAL_STRING("UNKNOWN", getSamplingModeName(SAMPLING_MODE_COUNT));
+}
+
+// The point of the policy: a day costs a fraction of the fixed rates
+static void test_day_saves_cpu_over_fixed_rates()
+{
+  DayResult adaptive = runDay(defaultSamplingPolicy);
+  DayResult fixed = runDay(fixedRatePolicy());
+
+  float adaptiveBusy, adaptiveEstimate, fixedBusy, fixedEstimate;
+  samplingLoad(adaptive.stats, DAY_MS, adaptiveBusy, adaptiveEstimate);
+  samplingLoad(fixed.stats, DAY_MS, fixedBusy, fixedEstimate);
+
+  printf("sampling: adaptive %.2f%% busy (%lu weight, %lu level reads, %lu mode changes), "
+         "fixed %.2f%% (%lu weight, %lu level reads)\n",
+         adaptiveBusy, (unsigned long)adaptive.stats.weightReads,
+         (unsigned long)adaptive.stats.ultrasonicReads, (unsigned long)adaptive.stats.modeChanges,
+         fixedBusy, (unsigned long)fixed.stats.weightReads, (unsigned long)fixed.stats.ultrasonicReads);
+
+  TEST_ASSERT_TRUE(adaptiveBusy > 0.0f);
+  TEST_ASSERT_TRUE(adaptiveBusy < fixedBusy / 2);
+  // Every feed and every visit switched modes and back
+  TEST_ASSERT_TRUE(adaptive.stats.modeChanges >= 2 * 12);
+
+  // What /sampling reports as fixedRatePercent is what the fixed rates
+  // actually cost over the same day
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, fixedBusy, adaptiveEstimate);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, fixedBusy, fixedEstimate);
+}
+
+// Savings must not cost the readings that matter
+static void test_day_keeps_reads_where_needed()
+{
+  DayResult adaptive = runDay(defaultSamplingPolicy);
+  const SamplingRates &presence = defaultSamplingPolicy.rates[SAMPLING_PRESENCE];
+  const SamplingRates &dispense = defaultSamplingPolicy.rates[SAMPLING_DISPENSE];
+  const SamplingRates &idle = defaultSamplingPolicy.rates[SAMPLING_IDLE];
+
+  // The meal tracker sees an arrival on the next pass and then every 200 ms
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(TICK_MS, adaptive.worstPresenceStartMs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(presence.weightMs + TICK_MS, adaptive.worstPresenceWeightGapMs);
+  TEST_ASSERT_TRUE(adaptive.worstPresenceWeightGapMs > 0);
+
+  // The hopper cross-check gets the old fixed level rate while dispensing
+  // and through the linger
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(TICK_MS, adaptive.worstDispenseStartMs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(dispense.ultrasonicMs + TICK_MS, adaptive.worstDispenseLevelGapMs);
+  TEST_ASSERT_TRUE(adaptive.worstDispenseLevelGapMs > 0);
+
+  // An idle hopper is still looked at once a minute
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(idle.ultrasonicMs + TICK_MS, adaptive.worstIdleLevelGapMs);
+}
+
+static void test_load_without_reads()
+{
+  SamplingStats stats;
+  float busy = -1.0f, fixed = -1.0f;
+  samplingLoad(stats, 0, busy, fixed);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, busy);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, fixed);
+  samplingLoad(stats, 60000, busy, fixed);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, busy);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, fixed);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_mode_selection);
+  RUN_TEST(test_dispense_lingers_then_drops);
+  RUN_TEST(test_rate_bounds);
+  RUN_TEST(test_mode_names);
+  RUN_TEST(test_day_saves_cpu_over_fixed_rates);
+  RUN_TEST(test_day_keeps_reads_where_needed);
+  RUN_TEST(test_load_without_reads);
+  return UNITY_END();
+}
@@ -0,0 +1,118 @@
+#include <unity.h>
+#include <string.h>
+#include "sas_token_core.h"
+
+// Stands in for HMAC-SHA256: records what was signed, returns 0x00..0x1F
+static char signedMessage[200];
+static size_t signedKeyLength;
+static bool hmacFails;
+
+static bool fakeHmac(const uint8_t *key, size_t keyLength, const uint8_t *message,
+                     size_t messageLength, uint8_t *digest)
+{
+  signedKeyLength = keyLength;
+  memcpy(signedMessage, message, messageLength);
+  signedMessage[messageLength] = '\0';
+  for (int i = 0; i < SAS_DIGEST_BYTES; i++)
+    digest[i] = (uint8_t)i;
+  return !hmacFails;
+}
+
+static const uint8_t key[] = {1, 2, 3, 4};
+
+void setUp(void)
+{
+  signedMessage[0] = '\0';
+  signedKeyLength = 0;
+  hmacFails = false;
+}
+
+void tearDown(void) {}
+
+static void test_url_encode(void)
+{
+  char out[64];
+  const char *in = "hub.azure-devices.net/devices/Pet Feeder_1~";
+  TEST_ASSERT_EQUAL(49, urlEncode(in, strlen(in), out, sizeof(out)));
+  TEST_ASSERT_EQUAL_STRING("hub.azure-devices.net%2Fdevices%2FPet%20Feeder_1~", out);
+
+  const char *sig = "a+b/c=";
+  TEST_ASSERT_EQUAL(12, urlEncode(sig, strlen(sig), out, sizeof(out)));
+  TEST_ASSERT_EQUAL_STRING("a%2Bb%2Fc%3D", out);
+
+  // Output plus terminator must fit
+  TEST_ASSERT_EQUAL(0, urlEncode("abc", 3, out, 3));
+  TEST_ASSERT_EQUAL(3, urlEncode("abc", 3, out, 4));
+  TEST_ASSERT_EQUAL(0, urlEncode("/", 1, out, 3));
+}
+
+// RFC 4648 test vectors
+static void test_base64_encode(void)
+{
+  static const char *const plain[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+  static const char *const encoded[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+  char out[16];
+  for (int i = 0; i < 7; i++)
+  {
+    size_t length = base64Encode((const uint8_t *)plain[i], strlen(plain[i]), out, sizeof(out));
+    TEST_ASSERT_EQUAL(strlen(encoded[i]), length);
+    TEST_ASSERT_EQUAL_STRING(encoded[i], out);
+  }
+
+  const uint8_t bytes[] = {0xFB, 0xFF};
+  TEST_ASSERT_EQUAL(4, base64Encode(bytes, 2, out, sizeof(out)));
+  TEST_ASSERT_EQUAL_STRING("+/8=", out);
+  TEST_ASSERT_EQUAL(0, base64Encode(bytes, 2, out, 4));
+}
+
+static void test_token_format(void)
+{
+  char token[300];
+  size_t length = buildSasToken(fakeHmac, key, sizeof(key), "hub.azure-devices.net/devices/PetFeeder_001",
+                                1700000000UL, token, sizeof(token));
+
+  TEST_ASSERT_EQUAL_STRING("hub.azure-devices.net%2Fdevices%2FPetFeeder_001\n1700000000", signedMessage);
+  TEST_ASSERT_EQUAL(sizeof(key), signedKeyLength);
+  TEST_ASSERT_EQUAL_STRING("SharedAccessSignature sr=hub.azure-devices.net%2Fdevices%2FPetFeeder_001"
+                           "&sig=AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8%3D&se=1700000000",
+                           token);
+  TEST_ASSERT_EQUAL(strlen(token), length);
+}
+
+static void test_token_buffer_too_small(void)
+{
+  char token[300];
+  size_t length = buildSasToken(fakeHmac, key, sizeof(key), "hub/devices/d", 1, token, sizeof(token));
+  TEST_ASSERT_GREATER_THAN(0, length);
+
+  TEST_ASSERT_EQUAL(0, buildSasToken(fakeHmac, key, sizeof(key), "hub/devices/d", 1, token, length));
+  TEST_ASSERT_EQUAL(length, buildSasToken(fakeHmac, key, sizeof(key), "hub/devices/d", 1, token, length + 1));
+}
+
+static void test_token_resource_too_long(void)
+{
+  char uri[200];
+  memset(uri, '/', sizeof(uri) - 1); // 3 bytes each once encoded
+  uri[sizeof(uri) - 1] = '\0';
+  char token[300];
+  TEST_ASSERT_EQUAL(0, buildSasToken(fakeHmac, key, sizeof(key), uri, 1, token, sizeof(token)));
+}
+
+static void test_token_hmac_failure(void)
+{
+  hmacFails = true;
+  char token[300];
+  TEST_ASSERT_EQUAL(0, buildSasToken(fakeHmac, key, sizeof(key), "hub/devices/d", 1, token, sizeof(token)));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_url_encode);
+  RUN_TEST(test_base64_encode);
+  RUN_TEST(test_token_format);
+  RUN_TEST(test_token_buffer_too_small);
+  RUN_TEST(test_token_resource_too_long);
+  RUN_TEST(test_token_hmac_failure);
+  return UNITY_END();
+}
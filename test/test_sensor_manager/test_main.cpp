@@ -0,0 +1,60 @@
+#include <unity.h>
+#include "sensor_manager_core.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_food_level_boundaries(void)
+{
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_FULL, getFoodLevel(0.0f));
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_FULL, getFoodLevel(FOOD_FULL_DISTANCE));
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_HALF, getFoodLevel(FOOD_FULL_DISTANCE + 0.01f));
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_HALF, getFoodLevel(FOOD_HALF_DISTANCE));
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_HALF, getFoodLevel(FOOD_EMPTY_DISTANCE));
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_EMPTY, getFoodLevel(FOOD_EMPTY_DISTANCE + 0.01f));
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_EMPTY, getFoodLevel(400.0f)); // No echo
+}
+
+// Farther from the sensor never reads as more food
+static void test_food_level_monotonic(void)
+{
+  FoodLevel previous = getFoodLevel(0.0f);
+  for (int mm = 0; mm <= 500; mm++)
+  {
+    FoodLevel level = getFoodLevel(mm * 0.1f);
+    TEST_ASSERT_LESS_OR_EQUAL(previous, level);
+    previous = level;
+  }
+}
+
+static void test_bowl_status_boundaries(void)
+{
+  TEST_ASSERT_EQUAL(BOWL_STATUS_EMPTY, getBowlStatus(-5.0f)); // Tare drift
+  TEST_ASSERT_EQUAL(BOWL_STATUS_EMPTY, getBowlStatus(EMPTY_BOWL_THRESHOLD));
+  TEST_ASSERT_EQUAL(BOWL_STATUS_PARTIAL, getBowlStatus(EMPTY_BOWL_THRESHOLD + 0.1f));
+  TEST_ASSERT_EQUAL(BOWL_STATUS_PARTIAL, getBowlStatus(FULL_BOWL_THRESHOLD - 0.1f));
+  TEST_ASSERT_EQUAL(BOWL_STATUS_FULL, getBowlStatus(FULL_BOWL_THRESHOLD));
+  TEST_ASSERT_EQUAL(BOWL_STATUS_FULL, getBowlStatus(5000.0f));
+}
+
+static void test_bowl_status_monotonic(void)
+{
+  BowlStatus previous = getBowlStatus(-10.0f);
+  for (int dg = -100; dg <= 3000; dg++)
+  {
+    BowlStatus status = getBowlStatus(dg * 0.1f);
+    TEST_ASSERT_NOT_EQUAL(BOWL_STATUS_ERROR, status);
+    TEST_ASSERT_GREATER_OR_EQUAL(previous, status);
+    previous = status;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_food_level_boundaries);
+  RUN_TEST(test_food_level_monotonic);
+  RUN_TEST(test_bowl_status_boundaries);
+  RUN_TEST(test_bowl_status_monotonic);
+  return UNITY_END();
+}
@@ -0,0 +1,118 @@
+#include <unity.h>
+#include "servo_motion_core.h"
+
+static const MotionProfile profiles[] = {PROFILE_TRAPEZOID, PROFILE_SCURVE};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_profile_endpoints_and_clamping(void)
+{
+  for (MotionProfile profile : profiles)
+  {
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, motionProfilePosition(profile, 0.0f));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, motionProfilePosition(profile, 1.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, motionProfilePosition(profile, -0.5f));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, motionProfilePosition(profile, 1.5f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, motionProfilePosition(profile, 0.5f));
+  }
+}
+
+// Never moves backwards, never overshoots, and the step between 10 ms ticks
+// stays bounded (no jump at the trapezoid's phase changes)
+static void test_profile_monotonic_and_continuous(void)
+{
+  for (MotionProfile profile : profiles)
+  {
+    float previous = 0.0f;
+    for (int i = 1; i <= 1000; i++)
+    {
+      float position = motionProfilePosition(profile, i / 1000.0f);
+      TEST_ASSERT_TRUE(position >= previous);
+      TEST_ASSERT_TRUE(position <= 1.0f);
+      TEST_ASSERT_TRUE(position - previous < 0.002f); // Peak speed is 1.5 (trapezoid), 1.875 (S-curve)
+      previous = position;
+    }
+  }
+}
+
+// Deceleration mirrors acceleration
+static void test_profile_symmetric(void)
+{
+  for (MotionProfile profile : profiles)
+  {
+    for (int i = 0; i <= 100; i++)
+    {
+      float t = i / 100.0f;
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, motionProfilePosition(profile, t) + motionProfilePosition(profile, 1.0f - t));
+    }
+  }
+}
+
+// S-curve starts and ends with zero velocity; the trapezoid ramps linearly
+static void test_profile_shapes(void)
+{
+  TEST_ASSERT_TRUE(motionProfilePosition(PROFILE_SCURVE, 0.01f) < 1e-5f);
+  TEST_ASSERT_TRUE(1.0f - motionProfilePosition(PROFILE_SCURVE, 0.99f) < 1e-5f);
+
+  float v1 = motionProfilePosition(PROFILE_TRAPEZOID, 0.40f) - motionProfilePosition(PROFILE_TRAPEZOID, 0.39f);
+  float v2 = motionProfilePosition(PROFILE_TRAPEZOID, 0.60f) - motionProfilePosition(PROFILE_TRAPEZOID, 0.59f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.015f, v1); // Cruise at 1.5x the average speed
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, v1, v2);
+}
+
+static void test_default_pattern(void)
+{
+  DispensePattern pattern = DEFAULT_DISPENSE_PATTERN;
+  TEST_ASSERT_TRUE(isValidDispensePattern(pattern));
+  // 3 cycles of (2 x 250 ms move + 500 ms dwell) with two 400 ms pauses
+  TEST_ASSERT_EQUAL_UINT32(3800, dispensePatternDurationMs(pattern));
+}
+
+static void test_pattern_duration_with_wiggle(void)
+{
+  DispensePattern pattern = DEFAULT_DISPENSE_PATTERN;
+  pattern.cycles = 1;
+  pattern.wiggleCount = 2;
+  pattern.wiggleMs = 100;
+  TEST_ASSERT_TRUE(isValidDispensePattern(pattern));
+  TEST_ASSERT_EQUAL_UINT32(2 * 250 + 500 + 3 * 100, dispensePatternDurationMs(pattern));
+}
+
+static void test_invalid_patterns_rejected(void)
+{
+  DispensePattern pattern = DEFAULT_DISPENSE_PATTERN;
+  pattern.version = MOTION_PATTERN_VERSION + 1;
+  TEST_ASSERT_FALSE(isValidDispensePattern(pattern));
+
+  pattern = DEFAULT_DISPENSE_PATTERN;
+  pattern.cycles = 0;
+  TEST_ASSERT_FALSE(isValidDispensePattern(pattern));
+
+  pattern = DEFAULT_DISPENSE_PATTERN;
+  pattern.openAngle = 178;
+  pattern.wiggleDegrees = 8; // Would wiggle past 180
+  TEST_ASSERT_FALSE(isValidDispensePattern(pattern));
+
+  pattern = DEFAULT_DISPENSE_PATTERN;
+  pattern.moveMs = 10; // Slam
+  TEST_ASSERT_FALSE(isValidDispensePattern(pattern));
+
+  pattern = DEFAULT_DISPENSE_PATTERN;
+  pattern.wiggleCount = 2;
+  pattern.wiggleMs = 10;
+  TEST_ASSERT_FALSE(isValidDispensePattern(pattern));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_profile_endpoints_and_clamping);
+  RUN_TEST(test_profile_monotonic_and_continuous);
+  RUN_TEST(test_profile_symmetric);
+  RUN_TEST(test_profile_shapes);
+  RUN_TEST(test_default_pattern);
+  RUN_TEST(test_pattern_duration_with_wiggle);
+  RUN_TEST(test_invalid_patterns_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,165 @@
+#include <unity.h>
+#include "time_manager_core.h"
+
+// Same schedule as config.h
+static const int times[] = {480, 720, 1080, 1320};
+static const int count = sizeof(times) / sizeof(times[0]);
+
+// Seconds since 2000-01-01, the RtcDateTime clock
+static uint32_t rtcSeconds(int year, int month, int day, int hour, int minute)
+{
+  return (uint32_t)(daysFromCivil(year, month, day) - daysFromCivil(2000, 1, 1)) * SECONDS_PER_DAY +
+         hour * 3600UL + minute * 60UL;
+}
+
+static CivilTime civilFromRtc(uint32_t seconds)
+{
+  return civilFromUnix(seconds + UNIX_EPOCH_2000);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_feed_due_window(void)
+{
+  uint32_t now = rtcSeconds(2024, 3, 1, 8, 0);
+  TEST_ASSERT_FALSE(isScheduledFeedDue(478, times, count, now, 0));
+  TEST_ASSERT_TRUE(isScheduledFeedDue(479, times, count, now, 0));
+  TEST_ASSERT_TRUE(isScheduledFeedDue(480, times, count, now, 0));
+  TEST_ASSERT_TRUE(isScheduledFeedDue(481, times, count, now, 0));
+  TEST_ASSERT_FALSE(isScheduledFeedDue(482, times, count, now, 0));
+}
+
+static void test_feed_due_across_midnight(void)
+{
+  const int midnight[] = {0};
+  TEST_ASSERT_TRUE(isScheduledFeedDue(1439, midnight, 1, 100000, 0));
+  TEST_ASSERT_TRUE(isScheduledFeedDue(0, midnight, 1, 100000, 0));
+  TEST_ASSERT_TRUE(isScheduledFeedDue(1, midnight, 1, 100000, 0));
+  TEST_ASSERT_FALSE(isScheduledFeedDue(1438, midnight, 1, 100000, 0));
+  TEST_ASSERT_FALSE(isScheduledFeedDue(2, midnight, 1, 100000, 0));
+}
+
+static void test_feed_due_suppressed_for_an_hour(void)
+{
+  uint32_t fed = rtcSeconds(2024, 3, 1, 8, 0);
+  TEST_ASSERT_FALSE(isScheduledFeedDue(481, times, count, fed + 60, fed));
+  TEST_ASSERT_FALSE(isScheduledFeedDue(480, times, count, fed + 3599, fed));
+  TEST_ASSERT_TRUE(isScheduledFeedDue(480, times, count, fed + 3600, fed));
+}
+
+// Every minute of a leap year, feeding whenever due: each slot fires exactly
+// once a day, at its first minute
+static void test_feed_due_every_minute_of_a_year(void)
+{
+  uint32_t start = rtcSeconds(2024, 1, 1, 0, 0);
+  uint32_t end = rtcSeconds(2025, 1, 1, 0, 0);
+  uint32_t lastFeed = 0;
+  int feedsToday = 0;
+  int days = 0;
+
+  for (uint32_t now = start; now < end; now += 60)
+  {
+    int minuteOfDay = (int)(now % SECONDS_PER_DAY / 60);
+    if (minuteOfDay == 0 && now != start)
+    {
+      TEST_ASSERT_EQUAL(count, feedsToday);
+      feedsToday = 0;
+      days++;
+    }
+    if (isScheduledFeedDue(minuteOfDay, times, count, now, lastFeed))
+    {
+      bool slotStart = false;
+      for (int i = 0; i < count; i++)
+        slotStart |= minuteOfDay == times[i] - 1;
+      TEST_ASSERT_TRUE(slotStart);
+      lastFeed = now;
+      feedsToday++;
+    }
+  }
+  TEST_ASSERT_EQUAL(count, feedsToday);
+  TEST_ASSERT_EQUAL(366, days + 1); // 2024 is a leap year
+}
+
+static void test_next_feed_same_day_and_next_day(void)
+{
+  uint32_t next = nextScheduledFeedSeconds(rtcSeconds(2024, 6, 10, 7, 59), times, count);
+  TEST_ASSERT_EQUAL_UINT32(rtcSeconds(2024, 6, 10, 8, 0), next);
+
+  // Exactly at a feeding time: that one is not "next"
+  next = nextScheduledFeedSeconds(rtcSeconds(2024, 6, 10, 8, 0), times, count);
+  TEST_ASSERT_EQUAL_UINT32(rtcSeconds(2024, 6, 10, 12, 0), next);
+
+  next = nextScheduledFeedSeconds(rtcSeconds(2024, 6, 10, 22, 30), times, count);
+  TEST_ASSERT_EQUAL_UINT32(rtcSeconds(2024, 6, 11, 8, 0), next);
+}
+
+static void test_next_feed_month_and_leap_boundaries(void)
+{
+  CivilTime next = civilFromRtc(nextScheduledFeedSeconds(rtcSeconds(2024, 2, 28, 23, 0), times, count));
+  TEST_ASSERT_EQUAL(2, next.month);
+  TEST_ASSERT_EQUAL(29, next.day);
+  TEST_ASSERT_EQUAL(8, next.hour);
+
+  next = civilFromRtc(nextScheduledFeedSeconds(rtcSeconds(2023, 2, 28, 23, 0), times, count));
+  TEST_ASSERT_EQUAL(3, next.month);
+  TEST_ASSERT_EQUAL(1, next.day);
+
+  next = civilFromRtc(nextScheduledFeedSeconds(rtcSeconds(2024, 12, 31, 23, 59), times, count));
+  TEST_ASSERT_EQUAL(2025, next.year);
+  TEST_ASSERT_EQUAL(1, next.month);
+  TEST_ASSERT_EQUAL(1, next.day);
+  TEST_ASSERT_EQUAL(8, next.hour);
+  TEST_ASSERT_EQUAL(0, next.minute);
+}
+
+static void test_next_feed_unsorted_times(void)
+{
+  const int unsorted[] = {1080, 480};
+  TEST_ASSERT_EQUAL_UINT32(rtcSeconds(2024, 6, 10, 8, 0),
+                           nextScheduledFeedSeconds(rtcSeconds(2024, 6, 10, 1, 0), unsorted, 2));
+  TEST_ASSERT_EQUAL_UINT32(rtcSeconds(2024, 6, 11, 8, 0),
+                           nextScheduledFeedSeconds(rtcSeconds(2024, 6, 10, 19, 0), unsorted, 2));
+}
+
+// Every minute of a leap year: the next feed is ahead, less than a day away,
+// on a feeding time, and no feeding time is skipped on the way
+static void test_next_feed_every_minute_of_a_year(void)
+{
+  uint32_t start = rtcSeconds(2024, 1, 1, 0, 0);
+  uint32_t end = rtcSeconds(2025, 1, 1, 0, 0);
+  for (uint32_t now = start; now < end; now += 60)
+  {
+    uint32_t next = nextScheduledFeedSeconds(now + 59, times, count);
+    TEST_ASSERT_GREATER_THAN(now + 59, next);
+    TEST_ASSERT_LESS_OR_EQUAL(SECONDS_PER_DAY, next - now);
+    TEST_ASSERT_EQUAL(0, next % 60);
+
+    int nextMinute = (int)(next % SECONDS_PER_DAY / 60);
+    bool onSchedule = false;
+    for (int i = 0; i < count; i++)
+      onSchedule |= times[i] == nextMinute;
+    TEST_ASSERT_TRUE(onSchedule);
+
+    for (uint32_t t = now + 60; t < next; t += 60)
+    {
+      int minute = (int)(t % SECONDS_PER_DAY / 60);
+      for (int i = 0; i < count; i++)
+        TEST_ASSERT_NOT_EQUAL(times[i], minute);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_feed_due_window);
+  RUN_TEST(test_feed_due_across_midnight);
+  RUN_TEST(test_feed_due_suppressed_for_an_hour);
+  RUN_TEST(test_feed_due_every_minute_of_a_year);
+  RUN_TEST(test_next_feed_same_day_and_next_day);
+  RUN_TEST(test_next_feed_month_and_leap_boundaries);
+  RUN_TEST(test_next_feed_unsorted_times);
+  RUN_TEST(test_next_feed_every_minute_of_a_year);
+  return UNITY_END();
+}
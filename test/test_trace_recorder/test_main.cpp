@@ -0,0 +1,332 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "trace_recorder_core.h"
+#include "sensor_manager_core.h"
+#include "meal_tracker.h"
+#include "network_manager_core.h"
+#include "time_manager_core.h"
+
+// A recorded session, written with the same encoders the recorder uses
+static uint8_t trace[8192];
+static size_t traceLength;
+static TraceEncoder encoder;
+
+// Calibration for the session: raw = offset + scale * grams
+static const int32_t OFFSET = 84000;
+static const float SCALE = 420.0f;
+
+static void put(size_t length)
+{
+  traceLength += length;
+  TEST_ASSERT_TRUE(traceLength < sizeof(trace));
+}
+
+static void recordGrams(uint32_t ms, float grams)
+{
+  put(traceEncodeScaleRaw(encoder, trace + traceLength, ms, OFFSET + (int32_t)(grams * SCALE)));
+}
+
+static void recordDistance(uint32_t ms, float cm)
+{
+  put(traceEncodeEcho(encoder, trace + traceLength, ms, (uint32_t)(cm * 2 / 0.034f + 0.5f)));
+}
+
+static void recordMqtt(uint32_t ms, const char *topic, const char *payload)
+{
+  put(traceEncodeMqtt(encoder, trace + traceLength, ms, topic, (const uint8_t *)payload, strlen(payload)));
+}
+
+void setUp(void)
+{
+  traceLength = 0;
+}
+
+void tearDown(void) {}
+
+static void test_varint_and_zigzag_round_trip(void)
+{
+  static const int32_t values[] = {0, 1, -1, 63, -64, 64, 8191, -8192, 1 << 20, -(1 << 24),
+                                   2147483647, -2147483647 - 1};
+  for (int32_t value : values)
+  {
+    uint8_t buffer[8];
+    size_t n = putVarint(buffer, zigzag(value));
+    TEST_ASSERT_LESS_OR_EQUAL(5, n);
+    TEST_ASSERT_EQUAL_INT32(value, unzigzag(zigzag(value)));
+  }
+  uint8_t buffer[8];
+  TEST_ASSERT_EQUAL(1, putVarint(buffer, 127));
+  TEST_ASSERT_EQUAL(2, putVarint(buffer, 128));
+  TEST_ASSERT_EQUAL(0x80, buffer[0]);
+  TEST_ASSERT_EQUAL(0x01, buffer[1]);
+  TEST_ASSERT_EQUAL(1, zigzag(-1));
+  TEST_ASSERT_EQUAL(2, zigzag(1));
+}
+
+// Every record type comes back as written, across a millis() wrap
+static void test_records_round_trip(void)
+{
+  uint32_t start = 0xFFFFFFFFu - 1500;
+  put(traceEncodeHeader(encoder, trace, 1717200000, start));
+  put(traceEncodeScaleRaw(encoder, trace + traceLength, start + 100, -123456));
+  put(traceEncodeScaleRaw(encoder, trace + traceLength, start + 600, 987654));
+  put(traceEncodeEcho(encoder, trace + traceLength, start + 1000, 529));
+  put(traceEncodePir(encoder, trace + traceLength, start + 2000, true));
+  put(traceEncodeButton(encoder, trace + traceLength, start + 2100, 2, false));
+
+  char topic[200];
+  memset(topic, 't', sizeof(topic) - 1);
+  topic[sizeof(topic) - 1] = '\0';
+  uint8_t payload[300] = {0x7B, 0x00, 0xFF};
+  put(traceEncodeMqtt(encoder, trace + traceLength, start + 70000, topic, payload, sizeof(payload)));
+
+  TracePlayer player;
+  TraceRecord record;
+  TEST_ASSERT_TRUE(traceOpen(player, trace, traceLength));
+  TEST_ASSERT_EQUAL_UINT32(1717200000, player.epoch);
+  TEST_ASSERT_EQUAL_UINT32(start, player.startMillis);
+
+  TEST_ASSERT_TRUE(traceNext(player, record));
+  TEST_ASSERT_EQUAL(TRACE_HX711, record.type);
+  TEST_ASSERT_EQUAL_UINT32(start + 100, record.millis);
+  TEST_ASSERT_EQUAL_INT32(-123456, record.scaleRaw);
+
+  TEST_ASSERT_TRUE(traceNext(player, record));
+  TEST_ASSERT_EQUAL_INT32(987654, record.scaleRaw);
+
+  TEST_ASSERT_TRUE(traceNext(player, record));
+  TEST_ASSERT_EQUAL(TRACE_ECHO, record.type);
+  TEST_ASSERT_EQUAL_UINT32(529, record.echoMicros);
+
+  TEST_ASSERT_TRUE(traceNext(player, record));
+  TEST_ASSERT_EQUAL(TRACE_PIR, record.type);
+  TEST_ASSERT_TRUE(record.level);
+  TEST_ASSERT_EQUAL_UINT32(start + 2000, record.millis); // After the wrap
+
+  TEST_ASSERT_TRUE(traceNext(player, record));
+  TEST_ASSERT_EQUAL(TRACE_BUTTON, record.type);
+  TEST_ASSERT_EQUAL(2, record.button);
+  TEST_ASSERT_FALSE(record.level);
+
+  TEST_ASSERT_TRUE(traceNext(player, record));
+  TEST_ASSERT_EQUAL(TRACE_MQTT, record.type);
+  TEST_ASSERT_EQUAL_UINT32(start + 70000, record.millis);
+  TEST_ASSERT_EQUAL(TRACE_TOPIC_MAX, record.topicLength);
+  TEST_ASSERT_EQUAL(TRACE_MQTT_MAX, record.payloadLength);
+  TEST_ASSERT_EQUAL_MEMORY(payload, record.payload, TRACE_MQTT_MAX);
+
+  TEST_ASSERT_FALSE(traceNext(player, record));
+  TEST_ASSERT_FALSE(player.corrupt);
+}
+
+static void test_bad_header_rejected(void)
+{
+  put(traceEncodeHeader(encoder, trace, 0, 0));
+  TracePlayer player;
+  TraceRecord record;
+  TEST_ASSERT_FALSE(traceOpen(player, trace, TRACE_HEADER_BYTES - 1));
+  trace[4] = TRACE_VERSION + 1;
+  TEST_ASSERT_FALSE(traceOpen(player, trace, traceLength));
+  TEST_ASSERT_FALSE(traceNext(player, record));
+}
+
+// A trace cut anywhere (the recorder lost power mid-flush) plays up to the
+// last whole record and never reads past the end
+static void test_truncated_trace_stops_cleanly(void)
+{
+  put(traceEncodeHeader(encoder, trace, 0, 0));
+  put(traceEncodeEcho(encoder, trace + traceLength, 10, 300));
+  size_t firstEnd = traceLength;
+  recordMqtt(20, "$iothub/methods/POST/trace/?$rid=1", "{\"action\":\"status\"}");
+
+  for (size_t cut = firstEnd + 1; cut < traceLength; cut++)
+  {
+    TracePlayer player;
+    TraceRecord record;
+    TEST_ASSERT_TRUE(traceOpen(player, trace, cut));
+    TEST_ASSERT_TRUE(traceNext(player, record));
+    TEST_ASSERT_FALSE(traceNext(player, record));
+    TEST_ASSERT_TRUE(player.corrupt);
+    TEST_ASSERT_LESS_OR_EQUAL(cut, player.offset);
+  }
+}
+
+static void test_unknown_record_type_stops(void)
+{
+  put(traceEncodeHeader(encoder, trace, 0, 0));
+  trace[traceLength++] = 5;  // delta
+  trace[traceLength++] = 42; // type
+  TracePlayer player;
+  TraceRecord record;
+  TEST_ASSERT_TRUE(traceOpen(player, trace, traceLength));
+  TEST_ASSERT_FALSE(traceNext(player, record));
+  TEST_ASSERT_TRUE(player.corrupt);
+}
+
+// Recorded session: the hopper drops a level, the cat arrives at 08:00
+// local time and eats 18 g, and a runMotors call comes in. Played back
+// through traceReplayRecord(), the sensor steps the firmware runs.
+static void test_replay_session_through_cores(void)
+{
+  const uint32_t epoch = 1717199940; // 2024-06-01 07:59:00 +08:00 (PHT)
+  const uint32_t start = 50000;
+  put(traceEncodeHeader(encoder, trace, epoch, start));
+
+  uint32_t t = start;
+  recordDistance(t, 8.0f);
+  recordGrams(t, 60.0f);
+  recordDistance(t += 30000, 12.0f);
+  put(traceEncodePir(encoder, trace + traceLength, t += 20000, true));
+  for (int i = 1; i <= 18; i++)
+    recordGrams(t += 2000, 60.0f - i);
+  recordMqtt(t += 500, "$iothub/methods/POST/runMotors/?$rid=17", "{}");
+  put(traceEncodePir(encoder, trace + traceLength, t += 5000, false));
+  for (int i = 0; i < 4; i++)
+    recordGrams(t += 20000, 42.0f);
+
+  TimeZoneRule zone;
+  TEST_ASSERT_TRUE(parsePosixTz("PHT-8", zone));
+  static const int feedingTimes[] = {480, 720, 1080, 1320};
+
+  SensorCore core;
+  TraceReplayEvents events;
+  MealEvent meal = {};
+  int meals = 0, visits = 0;
+  bool presentAfterPirLow = false;
+  FoodLevel firstLevel = FOOD_LEVEL_EMPTY, lastLevel = FOOD_LEVEL_EMPTY;
+  int echoes = 0;
+  char method[32] = "", requestId[40] = "";
+  bool feedDueSeen = false;
+
+  TracePlayer player;
+  TraceRecord record;
+  TEST_ASSERT_TRUE(traceOpen(player, trace, traceLength));
+  while (traceNext(player, record))
+  {
+    uint32_t unixUtc = player.epoch + (record.millis - player.startMillis) / 1000;
+    uint32_t local = unixUtc + utcOffsetAt(zone, unixUtc);
+    traceReplayRecord(core, record, OFFSET, SCALE, events);
+    if (events.mealEnded)
+    {
+      meals++;
+      meal = events.meal;
+    }
+    if (events.visitEnded)
+      visits++;
+    if (events.levelRead)
+    {
+      lastLevel = core.foodLevel;
+      if (echoes++ == 0)
+        firstLevel = lastLevel;
+    }
+    switch (record.type)
+    {
+    case TRACE_HX711:
+      // The PIR went low, but the pet counts as present until PIR_TIMEOUT
+      if (!core.presence.motion && record.millis - core.presence.lastMotionMillis < PIR_TIMEOUT)
+        presentAfterPirLow |= core.presence.active;
+      break;
+    case TRACE_PIR:
+      feedDueSeen |= isScheduledFeedDue((int)(local % SECONDS_PER_DAY / 60), feedingTimes, 4, local, 0);
+      break;
+    case TRACE_MQTT:
+    {
+      char topic[TRACE_TOPIC_MAX + 1];
+      memcpy(topic, record.topic, record.topicLength);
+      topic[record.topicLength] = '\0';
+      TEST_ASSERT_TRUE(parseMethodTopic(topic, method, sizeof(method), requestId, sizeof(requestId)));
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  TEST_ASSERT_FALSE(player.corrupt);
+  TEST_ASSERT_EQUAL(traceLength, player.offset);
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_FULL, firstLevel);
+  TEST_ASSERT_EQUAL(FOOD_LEVEL_HALF, lastLevel);
+  TEST_ASSERT_TRUE(feedDueSeen); // Cat arrived at 07:59:50, inside the 08:00 window
+  TEST_ASSERT_EQUAL_STRING("runMotors", method);
+  TEST_ASSERT_EQUAL_STRING("17", requestId);
+  TEST_ASSERT_EQUAL(1, meals);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 18.0f, meal.gramsEaten);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 42.0f, meal.endWeight);
+  TEST_ASSERT_TRUE(presentAfterPirLow);
+  TEST_ASSERT_EQUAL(1, visits); // Over PIR_TIMEOUT after the last motion
+  TEST_ASSERT_FALSE(core.presence.active);
+}
+
+static uint64_t nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// A day at the idle sampling rates (weight every 2 s, level every minute)
+// with a visit and a 10 g meal every two hours, replayed for throughput
+static void test_replay_day_throughput(void)
+{
+  static uint8_t day[262144];
+  size_t length = traceEncodeHeader(encoder, day, 0, 0);
+  float grams = 80.0f;
+  for (uint32_t ms = 0; ms < 24UL * 3600 * 1000; ms += 2000)
+  {
+    uint32_t inCycle = ms % 7200000;
+    if (inCycle == 3600000)
+      length += traceEncodePir(encoder, day + length, ms, true);
+    if (inCycle == 3620000)
+      length += traceEncodePir(encoder, day + length, ms, false);
+    if (inCycle > 3600000 && inCycle <= 3620000)
+      grams -= 0.5f; // 10 g over the 20 s at the bowl
+    if (inCycle == 0)
+      grams = 80.0f;
+    length += traceEncodeScaleRaw(encoder, day + length, ms, OFFSET + (int32_t)(grams * SCALE));
+    if (ms % 60000 == 0)
+      length += traceEncodeEcho(encoder, day + length, ms, 600);
+    TEST_ASSERT_TRUE(length + TRACE_RECORD_MAX < sizeof(day));
+  }
+
+  const int passes = 20;
+  unsigned long records = 0, meals = 0, visits = 0;
+  uint64_t start = nowNs();
+  for (int pass = 0; pass < passes; pass++)
+  {
+    SensorCore core;
+    TraceReplayEvents events;
+    TracePlayer player;
+    TraceRecord record;
+    TEST_ASSERT_TRUE(traceOpen(player, day, length));
+    while (traceNext(player, record))
+    {
+      traceReplayRecord(core, record, OFFSET, SCALE, events);
+      records++;
+      meals += events.mealEnded;
+      visits += events.visitEnded;
+    }
+    TEST_ASSERT_FALSE(player.corrupt);
+  }
+  double seconds = (nowNs() - start) / 1e9;
+  double hours = 24.0 * passes;
+  printf("replay: %lu records, %.0f simulated hours in %.3f s (%.0f simulated h/s)\n", records,
+         hours, seconds, hours / seconds);
+
+  TEST_ASSERT_EQUAL_UINT32(12 * passes, meals);
+  TEST_ASSERT_EQUAL_UINT32(12 * passes, visits);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_varint_and_zigzag_round_trip);
+  RUN_TEST(test_records_round_trip);
+  RUN_TEST(test_bad_header_rejected);
+  RUN_TEST(test_truncated_trace_stops_cleanly);
+  RUN_TEST(test_unknown_record_type_stops);
+  RUN_TEST(test_replay_session_through_cores);
+  RUN_TEST(test_replay_day_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,307 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "web_server_core.h"
+
+// Simulated browsers: each has a bounded send queue like AsyncWebSocket's
+// (WS_MAX_QUEUED_MESSAGES) and drains a number of frames per stream tick
+#define SIM_QUEUE 8
+#define SIM_CLIENTS 64
+
+struct SimClient
+{
+  bool connected;
+  int queued;
+  int drainPerTick; // 0 = stalled browser
+  unsigned long received;
+  unsigned long lastT;
+  bool outOfOrder;
+};
+
+static SimClient sim[SIM_CLIENTS];
+static unsigned long sendCalls;
+
+void setUp(void)
+{
+  memset(sim, 0, sizeof(sim));
+  sendCalls = 0;
+}
+void tearDown(void) {}
+
+static WebSendResult simSend(void *context, uint32_t clientId, const char *frame, size_t length)
+{
+  sendCalls++;
+  SimClient &client = sim[clientId];
+  // Same decision as the firmware's sendToClient()
+  WebSendResult result = webSendResultFor(client.connected, client.queued >= SIM_QUEUE);
+  if (result != WEB_SEND_OK)
+    return result;
+  client.queued++;
+
+  unsigned long t = 0;
+  sscanf(frame, "{\"t\":%lu", &t);
+  if (client.received > 0 && t <= client.lastT)
+    client.outOfOrder = true;
+  client.lastT = t;
+  client.received++;
+  return WEB_SEND_OK;
+}
+
+static void drainClients()
+{
+  for (int i = 0; i < SIM_CLIENTS; i++)
+  {
+    sim[i].queued -= sim[i].drainPerTick;
+    if (sim[i].queued < 0)
+      sim[i].queued = 0;
+  }
+}
+
+// One 100 ms stream tick: format a sample and fan it out
+static void streamTick(const WebClientTable &clients, unsigned long uptimeMs, WebServerStats &stats)
+{
+  WebSnapshot s;
+  memset(&s, 0, sizeof(s));
+  s.uptimeMs = uptimeMs;
+  s.weight = 42.5f;
+  s.distance = 12.0f;
+  s.foodLevel = FOOD_LEVEL_HALF;
+  s.bowlStatus = BOWL_STATUS_PARTIAL;
+
+  char frame[WEB_FRAME_MAX];
+  int len = formatStreamFrame(frame, sizeof(frame), s);
+  webFanOut(clients, frame, len, simSend, nullptr, stats);
+  drainClients();
+}
+
+static void test_client_limit(void)
+{
+  WebClientTable table = {};
+  for (uint32_t id = 0; id < WEB_MAX_CLIENTS; id++)
+    TEST_ASSERT_TRUE(webClientAdmit(table, id));
+  TEST_ASSERT_FALSE(webClientAdmit(table, 99));
+  TEST_ASSERT_EQUAL(WEB_MAX_CLIENTS, table.count);
+
+  TEST_ASSERT_TRUE(webClientRemove(table, 1));
+  TEST_ASSERT_FALSE(webClientRemove(table, 1));
+  TEST_ASSERT_FALSE(webClientRemove(table, 99)); // Refused ones were never added
+  TEST_ASSERT_TRUE(webClientAdmit(table, 99));
+  TEST_ASSERT_FALSE(webClientAdmit(table, 100));
+}
+
+// The widest values still fit the frame and remain valid JSON
+static void test_frame_fits(void)
+{
+  WebSnapshot s;
+  memset(&s, 0, sizeof(s));
+  s.uptimeMs = 0xFFFFFFFFUL;
+  s.weight = -99999.9f;
+  s.distance = 99999.9f;
+  s.foodLevel = (FoodLevel)7;
+  s.bowlStatus = (BowlStatus)7;
+  s.motion = true;
+  s.dispensing = true;
+
+  char frame[WEB_FRAME_MAX];
+  int len = formatStreamFrame(frame, sizeof(frame), s);
+  TEST_ASSERT_GREATER_THAN(0, len);
+  TEST_ASSERT_LESS_THAN(WEB_FRAME_MAX, len);
+  TEST_ASSERT_EQUAL(len, (int)strlen(frame));
+  TEST_ASSERT_EQUAL('}', frame[len - 1]);
+  TEST_ASSERT_NOT_NULL(strstr(frame, "\"l\":\"UNKNOWN\""));
+}
+
+// The refusal path: past the limit a connect is refused and counted, and
+// its disconnect event leaves the admitted clients alone
+static void test_connect_refused_past_limit(void)
+{
+  WebClientTable table = {};
+  WebServerStats stats;
+  for (uint32_t id = 0; id < WEB_MAX_CLIENTS; id++)
+    TEST_ASSERT_TRUE(webClientConnect(table, id, stats));
+  TEST_ASSERT_EQUAL(WEB_MAX_CLIENTS, stats.clients);
+
+  TEST_ASSERT_FALSE(webClientConnect(table, 50, stats));
+  TEST_ASSERT_EQUAL_UINT32(1, stats.rejected);
+  TEST_ASSERT_EQUAL(WEB_MAX_CLIENTS, stats.clients);
+  webClientDisconnect(table, 50, stats);
+  TEST_ASSERT_EQUAL(WEB_MAX_CLIENTS, stats.clients);
+
+  webClientDisconnect(table, 0, stats);
+  TEST_ASSERT_EQUAL(WEB_MAX_CLIENTS - 1, stats.clients);
+  TEST_ASSERT_TRUE(webClientConnect(table, 50, stats));
+  TEST_ASSERT_EQUAL_UINT32(1, stats.rejected);
+}
+
+// GET /status with the widest values still fits and carries the counters
+static void test_status_fits(void)
+{
+  WebSnapshot s;
+  memset(&s, 0, sizeof(s));
+  s.uptimeMs = 0xFFFFFFFFUL;
+  s.weight = -99999.9f;
+  s.distance = 99999.9f;
+  s.dailyFoodDispensed = 99999.9f;
+  s.foodLevel = (FoodLevel)7;
+  s.bowlStatus = (BowlStatus)7;
+  s.feedingStatus = (FeedingStatus)7;
+  s.motion = true;
+  WebServerStats stats;
+  stats.clients = WEB_MAX_CLIENTS;
+  stats.framesDropped = 0xFFFFFFFFUL;
+
+  char json[WEB_STATUS_MAX];
+  int len = formatStatusJson(json, sizeof(json), s, stats);
+  TEST_ASSERT_GREATER_THAN(0, len);
+  TEST_ASSERT_LESS_THAN(WEB_STATUS_MAX, len);
+  TEST_ASSERT_EQUAL(len, (int)strlen(json));
+  TEST_ASSERT_EQUAL('}', json[len - 1]);
+  TEST_ASSERT_NOT_NULL(strstr(json, "\"motion\":true,\"dispensing\":false"));
+  TEST_ASSERT_NOT_NULL(strstr(json, "\"clients\":4,\"framesDropped\":4294967295}"));
+}
+
+static void test_send_result(void)
+{
+  TEST_ASSERT_EQUAL(WEB_SEND_OK, webSendResultFor(true, false));
+  TEST_ASSERT_EQUAL(WEB_SEND_FULL, webSendResultFor(true, true));
+  TEST_ASSERT_EQUAL(WEB_SEND_GONE, webSendResultFor(false, false));
+  TEST_ASSERT_EQUAL(WEB_SEND_GONE, webSendResultFor(false, true));
+}
+
+// A stalled browser loses frames; the others still get every one
+static void test_slow_client_drops_alone(void)
+{
+  WebClientTable table = {};
+  WebServerStats stats;
+  for (uint32_t id = 0; id < WEB_MAX_CLIENTS; id++)
+  {
+    webClientAdmit(table, id);
+    sim[id].connected = true;
+    sim[id].drainPerTick = id == 2 ? 0 : 1;
+  }
+
+  const int ticks = 600; // One minute at 10 Hz
+  for (int tick = 0; tick < ticks; tick++)
+    streamTick(table, tick * 100UL, stats);
+
+  for (uint32_t id = 0; id < WEB_MAX_CLIENTS; id++)
+  {
+    TEST_ASSERT_LESS_OR_EQUAL(SIM_QUEUE, sim[id].queued);
+    TEST_ASSERT_FALSE(sim[id].outOfOrder);
+    if (id != 2)
+      TEST_ASSERT_EQUAL_UINT32(ticks, sim[id].received);
+  }
+  TEST_ASSERT_EQUAL_UINT32(SIM_QUEUE, sim[2].received);
+  TEST_ASSERT_EQUAL_UINT32(ticks - SIM_QUEUE, stats.framesDropped);
+  TEST_ASSERT_EQUAL_UINT32((WEB_MAX_CLIENTS - 1) * ticks + SIM_QUEUE, stats.framesSent);
+}
+
+// A client that catches up receives again; nothing was buffered for it
+static void test_backpressure_recovers(void)
+{
+  WebClientTable table = {};
+  WebServerStats stats;
+  webClientAdmit(table, 0);
+  sim[0].connected = true;
+
+  for (int tick = 0; tick < 50; tick++)
+    streamTick(table, tick * 100UL, stats);
+  TEST_ASSERT_EQUAL_UINT32(SIM_QUEUE, stats.framesSent);
+
+  sim[0].drainPerTick = SIM_QUEUE; // Browser wakes up and empties its queue
+  streamTick(table, 5000, stats);  // Drains after the send: still full here
+  streamTick(table, 5100, stats);
+  streamTick(table, 5200, stats);
+  TEST_ASSERT_EQUAL_UINT32(SIM_QUEUE + 2, stats.framesSent);
+  TEST_ASSERT_EQUAL_UINT32(5200, sim[0].lastT);
+  TEST_ASSERT_FALSE(sim[0].outOfOrder);
+}
+
+// Closed between the table copy and the send: neither sent nor dropped
+static void test_gone_client_not_counted(void)
+{
+  WebClientTable table = {};
+  WebServerStats stats;
+  webClientAdmit(table, 0);
+  webClientAdmit(table, 1);
+  sim[0].connected = true;
+  sim[0].drainPerTick = 1;
+
+  streamTick(table, 0, stats);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.framesSent);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.framesDropped);
+}
+
+// Many browsers connecting and leaving at random, some of them stalled:
+// the table never exceeds the limit, every tick costs at most one send per
+// admitted client, and no queue grows past its bound
+static void test_load_many_clients(void)
+{
+  WebClientTable table = {};
+  WebServerStats stats;
+  uint32_t seed = 12345;
+  unsigned long refused = 0, admitted = 0;
+
+  const int ticks = 36000; // One hour at 10 Hz
+  for (int tick = 0; tick < ticks; tick++)
+  {
+    seed = seed * 1103515245 + 12345;
+    uint32_t id = (seed >> 8) % SIM_CLIENTS;
+    if ((seed >> 20) % 4 == 0)
+    {
+      if (!sim[id].connected)
+      {
+        sim[id].connected = true;
+        sim[id].queued = 0;
+        sim[id].received = 0;
+        sim[id].drainPerTick = (seed >> 24) % 3; // 0, 1 or 2 frames per tick
+        if (webClientConnect(table, id, stats))
+          admitted++;
+        else
+        {
+          refused++;
+          sim[id].connected = false; // Closed with WEB_CLOSE_TRY_AGAIN
+          webClientDisconnect(table, id, stats);
+        }
+      }
+      else
+      {
+        sim[id].connected = false;
+        webClientDisconnect(table, id, stats);
+      }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(WEB_MAX_CLIENTS, table.count);
+    TEST_ASSERT_EQUAL(table.count, stats.clients);
+
+    unsigned long before = sendCalls;
+    streamTick(table, tick * 100UL, stats);
+    TEST_ASSERT_EQUAL_UINT32(table.count, sendCalls - before);
+  }
+
+  for (int i = 0; i < SIM_CLIENTS; i++)
+  {
+    TEST_ASSERT_LESS_OR_EQUAL(SIM_QUEUE, sim[i].queued);
+    TEST_ASSERT_FALSE(sim[i].outOfOrder);
+  }
+  TEST_ASSERT_GREATER_THAN(0, refused);
+  TEST_ASSERT_EQUAL_UINT32(refused, stats.rejected);
+  TEST_ASSERT_GREATER_THAN(0, stats.framesDropped);
+  TEST_ASSERT_EQUAL_UINT32(sendCalls, stats.framesSent + stats.framesDropped);
+  printf("load: %lu admitted, %lu refused, %lu frames sent, %lu dropped\n", admitted, refused,
+         stats.framesSent, stats.framesDropped);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_client_limit);
+  RUN_TEST(test_frame_fits);
+  RUN_TEST(test_connect_refused_past_limit);
+  RUN_TEST(test_status_fits);
+  RUN_TEST(test_send_result);
+  RUN_TEST(test_slow_client_drops_alone);
+  RUN_TEST(test_backpressure_recovers);
+  RUN_TEST(test_gone_client_not_counted);
+  RUN_TEST(test_load_many_clients);
+  return UNITY_END();
+}
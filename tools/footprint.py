@@ -0,0 +1,117 @@
+# Per-module RAM, flash and stack report, run by PlatformIO after every link
+#
+# .data/.bss/flash per module come from the object files (size -A); the
+# largest stack frame per module comes from the .su files written by
+# -fstack-usage. Budgets are bytes. Modules over budget are flagged; with
+# custom_footprint_strict = yes in the environment they also fail the build.
+
+Import("env")
+
+import glob
+import os
+import subprocess
+
+DEFAULT_BUDGET = {"ram": 2048, "frame": 768}
+BUDGETS = {
+    "logger": {"ram": 6144},           # 32-slot message ring
+    "trace_recorder": {"ram": 5120},   # 4 KB staging buffer
+    "json_pool": {"ram": 2304},        # Shared loop-task JSON document and text
+    "network_manager": {"ram": 4096},  # TLS client and held telemetry events
+    "gateway": {"ram": 3072},          # Batch buffer and local broker client
+    "history_store": {"ram": 31744},   # 2526 twelve-byte points across three tiers
+    "dispense_capture": {"ram": 13312}, # 1024-sample ring
+}
+
+DEBUG_PREFIXES = (".debug", ".comment", ".xt.", ".xtensa", ".note", ".group", ".rela")
+
+
+def classify(section):
+    if section.startswith(DEBUG_PREFIXES):
+        return None
+    if section.startswith((".data", ".dram")):
+        return "data"
+    if section.startswith((".bss", "COMMON")):
+        return "bss"
+    if section.startswith(".iram"):
+        return "iram"
+    if section.startswith((".text", ".literal", ".rodata", ".flash")):
+        return "flash"
+    return None
+
+
+def section_sizes(size_tool, obj):
+    sizes = {"data": 0, "bss": 0, "iram": 0, "flash": 0}
+    out = subprocess.run([size_tool, "-A", obj], capture_output=True, text=True).stdout
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) < 2 or not fields[1].isdigit():
+            continue
+        kind = classify(fields[0])
+        if kind:
+            sizes[kind] += int(fields[1])
+    return sizes
+
+
+def worst_frame(su_file):
+    worst = (0, "")
+    with open(su_file) as f:
+        for line in f:
+            parts = line.rstrip("\n").rsplit("\t", 2)
+            if len(parts) != 3 or not parts[1].isdigit():
+                continue
+            function = parts[0].split(":", 3)[-1]
+            if int(parts[1]) > worst[0]:
+                worst = (int(parts[1]), function)
+    return worst
+
+
+def module_name(path):
+    name = os.path.basename(path)
+    for suffix in (".o", ".su", ".cpp", ".c"):
+        if name.endswith(suffix):
+            name = name[: -len(suffix)]
+    return name
+
+
+def report(source, target, env):
+    build_src = os.path.join(env.subst("$BUILD_DIR"), "src")
+    size_tool = env.subst("$SIZETOOL")
+    strict = env.GetProjectOption("custom_footprint_strict", "no") == "yes"
+
+    frames = {module_name(su): worst_frame(su) for su in glob.glob(os.path.join(build_src, "*.su"))}
+
+    rows = []
+    for obj in sorted(glob.glob(os.path.join(build_src, "*.o"))):
+        name = module_name(obj)
+        sizes = section_sizes(size_tool, obj)
+        frame, function = frames.get(name, (0, ""))
+        budget = dict(DEFAULT_BUDGET, **BUDGETS.get(name, {}))
+        ram = sizes["data"] + sizes["bss"]
+        over = []
+        if ram > budget["ram"]:
+            over.append("ram>%d" % budget["ram"])
+        if frame > budget["frame"]:
+            over.append("frame>%d" % budget["frame"])
+        rows.append((name, sizes, frame, function, over))
+
+    print("\nFootprint per module (bytes)")
+    print("%-18s %6s %6s %6s %7s %6s  %s" % ("module", "data", "bss", "iram", "flash", "frame", "largest frame"))
+    totals = {"data": 0, "bss": 0, "iram": 0, "flash": 0}
+    failed = 0
+    for name, sizes, frame, function, over in rows:
+        for kind in totals:
+            totals[kind] += sizes[kind]
+        flag = "  OVER " + ",".join(over) if over else ""
+        failed += 1 if over else 0
+        print("%-18s %6d %6d %6d %7d %6d  %s%s" % (name, sizes["data"], sizes["bss"], sizes["iram"],
+                                                   sizes["flash"], frame, function[:40], flag))
+    print("%-18s %6d %6d %6d %7d" % ("total (src/)", totals["data"], totals["bss"], totals["iram"],
+                                     totals["flash"]))
+
+    if failed:
+        print("%d module(s) over budget (tools/footprint.py)" % failed)
+        if strict:
+            env.Exit(1)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
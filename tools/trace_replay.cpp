@@ -0,0 +1,145 @@
+// Host-side trace player
+// Reads a trace uploaded with the "trace" method ({"action":"upload"}, pages
+// joined in order), prints every record and replays it through the sensor
+// steps the firmware runs (traceReplayRecord): hopper level from the echo
+// times, bowl weight and meals from the HX711 counts (with the calibration
+// from the "calibrate" method), visits from the PIR edges, and
+// direct-method topics. Ends with the replay speed in simulated hours per
+// second; -q leaves out the per-record lines so that measures the cores.
+//
+//   g++ -std=gnu++11 -O2 -Iinclude tools/trace_replay.cpp src/*_core.cpp -o trace_replay
+//   ./trace_replay [-q] trace.bin [offset scale]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "trace_recorder_core.h"
+#include "sensor_manager_core.h"
+#include "network_manager_core.h"
+
+static double monotonicSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  bool quiet = argc > 1 && strcmp(argv[1], "-q") == 0;
+  if (quiet)
+  {
+    argv++;
+    argc--;
+  }
+  if (argc != 2 && argc != 4)
+  {
+    fprintf(stderr, "usage: %s [-q] trace.bin [offset scale]\n", argv[0]);
+    return 2;
+  }
+
+  FILE *file = fopen(argv[1], "rb");
+  if (file == nullptr)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    data.insert(data.end(), chunk, chunk + n);
+  fclose(file);
+
+  // Without a calibration, weights are reported in raw counts
+  long offset = argc == 4 ? atol(argv[2]) : 0;
+  float scale = argc == 4 ? (float)atof(argv[3]) : 1.0f;
+  if (scale == 0.0f)
+  {
+    fprintf(stderr, "scale cannot be zero\n");
+    return 2;
+  }
+
+  TracePlayer player;
+  if (!traceOpen(player, data.data(), data.size()))
+  {
+    fprintf(stderr, "%s: not a version %d trace\n", argv[1], TRACE_VERSION);
+    return 1;
+  }
+  printf("trace: %u bytes, epoch %lu, millis %lu\n", (unsigned)data.size(),
+         (unsigned long)player.epoch, (unsigned long)player.startMillis);
+
+  SensorCore core;
+  TraceReplayEvents events;
+  int level = -1;
+  unsigned long records = 0;
+  uint32_t lastMillis = player.startMillis;
+  double started = monotonicSeconds();
+  TraceRecord record;
+  while (traceNext(player, record))
+  {
+    records++;
+    lastMillis = record.millis;
+    double seconds = (uint32_t)(record.millis - player.startMillis) / 1000.0;
+    traceReplayRecord(core, record, offset, scale, events);
+
+    if (events.visitEnded)
+      printf("%10.3f VISIT  %lu s, %u motion pulses, bowl %+.1f\n", seconds,
+             (unsigned long)(events.visit.durationMs / 1000), events.visit.motionEdges,
+             -events.visit.bowlDeltaGrams);
+    if (!quiet)
+    {
+      switch (record.type)
+      {
+      case TRACE_HX711:
+        printf("%10.3f hx711  %ld (%.1f)\n", seconds, (long)record.scaleRaw, core.weight);
+        break;
+      case TRACE_ECHO:
+        printf("%10.3f echo   %lu us\n", seconds, (unsigned long)record.echoMicros);
+        break;
+      case TRACE_PIR:
+        printf("%10.3f pir    %d\n", seconds, record.level);
+        break;
+      case TRACE_BUTTON:
+        printf("%10.3f button %u level %d\n", seconds, record.button, record.level);
+        break;
+      case TRACE_MQTT:
+        printf("%10.3f mqtt   %.*s %.*s\n", seconds, (int)record.topicLength, record.topic,
+               (int)record.payloadLength, (const char *)record.payload);
+        break;
+      default:
+        break;
+      }
+    }
+    if (events.mealEnded)
+      printf("%10.3f MEAL   %.1f g in %lu s, peak %.2f g/min\n", seconds, events.meal.gramsEaten,
+             (events.meal.endMillis - events.meal.startMillis) / 1000, events.meal.peakRate);
+    if (events.levelRead && core.foodLevel != level)
+    {
+      printf("%10.3f LEVEL  %s (%.1f cm)\n", seconds, getFoodLevelName(core.foodLevel), core.distance);
+      level = core.foodLevel;
+    }
+    if (record.type == TRACE_MQTT)
+    {
+      char topic[TRACE_TOPIC_MAX + 1];
+      memcpy(topic, record.topic, record.topicLength);
+      topic[record.topicLength] = '\0';
+      char method[32], requestId[40];
+      if (parseMethodTopic(topic, method, sizeof(method), requestId, sizeof(requestId)))
+        printf("%10.3f METHOD %s rid=%s\n", seconds, method, requestId);
+    }
+  }
+  double elapsed = monotonicSeconds() - started;
+
+  double hours = (uint32_t)(lastMillis - player.startMillis) / 3600000.0;
+  printf("%lu records, %.2f simulated hours in %.3f s (%.0f simulated h/s)\n", records, hours,
+         elapsed, elapsed > 0 ? hours / elapsed : 0.0);
+  if (player.corrupt)
+  {
+    fprintf(stderr, "stopped at byte %u: truncated or corrupt record\n", (unsigned)player.offset);
+    return 1;
+  }
+  return 0;
+}